@@ -11,11 +11,9 @@ runexperiment() {
 
     echo "nid $1" >> $EXP_FILE
 
-    I=$((40320 + 60))
-    while [ $I -le $((2 * 40320)) ]; do
-        echo "t= $I"
-        I=$(($I + 60))
-    done >> $EXP_FILE
+    # Record the outputs every hour for the next four weeks.
+    echo "every= 60 40320" >> $EXP_FILE
+    echo "t= $((2 * 40320))" >> $EXP_FILE
 
     echo "$1 ..."
     $MODEL -n $EXP_FILE > $OUT_FILE
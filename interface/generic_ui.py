@@ -5,7 +5,7 @@ class GenericUI():
     def __init__(self, argv):
         self.api = load_api()
         self.simThread = SimulationThread(self.api, self.update_plots_ui,
-                                          delay=0.05)
+                                          delay=0.05, telemetry=True)
 
     def api(self):
         return self.api
@@ -15,6 +15,7 @@ class GenericUI():
 
     def quit(self, *args):
         self.simThread.stop()
+        self.simThread.close()
         self.quit_ui(*args)
 
     def pause_simulation(self, *args):
@@ -40,6 +40,35 @@ class ModelAPI:
     def step(self, p, v, e):
         return self.lib.guyton92_step(p, v, e)
 
+    def ctx(self, p, v, e=None):
+        return self.lib.guyton92_ctx(p, v, e)
+
+    def ctx_delete(self, ctx):
+        return self.lib.guyton92_ctx_delete(ctx)
+
+    def handle(self, name):
+        return self.lib.guyton92_handle(name)
+
+    def run_until(self, ctx, t_end, max_steps=0):
+        return self.lib.guyton92_run_until(ctx, t_end, max_steps)
+
+    def run_sampled(self, ctx, times, handles, out):
+        return self.lib.guyton92_run_sampled(ctx, times, len(times),
+                                             handles, len(handles), out)
+
+    def run_gradient(self, ctx, mode, params, times, handles, out, grad):
+        return self.lib.guyton92_run_gradient(ctx, mode, params, len(params),
+                                              times, len(times), handles,
+                                              len(handles), out, grad)
+
+    def telemetry_open(self, name, names=None, slots=0, interval=0):
+        if names is not None:
+            names = ",".join(names)
+        return self.lib.guyton92_telemetry_open(name, names, slots, interval)
+
+    def telemetry_close(self, channel):
+        return self.lib.guyton92_telemetry_close(channel)
+
     def exp_file_stream(self, filename):
         return self.lib.exp_file_stream(filename)
 
@@ -64,6 +93,9 @@ class ModelAPI:
     def exp_output_var(self, exp, ix):
         return self.lib.exp_output_var(exp, ix)
 
+    def exp_set_exact_times(self, exp, enable):
+        return self.lib.exp_set_exact_times(exp, enable)
+
     def exp_output_times(self, exp):
         return self.lib.exp_output_times(exp)
 
@@ -87,6 +119,37 @@ class ModelAPI:
         # step()
         lib.guyton92_step.argtypes = [PPARAMS, PVARS, c_void_p]
         lib.guyton92_step.restype = None
+        # guyton92_ctx()
+        lib.guyton92_ctx.argtypes = [PPARAMS, PVARS, c_void_p]
+        lib.guyton92_ctx.restype = c_void_p
+        # guyton92_ctx_delete()
+        lib.guyton92_ctx_delete.argtypes = [c_void_p]
+        lib.guyton92_ctx_delete.restype = None
+        # guyton92_handle()
+        lib.guyton92_handle.argtypes = [c_char_p]
+        lib.guyton92_handle.restype = c_int
+        # guyton92_run_until()
+        lib.guyton92_run_until.argtypes = [c_void_p, c_double, c_ulong]
+        lib.guyton92_run_until.restype = c_ulong
+        # guyton92_run_sampled()
+        lib.guyton92_run_sampled.argtypes = [c_void_p, POINTER(c_double),
+                                             c_ulong, POINTER(c_int), c_int,
+                                             POINTER(c_double)]
+        lib.guyton92_run_sampled.restype = c_ulong
+        # guyton92_run_gradient()
+        lib.guyton92_run_gradient.argtypes = [c_void_p, c_int, POINTER(c_int),
+                                              c_int, POINTER(c_double),
+                                              c_ulong, POINTER(c_int), c_int,
+                                              POINTER(c_double),
+                                              POINTER(c_double)]
+        lib.guyton92_run_gradient.restype = c_ulong
+        # guyton92_telemetry_open()
+        lib.guyton92_telemetry_open.argtypes = [c_char_p, c_char_p, c_ulong,
+                                                c_double]
+        lib.guyton92_telemetry_open.restype = c_void_p
+        # guyton92_telemetry_close()
+        lib.guyton92_telemetry_close.argtypes = [c_void_p]
+        lib.guyton92_telemetry_close.restype = None
         # exp_file_stream()
         lib.exp_file_stream.argtypes = [c_char_p]
         lib.exp_file_stream.restype = c_void_p
@@ -111,6 +174,9 @@ class ModelAPI:
         # exp_output_var()
         lib.exp_output_var.argtypes = [c_void_p, c_uint]
         lib.exp_output_var.restype = c_char_p
+        # exp_set_exact_times()
+        lib.exp_set_exact_times.argtypes = [c_void_p, c_bool]
+        lib.exp_set_exact_times.restype = None
         # exp_output_times()
         lib.exp_output_times.argtypes = [c_void_p]
         lib.exp_output_times.restype = POINTER(c_double)
@@ -131,10 +197,9 @@ def run_simulation(api, t_end=21590, p=None):
 
     #print "0", "-->", t_end
 
-    while (cv.t < t_end):
-        #prev_t = cv.t
-        api.step(p, v, None)
-        #print prev_t, "-->", cv.t
+    ctx = api.ctx(p, v, None)
+    api.run_until(ctx, t_end)
+    api.ctx_delete(ctx)
 
     return cv
 
@@ -165,6 +230,9 @@ class ModelExperiment:
             output_vars.append(self.api.exp_output_var(self.exp, i))
         return output_vars
 
+    def set_exact_times(self, enable=True):
+        return self.api.exp_set_exact_times(self.exp, enable)
+
     def output_times(self):
         times = self.api.exp_output_times(self.exp)
         sentinel = self.api.exp_sentinel_time(self.exp)
@@ -176,6 +244,12 @@ class ModelExperiment:
     def step(self, v):
         self.api.step(self.params, v, self.exp)
 
+    def run_until(self, v, t_end, max_steps=0):
+        ctx = self.api.ctx(self.params, v, self.exp)
+        steps = self.api.run_until(ctx, t_end, max_steps)
+        self.api.ctx_delete(ctx)
+        return steps
+
 def run_experiment(api, exp_file="../exps/hypertension.exp", p=None):
     exp_file = this_dir(exp_file)
     if p is None:
@@ -189,9 +263,75 @@ def run_experiment(api, exp_file="../exps/hypertension.exp", p=None):
     v = api.new_vars()
     cv = v.contents
 
-    while (cv.t < t_end):
-        #prev_t = cv.t
-        exp.step(v)
-        #print prev_t, "-->", cv.t
+    exp.run_until(v, t_end)
 
     return cv
+
+def run_sampled(api, p, v, times, names, e=None):
+    """Run the model until each of the sample times is reached in turn, and
+    return the value of each named variable (or parameter) at these times.
+
+    The samples are written directly into a single contiguous buffer, which
+    is returned as an (n x k) NumPy array if NumPy is available, and as a
+    flat ctypes array (in row-major order) otherwise.
+    """
+    n = len(times)
+    k = len(names)
+    handles = (c_int * k)(*[api.handle(name) for name in names])
+    for (name, handle) in zip(names, handles):
+        if handle < 0:
+            raise ValueError("Unknown variable or parameter '%s'" % (name,))
+    c_times = (c_double * n)(*times)
+    try:
+        import numpy
+        out = numpy.empty((n, k))
+        c_out = out.ctypes.data_as(POINTER(c_double))
+    except ImportError:
+        out = (c_double * (n * k))()
+        c_out = out
+    ctx = api.ctx(p, v, e)
+    api.run_sampled(ctx, c_times, handles, c_out)
+    api.ctx_delete(ctx)
+    return out
+
+def run_gradient(api, p, v, times, names, params, mode="forward", e=None):
+    """Run the model until each of the sample times is reached in turn, and
+    return the value of each named variable (or parameter) at these times,
+    and its derivative with respect to each named parameter.
+
+    The mode is either "forward" (which is cheaper for few parameters) or
+    "adjoint" (which is cheaper for few outputs and sample times). The
+    derivatives are returned as an (n x k x m) NumPy array if NumPy is
+    available, and as a flat ctypes array (in row-major order) otherwise.
+    """
+    modes = {"forward": 0, "adjoint": 1}
+    if mode not in modes:
+        raise ValueError("Unknown gradient mode '%s'" % (mode,))
+    n = len(times)
+    k = len(names)
+    m = len(params)
+    handles = (c_int * k)(*[api.handle(name) for name in names])
+    for (name, handle) in zip(names, handles):
+        if handle < 0:
+            raise ValueError("Unknown variable or parameter '%s'" % (name,))
+    phandles = (c_int * m)(*[api.handle(name) for name in params])
+    for (name, handle) in zip(params, phandles):
+        if handle < len(struct_fields(v)):
+            raise ValueError("Unknown parameter '%s'" % (name,))
+    c_times = (c_double * n)(*times)
+    try:
+        import numpy
+        out = numpy.empty((n, k))
+        grad = numpy.empty((n, k, m))
+        c_out = out.ctypes.data_as(POINTER(c_double))
+        c_grad = grad.ctypes.data_as(POINTER(c_double))
+    except ImportError:
+        out = (c_double * (n * k))()
+        grad = (c_double * (n * k * m))()
+        c_out = out
+        c_grad = grad
+    ctx = api.ctx(p, v, e)
+    api.run_gradient(ctx, modes[mode], phandles, c_times, handles, c_out,
+                     c_grad)
+    api.ctx_delete(ctx)
+    return (out, grad)
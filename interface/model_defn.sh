@@ -10,7 +10,7 @@
 OUTFILE=model_defn.py
 
 PARAMS_LIST="../src/params.lst"
-VARS_LIST="../src/vars.lst"
+VARS_HEADER="../src/vars.h"
 
 #
 # Ensure that the necessary data files can be read.
@@ -21,8 +21,9 @@ if [ ! -r ${PARAMS_LIST} ]; then
     exit 2
 fi
 
-if [ ! -r ${VARS_LIST} ]; then
-    echo "ERROR: variables file ${VARS_LIST} is not readable."
+# The variables are ordered by the generated header (see ../src/vars.sh).
+if [ ! -r ${VARS_HEADER} ]; then
+    echo "ERROR: variables header ${VARS_HEADER} is not readable."
     exit 2
 fi
 
@@ -59,7 +60,9 @@ echo '' >> ${OUTFILE}
 echo 'class MVARS(Structure):' >> ${OUTFILE}
 echo '  """The model variables."""' >> ${OUTFILE}
 echo '  _fields_ = [' >> ${OUTFILE}
-# Print each variable as: '    ("name", c_double),'.
-cat ${VARS_LIST} |
+# Print each variable, in the order of the VARS_T fields (as listed by the
+# VARS_ALL macro), as: '    ("name", c_double),'.
+sed -n 's/^#define VARS_ALL(X) //p' ${VARS_HEADER} | tr ' ' '\n' |
+  sed -n 's/^X(\(.*\))$/\1/p' |
   awk '{ print "    (\"" $1 "\", c_double)," }' >> ${OUTFILE}
 echo '  ]' >> ${OUTFILE}
@@ -1,23 +1,58 @@
-from time import sleep
+import os
+from time import sleep, time
 
 from threads import StoppableThread
 from model_api import ModelExperiment
 from model_defn import MPARAMS, MVARS
+from telemetry import open_telemetry
 
 class SimulationThread(StoppableThread):
-    def __init__(self, api, callback, mpars=None, mvars=None, delay=None):
+    """Run the model in a separate thread.
+
+    By default, the model is advanced one step at a time and the callback is
+    invoked after every step, followed by a delay. If telemetry is enabled,
+    the model instead runs at full speed (batch_steps at a time) and
+    publishes a snapshot of every state variable once every interval minutes
+    in a shared-memory telemetry channel; the callback is then invoked at
+    most once every delay seconds, and should use history() to obtain the
+    latest values.
+    """
+    def __init__(self, api, callback, mpars=None, mvars=None, delay=None,
+                 telemetry=False, interval=1.0, batch_steps=1000):
         StoppableThread.__init__(self)
         self.api = api
         self.callback = callback
         self.experiment = None
+        self.channel = None
+        self.telemetry = None
+        self.ctx = None
+        self.batch_steps = batch_steps
+        self.last_update = 0
 
         if delay is None:
             self.delay = 0.25
         else:
             self.delay = delay
 
+        if telemetry:
+            name = "/guyton92-%d" % (os.getpid(),)
+            self.channel = api.telemetry_open(name.encode(), None, 0,
+                                              interval)
+            if self.channel:
+                self.telemetry = open_telemetry(name)
+
         self.reset()
 
+    def close(self):
+        if self.ctx is not None:
+            self.api.ctx_delete(self.ctx)
+            self.ctx = None
+        if self.telemetry is not None:
+            self.telemetry.close()
+            self.api.telemetry_close(self.channel)
+            self.telemetry = None
+            self.channel = None
+
     def param_names(self):
         return self.api.param_names()
 
@@ -39,6 +74,15 @@ class SimulationThread(StoppableThread):
         self.cvars = self.mvars.contents
 
         self.cpars.newkidney = 0
+        self.new_context()
+
+    def new_context(self):
+        if self.ctx is not None:
+            self.api.ctx_delete(self.ctx)
+        self.ctx = self.api.ctx(self.mpars, self.mvars, self.experiment)
+        if self.telemetry is not None:
+            # Ignore the snapshots of any previous simulation.
+            self.first = self.telemetry.head()
 
     def load_experiment(self, filename):
         if self.is_alive():
@@ -49,6 +93,7 @@ class SimulationThread(StoppableThread):
         self.reset()
 
         self.experiment = ModelExperiment(self.api, self.mpars, filename)
+        self.new_context()
 
     def experiment_outputs(self):
         if self.experiment is not None:
@@ -62,6 +107,11 @@ class SimulationThread(StoppableThread):
     def par(self, name):
         return getattr(self.cpars, name)
 
+    def history(self, x_name, y_name, count):
+        """Return the latest (at most count) values of two state variables
+        from the telemetry channel."""
+        return self.telemetry.tail([x_name, y_name], count, self.first)
+
     def get_pars(self):
         return self.mpars
 
@@ -72,11 +122,29 @@ class SimulationThread(StoppableThread):
         return self.delay
 
     def run_body(self):
+        if self.telemetry is not None:
+            self.run_batch()
+            return
         self.api.step(self.mpars, self.mvars, self.experiment)
         self.callback(self)
         if self.delay is not None:
             sleep(self.delay)
 
+    def run_batch(self):
+        if self.experiment is not None:
+            t_end = self.experiment.stop_at()
+        else:
+            t_end = float("inf")
+        # The GIL is released while the model is running.
+        steps = self.api.run_until(self.ctx, t_end, self.batch_steps)
+        now = time()
+        if steps == 0 or now - self.last_update >= self.delay:
+            self.last_update = now
+            self.callback(self)
+        if steps == 0:
+            # The experiment has finished.
+            sleep(self.delay)
+
     def save_to_file(self, save_file, output_vars, save_vars=False):
         with open(save_file, 'w') as f:
             if len(output_vars) > 1:
@@ -0,0 +1,105 @@
+"""Read live telemetry channels (as published by "guyton92 -T NAME" or by
+guyton92_telemetry_open() in the shared library).
+
+A telemetry channel is a POSIX shared-memory object that holds a ring buffer
+of snapshots of selected state variables (see src/telemetry_format.h). The
+simulation never waits for its readers, so a reader can poll the channel at
+its own rate (eg, once per frame) without slowing down the simulation.
+
+    chan = open_telemetry("/guyton92")
+    t, pa = chan.tail(["t", "pa"], 200)
+    chan.close()
+"""
+
+import mmap
+import os
+import struct
+
+try:
+    import numpy
+except ImportError:
+    numpy = None
+
+TELEM_MAGIC = b"G92TELE\0"
+TELEM_VERSION = 1
+# magic, version, ncols, slots, slot_size, header_size, head, done
+HEADER_FMT = "=8sIIQQQQQ"
+HEAD_OFFSET = struct.calcsize("=8sIIQQQ")
+DONE_OFFSET = HEAD_OFFSET + 8
+
+def _shm_path(name):
+    return os.path.join("/dev/shm", name.lstrip("/"))
+
+class Telemetry:
+    def __init__(self, name):
+        with open(_shm_path(name), "rb") as f:
+            self.buf = mmap.mmap(f.fileno(), 0, access=mmap.ACCESS_READ)
+        (magic, version, self.ncols, self.slots, self.slot_size,
+         self.header_size, _, _) = struct.unpack_from(HEADER_FMT, self.buf)
+        if magic != TELEM_MAGIC or version != TELEM_VERSION:
+            self.buf.close()
+            raise IOError("invalid telemetry channel '%s'" % (name,))
+        names = self.buf[struct.calcsize(HEADER_FMT):self.header_size]
+        names = names.split(b"\0")[:self.ncols]
+        self.names = [n.decode() if not isinstance(n, str) else n
+                      for n in names]
+        self.index = dict((n, i) for (i, n) in enumerate(self.names))
+        self.mask = self.slots - 1
+        self.ring = None
+        if numpy is not None:
+            dtype = numpy.dtype([("seq", numpy.uint64),
+                                 ("values", numpy.float64, (self.ncols,))])
+            self.ring = numpy.frombuffer(self.buf, dtype, self.slots,
+                                         self.header_size)
+
+    def close(self):
+        self.ring = None
+        try:
+            self.buf.close()
+        except BufferError:
+            # Views of the ring buffer are still in use.
+            pass
+
+    def head(self):
+        """Return the number of snapshots that have been published."""
+        return struct.unpack_from("=Q", self.buf, HEAD_OFFSET)[0]
+
+    def done(self):
+        """Return whether the simulation has finished."""
+        return struct.unpack_from("=Q", self.buf, DONE_OFFSET)[0] != 0
+
+    def view(self):
+        """Return a zero-copy view of the entire ring buffer, with fields
+        "seq" and "values" (requires NumPy). Snapshot n is stored in row
+        (n % slots) and is valid while its sequence number is 2n + 2."""
+        return self.ring
+
+    def _seq(self, n):
+        offset = self.header_size + (n & self.mask) * self.slot_size
+        return struct.unpack_from("=Q", self.buf, offset)[0]
+
+    def tail(self, names, count, first=0):
+        """Return the named columns of (at most) the latest count snapshots,
+        ignoring snapshots that were published before snapshot first and
+        any that are overwritten while they are being read."""
+        cols = [self.index[name] for name in names]
+        head = self.head()
+        start = max(head - count, first, head - self.slots + 1, 0)
+        ns = range(start, head)
+        if numpy is not None:
+            ixs = numpy.arange(start, head, dtype=numpy.uint64)
+            rows = ixs & numpy.uint64(self.mask)
+            values = self.ring["values"][numpy.ix_(rows, cols)]
+            ok = self.ring["seq"][rows] == 2 * ixs + 2
+            return [values[ok, c] for c in range(len(cols))]
+        out = [[] for c in cols]
+        for n in ns:
+            offset = self.header_size + (n & self.mask) * self.slot_size + 8
+            row = struct.unpack_from("=%dd" % (self.ncols,), self.buf, offset)
+            if self._seq(n) == 2 * n + 2:
+                for (c, col) in enumerate(cols):
+                    out[c].append(row[col])
+        return out
+
+def open_telemetry(name):
+    return Telemetry(name)
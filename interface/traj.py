@@ -0,0 +1,118 @@
+"""Load binary trajectory files (as recorded by "guyton92 -b FILE").
+
+The trajectory is memory-mapped by the reader library (build/libtraj.so),
+so each column can be viewed in place without parsing any text. When NumPy
+is available, each column is returned as a NumPy array; trajectories that
+consist of a single chunk are returned as views of the mapped file and are
+not copied at all.
+
+    traj = load_trajectory("hypertension.traj")
+    print traj.names
+    pa = traj["pa"]
+    traj.close()
+"""
+
+import os
+from ctypes import *
+
+try:
+    import numpy
+except ImportError:
+    numpy = None
+
+def load_traj_library(libname = "libtraj.so"):
+    dir_path = os.path.dirname(os.path.abspath(__file__))
+    lib = CDLL(os.path.join(dir_path, "..", "build", libname))
+    lib.traj_open.argtypes = [c_char_p]
+    lib.traj_open.restype = c_void_p
+    lib.traj_close.argtypes = [c_void_p]
+    lib.traj_close.restype = None
+    lib.traj_ncols.argtypes = [c_void_p]
+    lib.traj_ncols.restype = c_uint
+    lib.traj_nrows.argtypes = [c_void_p]
+    lib.traj_nrows.restype = c_ulong
+    lib.traj_nchunks.argtypes = [c_void_p]
+    lib.traj_nchunks.restype = c_uint
+    lib.traj_name.argtypes = [c_void_p, c_uint]
+    lib.traj_name.restype = c_char_p
+    lib.traj_units.argtypes = [c_void_p, c_uint]
+    lib.traj_units.restype = c_char_p
+    lib.traj_find.argtypes = [c_void_p, c_char_p]
+    lib.traj_find.restype = c_int
+    lib.traj_chunk.argtypes = [c_void_p, c_uint, c_uint, POINTER(c_ulong)]
+    lib.traj_chunk.restype = POINTER(c_double)
+    lib.traj_copy.argtypes = [c_void_p, c_uint, c_ulong, c_ulong,
+                              POINTER(c_double)]
+    lib.traj_copy.restype = c_ulong
+    return lib
+
+def _to_str(value):
+    if isinstance(value, bytes) and not isinstance(value, str):
+        return value.decode()
+    return value
+
+def _to_bytes(value):
+    if isinstance(value, bytes):
+        return value
+    return value.encode()
+
+class Trajectory:
+    def __init__(self, lib, filename):
+        self.lib = lib
+        self.traj = lib.traj_open(_to_bytes(filename))
+        if not self.traj:
+            raise IOError("unable to read trajectory '%s'" % (filename,))
+        ncols = lib.traj_ncols(self.traj)
+        self.names = [_to_str(lib.traj_name(self.traj, c))
+                      for c in range(ncols)]
+        self.units = [_to_str(lib.traj_units(self.traj, c))
+                      for c in range(ncols)]
+
+    def close(self):
+        if self.traj:
+            self.lib.traj_close(self.traj)
+            self.traj = None
+
+    def rows(self):
+        return self.lib.traj_nrows(self.traj)
+
+    def chunks(self, name):
+        """Return a zero-copy view of the named column in each chunk."""
+        col = self._column(name)
+        views = []
+        rows = c_ulong(0)
+        for c in range(self.lib.traj_nchunks(self.traj)):
+            ptr = self.lib.traj_chunk(self.traj, c, col, byref(rows))
+            if numpy is not None:
+                views.append(numpy.ctypeslib.as_array(ptr, (rows.value,)))
+            else:
+                views.append(cast(ptr, POINTER(c_double * rows.value))[0])
+        return views
+
+    def column(self, name):
+        """Return the named column; this is a view when there is one chunk."""
+        views = self.chunks(name)
+        if len(views) == 1:
+            return views[0]
+        if numpy is not None:
+            if len(views) == 0:
+                return numpy.zeros(0)
+            return numpy.concatenate(views)
+        rows = self.rows()
+        out = (c_double * rows)()
+        self.lib.traj_copy(self.traj, self._column(name), 0, rows, out)
+        return out
+
+    def __getitem__(self, name):
+        return self.column(name)
+
+    def _column(self, name):
+        col = self.lib.traj_find(self.traj, _to_bytes(name))
+        if col < 0:
+            raise KeyError(name)
+        return col
+
+def load_trajectory(filename, lib=None):
+    if lib is None:
+        lib = load_traj_library()
+    return Trajectory(lib, filename)
@@ -41,15 +41,20 @@ class Plot(Figure):
         return False
 
     def update_plot(self, simThread):
-        self.plot_xdata.append(simThread.var(self.plot_xname))
-        self.plot_ydata.append(simThread.var(self.plot_yname))
+        if simThread.telemetry is not None:
+            # Read the latest values directly from the telemetry channel.
+            (self.plot_xdata, self.plot_ydata) = simThread.history(
+                self.plot_xname, self.plot_yname, self.plot_max_points)
+        else:
+            self.plot_xdata.append(simThread.var(self.plot_xname))
+            self.plot_ydata.append(simThread.var(self.plot_yname))
 
-        if len(self.plot_xdata) > self.plot_max_points:
-            offset = len(self.plot_xdata) - self.plot_max_points
-            self.plot_xdata = self.plot_xdata[offset:]
-        if len(self.plot_ydata) > self.plot_max_points:
-            offset = len(self.plot_ydata) - self.plot_max_points
-            self.plot_ydata = self.plot_ydata[offset:]
+            if len(self.plot_xdata) > self.plot_max_points:
+                offset = len(self.plot_xdata) - self.plot_max_points
+                self.plot_xdata = self.plot_xdata[offset:]
+            if len(self.plot_ydata) > self.plot_max_points:
+                offset = len(self.plot_ydata) - self.plot_max_points
+                self.plot_ydata = self.plot_ydata[offset:]
 
         self.redraw_plot()
 
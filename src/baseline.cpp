@@ -0,0 +1,216 @@
+/**
+ * @file
+ * A cache of equilibrated model states, so that simulations which share a
+ * common starting point do not need to simulate it again (see guyton92d).
+ *
+ * The state is cached immediately before the time-step that reaches the
+ * first output time of an experiment. Until that time, no notifications can
+ * pass the output filter, so the state depends only on the initial
+ * parameters and variables, the model variant, the changes and continuous
+ * inputs (ramps, schedules and tables) that are scheduled before the first
+ * output time, the first output time and the time-step options.
+ */
+
+#include <cstring>
+#include <string>
+#include <map>
+#include <list>
+
+#include <stdint.h>
+#include <unistd.h>
+
+using namespace std;
+
+#include "params.h"
+#include "vars.h"
+#include "baseline.h"
+
+/** The FNV-1a 64-bit offset basis. */
+#define FNV_OFFSET 14695981039346656037ULL
+/** The FNV-1a 64-bit prime. */
+#define FNV_PRIME 1099511628211ULL
+
+/**
+ * Updates a 64-bit FNV-1a hash with an arbitrary block of data.
+ *
+ * @param[in] hash The current hash, or zero to start a new hash.
+ * @param[in] data The data to add to the hash.
+ * @param[in] len The length of the data (bytes).
+ *
+ * @return The updated hash.
+ */
+uint64_t baseline_hash(uint64_t hash, const void *data, size_t len) {
+  const unsigned char *bytes = (const unsigned char *) data;
+  if (hash == 0) {
+    hash = FNV_OFFSET;
+  }
+  for (size_t i = 0; i < len; i++) {
+    hash ^= bytes[i];
+    hash *= FNV_PRIME;
+  }
+  return hash;
+}
+
+/**
+ * Creates an empty cache.
+ *
+ * @param[in] capacity The maximum number of states; once the cache is full,
+ *                     the least recently used state is discarded.
+ */
+BASELINE_CACHE *baseline_cache(unsigned long capacity) {
+  BASELINE_CACHE *cache = new BASELINE_CACHE;
+  cache->capacity = capacity;
+  cache->fd = -1;
+  return cache;
+}
+
+/**
+ * Deletes a cache and every state that it contains.
+ */
+void baseline_cache_delete(BASELINE_CACHE *cache) {
+  delete cache;
+}
+
+/**
+ * Returns the key that identifies the state that is reached immediately
+ * before the first output time.
+ *
+ * @param[in] p The initial model parameters (after any changes that are
+ *              made at the start of the simulation).
+ * @param[in] v The initial state variables.
+ * @param[in] t_first The first output time (mins).
+ * @param[in] exact Whether time-steps end exactly at each output time.
+ * @param[in] variant The name of the model variant (see exp_variants.cpp).
+ * @param[in] prefix The definitions of the changes and inputs that are
+ *                   scheduled before the first output time (see
+ *                   Experiment::write_changes()).
+ */
+uint64_t baseline_key(const PARAMS &p, const VARS &v, double t_first,
+                      bool exact, const char *variant,
+                      const string &prefix) {
+  uint64_t hash = baseline_hash(0, &p, sizeof(PARAMS));
+  hash = baseline_hash(hash, &v, sizeof(VARS));
+  hash = baseline_hash(hash, &t_first, sizeof(t_first));
+  hash = baseline_hash(hash, variant, strlen(variant) + 1);
+  hash = baseline_hash(hash, prefix.c_str(), prefix.size());
+  return baseline_hash(hash, &exact, sizeof(exact));
+}
+
+/**
+ * Retrieves a cached state.
+ *
+ * @param[in] cache The cache.
+ * @param[in] key The key that identifies the state (see baseline_key()).
+ * @param[out] p The cached model parameters.
+ * @param[out] v The cached state variables.
+ *
+ * @return \c true if the state was cached, otherwise \c false.
+ */
+bool baseline_find(BASELINE_CACHE *cache, uint64_t key, PARAMS &p, VARS &v) {
+  map<uint64_t, BASELINE>::iterator it = cache->states.find(key);
+  if (it == cache->states.end()) {
+    return false;
+  }
+
+  memcpy(&p, &it->second.p, sizeof(PARAMS));
+  memcpy(&v, &it->second.v, sizeof(VARS));
+  cache->order.remove(key);
+  cache->order.push_front(key);
+  return true;
+}
+
+/**
+ * Reads exactly the given number of bytes from a file descriptor.
+ *
+ * @return \c true if every byte was read, otherwise \c false.
+ */
+static bool read_all(int fd, void *buf, size_t len) {
+  char *bytes = (char *) buf;
+  while (len > 0) {
+    ssize_t n = read(fd, bytes, len);
+    if (n <= 0) {
+      return false;
+    }
+    bytes += n;
+    len -= (size_t) n;
+  }
+  return true;
+}
+
+/**
+ * Writes exactly the given number of bytes to a file descriptor.
+ *
+ * @return \c true if every byte was written, otherwise \c false.
+ */
+static bool write_all(int fd, const void *buf, size_t len) {
+  const char *bytes = (const char *) buf;
+  while (len > 0) {
+    ssize_t n = write(fd, bytes, len);
+    if (n <= 0) {
+      return false;
+    }
+    bytes += n;
+    len -= (size_t) n;
+  }
+  return true;
+}
+
+/**
+ * Adds a state to the cache. If the cache has a file descriptor (ie, this is
+ * a worker process), the state is written to this descriptor instead, so
+ * that it can be added to the cache by baseline_read().
+ *
+ * @param[in] cache The cache.
+ * @param[in] key The key that identifies the state (see baseline_key()).
+ * @param[in] p The model parameters.
+ * @param[in] v The state variables.
+ */
+void baseline_store(BASELINE_CACHE *cache, uint64_t key, const PARAMS &p,
+                    const VARS &v) {
+  if (cache->fd >= 0) {
+    /* If this fails, the state will simply not be cached. */
+    if (write_all(cache->fd, &key, sizeof(key)) &&
+        write_all(cache->fd, &p, sizeof(PARAMS))) {
+      write_all(cache->fd, &v, sizeof(VARS));
+    }
+    return;
+  }
+
+  if (cache->states.find(key) == cache->states.end()) {
+    cache->order.push_front(key);
+  }
+  BASELINE &state = cache->states[key];
+  memcpy(&state.p, &p, sizeof(PARAMS));
+  memcpy(&state.v, &v, sizeof(VARS));
+
+  /* Discard the least recently used states. */
+  while (cache->order.size() > cache->capacity) {
+    cache->states.erase(cache->order.back());
+    cache->order.pop_back();
+  }
+}
+
+/**
+ * Reads a state that was written by a worker process (see baseline_store())
+ * and adds it to the cache.
+ *
+ * @param[in] cache The cache.
+ * @param[in] fd The file descriptor from which to read the state.
+ *
+ * @return \c true if a state was read, or \c false if there was none.
+ */
+bool baseline_read(BASELINE_CACHE *cache, int fd) {
+  uint64_t key;
+  BASELINE *state = new BASELINE;
+  bool ok = read_all(fd, &key, sizeof(key)) &&
+    read_all(fd, &state->p, sizeof(PARAMS)) &&
+    read_all(fd, &state->v, sizeof(VARS));
+  if (ok) {
+    int keep = cache->fd;
+    cache->fd = -1;
+    baseline_store(cache, key, state->p, state->v);
+    cache->fd = keep;
+  }
+  delete state;
+  return ok;
+}
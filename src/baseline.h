@@ -0,0 +1,27 @@
+/** A model state, from which a simulation can be resumed. */
+struct BASELINE {
+  PARAMS p; /** The struct of model parameters. */
+  VARS v; /** The struct of state variables. */
+};
+
+/**
+ * A cache of model states, each of which is identified by a key that is
+ * derived from everything that determines the state (see baseline_key()).
+ */
+struct BASELINE_CACHE {
+  std::map<uint64_t, BASELINE> states; /** The cached model states. */
+  std::list<uint64_t> order; /** The keys, most recently used first. */
+  unsigned long capacity; /** The maximum number of cached states. */
+  int fd; /** If non-negative, new states are written to this descriptor. */
+};
+
+uint64_t baseline_hash(uint64_t hash, const void *data, size_t len);
+BASELINE_CACHE *baseline_cache(unsigned long capacity);
+void baseline_cache_delete(BASELINE_CACHE *cache);
+uint64_t baseline_key(const PARAMS &p, const VARS &v, double t_first,
+                      bool exact, const char *variant,
+                      const std::string &prefix);
+bool baseline_find(BASELINE_CACHE *cache, uint64_t key, PARAMS &p, VARS &v);
+void baseline_store(BASELINE_CACHE *cache, uint64_t key, const PARAMS &p,
+                    const VARS &v);
+bool baseline_read(BASELINE_CACHE *cache, int fd);
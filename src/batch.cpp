@@ -0,0 +1,326 @@
+/**
+ * @file
+ * Support for running batches of simulations of an experiment in parallel
+ * (eg, the objective evaluations of a calibration), each of which differs
+ * only in the values of some parameters.
+ *
+ * Every simulation in a batch starts from a shared warm-start state, which
+ * is simulated once (see batch_start()). Each simulation then copies this
+ * state, sets its own parameter values and simulates the remainder of the
+ * experiment, so that the equilibration that precedes the experimental
+ * protocol is not repeated for every simulation.
+ *
+ * This module also provides the parsing of command-line arguments and the
+ * running statistics that are shared by the programs that run batches (eg,
+ * calibrate, gsa and vpop).
+ */
+
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <queue>
+#include <vector>
+#include <string>
+
+#include <pthread.h>
+#include <unistd.h>
+
+using namespace std;
+
+#include "params.h"
+#include "vars.h"
+#include "read_exp.h"
+#include "guyton92_step.h"
+#include "batch.h"
+
+/**
+ * The maximum number of time-steps that a simulation may take, as a multiple
+ * of the number of time-steps of the default size. This prevents parameter
+ * values for which the model livelocks (see module_autonom()) from stalling
+ * the entire batch.
+ */
+#define BATCH_STEP_LIMIT 20
+
+/**
+ * Simulates an experiment up to the warm-start time, from which a batch of
+ * simulations can then be started. The warm-start state is the state at the
+ * end of the first time-step that reaches the warm-start time, and so the
+ * model outputs at this time are identical to those of a full simulation.
+ *
+ * @param[in] exp_file The experiment definition file.
+ * @param[in] t_warm The warm-start time (mins), or a negative value for the
+ *                   first output time of the experiment.
+ * @param[in] exact Whether time-steps end exactly at each output time and
+ *                  scheduled change (see Experiment::set_exact_times).
+ *
+ * @return The warm-start state, or \c NULL if the experiment is invalid.
+ */
+BATCH_START *batch_start(const char *exp_file, double t_warm, bool exact) {
+  ifstream input(exp_file);
+  if (input.fail()) {
+    cerr << "ERROR: Unable to open experiment: '" << exp_file << "'" << endl;
+    return NULL;
+  }
+  ostringstream text;
+  text << input.rdbuf();
+
+  BATCH_START *start = new BATCH_START;
+  start->exp = text.str();
+  start->exact = exact;
+  PARAMS_INIT(start->p);
+  VARS_INIT(start->v);
+  /* The simulation begins at time t = 0, as per the model binary. */
+  start->v.t = 0.0;
+  start->v.i = 0.0030;
+
+  istringstream exp(start->exp);
+  Experiment e(start->p, exp);
+  if (e.failed()) {
+    cerr << "ERROR: Invalid experiment: '" << exp_file << "': "
+         << *e.errmsg() << endl;
+    delete start;
+    return NULL;
+  }
+  e.set_exact_times(exact);
+  start->stop = e.stop_at();
+  if (t_warm < 0) {
+    const double *times = e.output_times();
+    t_warm = (times[0] < start->stop) ? times[0] : 0;
+    delete[] times;
+  }
+
+  while (start->v.t < t_warm) {
+    guyton92_step(start->p, start->v, &e);
+  }
+  start->events = e.events_applied();
+  return start;
+}
+
+/**
+ * Warns about any scheduled change to the given parameters after the
+ * warm-start time, since such a change replaces the value that is set for
+ * each simulation (see batch_simulate()).
+ *
+ * @param[in] start The warm-start state (see batch_start()).
+ * @param[in] pix The index of each parameter (see param_index()).
+ * @param[in] n The number of parameters.
+ */
+void batch_check_schedule(const BATCH_START *start, const int *pix, int n) {
+  PARAMS p;
+  PARAMS_INIT(p);
+  istringstream input(start->exp);
+  Experiment e(p, input);
+  param_changes changes = e.schedule();
+  for (size_t i = 0; i < start->events && ! changes.empty(); i++) {
+    changes.pop();
+  }
+
+  for (; ! changes.empty(); changes.pop()) {
+    const PARAM_CHANGES &cs = changes.front();
+    for (int i = 0; i < n; i++) {
+      string name = PARAM_NAMES[pix[i]];
+      bool changed = false;
+      for (size_t j = 0; j < cs.changes.size(); j++) {
+        changed = changed || name == cs.changes[j].name;
+      }
+      for (size_t j = 0; j < cs.inputs.size(); j++) {
+        changed = changed || name == cs.inputs[j].name;
+      }
+      if (changed) {
+        cerr << "WARNING: '" << name << "' is changed by the experiment at "
+             << "t = " << cs.at_time << endl;
+      }
+    }
+  }
+}
+
+/**
+ * Simulates an experiment from a warm-start state, with some parameters set
+ * to new values, and records the value of the selected state variables and
+ * parameters at each sample time (see guyton92_run_sampled()).
+ *
+ * Note that the new parameter values take effect from the warm-start time,
+ * and any scheduled changes to these parameters after the warm-start time
+ * are applied as usual.
+ *
+ * @param[in] start The warm-start state (see batch_start()).
+ * @param[in] pix The index of each parameter to set (see param_index()).
+ * @param[in] values The value of each parameter to set.
+ * @param[in] n The number of parameters to set.
+ * @param[in] times The sample times, in ascending order (mins). These must
+ *                  not precede the warm-start time.
+ * @param[in] count The number of sample times.
+ * @param[in] handles The handles of the state variables and parameters to
+ *                    record (see guyton92_handle()).
+ * @param[in] k The number of handles.
+ * @param[out] out The output buffer, which must hold (count * k) values.
+ *
+ * @return \c true if every sample was recorded, or \c false if the
+ *         simulation exceeded its time-step limit (see BATCH_STEP_LIMIT).
+ */
+bool batch_simulate(const BATCH_START *start, const int *pix,
+                    const double *values, int n, const double *times,
+                    size_t count, const int *handles, int k, double *out) {
+  /* Each simulation has its own copy of the warm-start state. */
+  PARAMS *p = new PARAMS;
+  VARS *v = new VARS;
+  memcpy(p, &start->p, sizeof(PARAMS));
+  memcpy(v, &start->v, sizeof(VARS));
+
+  /* The struct only contains doubles, so it can be treated as an array. */
+  double *ps = (double *) p;
+  for (int i = 0; i < n; i++) {
+    ps[pix[i]] = values[i];
+  }
+
+  /* Skip the scheduled changes that have already been applied. */
+  istringstream exp(start->exp);
+  Experiment e(*p, exp);
+  e.set_exact_times(start->exact);
+  e.skip_events(start->events);
+
+  G92_CTX *ctx = guyton92_ctx(p, v, &e);
+  bool ok = true;
+  unsigned long max_steps = 1000;
+  if (count > 0 && times[count - 1] > v->t) {
+    max_steps += (unsigned long) (BATCH_STEP_LIMIT
+                                  * (times[count - 1] - v->t) / v->i);
+  }
+  for (size_t i = 0; i < count && ok; i++) {
+    unsigned long steps = guyton92_run_until(ctx, times[i], max_steps);
+    max_steps -= steps;
+    if (v->t < times[i]) {
+      ok = false;
+    } else {
+      guyton92_run_sampled(ctx, times + i, 1, handles, k, out + i * k);
+    }
+  }
+
+  guyton92_ctx_delete(ctx);
+  delete p;
+  delete v;
+  return ok;
+}
+
+/**
+ * Returns the default number of threads for running a batch, which is the
+ * number of online processors.
+ */
+unsigned int batch_threads() {
+  long n = sysconf(_SC_NPROCESSORS_ONLN);
+  return (n > 0) ? (unsigned int) n : 1;
+}
+
+/**
+ * The jobs of a batch, which are shared by every worker thread.
+ */
+struct BATCH {
+  size_t count; /** The number of jobs in the batch. */
+  size_t next; /** The index of the next job to start. */
+  batch_job job; /** The job function. */
+  void *data; /** The job-specific data. */
+  pthread_mutex_t lock; /** Protects the index of the next job. */
+};
+
+/**
+ * Runs jobs from a batch until every job has been started.
+ *
+ * @param[in] arg The batch (see BATCH).
+ */
+static void *batch_worker(void *arg) {
+  BATCH *batch = (BATCH *) arg;
+  while (1) {
+    pthread_mutex_lock(&batch->lock);
+    size_t index = batch->next;
+    if (index < batch->count) {
+      batch->next++;
+    }
+    pthread_mutex_unlock(&batch->lock);
+
+    if (index >= batch->count) {
+      return NULL;
+    }
+    batch->job(batch->data, index);
+  }
+}
+
+/**
+ * Runs a batch of jobs on a pool of worker threads, and returns once every
+ * job has finished. Each worker runs the next job that has not been started,
+ * so that the jobs are balanced across the workers.
+ *
+ * @param[in] count The number of jobs.
+ * @param[in] threads The number of worker threads (see batch_threads()).
+ * @param[in] job The job function, which is called once with each index
+ *                from zero to (count - 1).
+ * @param[in] data The job-specific data (if any).
+ */
+void batch_run(size_t count, unsigned int threads, batch_job job, void *data) {
+  BATCH batch;
+  batch.count = count;
+  batch.next = 0;
+  batch.job = job;
+  batch.data = data;
+  pthread_mutex_init(&batch.lock, NULL);
+
+  /* The calling thread is also a worker. */
+  if (threads > count) {
+    threads = (unsigned int) count;
+  }
+  vector<pthread_t> workers;
+  for (unsigned int i = 1; i < threads; i++) {
+    pthread_t thread;
+    if (pthread_create(&thread, NULL, batch_worker, &batch) == 0) {
+      workers.push_back(thread);
+    }
+  }
+  batch_worker(&batch);
+  for (size_t i = 0; i < workers.size(); i++) {
+    pthread_join(workers[i], NULL);
+  }
+  pthread_mutex_destroy(&batch.lock);
+}
+
+/**
+ * Splits a command-line argument into fields that are separated by the
+ * given character.
+ */
+vector<string> split_fields(const char *arg, char sep) {
+  vector<string> fields;
+  istringstream ss(arg);
+  string field;
+  while (getline(ss, field, sep)) {
+    fields.push_back(field);
+  }
+  return fields;
+}
+
+/**
+ * Converts a field of a command-line argument into a number.
+ *
+ * @return \c true if the entire field is a valid number, otherwise \c false.
+ */
+bool read_number(const string &field, double &value) {
+  istringstream ss(field);
+  char extra;
+  return (ss >> value) && ! (ss >> extra);
+}
+
+/**
+ * Adds a value to the running mean and variance.
+ */
+void moments_add(MOMENTS &m, double x) {
+  m.n++;
+  double d = x - m.mean;
+  m.mean += d / m.n;
+  m.m2 += d * (x - m.mean);
+}
+
+/**
+ * Returns the (sample) variance of the values.
+ */
+double moments_var(const MOMENTS &m) {
+  return (m.n > 1) ? m.m2 / (m.n - 1) : 0;
+}
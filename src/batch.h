@@ -0,0 +1,41 @@
+/**
+ * A model state from which every simulation in a batch is started (see
+ * batch_start()).
+ */
+struct BATCH_START {
+  PARAMS p; /** The struct of model parameters. */
+  VARS v; /** The struct of state variables. */
+  std::string exp; /** The experiment definition. */
+  size_t events; /** The number of sets of scheduled changes applied. */
+  double stop; /** The time at which the experiment ends (mins). */
+  bool exact; /** Whether time-steps end exactly at each output time. */
+};
+
+/**
+ * The running mean and variance of a quantity (Welford's algorithm).
+ */
+struct MOMENTS {
+  unsigned long n; /** The number of values. */
+  double mean; /** The mean of the values. */
+  double m2; /** The sum of squared differences from the mean. */
+};
+
+/**
+ * A job that is run once for each simulation in a batch, given its index in
+ * the batch. The second argument (\c data) is a pointer to some arbitrary
+ * job-specific data. Jobs are run concurrently, and must not modify any data
+ * that is shared with other jobs.
+ */
+typedef void (*batch_job)(void *data, size_t index);
+
+BATCH_START *batch_start(const char *exp_file, double t_warm, bool exact);
+void batch_check_schedule(const BATCH_START *start, const int *pix, int n);
+bool batch_simulate(const BATCH_START *start, const int *pix,
+                    const double *values, int n, const double *times,
+                    size_t count, const int *handles, int k, double *out);
+unsigned int batch_threads();
+void batch_run(size_t count, unsigned int threads, batch_job job, void *data);
+std::vector<std::string> split_fields(const char *arg, char sep);
+bool read_number(const std::string &field, double &value);
+void moments_add(MOMENTS &m, double x);
+double moments_var(const MOMENTS &m);
@@ -0,0 +1,575 @@
+/**
+ * @file
+ * A program that estimates the values of model parameters by fitting the
+ * outputs of an experiment to observed data (eg, the data sets in
+ * exps/data).
+ *
+ * The free parameters are bounded, and the weighted residual between the
+ * model outputs and the observed data is minimised by the Nelder-Mead
+ * simplex method. The objective evaluations of each iteration are run in
+ * parallel (see batch.cpp), and every evaluation starts from a shared
+ * warm-start state at the time of the first observation.
+ */
+
+#include <cstdlib>
+#include <cstring>
+#include <cmath>
+#include <cfloat>
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <queue>
+#include <vector>
+#include <string>
+#include <algorithm>
+
+#include <unistd.h>
+
+using namespace std;
+
+#include "params.h"
+#include "vars.h"
+#include "read_exp.h"
+#include "guyton92_step.h"
+/* Run batches of simulations in parallel from a shared warm-start state. */
+#include "batch.h"
+#include "calibrate.h"
+
+/** The default maximum number of iterations of the simplex method. */
+#define MAX_ITERS 200
+
+/** The default convergence tolerance of the simplex method. */
+#define TOLERANCE 1e-6
+
+/**
+ * The size of the initial simplex, as a fraction of the range of each free
+ * parameter.
+ */
+#define SIMPLEX_SIZE 0.1
+
+/** A parameter whose value is estimated. */
+struct FREE_PARAM {
+  string name; /** The name of the parameter. */
+  int index; /** The index of the parameter in the PARAMS struct. */
+  double min; /** The lower bound. */
+  double max; /** The upper bound. */
+};
+
+/** A set of observations of a single model output. */
+struct DATA_SET {
+  string file; /** The file from which the observations were read. */
+  string var; /** The name of the model output. */
+  size_t column; /** The column of the model output in the samples. */
+  double scale; /** The conversion of the model output to the data units. */
+  double weight; /** The weight of this data set in the residual. */
+  double norm; /** The typical magnitude of the observations. */
+  vector<double> times; /** The model time of each observation (mins). */
+  vector<size_t> rows; /** The row of each observation in the samples. */
+  vector<double> values; /** The observed values. */
+};
+
+/** A calibration problem. */
+struct CALIBRATION {
+  BATCH_START *start; /** The shared warm-start state. */
+  vector<FREE_PARAM> params; /** The free parameters. */
+  vector<int> pix; /** The index of each free parameter. */
+  vector<DATA_SET> data; /** The observed data. */
+  vector<double> times; /** The (unique) sample times, in ascending order. */
+  vector<int> handles; /** The (unique) sampled model outputs. */
+  unsigned int threads; /** The number of worker threads. */
+  unsigned long evals; /** The number of objective evaluations. */
+};
+
+/**
+ * The points at which the objective is evaluated by a batch of simulations.
+ * Points are expressed in unit coordinates, where each free parameter ranges
+ * from zero (lower bound) to one (upper bound).
+ */
+struct EVALUATIONS {
+  const CALIBRATION *calib; /** The calibration problem. */
+  const vector<vector<double> > *points; /** The points to evaluate. */
+  vector<double> *values; /** The objective value at each point. */
+};
+
+/**
+ * Displays the command-line usage for the calibration program, then exits.
+ *
+ * @param progname The name of the program.
+ * @param exitcode The exit code to pass to exit().
+ */
+static void usage(char *progname, int exitcode) {
+  cerr << "\n  USAGE: " << progname << " [options] experiment" << endl;
+  cerr << "\n  OPTIONS:" << endl;
+  cerr << "    -p NAME:MIN:MAX   " <<
+    "Estimate the parameter NAME, within the given bounds." << endl;
+  cerr << "    -d VAR:FILE[:SCALE[:WEIGHT]]" << endl;
+  cerr << "                      " <<
+    "Fit the model output VAR (multiplied by SCALE) to the" << endl;
+  cerr << "                      " <<
+    "observations (time and value) in FILE." << endl;
+  cerr << "    -t T0[:DT]        " <<
+    "The observation time t is model time T0 + t * DT (mins)." << endl;
+  cerr << "    -w T              " <<
+    "Start each evaluation from the model state at time T" << endl;
+  cerr << "                      " <<
+    "(default: the time of the first observation)." << endl;
+  cerr << "    -x                " <<
+    "End time-steps exactly at each output time and event." << endl;
+  cerr << "    -j N              " <<
+    "Run N evaluations at once (default: one per processor)." << endl;
+  cerr << "    -i N              " <<
+    "Stop after N iterations (default: " << MAX_ITERS << ")." << endl;
+  cerr << "    -e TOL            " <<
+    "Stop when the residuals differ by less than TOL (default: " <<
+    TOLERANCE << ")." << endl;
+  cerr << "    -h                " << "Display this help and exit." << endl;
+  cerr << "\n  The parameters take their estimated values at the warm-start "
+    "time, and are" << endl;
+  cerr << "  initially set to their values at this time. Each iteration "
+    "is printed to" << endl;
+  cerr << "  standard output; the final row contains the best estimate." <<
+    endl;
+  cerr << "\n  EXAMPLE:" << endl;
+  cerr << "    " << progname << " -p adhtc:5:60 -t 40320:60 \\" << endl;
+  cerr << "      -d vud:exps/data/Uttam_Fig4_data.dat:1000 " <<
+    "exps/uttamsingh_2.exp" << endl;
+  cerr << endl;
+  exit(exitcode);
+}
+
+/**
+ * Reads the observations (time and value) of a data set.
+ *
+ * @param[in,out] data The data set.
+ * @param[in] t0 The model time at which the observation time is zero (mins).
+ * @param[in] dt The duration of one unit of observation time (mins).
+ *
+ * @return \c true if the data were read successfully, otherwise \c false.
+ */
+static bool read_data(DATA_SET &data, double t0, double dt) {
+  ifstream input(data.file.c_str());
+  if (input.fail()) {
+    cerr << "ERROR: Unable to open data file: '" << data.file << "'" << endl;
+    return false;
+  }
+
+  string row;
+  double sum = 0;
+  while (getline(input, row)) {
+    size_t start = row.find_first_not_of(" \t\r\n");
+    if (start == string::npos || row[start] == '#') {
+      continue;
+    }
+    istringstream fields(row);
+    double t, value;
+    if (! (fields >> t >> value)) {
+      cerr << "ERROR: Invalid data in '" << data.file << "': '" << row
+           << "'" << endl;
+      return false;
+    }
+    data.times.push_back(t0 + t * dt);
+    data.values.push_back(value);
+    sum += fabs(value);
+  }
+
+  if (data.values.empty()) {
+    cerr << "ERROR: No data in '" << data.file << "'" << endl;
+    return false;
+  }
+  data.norm = sum / data.values.size();
+  if (data.norm == 0) {
+    data.norm = 1;
+  }
+  return true;
+}
+
+/**
+ * Converts a point in unit coordinates into parameter values.
+ */
+static vector<double> param_values(const CALIBRATION &calib,
+                                   const vector<double> &x) {
+  vector<double> values(x.size());
+  for (size_t i = 0; i < x.size(); i++) {
+    const FREE_PARAM &fp = calib.params[i];
+    values[i] = fp.min + x[i] * (fp.max - fp.min);
+  }
+  return values;
+}
+
+/**
+ * Calculates the weighted residual between the model outputs and the
+ * observed data. Each data set contributes its weight, multiplied by the
+ * mean squared difference between the (scaled) model output and the
+ * observations, relative to the mean magnitude of the observations.
+ *
+ * @param[in] calib The calibration problem.
+ * @param[in] x The parameter values, in unit coordinates.
+ *
+ * @return The residual, or \c DBL_MAX if the simulation failed.
+ */
+static double residual(const CALIBRATION &calib, const vector<double> &x) {
+  vector<double> values = param_values(calib, x);
+  size_t k = calib.handles.size();
+  vector<double> out(calib.times.size() * k);
+  if (! batch_simulate(calib.start, &calib.pix[0], &values[0],
+                       (int) values.size(), &calib.times[0],
+                       calib.times.size(), &calib.handles[0], (int) k,
+                       &out[0])) {
+    return DBL_MAX;
+  }
+
+  double total = 0;
+  for (size_t d = 0; d < calib.data.size(); d++) {
+    const DATA_SET &data = calib.data[d];
+    double sum = 0;
+    for (size_t i = 0; i < data.values.size(); i++) {
+      double model = data.scale * out[data.rows[i] * k + data.column];
+      double err = (model - data.values[i]) / data.norm;
+      sum += err * err;
+    }
+    total += data.weight * sum / data.values.size();
+  }
+  return (total == total && total < DBL_MAX) ? total : DBL_MAX;
+}
+
+/**
+ * Evaluates the objective at a single point (see batch_run()).
+ */
+static void evaluate_job(void *data, size_t index) {
+  EVALUATIONS *evals = (EVALUATIONS *) data;
+  (*evals->values)[index] = residual(*evals->calib, (*evals->points)[index]);
+}
+
+/**
+ * Evaluates the objective at each point, in parallel.
+ *
+ * @param[in,out] calib The calibration problem.
+ * @param[in] points The points to evaluate, in unit coordinates.
+ *
+ * @return The objective value at each point.
+ */
+static vector<double> evaluate(CALIBRATION &calib,
+                               const vector<vector<double> > &points) {
+  vector<double> values(points.size(), DBL_MAX);
+  EVALUATIONS evals;
+  evals.calib = &calib;
+  evals.points = &points;
+  evals.values = &values;
+  batch_run(points.size(), calib.threads, evaluate_job, &evals);
+  calib.evals += points.size();
+  return values;
+}
+
+/**
+ * Returns the point (c + coeff * (c - w)), restricted to the unit cube.
+ */
+static vector<double> simplex_point(const vector<double> &c,
+                                    const vector<double> &w, double coeff) {
+  vector<double> x(c.size());
+  for (size_t i = 0; i < c.size(); i++) {
+    x[i] = c[i] + coeff * (c[i] - w[i]);
+    x[i] = (x[i] < 0) ? 0 : (x[i] > 1) ? 1 : x[i];
+  }
+  return x;
+}
+
+/**
+ * Prints the best point of the current simplex.
+ */
+static void print_iteration(const CALIBRATION &calib, int iter,
+                            const vector<double> &x, double f) {
+  vector<double> values = param_values(calib, x);
+  cout << iter << " " << calib.evals << " " << f;
+  for (size_t i = 0; i < values.size(); i++) {
+    cout << " " << values[i];
+  }
+  cout << endl;
+}
+
+/**
+ * Minimises the residual with the Nelder-Mead simplex method, within the
+ * bounds of the free parameters.
+ *
+ * When there are enough worker threads, every candidate point of an
+ * iteration (the reflection, expansion and both contractions) is evaluated
+ * at once, so that each iteration takes the time of a single evaluation.
+ * Otherwise, the candidate points are evaluated only as they are required.
+ *
+ * @param[in,out] calib The calibration problem.
+ * @param[in] x0 The initial point, in unit coordinates.
+ * @param[in] max_iters The maximum number of iterations.
+ * @param[in] tol The convergence tolerance.
+ */
+static void nelder_mead(CALIBRATION &calib, const vector<double> &x0,
+                        int max_iters, double tol) {
+  size_t n = x0.size();
+
+  /* The initial simplex extends from x0 along each axis. */
+  vector<vector<double> > simplex(n + 1, x0);
+  for (size_t i = 0; i < n; i++) {
+    double step = (x0[i] + SIMPLEX_SIZE <= 1) ? SIMPLEX_SIZE : -SIMPLEX_SIZE;
+    simplex[i + 1][i] += step;
+  }
+  vector<double> f = evaluate(calib, simplex);
+
+  /* The coefficients of the reflection, expansion, outside contraction and
+     inside contraction. */
+  const double coeffs[4] = {1.0, 2.0, 0.5, -0.5};
+  bool speculate = calib.threads >= 4;
+
+  cout << "iter evals residual";
+  for (size_t i = 0; i < n; i++) {
+    cout << " " << calib.params[i].name;
+  }
+  cout << endl;
+
+  for (int iter = 0; ; iter++) {
+    /* Order the vertices from best to worst. */
+    vector<pair<double, size_t> > order(n + 1);
+    for (size_t i = 0; i <= n; i++) {
+      order[i] = make_pair(f[i], i);
+    }
+    sort(order.begin(), order.end());
+    vector<vector<double> > sorted(n + 1);
+    for (size_t i = 0; i <= n; i++) {
+      sorted[i] = simplex[order[i].second];
+      f[i] = order[i].first;
+    }
+    simplex = sorted;
+    print_iteration(calib, iter, simplex[0], f[0]);
+
+    /* Stop when the residuals or the vertices are no longer distinct. */
+    double size = 0;
+    for (size_t i = 1; i <= n; i++) {
+      for (size_t j = 0; j < n; j++) {
+        double d = fabs(simplex[i][j] - simplex[0][j]);
+        size = (d > size) ? d : size;
+      }
+    }
+    if (iter >= max_iters || size < tol
+        || (f[n] < DBL_MAX && f[n] - f[0] <= tol * fabs(f[0]))) {
+      break;
+    }
+
+    /* The centroid of every vertex except the worst. */
+    vector<double> c(n, 0.0);
+    for (size_t i = 0; i < n; i++) {
+      for (size_t j = 0; j < n; j++) {
+        c[j] += simplex[i][j] / n;
+      }
+    }
+
+    vector<vector<double> > cands(4);
+    vector<double> fc(4, DBL_MAX);
+    vector<bool> done(4, speculate);
+    for (int i = 0; i < 4; i++) {
+      cands[i] = simplex_point(c, simplex[n], coeffs[i]);
+    }
+    if (speculate) {
+      fc = evaluate(calib, cands);
+    }
+
+    /* Evaluate a single candidate point, if it has not been evaluated. */
+    for (int i = 0; i < 4; i++) {
+      bool needed = (i == 0)
+        || (i == 1 && fc[0] < f[0])
+        || (i == 2 && fc[0] >= f[n - 1] && fc[0] < f[n])
+        || (i == 3 && fc[0] >= f[n]);
+      if (needed && ! done[i]) {
+        fc[i] = evaluate(calib, vector<vector<double> >(1, cands[i]))[0];
+        done[i] = true;
+      }
+    }
+
+    int accept = -1;
+    if (fc[0] < f[0]) {
+      accept = (fc[1] < fc[0]) ? 1 : 0;
+    } else if (fc[0] < f[n - 1]) {
+      accept = 0;
+    } else if (fc[0] < f[n]) {
+      accept = (fc[2] <= fc[0]) ? 2 : -1;
+    } else {
+      accept = (fc[3] < f[n]) ? 3 : -1;
+    }
+
+    if (accept >= 0) {
+      simplex[n] = cands[accept];
+      f[n] = fc[accept];
+    } else {
+      /* Shrink every vertex towards the best vertex. */
+      vector<vector<double> > shrunk(simplex.begin() + 1, simplex.end());
+      for (size_t i = 0; i < n; i++) {
+        shrunk[i] = simplex_point(simplex[0], shrunk[i], -0.5);
+      }
+      vector<double> fs = evaluate(calib, shrunk);
+      for (size_t i = 0; i < n; i++) {
+        simplex[i + 1] = shrunk[i];
+        f[i + 1] = fs[i];
+      }
+    }
+  }
+}
+
+/**
+ * The entry point for the calibration program.
+ *
+ * @param[in] argc The number of arguments on the command line.
+ * @param[in] argv The arguments provided on the command line.
+ */
+int main(int argc, char *argv[]) {
+  CALIBRATION calib;
+  calib.threads = batch_threads();
+  calib.evals = 0;
+  double t0 = 0, dt = 1;
+  double t_warm = -1;
+  bool exact = false;
+  int max_iters = MAX_ITERS;
+  double tol = TOLERANCE;
+
+  int c;
+  while ((c = getopt(argc, argv, "hxp:d:t:w:j:i:e:")) != -1) {
+    istringstream ss((optarg) ? optarg : "");
+    vector<string> fields = split_fields((optarg) ? optarg : "", ':');
+    switch (c) {
+    case 'p': {
+      FREE_PARAM fp;
+      if (fields.size() != 3 || ! read_number(fields[1], fp.min)
+          || ! read_number(fields[2], fp.max) || fp.min >= fp.max) {
+        cerr << "ERROR: Invalid parameter: '" << optarg << "'" << endl;
+        usage(argv[0], EXIT_FAILURE);
+      }
+      fp.name = fields[0];
+      fp.index = param_index(fp.name.c_str());
+      if (fp.index < 0) {
+        cerr << "ERROR: Unknown parameter: '" << fp.name << "'" << endl;
+        usage(argv[0], EXIT_FAILURE);
+      }
+      calib.params.push_back(fp);
+      calib.pix.push_back(fp.index);
+      break;
+    }
+    case 'd': {
+      DATA_SET data;
+      data.scale = 1;
+      data.weight = 1;
+      if (fields.size() < 2 || fields.size() > 4
+          || (fields.size() > 2 && ! read_number(fields[2], data.scale))
+          || (fields.size() > 3 && ! read_number(fields[3], data.weight))) {
+        cerr << "ERROR: Invalid data set: '" << optarg << "'" << endl;
+        usage(argv[0], EXIT_FAILURE);
+      }
+      data.var = fields[0];
+      data.file = fields[1];
+      if (guyton92_handle(data.var.c_str()) < 0) {
+        cerr << "ERROR: Unknown output: '" << data.var << "'" << endl;
+        usage(argv[0], EXIT_FAILURE);
+      }
+      calib.data.push_back(data);
+      break;
+    }
+    case 't':
+      if (fields.empty() || fields.size() > 2 || ! read_number(fields[0], t0)
+          || (fields.size() > 1 && (! read_number(fields[1], dt) || dt <= 0))) {
+        cerr << "ERROR: Invalid time scale: '" << optarg << "'" << endl;
+        usage(argv[0], EXIT_FAILURE);
+      }
+      break;
+    case 'w':
+      if (! read_number(optarg, t_warm) || t_warm < 0) {
+        cerr << "ERROR: Invalid warm-start time: '" << optarg << "'" << endl;
+        usage(argv[0], EXIT_FAILURE);
+      }
+      break;
+    case 'x':
+      exact = true;
+      break;
+    case 'j':
+      if (! (ss >> calib.threads) || calib.threads < 1) {
+        cerr << "ERROR: Invalid number of jobs: '" << optarg << "'" << endl;
+        usage(argv[0], EXIT_FAILURE);
+      }
+      break;
+    case 'i':
+      if (! (ss >> max_iters) || max_iters < 0) {
+        cerr << "ERROR: Invalid number of iterations: '" << optarg << "'"
+             << endl;
+        usage(argv[0], EXIT_FAILURE);
+      }
+      break;
+    case 'e':
+      if (! (ss >> tol) || tol < 0) {
+        cerr << "ERROR: Invalid tolerance: '" << optarg << "'" << endl;
+        usage(argv[0], EXIT_FAILURE);
+      }
+      break;
+    case 'h':
+      usage(argv[0], EXIT_SUCCESS);
+      break;
+    default:
+      usage(argv[0], EXIT_FAILURE);
+      break;
+    }
+  }
+  if (optind != argc - 1 || calib.params.empty() || calib.data.empty()) {
+    usage(argv[0], EXIT_FAILURE);
+  }
+
+  /* Read the observations, and determine which outputs to sample at which
+     times. */
+  vector<string> outputs;
+  for (size_t d = 0; d < calib.data.size(); d++) {
+    DATA_SET &data = calib.data[d];
+    if (! read_data(data, t0, dt)) {
+      return EXIT_FAILURE;
+    }
+    calib.times.insert(calib.times.end(), data.times.begin(),
+                       data.times.end());
+    vector<string>::iterator it = find(outputs.begin(), outputs.end(),
+                                       data.var);
+    data.column = it - outputs.begin();
+    if (it == outputs.end()) {
+      outputs.push_back(data.var);
+      calib.handles.push_back(guyton92_handle(data.var.c_str()));
+    }
+  }
+  sort(calib.times.begin(), calib.times.end());
+  calib.times.erase(unique(calib.times.begin(), calib.times.end()),
+                    calib.times.end());
+  for (size_t d = 0; d < calib.data.size(); d++) {
+    DATA_SET &data = calib.data[d];
+    for (size_t i = 0; i < data.times.size(); i++) {
+      data.rows.push_back(lower_bound(calib.times.begin(), calib.times.end(),
+                                      data.times[i]) - calib.times.begin());
+    }
+  }
+
+  if (t_warm < 0) {
+    t_warm = calib.times[0];
+  } else if (t_warm > calib.times[0]) {
+    cerr << "ERROR: The warm-start time is after the first observation (t = "
+         << calib.times[0] << ")" << endl;
+    return EXIT_FAILURE;
+  }
+
+  /* Simulate the experiment up to the warm-start time, once. */
+  calib.start = batch_start(argv[optind], t_warm, exact);
+  if (! calib.start) {
+    return EXIT_FAILURE;
+  }
+  batch_check_schedule(calib.start, &calib.pix[0], (int) calib.pix.size());
+
+  /* The initial estimates are the parameter values at the warm start. */
+  const double *ps = (const double *) &calib.start->p;
+  vector<double> x0(calib.params.size());
+  for (size_t i = 0; i < calib.params.size(); i++) {
+    const FREE_PARAM &fp = calib.params[i];
+    double x = (ps[fp.index] - fp.min) / (fp.max - fp.min);
+    x0[i] = (x < 0) ? 0 : (x > 1) ? 1 : x;
+  }
+
+  cout.precision(8);
+  nelder_mead(calib, x0, max_iters, tol);
+
+  delete calib.start;
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,80 @@
+/**
+ * @file
+ * The parts of the protocol between the simulation daemon (guyton92d) and
+ * its client (guyton92c) that are shared by both programs: the location of
+ * the socket, and the check that both ends belong to the same user.
+ */
+
+#include <cstdlib>
+#include <cstdio>
+#include <iostream>
+#include <string>
+
+#include <errno.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+
+using namespace std;
+
+#include "daemon_proto.h"
+
+/**
+ * Returns the location of the socket. This is given by the environment
+ * variable \c DAEMON_SOCKET_ENV, if it is defined. Otherwise, the socket is
+ * created in the user's runtime directory (\c $XDG_RUNTIME_DIR) or, failing
+ * that, in a directory in /tmp that only the user can access.
+ *
+ * @param[in] create Whether to create the directory in /tmp, if it does not
+ *                   already exist.
+ *
+ * @return The location of the socket, or an empty string if the directory
+ *         in /tmp does not exist or can be accessed by other users.
+ */
+string daemon_socket_path(bool create) {
+  const char *env = getenv(DAEMON_SOCKET_ENV);
+  if (env && *env) {
+    return env;
+  }
+  env = getenv("XDG_RUNTIME_DIR");
+  if (env && *env) {
+    return string(env) + "/" + DAEMON_SOCKET_NAME;
+  }
+
+  char dir[256];
+  snprintf(dir, sizeof(dir), DAEMON_DIR_FMT, (unsigned) getuid());
+  if (create && mkdir(dir, 0700) != 0 && errno != EEXIST) {
+    cerr << "ERROR: Unable to create '" << dir << "'" << endl;
+    return "";
+  }
+  /* Another user may have created the directory first. */
+  struct stat st;
+  if (lstat(dir, &st) != 0) {
+    return "";
+  }
+  if (! S_ISDIR(st.st_mode) || st.st_uid != getuid()
+      || (st.st_mode & (S_IRWXG | S_IRWXO))) {
+    cerr << "ERROR: '" << dir << "' is not a private directory" << endl;
+    return "";
+  }
+  return string(dir) + "/" + DAEMON_SOCKET_NAME;
+}
+
+/**
+ * Checks that the process at the other end of a connection belongs to the
+ * same user as this process.
+ *
+ * @param[in] sock The connected socket.
+ *
+ * @return \c true if the peer belongs to the same user, otherwise \c false.
+ */
+bool daemon_peer_ok(int sock) {
+  struct ucred cred;
+  socklen_t len = sizeof(cred);
+  if (getsockopt(sock, SOL_SOCKET, SO_PEERCRED, &cred, &len) != 0
+      || len != sizeof(cred)) {
+    return false;
+  }
+  return cred.uid == getuid();
+}
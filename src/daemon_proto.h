@@ -0,0 +1,38 @@
+/**
+ * @file
+ * The protocol between the simulation daemon (guyton92d) and its client
+ * (guyton92c), which communicate over a Unix domain socket.
+ *
+ * <b>Request:</b>
+ * - The size of the job in bytes (uint32). The client's standard output and
+ *   standard error are sent with this message as ancillary data
+ *   (\c SCM_RIGHTS), so that the job can write its output directly.
+ * - The job: the client's working directory, followed by each command-line
+ *   argument for the model, each stored as a NUL-terminated string.
+ *
+ * Both ends only accept connections from processes of the same user. The
+ * request must be sent within \c DAEMON_RECV_TIMEOUT seconds of
+ * connecting, otherwise the job fails.
+ *
+ * <b>Response:</b>
+ * - The exit code of the job (int32), once the job has finished.
+ */
+
+/** The environment variable that overrides the location of the socket. */
+#define DAEMON_SOCKET_ENV "GUYTON92_SOCKET"
+/** The name of the socket in the user's runtime directory. */
+#define DAEMON_SOCKET_NAME "guyton92.sock"
+/**
+ * The directory that contains the socket when the user has no runtime
+ * directory (formatted with the user ID).
+ */
+#define DAEMON_DIR_FMT "/tmp/guyton92-%u"
+/** The maximum size of a job (bytes). */
+#define DAEMON_MAX_JOB (1 << 20)
+/** The time in which the client must send its request (seconds). */
+#define DAEMON_RECV_TIMEOUT 10
+/** The number of file descriptors that are sent with each request. */
+#define DAEMON_FDS 2
+
+std::string daemon_socket_path(bool create);
+bool daemon_peer_ok(int sock);
@@ -0,0 +1,299 @@
+/**
+ * @file
+ * Incremental evaluation of the model equations, which skips a module when
+ * none of its inputs have changed since it was last evaluated, and reuses
+ * the outputs of that evaluation instead.
+ *
+ * The inputs and outputs of each module are found when the model is built
+ * (see vars.sh): the inputs are every state variable and parameter that the
+ * module refers to, and the outputs are every state variable that it
+ * assigns. Since the modules are pure functions of these inputs, skipping a
+ * module whose inputs are identical gives exactly the same results. Each
+ * state variable and parameter has a relative tolerance, which allows
+ * modules to be skipped when that input has changed by a small fraction, at
+ * the cost of (small) errors.
+ *
+ * Note that most modules integrate their state variables over time, and so
+ * refer to the time-step size (v.i) and to their own outputs. Since the
+ * time-step size changes at almost every time-step (see module_autonom()),
+ * these modules are never skipped unless the time-step size has a tolerance
+ * (eg, "i=0.5"), and even a small tolerance can accumulate large errors over
+ * a long simulation.
+ *
+ * By default, the evaluation is strict: every module is evaluated, and the
+ * modules that would have been skipped are counted, along with those whose
+ * outputs differ from the outputs that would have been reused and the
+ * largest relative difference, so that the savings and the error of a set
+ * of tolerances can be measured before the modules are actually skipped.
+ */
+
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+#include <string>
+
+using namespace std;
+
+#include "params.h"
+#include "vars.h"
+#include "dataflow.h"
+
+/** The incremental evaluation (if any) used by the current thread. */
+__thread DATAFLOW *dataflow = NULL;
+
+/** The state of a single module. */
+struct DATAFLOW_MODULE {
+  bool evaluated; /** Whether the module has been evaluated. */
+  PARAMS p_in; /** The parameters when the module was last evaluated. */
+  VARS v_in; /** The state variables when the module was last evaluated. */
+  VARS v_out; /** The state variables after the module was last evaluated. */
+  unsigned long runs; /** The number of times the module was evaluated. */
+  unsigned long skips; /** The number of times the module was skipped. */
+  unsigned long errors; /** The number of times the outputs would differ. */
+  double max_error; /** The largest relative difference in any output. */
+};
+
+/** The state of the incremental evaluation of the model equations. */
+struct DATAFLOW {
+  PARAMS tol_p; /** The largest relative change in each parameter that is
+                    ignored. */
+  VARS tol_v; /** The largest relative change in each state variable that
+                  is ignored. */
+  bool strict; /** Whether every module is evaluated regardless. */
+  DATAFLOW_MODULE mods[DATAFLOW_COUNT]; /** The state of each module. */
+};
+
+/**
+ * Returns whether a value is unchanged, to within a relative tolerance.
+ */
+static inline bool same(double now, double then, double tol) {
+  return now == then || fabs(now - then) <= tol * fabs(then);
+}
+
+/**
+ * Returns the larger of an error and the relative difference between two
+ * values (or their absolute difference, if the reused value is zero).
+ */
+static inline double worst(double err, double now, double then) {
+  double diff = fabs(now - then);
+  if (then != 0) {
+    diff /= fabs(then);
+  }
+  return (diff > err) ? diff : err;
+}
+
+/* Compare, save and restore the fields that are listed by the views of each
+   module (see vars.sh), so that each module only touches its own fields. */
+#define SAME_VAR(name) && same(v.name, m.v_in.name, df.tol_v.name)
+#define SAME_PARAM(name) && same(p.name, m.p_in.name, df.tol_p.name)
+#define SAVE_VAR(name) m.v_in.name = v.name;
+#define SAVE_PARAM(name) m.p_in.name = p.name;
+#define SAVE_OUT(name) m.v_out.name = v.name;
+#define RESTORE_OUT(name) v.name = m.v_out.name;
+#define ERROR_OUT(name) err = worst(err, v.name, m.v_out.name);
+
+/** The functions that operate on the views of a single module. */
+struct DATAFLOW_VIEW {
+  const char *name; /** The name of the module. */
+  /** Returns whether the inputs of the module are unchanged. */
+  bool (*unchanged)(const DATAFLOW &df, const DATAFLOW_MODULE &m,
+                    const PARAMS &p, const VARS &v);
+  /** Saves the inputs of the module, before it is evaluated. */
+  void (*save_inputs)(DATAFLOW_MODULE &m, const PARAMS &p, const VARS &v);
+  /** Saves the outputs of the module, after it is evaluated. */
+  void (*save_outputs)(DATAFLOW_MODULE &m, const VARS &v);
+  /** Restores the saved outputs of the module, in place of evaluating it. */
+  void (*restore_outputs)(const DATAFLOW_MODULE &m, VARS &v);
+  /** Returns the largest relative difference between the outputs of the
+      module and the saved outputs. */
+  double (*output_error)(const DATAFLOW_MODULE &m, const VARS &v);
+};
+
+/* The outputs are compared as inputs, since a module that refers to its own
+   outputs (eg, to integrate them) must be evaluated whenever they change. */
+#define DATAFLOW_FUNCS(MOD) \
+  static bool MOD##_unchanged(const DATAFLOW &df, const DATAFLOW_MODULE &m, \
+                              const PARAMS &p, const VARS &v) { \
+    return true VARS_IN_##MOD(SAME_VAR) VARS_OUT_##MOD(SAME_VAR) \
+      PARAMS_IN_##MOD(SAME_PARAM); \
+  } \
+  static void MOD##_save_inputs(DATAFLOW_MODULE &m, const PARAMS &p, \
+                                const VARS &v) { \
+    VARS_IN_##MOD(SAVE_VAR) VARS_OUT_##MOD(SAVE_VAR) \
+    PARAMS_IN_##MOD(SAVE_PARAM) \
+  } \
+  static void MOD##_save_outputs(DATAFLOW_MODULE &m, const VARS &v) { \
+    VARS_OUT_##MOD(SAVE_OUT) \
+  } \
+  static void MOD##_restore_outputs(const DATAFLOW_MODULE &m, VARS &v) { \
+    VARS_OUT_##MOD(RESTORE_OUT) \
+  } \
+  static double MOD##_output_error(const DATAFLOW_MODULE &m, const VARS &v) { \
+    double err = 0; \
+    VARS_OUT_##MOD(ERROR_OUT) \
+    return err; \
+  }
+DATAFLOW_MODULES(DATAFLOW_FUNCS)
+
+#define DATAFLOW_ENTRY(MOD) \
+  {#MOD, MOD##_unchanged, MOD##_save_inputs, MOD##_save_outputs, \
+   MOD##_restore_outputs, MOD##_output_error},
+/** The views of each module, in the order of the module identifiers. */
+static const DATAFLOW_VIEW views[DATAFLOW_COUNT] = {
+  DATAFLOW_MODULES(DATAFLOW_ENTRY)
+};
+
+/**
+ * Creates the state of an incremental evaluation, in which no module has
+ * been evaluated and every input has a tolerance of zero, so that modules
+ * are only skipped when their inputs are identical.
+ *
+ * @param[in] strict Whether every module is evaluated regardless, and the
+ *                   modules that would be skipped are only counted.
+ */
+DATAFLOW *dataflow_new(bool strict) {
+  DATAFLOW *df = new DATAFLOW;
+  double *tol_p = (double *) &df->tol_p;
+  double *tol_v = (double *) &df->tol_v;
+  for (int j = 0; j < PARAM_COUNT; j++) {
+    tol_p[j] = 0;
+  }
+  for (int j = 0; j < VAR_COUNT; j++) {
+    tol_v[j] = 0;
+  }
+  df->strict = strict;
+  for (int i = 0; i < DATAFLOW_COUNT; i++) {
+    df->mods[i].evaluated = false;
+    df->mods[i].runs = 0;
+    df->mods[i].skips = 0;
+    df->mods[i].errors = 0;
+    df->mods[i].max_error = 0;
+  }
+  return df;
+}
+
+/**
+ * Deletes the state of an incremental evaluation.
+ */
+void dataflow_delete(DATAFLOW *df) {
+  delete df;
+}
+
+/**
+ * Sets the relative tolerances of the inputs, from a comma-separated list of
+ * items. An item of the form "TOL" sets the tolerance of every state
+ * variable and parameter, and an item of the form "NAME=TOL" sets the
+ * tolerance of a single state variable or parameter. Items are applied in
+ * order, so "0.01,i=0.5" gives the time-step size a larger tolerance than
+ * every other input.
+ *
+ * @param[in] df   The state of the incremental evaluation.
+ * @param[in] spec The list of tolerances.
+ *
+ * @return \c true if every item was valid, otherwise \c false.
+ */
+bool dataflow_tolerances(DATAFLOW *df, const string &spec) {
+  double *tol_p = (double *) &df->tol_p;
+  double *tol_v = (double *) &df->tol_v;
+  istringstream items(spec);
+  string item;
+  while (getline(items, item, ',')) {
+    size_t eq = item.find('=');
+    string name = (eq == string::npos) ? "" : item.substr(0, eq);
+    istringstream ss(item.substr((eq == string::npos) ? 0 : eq + 1));
+    double tol;
+    if (! (ss >> tol) || ! ss.eof() || tol < 0) {
+      cerr << "ERROR: Invalid tolerance: '" << item << "'" << endl;
+      return false;
+    }
+
+    if (name.empty()) {
+      for (int j = 0; j < PARAM_COUNT; j++) {
+        tol_p[j] = tol;
+      }
+      for (int j = 0; j < VAR_COUNT; j++) {
+        tol_v[j] = tol;
+      }
+    } else if (var_index(name.c_str()) >= 0) {
+      tol_v[var_index(name.c_str())] = tol;
+    } else if (param_index(name.c_str()) >= 0) {
+      tol_p[param_index(name.c_str())] = tol;
+    } else {
+      cerr << "ERROR: Unknown variable or parameter: '" << name << "'"
+           << endl;
+      return false;
+    }
+  }
+  return true;
+}
+
+/**
+ * Evaluates a module, unless none of its inputs have changed since it was
+ * last evaluated, in which case its outputs from that evaluation are reused.
+ *
+ * @param[in] df     The state of the incremental evaluation.
+ * @param[in] id     The module identifier (see DATAFLOW_MODULES).
+ * @param[in] module The function that evaluates the module.
+ * @param[in] p      The struct of model parameters.
+ * @param[in] v      The struct of state variables.
+ */
+void dataflow_run(DATAFLOW *df, int id,
+                  void (*module)(const PARAMS &p, VARS &v),
+                  const PARAMS &p, VARS &v) {
+  const DATAFLOW_VIEW &view = views[id];
+  DATAFLOW_MODULE &m = df->mods[id];
+
+  if (m.evaluated && view.unchanged(*df, m, p, v)) {
+    m.skips++;
+    if (! df->strict) {
+      view.restore_outputs(m, v);
+      return;
+    }
+    /* Evaluate the module, but retain the saved inputs and outputs, so that
+       the same modules are skipped as if strict mode were disabled. */
+    m.runs++;
+    module(p, v);
+    double err = view.output_error(m, v);
+    if (err > 0) {
+      m.errors++;
+      m.max_error = (err > m.max_error) ? err : m.max_error;
+    }
+    return;
+  }
+
+  m.runs++;
+  view.save_inputs(m, p, v);
+  module(p, v);
+  view.save_outputs(m, v);
+  m.evaluated = true;
+}
+
+/**
+ * Prints the number of times that each module was evaluated and skipped
+ * and, in strict mode, the number of times that the reused outputs would
+ * have differed from the evaluated outputs, and the largest relative
+ * difference in any output.
+ *
+ * @param[in] df  The state of the incremental evaluation.
+ * @param[in] out The stream to which the counts are written.
+ */
+void dataflow_print(const DATAFLOW *df, ostream &out) {
+  out << setw(16) << left << "module" << right << setw(12) << "runs"
+      << setw(12) << "skipped";
+  if (df->strict) {
+    out << setw(12) << "differ" << setw(12) << "max error";
+  }
+  out << endl;
+  for (int i = 0; i < DATAFLOW_COUNT; i++) {
+    const DATAFLOW_MODULE &m = df->mods[i];
+    out << setw(16) << left << views[i].name << right << setw(12) << m.runs
+        << setw(12) << m.skips;
+    if (df->strict) {
+      out << setw(12) << m.errors << setw(12) << setprecision(3)
+          << m.max_error;
+    }
+    out << endl;
+  }
+}
@@ -0,0 +1,30 @@
+/**
+ * Invokes the macro \c X once for each module whose evaluation may be skipped
+ * when its inputs have not changed (see dataflow.cpp). The autonomic module
+ * and the replacement renal module are not included, because they have side
+ * effects other than writing to their output variables.
+ */
+#define DATAFLOW_MODULES(X) \
+  X(module_circdyn) X(module_aldost) X(module_angio) X(module_anp) \
+  X(module_rbc) X(module_o2deliv) X(module_volrec) X(module_adh) \
+  X(module_stress) X(module_thirst) X(module_baro) X(module_special) \
+  X(module_capdyn) X(module_puldyn) X(module_renal) X(module_electro)
+
+/** Identifies each module whose evaluation may be skipped. */
+#define DATAFLOW_ID(MOD) DATAFLOW_##MOD,
+enum { DATAFLOW_MODULES(DATAFLOW_ID) DATAFLOW_COUNT };
+#undef DATAFLOW_ID
+
+/** The state of the incremental evaluation of the model equations. */
+struct DATAFLOW;
+
+/** The incremental evaluation (if any) used by the current thread. */
+extern __thread DATAFLOW *dataflow;
+
+DATAFLOW *dataflow_new(bool strict);
+void dataflow_delete(DATAFLOW *df);
+bool dataflow_tolerances(DATAFLOW *df, const std::string &spec);
+void dataflow_run(DATAFLOW *df, int id,
+                  void (*module)(const PARAMS &p, VARS &v),
+                  const PARAMS &p, VARS &v);
+void dataflow_print(const DATAFLOW *df, std::ostream &out);
@@ -85,10 +85,14 @@ void print_model_state(const PARAMS &p, const VARS &v, char *prefix) {
  * and a pointer to data that is specific to that instrument. The list of all
  * registered instruments is stored as a singly-linked list, since there is no
  * need to traverse the list in reverse.
+ *
+ * Each instrument may also have its own list of filters, which only apply to
+ * the notifications of that instrument.
  */
 struct list_item {
   bool (*notify)(const PARAMS &p, const VARS &v, void *data);
   void *data;
+  list_item *filters;
   list_item *next;
 };
 
@@ -122,6 +126,7 @@ bool add_item(instrument item, void *data, list_item **list) {
   /* Populate the item with the appropriate details. */
   entry->notify = item;
   entry->data = data;
+  entry->filters = NULL;
   entry->next = *list;
 
   /* Add the item to the head of the list. */
@@ -143,6 +148,45 @@ bool add_instrument(instrument instr, void *data) {
   return add_item(instr, data, &list_instruments);
 }
 
+/**
+ * This function frees every item in a list.
+ *
+ * @param[in] list The head of the list.
+ */
+void free_items(list_item *list) {
+  while (list) {
+    list_item *next = list->next;
+    free(list);
+    list = next;
+  }
+}
+
+/**
+ * This function removes a registered instrument (and any filters that only
+ * apply to this instrument), so that it will no longer be notified.
+ *
+ * @param[in] instr A pointer to the instrument function.
+ * @param[in] data A pointer to the instrument-specific data (if any).
+ *
+ * @return \c true if the instrument was removed, or \c false if it was not
+ *         registered.
+ */
+bool remove_instrument(instrument instr, void *data) {
+  list_item **link = &list_instruments;
+  while (*link && ((*link)->notify != instr || (*link)->data != data)) {
+    link = &(*link)->next;
+  }
+  if (! *link) {
+    return false;
+  }
+
+  list_item *item = *link;
+  *link = item->next;
+  free_items(item->filters);
+  free(item);
+  return true;
+}
+
 /**
  * This function registers a filter to determine which notifications reach the
  * registered instruments.
@@ -158,22 +202,72 @@ bool add_filter(filter filter, void *data) {
 }
 
 /**
- * This function notifies all registered instruments of the current model
- * state.
+ * This function registers a filter that only determines which notifications
+ * reach a single registered instrument. An instrument's filters are applied
+ * in the order that they were registered, after the filters that apply to all
+ * instruments.
+ *
+ * @param[in] instr A pointer to the (registered) instrument function.
+ * @param[in] data A pointer to the instrument-specific data (if any).
+ * @param[in] filter A pointer to the filter function.
+ * @param[in] fdata A pointer to the filter-specific data (if any).
+ *
+ * @return \c true if the filter was registered successfully, or \c false
+ *         if the instrument is not registered or there is insufficient memory
+ *         available.
+ */
+bool add_instrument_filter(instrument instr, void *data, filter filter,
+                           void *fdata) {
+  /* Find the registered instrument. */
+  list_item *item = list_instruments;
+  while (item && (item->notify != instr || item->data != data)) {
+    item = item->next;
+  }
+  if (! item) {
+    return false;
+  }
+
+  /* Add the filter to the tail of the instrument's list of filters. */
+  list_item **tail = &item->filters;
+  while (*tail) {
+    tail = &(*tail)->next;
+  }
+  return add_item(filter, fdata, tail);
+}
+
+/**
+ * This function determines whether a notification passes every filter in a
+ * list of filters.
  *
  * @param[in] p The struct of model parameters.
  * @param[in] v The struct of state variables.
+ * @param[in] filter The head of the list of filters.
+ *
+ * @return \c true if no filter blocked the notification, otherwise \c false.
  */
-void notify_instruments(const PARAMS &p, const VARS &v) {
-  /* Check whether this notification is permitted by the filters. */
-  list_item *filter = list_filters;
+bool apply_filters(const PARAMS &p, const VARS &v, list_item *filter) {
   while (filter) {
     if (! filter->notify(p, v, filter->data)) {
       /* A filter blocked this notification by returning false. */
-      return;
+      return false;
     }
     filter = filter->next;
   }
+  return true;
+}
+
+/**
+ * This function notifies all registered instruments of the current model
+ * state.
+ *
+ * @param[in] p The struct of model parameters.
+ * @param[in] v The struct of state variables.
+ */
+void notify_instruments(const PARAMS &p, const VARS &v) {
+  /* Check whether this notification is permitted by the filters. */
+  if (! apply_filters(p, v, list_filters)) {
+    return;
+  }
 
   /* Pointers to the current, previous and next instruments in the list. */
   list_item *curr = list_instruments;
@@ -184,8 +278,12 @@ void notify_instruments(const PARAMS &p, const VARS &v) {
 
   /* Notify each instrument in turn. */
   while (curr) {
-    /* Notify the instrument and determine if it should be retained.*/
-    keep = curr->notify(p, v, curr->data);
+    /* Notify the instrument (unless one of its own filters blocks this
+       notification) and determine if it should be retained.*/
+    keep = true;
+    if (apply_filters(p, v, curr->filters)) {
+      keep = curr->notify(p, v, curr->data);
+    }
     /* Update the pointer to the next instrument. */
     next = curr->next;
 
@@ -195,6 +293,7 @@ void notify_instruments(const PARAMS &p, const VARS &v) {
       curr = next;
     } else {
       /* Remove the instrument and update the pointers. */
+      free_items(curr->filters);
       free(curr);
       curr = next;
       if (prev) {
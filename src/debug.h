@@ -26,5 +26,8 @@ typedef bool (*instrument)(const PARAMS &p, const VARS &v, void *data);
 typedef bool (*filter)(const PARAMS &p, const VARS &v, void *data);
 
 bool add_instrument(instrument instr, void *data);
+bool remove_instrument(instrument instr, void *data);
 bool add_filter(filter filter, void *data);
+bool add_instrument_filter(instrument instr, void *data, filter filter,
+                           void *fdata);
 void notify_instruments(const PARAMS &p, const VARS &v);
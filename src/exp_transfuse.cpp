@@ -30,61 +30,31 @@
  * To lose blood or only plasma (ie, zero hematocrit), use the procedure
  * outlined above but with a negative transfusion rate TRNSFS.
  *
+ * The fluid that is transfused (or lost) depends on the experiment variant
+ * (see exp_variants.cpp); by default, it is blood (see exp_transfuse_blood()).
+ *
  * @param[in] p      The struct of model parameters.
  * @param[in] v      The struct of state variables.
  *
  * \ingroup experiments
  */
 void exp_transfuse(PARAMS &p, VARS &v) {
+  exp_transfuse_with(p, v, exp_transfuse_blood);
+}
+
+/**
+ * Performs the transfusion experiment (see exp_transfuse()) with an
+ * arbitrary transfused fluid.
+ *
+ * @param[in] p      The struct of model parameters.
+ * @param[in] v      The struct of state variables.
+ * @param[in] fluid  The function that transfuses the fluid.
+ */
+void exp_transfuse_with(PARAMS &p, VARS &v, transfusion fluid) {
   if (p.timetr > 0) {
     double pcnt = 0.01 * v.i;
 
-#ifdef UTTAMSINGH2
-    double pcnt_p = p.trnsfs * pcnt;
-    v.vp = v.vp + pcnt_p;
-    v.nae = v.nae + pcnt_p * 4349.76;
-#elif defined IKEDA7
-    double pcnt_p = p.trnsfs * pcnt;
-    if (v.t < 41760) {
-        // saline loss
-        v.vp = v.vp + pcnt_p;
-        v.nae = v.nae + pcnt_p * v.cna;
-    } else {
-        // infuse the fluid treatment and maintenance amount
-        v.vp = v.vp + pcnt_p;
-        v.nae = v.nae + pcnt_p * v.cna;
-    }
-#elif defined IKEDA7A
-    double pcnt_p = p.trnsfs * pcnt;
-    if (v.t < 41760) {
-        // saline loss
-        v.vp = v.vp + pcnt_p;
-        v.nae = v.nae + pcnt_p * v.cna;
-    } else {
-        // fluid treatment
-        if (v.vud >= 0.001) {
-            // only infuse the maintenance amount
-            pcnt_p = 0.001 * pcnt;
-            v.vp = v.vp + pcnt_p;
-            v.nae = v.nae + pcnt_p * v.cna;
-        } else {
-            // infuse the fluid treatment and maintenance amount
-            v.vp = v.vp + pcnt_p;
-            v.nae = v.nae + pcnt_p * v.cna;
-        }
-    }
-#else
-    double pcnt_p = p.trnsfs * pcnt * (100 - p.hmtrns);
-    double pcnt_c = p.trnsfs * pcnt * p.hmtrns;
-
-    v.vic = v.vic + pcnt_c;
-    v.vrc = v.vrc + pcnt_c;
-    v.vp = v.vp + pcnt_p;
-    v.nae = v.nae + pcnt_p * v.cna;
-    v.ke = v.ke + pcnt_p * v.cke;
-    v.ki = v.ki + pcnt_c * v.cki;
-    v.prp = v.prp + pcnt_p * v.cpp;
-#endif
+    fluid(p, v, pcnt);
 
     v.trnstm = v.trnstm + v.i;
     if (v.trnstm > p.timetr) {
@@ -93,3 +63,92 @@ void exp_transfuse(PARAMS &p, VARS &v) {
     }
   }
 }
+
+/**
+ * Transfuses blood with a hematocrit of HMTRNS (or causes blood loss).
+ *
+ * @param[in] p      The struct of model parameters.
+ * @param[in] v      The struct of state variables.
+ * @param[in] pcnt   The fraction of TRNSFS that is transfused in this
+ *                   time-step, in percent of the hematocrit.
+ */
+void exp_transfuse_blood(const PARAMS &p, VARS &v, double pcnt) {
+  double pcnt_p = p.trnsfs * pcnt * (100 - p.hmtrns);
+  double pcnt_c = p.trnsfs * pcnt * p.hmtrns;
+
+  v.vic = v.vic + pcnt_c;
+  v.vrc = v.vrc + pcnt_c;
+  v.vp = v.vp + pcnt_p;
+  v.nae = v.nae + pcnt_p * v.cna;
+  v.ke = v.ke + pcnt_p * v.cke;
+  v.ki = v.ki + pcnt_c * v.cki;
+  v.prp = v.prp + pcnt_p * v.cpp;
+}
+
+/**
+ * Infuses hypertonic saline (or causes its loss), as per the saline load of
+ * Uttamsingh et al. (1985), section 3.2.
+ *
+ * @param[in] p      The struct of model parameters.
+ * @param[in] v      The struct of state variables.
+ * @param[in] pcnt   The fraction of TRNSFS that is transfused in this
+ *                   time-step.
+ */
+void exp_transfuse_hypertonic(const PARAMS &p, VARS &v, double pcnt) {
+  double pcnt_p = p.trnsfs * pcnt;
+  v.vp = v.vp + pcnt_p;
+  v.nae = v.nae + pcnt_p * 4349.76;
+}
+
+/**
+ * Causes the loss of saline at the extracellular sodium concentration, and
+ * then infuses the fluid treatment, as per Ikeda et al. (1979).
+ *
+ * @param[in] p      The struct of model parameters.
+ * @param[in] v      The struct of state variables.
+ * @param[in] pcnt   The fraction of TRNSFS that is transfused in this
+ *                   time-step.
+ */
+void exp_transfuse_isotonic(const PARAMS &p, VARS &v, double pcnt) {
+  double pcnt_p = p.trnsfs * pcnt;
+  if (v.t < 41760) {
+      // saline loss
+      v.vp = v.vp + pcnt_p;
+      v.nae = v.nae + pcnt_p * v.cna;
+  } else {
+      // infuse the fluid treatment and maintenance amount
+      v.vp = v.vp + pcnt_p;
+      v.nae = v.nae + pcnt_p * v.cna;
+  }
+}
+
+/**
+ * Causes the loss of saline at the extracellular sodium concentration, and
+ * then infuses the fluid treatment, as per Ikeda et al. (1979), except that
+ * only the maintenance amount is infused while urine output is adequate.
+ *
+ * @param[in] p      The struct of model parameters.
+ * @param[in] v      The struct of state variables.
+ * @param[in] pcnt   The fraction of TRNSFS that is transfused in this
+ *                   time-step.
+ */
+void exp_transfuse_treatment(const PARAMS &p, VARS &v, double pcnt) {
+  double pcnt_p = p.trnsfs * pcnt;
+  if (v.t < 41760) {
+      // saline loss
+      v.vp = v.vp + pcnt_p;
+      v.nae = v.nae + pcnt_p * v.cna;
+  } else {
+      // fluid treatment
+      if (v.vud >= 0.001) {
+          // only infuse the maintenance amount
+          pcnt_p = 0.001 * pcnt;
+          v.vp = v.vp + pcnt_p;
+          v.nae = v.nae + pcnt_p * v.cna;
+      } else {
+          // infuse the fluid treatment and maintenance amount
+          v.vp = v.vp + pcnt_p;
+          v.nae = v.nae + pcnt_p * v.cna;
+      }
+  }
+}
@@ -1 +1,7 @@
+typedef void (*transfusion)(const PARAMS &p, VARS &v, double pcnt);
 void exp_transfuse(PARAMS &p, VARS &v);
+void exp_transfuse_with(PARAMS &p, VARS &v, transfusion fluid);
+void exp_transfuse_blood(const PARAMS &p, VARS &v, double pcnt);
+void exp_transfuse_hypertonic(const PARAMS &p, VARS &v, double pcnt);
+void exp_transfuse_isotonic(const PARAMS &p, VARS &v, double pcnt);
+void exp_transfuse_treatment(const PARAMS &p, VARS &v, double pcnt);
@@ -0,0 +1,134 @@
+/**
+ * Variants of the model that are required by specific experiments, which
+ * are selected at run-time by the experiment definition:
+ *
+ * @code
+ * variant= uttamsingh2
+ * @endcode
+ *
+ * Each variant replaces some of the modules of the model (and the fluid that
+ * is given by the transfusion experiment), so variants impose no cost on
+ * the simulation of other experiments. Additional variants can be
+ * registered with exp_register_variant().
+ *
+ * The built-in variants are:
+ * - \b vanilla the unmodified model (the default).
+ * - \b uttamsingh1 the water load of Uttamsingh et al. (1985), section 3.1.
+ * - \b uttamsingh2 the hypertonic saline load of Uttamsingh et al. (1985),
+ *      section 3.2.
+ * - \b ikeda7 the salt depletion and fluid treatment of Ikeda et al. (1979).
+ * - \b ikeda7a as per \b ikeda7, but only giving the maintenance amount of
+ *      fluid while urine output is adequate.
+ */
+
+#include <cstring>
+#include <deque>
+
+using namespace std;
+
+#include "params.h"
+#include "vars.h"
+#include "module_thirst.h"
+#include "module_electro.h"
+#include "exp_transfuse.h"
+#include "exp_variants.h"
+
+/**
+ * Gives a water load of 1 L at the start of the experiment (t = 4 weeks),
+ * as per Uttamsingh et al., Med Biol Eng Comput 23(6):525-35, 1985.
+ *
+ * @param[in] p      The struct of model parameters.
+ * @param[in] v      The struct of state variables.
+ *
+ * \ingroup experiments
+ */
+void exp_uttamsingh1_electro(const PARAMS &p, VARS &v) {
+  module_electro_balance(p, v);
+  if (v.t < 40320.0 && (v.t + v.i) >= 40320.0) {
+    v.vtw += 1.0;
+  }
+  module_electro_fluids(p, v);
+}
+
+/**
+ * Deprives the body of fluid intake for the 16 hours before the start of
+ * the experiment (t = 4 weeks), as per Uttamsingh et al., Med Biol Eng
+ * Comput 23(6):525-35, 1985.
+ *
+ * @param[in] p      The struct of model parameters.
+ * @param[in] v      The struct of state variables.
+ *
+ * \ingroup experiments
+ */
+void exp_uttamsingh2_thirst(const PARAMS &p, VARS &v) {
+  module_thirst(p, v);
+  if (v.t >= 39360 && v.t <= 40320) {
+    v.tvd = 0;
+  }
+}
+
+/**
+ * Returns the registered variants, the first of which is the default.
+ * References to the variants remain valid when new variants are registered.
+ */
+static deque<EXP_VARIANT> &variants() {
+  static deque<EXP_VARIANT> vs;
+  if (vs.empty()) {
+    EXP_VARIANT builtin[] = {
+      {"vanilla", module_thirst, module_electro, exp_transfuse_blood},
+      {"uttamsingh1", module_thirst, exp_uttamsingh1_electro,
+       exp_transfuse_blood},
+      {"uttamsingh2", exp_uttamsingh2_thirst, module_electro,
+       exp_transfuse_hypertonic},
+      {"ikeda7", module_thirst, module_electro, exp_transfuse_isotonic},
+      {"ikeda7a", module_thirst, module_electro, exp_transfuse_treatment},
+    };
+    vs.assign(builtin, builtin + sizeof(builtin) / sizeof(builtin[0]));
+  }
+  return vs;
+}
+
+/**
+ * Returns the default variant (the unmodified model).
+ */
+const EXP_VARIANT *exp_variant_default() {
+  return &variants().front();
+}
+
+/**
+ * Returns the variant with the given name.
+ *
+ * @param[in] name The name of the variant.
+ *
+ * @return The variant, or \c NULL if there is no such variant.
+ */
+const EXP_VARIANT *exp_variant(const char *name) {
+  deque<EXP_VARIANT> &vs = variants();
+  for (size_t i = 0; i < vs.size(); i++) {
+    if (! strcmp(vs[i].name, name)) {
+      return &vs[i];
+    }
+  }
+  return NULL;
+}
+
+/**
+ * Registers a new variant, which can then be selected by experiment
+ * definitions. Variants should be registered before any experiments are
+ * loaded, and must not be registered while simulations are running in other
+ * threads.
+ *
+ * @param[in] variant The variant. The name must remain valid for as long as
+ *                    the variant can be used.
+ *
+ * @return \c true if the variant was registered, or \c false if a variant
+ *         with the same name already exists or a module is missing.
+ */
+bool exp_register_variant(const EXP_VARIANT &variant) {
+  if (! variant.name || ! variant.thirst || ! variant.electro
+      || ! variant.fluid || exp_variant(variant.name)) {
+    return false;
+  }
+  variants().push_back(variant);
+  return true;
+}
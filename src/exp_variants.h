@@ -0,0 +1,13 @@
+/** A variant of the model that is required by a specific experiment. */
+struct EXP_VARIANT {
+  const char *name; /** The name of the variant. */
+  void (*thirst)(const PARAMS &p, VARS &v); /** The thirst drive module. */
+  void (*electro)(const PARAMS &p, VARS &v); /** The electrolytes module. */
+  transfusion fluid; /** The fluid given by the transfusion experiment. */
+};
+
+const EXP_VARIANT *exp_variant_default();
+const EXP_VARIANT *exp_variant(const char *name);
+bool exp_register_variant(const EXP_VARIANT &variant);
+void exp_uttamsingh1_electro(const PARAMS &p, VARS &v);
+void exp_uttamsingh2_thirst(const PARAMS &p, VARS &v);
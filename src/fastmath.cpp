@@ -0,0 +1,73 @@
+/**
+ * @file
+ * Batch versions of the fast approximations of the power and exponential
+ * functions (see fastmath.h), which apply an approximation to each element of
+ * an array. The approximations are inlined and contain no branches (other
+ * than for the non-positive bases of fm_pow_batch(), which are selected after
+ * the fact), so that these loops are vectorised by the compiler when the
+ * model is built with optimisations.
+ *
+ * Unlike fm_exp() and fm_pow(), the batch versions always use the fast
+ * approximations, regardless of whether the model is built with FASTMATH=1.
+ */
+
+#include <cmath>
+
+using namespace std;
+
+#include "fastmath.h"
+
+/**
+ * Calculates an approximation of exp(x) for each element of an array.
+ *
+ * @param[in] x The array of arguments.
+ * @param[out] y The array of results (which may be \c x).
+ * @param[in] n The length of the arrays.
+ */
+void fm_exp_batch(const double *x, double *y, unsigned long n) {
+  for (unsigned long i = 0; i < n; i++) {
+    y[i] = fm_exp_fast(x[i]);
+  }
+}
+
+/**
+ * Calculates an approximation of log(x) for each element of an array, each
+ * of which must be positive and normal.
+ *
+ * @param[in] x The array of arguments.
+ * @param[out] y The array of results (which may be \c x).
+ * @param[in] n The length of the arrays.
+ */
+void fm_log_batch(const double *x, double *y, unsigned long n) {
+  for (unsigned long i = 0; i < n; i++) {
+    y[i] = fm_log_fast(x[i]);
+  }
+}
+
+/**
+ * Calculates an approximation of pow(x, y) for each pair of elements of two
+ * arrays. The elements of \c x that are not positive and normal are passed to
+ * the standard pow().
+ *
+ * @param[in] x The array of bases.
+ * @param[in] y The array of exponents.
+ * @param[out] z The array of results (which must not overlap \c x or \c y).
+ * @param[in] n The length of the arrays.
+ */
+void fm_pow_batch(const double *x, const double *y, double *z,
+                  unsigned long n) {
+  unsigned long slow = 0;
+  for (unsigned long i = 0; i < n; i++) {
+    double xi = x[i];
+    bool fast = xi >= FM_MIN_NORMAL;
+    slow += ! fast;
+    z[i] = fm_exp_fast(y[i] * fm_log_fast(fast ? xi : 1.0));
+  }
+  if (slow) {
+    for (unsigned long i = 0; i < n; i++) {
+      if (! (x[i] >= FM_MIN_NORMAL)) {
+        z[i] = pow(x[i], y[i]);
+      }
+    }
+  }
+}
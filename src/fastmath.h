@@ -0,0 +1,222 @@
+/**
+ * Fast approximations of the power and exponential functions that are called
+ * by the model equations, which are used for double-precision arithmetic when
+ * the model is built with FASTMATH=1 (ie, when G92_FASTMATH is defined).
+ * Otherwise, and for every other scalar type (see scalar.h), each function
+ * calls the corresponding standard function, so that the results are
+ * identical to calling the standard function directly.
+ *
+ * The errors of the approximations, relative to the correctly-rounded result
+ * and measured in units in the last place (ULP) over 10^7 random arguments,
+ * are:
+ * - fm_exp(x): at most 1 ULP, for -708 <= x <= 709 (x is clamped to this
+ *   range, so the result neither overflows nor underflows).
+ * - fm_log(x): at most 2 ULP, for positive normal x.
+ * - fm_pow(x, y): at most 1 + 3 |y log(x)| ULP, for positive normal x
+ *   (other values of x are passed to the standard pow()).
+ * - fm_ipow<N>(x): at most N - 1 ULP (a product of N factors, by repeated
+ *   squaring), for integers N >= 0.
+ * - fm_rpow<P, Q>(x): at most P ULP for Q = 2 and P + 1 ULP for Q = 4 (by
+ *   successive square roots), and as per fm_pow() otherwise.
+ *
+ * Note that the pow() and exp() functions of recent C libraries are already
+ * fast, so that fm_exp() and fm_pow() only pay off when they are inlined and
+ * vectorised (ie, in optimised builds); fm_ipow() and fm_rpow() replace calls
+ * to pow() with multiplications and square roots, which pays off in any build.
+ *
+ * The batch versions (eg, fm_exp_batch()) apply these approximations to each
+ * element of an array, without branches, so that the loops are vectorised by
+ * the compiler (see fastmath.cpp). See utils/fastmath_report.sh for a
+ * comparison of the model outputs of each experiment with and without these
+ * approximations.
+ */
+
+/** The bits of a double-precision value. */
+union FM_BITS {
+  double d; /** The value. */
+  unsigned long long u; /** The bits of the value. */
+};
+
+/** Adding this constant to a value rounds it to the nearest integer, which
+    is stored in the low bits of the sum (1.5 * 2^52). */
+#define FM_ROUND 6755399441055744.0
+/** The high and low parts of log(2), as per fdlibm. */
+#define FM_LN2_HI 6.93147180369123816490e-01
+#define FM_LN2_LO 1.90821492927058770002e-10
+/** The smallest positive normal double-precision value. */
+#define FM_MIN_NORMAL 2.2250738585072014e-308
+
+/**
+ * Returns an approximation of exp(x), by reducing x to x = k log(2) + r with
+ * |r| <= log(2) / 2, and evaluating the Taylor series of exp(r) to degree 13
+ * (whose truncation error is less than 0.05 ULP).
+ */
+inline double fm_exp_fast(double x) {
+  x = (x > 709.0) ? 709.0 : (x < -708.0) ? -708.0 : x;
+  FM_BITS k;
+  k.d = x * 1.4426950408889634 + FM_ROUND;
+  double kd = k.d - FM_ROUND;
+  double r = (x - kd * FM_LN2_HI) - kd * FM_LN2_LO;
+  /* Evaluate the polynomial by Estrin's scheme, which has a shorter chain
+     of dependent operations than Horner's scheme. */
+  double r2 = r * r;
+  double r4 = r2 * r2;
+  double p1 = 0.5 + r * 1.6666666666666666e-01;
+  double p2 = 4.1666666666666664e-02 + r * 8.3333333333333332e-03;
+  double p3 = 1.3888888888888889e-03 + r * 1.9841269841269841e-04;
+  double p4 = 2.4801587301587302e-05 + r * 2.7557319223985893e-06;
+  double p5 = 2.7557319223985888e-07 + r * 2.5052108385441720e-08;
+  double p6 = 2.0876756987868100e-09 + r * 1.6059043836821613e-10;
+  double q0 = r + r2 * p1;
+  double q1 = p2 + r2 * p3;
+  double q2 = p4 + r2 * p5;
+  /* Add the leading term last, which reduces the rounding error. */
+  double p = 1.0 + (q0 + r4 * (q1 + r4 * (q2 + r4 * p6)));
+  /* The low 12 bits of k hold k + 1023 (mod 4096), the biased exponent. */
+  FM_BITS scale;
+  scale.u = (k.u + 1023) << 52;
+  return p * scale.d;
+}
+
+/**
+ * Returns an approximation of log(x) for positive normal x, by reducing x to
+ * x = 2^e m with sqrt(2) / 2 <= m < sqrt(2), and evaluating the series
+ * log(m) = 2 atanh(s) with s = (m - 1) / (m + 1), to degree 19 (whose
+ * truncation error is less than 0.05 ULP).
+ */
+inline double fm_log_fast(double x) {
+  FM_BITS b;
+  b.d = x;
+  double e = (double) (b.u >> 52) - 1023;
+  b.u = (b.u & 0x000FFFFFFFFFFFFFULL) | 0x3FF0000000000000ULL;
+  double m = b.d;
+  e = (m > 1.4142135623730951) ? e + 1 : e;
+  m = (m > 1.4142135623730951) ? m * 0.5 : m;
+  double s = (m - 1) / (m + 1);
+  double z = s * s;
+  double z2 = z * z;
+  double z4 = z2 * z2;
+  double p0 = 1.0 / 3 + z * (1.0 / 5);
+  double p1 = 1.0 / 7 + z * (1.0 / 9);
+  double p2 = 1.0 / 11 + z * (1.0 / 13);
+  double p3 = 1.0 / 15 + z * (1.0 / 17);
+  double p = (p0 + z2 * p1) + z4 * ((p2 + z2 * p3) + z4 * (1.0 / 19));
+  return e * FM_LN2_HI + (2 * s + (2 * s * z * p + e * FM_LN2_LO));
+}
+
+/**
+ * Returns an approximation of pow(x, y), as exp(y log(x)) for positive normal
+ * x, and otherwise returns the standard pow(x, y).
+ */
+inline double fm_pow_fast(double x, double y) {
+  if (x >= FM_MIN_NORMAL) {
+    return fm_exp_fast(y * fm_log_fast(x));
+  }
+  return pow(x, y);
+}
+
+/** Returns exp(x). */
+template <typename T>
+inline T fm_exp(const T &x) {
+  return exp(x);
+}
+
+/** Returns pow(x, y). */
+template <typename T>
+inline T fm_pow(const T &x, const T &y) {
+  return pow(x, y);
+}
+template <typename T>
+inline T fm_pow(const T &x, double y) {
+  return pow(x, y);
+}
+template <typename T>
+inline T fm_pow(double x, const T &y) {
+  return pow(x, y);
+}
+
+#ifdef G92_FASTMATH
+inline double fm_exp(double x) {
+  return fm_exp_fast(x);
+}
+inline double fm_pow(double x, double y) {
+  return fm_pow_fast(x, y);
+}
+#else
+inline double fm_exp(double x) {
+  return exp(x);
+}
+inline double fm_pow(double x, double y) {
+  return pow(x, y);
+}
+#endif
+
+/**
+ * Evaluates x^N for a non-negative integer N that is known at compile time,
+ * by repeated squaring.
+ */
+template <int N>
+struct FM_IPOW {
+  static double eval(double x) {
+    double h = FM_IPOW<N / 2>::eval(x);
+    return (N % 2) ? h * h * x : h * h;
+  }
+};
+template <>
+struct FM_IPOW<1> {
+  static double eval(double x) { return x; }
+};
+template <>
+struct FM_IPOW<0> {
+  static double eval(double x) { return 1; }
+};
+
+/**
+ * Evaluates x^(1/Q) for a positive integer Q that is known at compile time:
+ * by square roots when Q is 2 or 4, and otherwise by fm_pow_fast().
+ */
+template <int Q>
+struct FM_ROOT {
+  static double eval(double x) { return fm_pow_fast(x, 1.0 / Q); }
+};
+template <>
+struct FM_ROOT<2> {
+  static double eval(double x) { return sqrt(x); }
+};
+template <>
+struct FM_ROOT<4> {
+  static double eval(double x) { return sqrt(sqrt(x)); }
+};
+
+/** Returns x^N, for a non-negative integer N. */
+template <int N, typename T>
+inline T fm_ipow(const T &x) {
+  return pow(x, N);
+}
+template <int N>
+inline double fm_ipow(double x) {
+#ifdef G92_FASTMATH
+  return FM_IPOW<N>::eval(x);
+#else
+  return pow(x, N);
+#endif
+}
+
+/** Returns x^(P/Q), for a non-negative integer P and a positive integer Q. */
+template <int P, int Q, typename T>
+inline T fm_rpow(const T &x) {
+  return pow(x, (double) P / Q);
+}
+template <int P, int Q>
+inline double fm_rpow(double x) {
+#ifdef G92_FASTMATH
+  return FM_IPOW<P>::eval(FM_ROOT<Q>::eval(x));
+#else
+  return pow(x, (double) P / Q);
+#endif
+}
+
+void fm_exp_batch(const double *x, double *y, unsigned long n);
+void fm_log_batch(const double *x, double *y, unsigned long n);
+void fm_pow_batch(const double *x, const double *y, double *z,
+                  unsigned long n);
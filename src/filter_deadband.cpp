@@ -0,0 +1,111 @@
+#include <cmath>
+#include <iostream>
+#include <vector>
+using namespace std;
+
+#include "params.h"
+#include "vars.h"
+#include "filter_deadband.h"
+
+/**
+ * A single state variable whose changes are monitored by this filter.
+ */
+struct DEADBAND {
+  int index; /** The index of the state variable in the VARS struct. */
+  double abs_tol; /** The absolute deadband (ignored if not positive). */
+  double rel_tol; /** The relative deadband (ignored if not positive). */
+  double last; /** The value at the last permitted notification. */
+};
+
+/**
+ * This struct type stores the options and the state of this filter.
+ */
+struct FILTER_DEADBAND_OPTIONS {
+  std::vector<DEADBAND> vars; /** The monitored state variables. */
+  bool first; /** Whether a notification has yet to be permitted. */
+};
+
+/**
+ * The options for this filter are the state variables that it monitors,
+ * which are added by filter_deadband_add().
+ */
+void *filter_deadband_opts() {
+  FILTER_DEADBAND_OPTIONS *opts = new FILTER_DEADBAND_OPTIONS;
+  opts->first = true;
+  return (void *) opts;
+}
+
+/**
+ * Adds a state variable to be monitored by this filter.
+ *
+ * @param[in] data The options for the filter (see filter_deadband_opts()).
+ * @param[in] name The name of the state variable.
+ * @param[in] abs_tol The absolute deadband; set to zero to disable.
+ * @param[in] rel_tol The relative deadband (relative to the value at the last
+ *                    permitted notification); set to zero to disable.
+ *
+ * @return \c true if the state variable was added, or \c false if there is
+ *         no state variable with the given name.
+ */
+bool filter_deadband_add(void *data, const char *name, double abs_tol,
+                         double rel_tol) {
+  FILTER_DEADBAND_OPTIONS *opts = (FILTER_DEADBAND_OPTIONS *) data;
+  int index = var_index(name);
+  if (index < 0) {
+    cerr << "ERROR: Unknown variable name \"" << name << "\"" << endl;
+    return false;
+  }
+
+  DEADBAND db;
+  db.index = index;
+  db.abs_tol = abs_tol;
+  db.rel_tol = rel_tol;
+  db.last = 0;
+  opts->vars.push_back(db);
+  return true;
+}
+
+/**
+ * This filter only permits a notification when at least one of the
+ * monitored state variables has changed, since the last permitted
+ * notification, by more than its absolute or relative deadband. The first
+ * notification is always permitted.
+ *
+ * @param[in] p The struct of model parameters.
+ * @param[in] v The struct of state variables.
+ * @param[in] data The options for the filter (see filter_deadband_opts()).
+ *
+ * @return \c true if the notification should be passed to the registered
+ *         instruments, or \c false if it should not.
+ *
+ * \ingroup filters
+ */
+bool filter_deadband(const PARAMS &p, const VARS &v, void *data) {
+  FILTER_DEADBAND_OPTIONS *opts = (FILTER_DEADBAND_OPTIONS *) data;
+  if (! opts || opts->vars.empty()) {
+    return true;
+  }
+
+  /* The VARS struct only contains doubles, so it can be treated as an array
+     of doubles. */
+  const double *vars = (const double *) &v;
+  bool permit = opts->first;
+  for (size_t i = 0; i < opts->vars.size() && ! permit; i++) {
+    const DEADBAND &db = opts->vars[i];
+    double change = fabs(vars[db.index] - db.last);
+    if (db.abs_tol > 0 && change > db.abs_tol) {
+      permit = true;
+    } else if (db.rel_tol > 0 && change > db.rel_tol * fabs(db.last)) {
+      permit = true;
+    }
+  }
+
+  if (permit) {
+    /* Record the values at this notification. */
+    opts->first = false;
+    for (size_t i = 0; i < opts->vars.size(); i++) {
+      opts->vars[i].last = vars[opts->vars[i].index];
+    }
+  }
+  return permit;
+}
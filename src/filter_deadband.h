@@ -0,0 +1,4 @@
+void *filter_deadband_opts();
+bool filter_deadband_add(void *data, const char *name, double abs_tol,
+                         double rel_tol);
+bool filter_deadband(const PARAMS &p, const VARS &v, void *data);
@@ -0,0 +1,70 @@
+#include "params.h"
+#include "vars.h"
+#include "filter_interval.h"
+
+/**
+ * This struct type stores the options and the state of this filter.
+ */
+struct FILTER_INTERVAL_OPTIONS {
+  double interval; /** The minimum interval between notifications (min). */
+  double start; /** The time of the first notification (min). */
+  unsigned long count; /** The number of intervals that have passed. */
+  bool first; /** Whether a notification has yet to be permitted. */
+};
+
+/**
+ * The options for this filter are:
+ *
+ * @param[in] interval The minimum interval of simulation time (min) between
+ *                     permitted notifications.
+ */
+void *filter_interval_opts(double interval) {
+  FILTER_INTERVAL_OPTIONS *opts = new FILTER_INTERVAL_OPTIONS;
+  opts->interval = interval;
+  opts->start = 0;
+  opts->count = 0;
+  opts->first = true;
+  return (void *) opts;
+}
+
+/**
+ * This filter permits a notification whenever the given interval of
+ * simulation time has passed, starting with the first notification. The
+ * permitted times are multiples of the interval (relative to the time of the
+ * first notification), so that rounding errors do not accumulate. If the
+ * simulation time moves backwards (ie, a new simulation has started), the
+ * filter starts again.
+ *
+ * @param[in] p The struct of model parameters.
+ * @param[in] v The struct of state variables.
+ * @param[in] data The options for the filter (see filter_interval_opts()).
+ *
+ * @return \c true if the notification should be passed to the registered
+ *         instruments, or \c false if it should not.
+ *
+ * \ingroup filters
+ */
+bool filter_interval(const PARAMS &p, const VARS &v, void *data) {
+  FILTER_INTERVAL_OPTIONS *opts = (FILTER_INTERVAL_OPTIONS *) data;
+  if (! opts || opts->interval <= 0) {
+    return true;
+  }
+
+  double last = opts->start + (opts->count - 1) * opts->interval;
+  if (opts->first || v.t < last) {
+    opts->first = false;
+    opts->start = v.t;
+    opts->count = 1;
+    return true;
+  }
+
+  if (v.t < opts->start + opts->count * opts->interval) {
+    return false;
+  }
+
+  /* Skip any intervals that were passed in a single time-step. */
+  while (opts->start + opts->count * opts->interval <= v.t) {
+    opts->count++;
+  }
+  return true;
+}
@@ -0,0 +1,2 @@
+void *filter_interval_opts(double interval);
+bool filter_interval(const PARAMS &p, const VARS &v, void *data);
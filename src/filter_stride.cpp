@@ -0,0 +1,49 @@
+#include "params.h"
+#include "vars.h"
+#include "filter_stride.h"
+
+/**
+ * This struct type stores the options and the state of this filter.
+ */
+struct FILTER_STRIDE_OPTIONS {
+  unsigned long stride; /** The number of notifications per permitted one. */
+  unsigned long count; /** The number of notifications since the last one. */
+};
+
+/**
+ * The options for this filter are:
+ *
+ * @param[in] stride The filter permits one in every \c stride notifications.
+ */
+void *filter_stride_opts(unsigned long stride) {
+  FILTER_STRIDE_OPTIONS *opts = new FILTER_STRIDE_OPTIONS;
+  opts->stride = (stride > 0) ? stride : 1;
+  opts->count = 0;
+  return (void *) opts;
+}
+
+/**
+ * This filter permits every Nth notification, starting with the first.
+ *
+ * @param[in] p The struct of model parameters.
+ * @param[in] v The struct of state variables.
+ * @param[in] data The options for the filter (see filter_stride_opts()).
+ *
+ * @return \c true if the notification should be passed to the registered
+ *         instruments, or \c false if it should not.
+ *
+ * \ingroup filters
+ */
+bool filter_stride(const PARAMS &p, const VARS &v, void *data) {
+  FILTER_STRIDE_OPTIONS *opts = (FILTER_STRIDE_OPTIONS *) data;
+  if (! opts) {
+    return true;
+  }
+
+  bool permit = (opts->count == 0);
+  opts->count++;
+  if (opts->count == opts->stride) {
+    opts->count = 0;
+  }
+  return permit;
+}
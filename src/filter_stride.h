@@ -0,0 +1,2 @@
+void *filter_stride_opts(unsigned long stride);
+bool filter_stride(const PARAMS &p, const VARS &v, void *data);
@@ -4,6 +4,56 @@
 #include "vars.h"
 #include "filter_times.h"
 
+/**
+ * This struct type stores the options and the state of this filter.
+ */
+struct FILTER_TIMES_OPTIONS {
+  const double *times; /** The times at which notifications are permitted. */
+  int index; /** The index of the next time at which to permit notification. */
+};
+
+/**
+ * The options for this filter are:
+ *
+ * @param[in] times An array of doubles, terminated by \c DBL_MAX, indicating
+ *                  the times at which notifications are permitted.
+ *
+ * Each set of options keeps track of its own position in the array of times,
+ * so this filter can be registered several times (eg, for individual
+ * instruments, see add_instrument_filter()).
+ */
+void *filter_times_opts(const double *times) {
+  FILTER_TIMES_OPTIONS *opts = new FILTER_TIMES_OPTIONS;
+  opts->times = times;
+  opts->index = 0;
+  return (void *) opts;
+}
+
+/**
+ * Returns the index of the next time at which a notification will be
+ * permitted (ie, the number of notifications that have been permitted).
+ *
+ * @param[in] data The options for the filter (see filter_times_opts()).
+ */
+int filter_times_index(void *data) {
+  FILTER_TIMES_OPTIONS *opts = (FILTER_TIMES_OPTIONS *) data;
+  return (opts) ? opts->index : 0;
+}
+
+/**
+ * Sets the index of the next time at which a notification will be
+ * permitted, so that a simulation can be resumed from a saved model state.
+ *
+ * @param[in] data The options for the filter (see filter_times_opts()).
+ * @param[in] index The index (see filter_times_index()).
+ */
+void filter_times_seek(void *data, int index) {
+  FILTER_TIMES_OPTIONS *opts = (FILTER_TIMES_OPTIONS *) data;
+  if (opts) {
+    opts->index = index;
+  }
+}
+
 /**
  * This filter restricts the notifications to occur only at specified times.
  * By default, notifications are only permitted at six times during the
@@ -12,8 +62,9 @@
  *
  * @param[in] p The struct of model parameters.
  * @param[in] v The struct of state variables.
- * @param[in] data An optional pointer to an array of doubles, indicating the
- *            times at which notifications are permitted.
+ * @param[in] data The options for the filter (see filter_times_opts()). If
+ *            this is \c NULL, or if the array of times is \c NULL, the default
+ *            times are used.
  *
  * @return \c true if the notification should be passed to the registered
  *         instruments, or \c false if it should not.
@@ -24,14 +75,18 @@ bool filter_times(const PARAMS &p, const VARS &v, void *data) {
   /* The default times at which to print a summary of the model state.
      NOTE: The fifth value was originally 40140 (just under 21 days). */
   static double time[] = {10070, 10075, 10130, 11510, 30230, 40310, DBL_MAX};
-  /* The index of the next time at which to print the model state. */
-  static int index = 0;
+  /* The index of the next time at which to print the default summary. */
+  static int default_index = 0;
+  FILTER_TIMES_OPTIONS *opts = (FILTER_TIMES_OPTIONS *) data;
+
   /* The actual times at which to print a summary of the model state. */
-  double *times = (data) ? (double *) data : time;
+  const double *times = (opts && opts->times) ? opts->times : time;
+  /* The index of the next time at which to print the model state. */
+  int *index = (opts) ? &opts->index : &default_index;
 
   /* Check whether a model state notification should be made. */
-  if (v.t >= times[index]) {
-    index++;
+  if (v.t >= times[*index]) {
+    (*index)++;
     return true;
   }
   return false;
@@ -1 +1,4 @@
+void *filter_times_opts(const double *times);
+int filter_times_index(void *data);
+void filter_times_seek(void *data, int index);
 bool filter_times(const PARAMS &p, const VARS &v, void *data);
@@ -0,0 +1,632 @@
+/**
+ * @file
+ * Calculates the derivatives of selected model outputs, at each sample time,
+ * with respect to selected parameters, by propagating derivatives alongside
+ * a single simulation rather than repeating the simulation for each
+ * parameter.
+ *
+ * The model equations are instantiated with dual numbers (see scalar.h). In
+ * forward mode, the derivatives with respect to DUAL_WIDTH parameters are
+ * carried by each dual copy of the model state, which is advanced alongside
+ * the simulation; the cost grows with the number of parameters. In adjoint
+ * mode, the simulation is run once and the model state is checkpointed every
+ * GRADIENT_SEGMENT time-steps. The derivatives are then propagated backward
+ * from the sample times: each segment is re-simulated from its checkpoint,
+ * and each of its time-steps is recorded on a tape and reversed in turn. The
+ * cost grows with the number of outputs and sample times, but not with the
+ * number of parameters.
+ *
+ * The derivatives are with respect to the parameter values at the start of
+ * the simulation (ie, after the initial changes of the experiment). A
+ * scheduled change to a parameter, or any other change that is not made by
+ * the model equations, replaces its value with a constant. The experiments
+ * that intervene in the model and the model variants (see exp_variants.cpp)
+ * only affect the values of the state variables, not their derivatives.
+ *
+ * These are the derivatives of the simulation along its sequence of
+ * time-steps: the size of each time-step is chosen by the stability test of
+ * module_autonom(), and is treated as a constant (see scalar_const()).
+ * Differentiating the step-size control instead feeds the derivatives of the
+ * stability test back into every subsequent time-step, and they grow without
+ * bound (to 1e54 within a simulated day, and then to NaN). Note that finite
+ * differences of the model outputs also change the sequence of time-steps,
+ * and so do not converge as the perturbation is reduced.
+ *
+ * The derivatives are checked before they are returned, and are rejected if
+ * any is not finite, or is implausibly large (see GRADIENT_MAX_ELASTICITY).
+ * Large derivatives that are not rejected are reported (see
+ * GRADIENT_WARN_ELASTICITY), since the derivatives along a long simulation
+ * can grow much faster than the response to any finite change (e.g. the
+ * derivative of \c pa with respect to \c hsl after two weeks is about twenty
+ * times the slope of the finite differences).
+ */
+
+#include <cstdlib>
+#include <cstring>
+#include <cfloat>
+#include <cmath>
+#include <iostream>
+#include <queue>
+#include <vector>
+#include <string>
+
+using namespace std;
+
+#include "params.h"
+#include "vars.h"
+#include "scalar.h"
+#include "read_exp.h"
+#include "exp_transfuse.h"
+#include "exp_variants.h"
+#include "debug.h"
+#include "guyton92_step.h"
+#include "gradient.h"
+
+/**
+ * The number of time-steps between the checkpoints of an adjoint
+ * calculation. Each segment of time-steps is re-simulated from its
+ * checkpoint, so this bounds the memory required to reverse the segment.
+ */
+#define GRADIENT_SEGMENT 256
+
+/**
+ * The largest plausible elasticity of an output with respect to a parameter:
+ * the relative change in the output (relative to its largest magnitude at any
+ * sample time) per relative change in the parameter.
+ */
+#define GRADIENT_MAX_ELASTICITY 1e6
+
+/**
+ * The largest elasticity (see GRADIENT_MAX_ELASTICITY) that is reported
+ * without a warning that the derivative may not reflect the response of the
+ * output to a finite change in the parameter.
+ */
+#define GRADIENT_WARN_ELASTICITY 10
+
+/** The new value of a single parameter or state variable. */
+struct GRADIENT_SET {
+  int index; /** The index of the parameter or state variable. */
+  double value; /** The new value. */
+};
+
+/**
+ * The state of a calculation of derivatives. The derivatives with respect to
+ * the parameter \c pix[j] of the output \c handles[h] at the sample time
+ * \c times[i] are stored in \c grad[(i * k + h) * n + j].
+ */
+struct GRADIENT {
+  PARAMS *p; /** The struct of model parameters. */
+  VARS *v; /** The struct of state variables. */
+  Experiment *e; /** The experiment (if any) to run. */
+  int mode; /** The mode of calculation (eg, GRADIENT_FORWARD). */
+  vector<int> pix; /** The index of each parameter. */
+  vector<double> p0; /** The initial value of each parameter. */
+  vector<double> times; /** The sample times (mins). */
+  vector<int> handles; /** The outputs (see guyton92_handle()). */
+  size_t samples; /** The number of samples that have been recorded. */
+  vector<double> out; /** The value of each output at each sample time. */
+  vector<double> grad; /** The derivatives (forward mode only). */
+  unsigned long steps; /** The number of time-steps simulated. */
+
+  /* The dual copies of the model state (forward mode only). */
+  vector<PARAMS_T<DUAL> > dp; /** The dual parameters. */
+  vector<VARS_T<DUAL> > dv; /** The dual state variables. */
+
+  /* The model state as it is re-simulated (adjoint mode only). */
+  PARAMS sp; /** The parameters, as per the model equations. */
+  VARS sv; /** The state variables, as per the model equations. */
+  vector<PARAMS> ckpt_p; /** The parameters at each checkpoint. */
+  vector<VARS> ckpt_v; /** The state variables at each checkpoint. */
+  vector<double> t_next; /** The end of each time-step (see
+                             guyton92_update()). */
+  vector<GRADIENT_SET> resets; /** The parameters that were replaced before
+                                   each time-step. */
+  vector<size_t> resets_end; /** The end of each time-step's resets. */
+  vector<GRADIENT_SET> fixes; /** The state variables that were changed
+                                  after each time-step. */
+  vector<size_t> fixes_end; /** The end of each time-step's fixes. */
+  vector<unsigned long> sample_step; /** The time-step of each sample. */
+};
+
+/**
+ * Returns the mode of calculation with the given name ("forward" or
+ * "adjoint"), or -1 if there is no such mode.
+ */
+int gradient_mode(const char *name) {
+  if (! strcmp(name, "forward")) {
+    return GRADIENT_FORWARD;
+  } else if (! strcmp(name, "adjoint")) {
+    return GRADIENT_ADJOINT;
+  }
+  return -1;
+}
+
+/**
+ * Prepares to calculate the derivatives of the selected outputs with respect
+ * to the selected parameters. The model must then be simulated one time-step
+ * at a time by gradient_step(), rather than by guyton92_step().
+ *
+ * @param[in] p The struct of model parameters.
+ * @param[in] v The struct of state variables.
+ * @param[in] e The experiment (if any) to run.
+ * @param[in] mode The mode of calculation (eg, GRADIENT_FORWARD).
+ * @param[in] pix The index of each parameter (see param_index()).
+ * @param[in] n The number of parameters.
+ * @param[in] times The sample times, in ascending order (mins).
+ * @param[in] count The number of sample times.
+ * @param[in] handles The handles of the state variables and parameters whose
+ *                    derivatives are calculated (see guyton92_handle()).
+ * @param[in] k The number of handles.
+ *
+ * @return The state of the calculation, or \c NULL if any argument is
+ *         invalid.
+ */
+GRADIENT *gradient_new(PARAMS &p, VARS &v, Experiment *e, int mode,
+                       const int *pix, int n, const double *times,
+                       size_t count, const int *handles, int k) {
+  if (mode != GRADIENT_FORWARD && mode != GRADIENT_ADJOINT) {
+    cerr << "ERROR: Invalid gradient mode: " << mode << endl;
+    return NULL;
+  }
+  for (int j = 0; j < n; j++) {
+    if (pix[j] < 0 || pix[j] >= PARAM_COUNT) {
+      cerr << "ERROR: Invalid parameter index: " << pix[j] << endl;
+      return NULL;
+    }
+  }
+  for (int h = 0; h < k; h++) {
+    if (handles[h] < 0 || handles[h] >= VAR_COUNT + PARAM_COUNT) {
+      cerr << "ERROR: Invalid output handle: " << handles[h] << endl;
+      return NULL;
+    }
+  }
+
+  GRADIENT *g = new GRADIENT;
+  g->p = &p;
+  g->v = &v;
+  g->e = e;
+  g->mode = mode;
+  g->pix.assign(pix, pix + n);
+  g->p0.assign(n, 0);
+  g->times.assign(times, times + count);
+  g->handles.assign(handles, handles + k);
+  g->samples = 0;
+  g->out.resize(count * k);
+  g->steps = 0;
+  if (mode == GRADIENT_FORWARD) {
+    g->grad.resize(count * k * n);
+    size_t chunks = (n + DUAL_WIDTH - 1) / DUAL_WIDTH;
+    g->dp.resize(chunks);
+    g->dv.resize(chunks);
+  } else {
+    memcpy(&g->sp, &p, sizeof(PARAMS));
+    memcpy(&g->sv, &v, sizeof(VARS));
+  }
+  return g;
+}
+
+/**
+ * Initialises the dual copies of the model state, once the initial changes
+ * of the experiment have been applied, and sets the derivative of each
+ * selected parameter with respect to itself.
+ */
+static void gradient_seed(GRADIENT *g) {
+  const double *ps = (const double *) g->p;
+  const double *vs = (const double *) g->v;
+  for (size_t c = 0; c < g->dp.size(); c++) {
+    DUAL *dps = (DUAL *) &g->dp[c];
+    DUAL *dvs = (DUAL *) &g->dv[c];
+    for (int j = 0; j < PARAM_COUNT; j++) {
+      dps[j] = DUAL(ps[j]);
+    }
+    for (int j = 0; j < VAR_COUNT; j++) {
+      dvs[j] = DUAL(vs[j]);
+    }
+  }
+  for (size_t j = 0; j < g->pix.size(); j++) {
+    DUAL *dps = (DUAL *) &g->dp[j / DUAL_WIDTH];
+    dps[g->pix[j]].d[j % DUAL_WIDTH] = 1;
+  }
+}
+
+/**
+ * Returns whether a parameter must be replaced by its value in the model,
+ * because it has been changed by something other than the model equations.
+ *
+ * @param[in] updated Whether the experiment set this parameter.
+ * @param[in] value The value of the parameter as per the model equations.
+ * @param[in] actual The value of the parameter in the model.
+ */
+static inline bool gradient_replaced(bool updated, double value,
+                                     double actual) {
+  return updated || value != actual;
+}
+
+/**
+ * Advances the dual copies of the model state by one time-step (forward
+ * mode), before the model itself is advanced.
+ */
+static void gradient_forward(GRADIENT *g, const vector<char> &updated,
+                             double t_next) {
+  const double *ps = (const double *) g->p;
+  for (size_t c = 0; c < g->dp.size(); c++) {
+    DUAL *dps = (DUAL *) &g->dp[c];
+    for (int j = 0; j < PARAM_COUNT; j++) {
+      if (gradient_replaced(updated[j], dps[j].v, ps[j])) {
+        dps[j] = DUAL(ps[j]);
+      }
+    }
+    guyton92_equations(g->dp[c], g->dv[c], NULL, t_next);
+  }
+}
+
+/**
+ * Records the changes to the model state that are required to re-simulate
+ * a time-step (adjoint mode), and advances the re-simulated model state,
+ * before the model itself is advanced.
+ */
+static void gradient_record(GRADIENT *g, const vector<char> &updated,
+                            double t_next) {
+  if (g->steps % GRADIENT_SEGMENT == 0) {
+    g->ckpt_p.push_back(g->sp);
+    g->ckpt_v.push_back(g->sv);
+  }
+
+  const double *ps = (const double *) g->p;
+  double *sps = (double *) &g->sp;
+  for (int j = 0; j < PARAM_COUNT; j++) {
+    if (gradient_replaced(updated[j], sps[j], ps[j])) {
+      GRADIENT_SET set = {j, ps[j]};
+      g->resets.push_back(set);
+      sps[j] = ps[j];
+    }
+  }
+  g->resets_end.push_back(g->resets.size());
+  g->t_next.push_back(t_next);
+  guyton92_equations(g->sp, g->sv, NULL, t_next);
+}
+
+/**
+ * Simulates a single time-step of the model (see guyton92_step()), and
+ * propagates or records the derivatives of the model state.
+ *
+ * @param[in] g The state of the calculation (see gradient_new()).
+ */
+void gradient_step(GRADIENT *g) {
+  PARAMS &p = *g->p;
+  VARS &v = *g->v;
+  double t_next = guyton92_update(p, v, g->e);
+  const EXP_VARIANT *var = (g->e) ? g->e->variant() : exp_variant_default();
+
+  /* The parameters that were set by the experiment. */
+  vector<char> updated(PARAM_COUNT, 0);
+  if (g->e) {
+    const vector<int> &ixs = g->e->updated_params();
+    for (size_t j = 0; j < ixs.size(); j++) {
+      updated[ixs[j]] = 1;
+    }
+  }
+
+  if (g->steps == 0) {
+    const double *ps = (const double *) &p;
+    for (size_t j = 0; j < g->pix.size(); j++) {
+      g->p0[j] = ps[g->pix[j]];
+    }
+  }
+
+  if (g->mode == GRADIENT_FORWARD) {
+    if (g->steps == 0) {
+      /* The derivatives are with respect to the initial values. */
+      gradient_seed(g);
+      updated.assign(PARAM_COUNT, 0);
+    }
+    gradient_forward(g, updated, t_next);
+  } else {
+    gradient_record(g, updated, t_next);
+  }
+
+  if (guyton92_equations(p, v, var, t_next)) {
+    notify_instruments(p, v);
+  }
+  g->steps++;
+
+  /* The experiments and model variants only change the values of the state
+     variables, not their derivatives. */
+  const double *vs = (const double *) &v;
+  if (g->mode == GRADIENT_FORWARD) {
+    for (size_t c = 0; c < g->dv.size(); c++) {
+      DUAL *dvs = (DUAL *) &g->dv[c];
+      for (int j = 0; j < VAR_COUNT; j++) {
+        dvs[j].v = vs[j];
+      }
+    }
+  } else {
+    double *svs = (double *) &g->sv;
+    for (int j = 0; j < VAR_COUNT; j++) {
+      if (svs[j] != vs[j]) {
+        GRADIENT_SET fix = {j, vs[j]};
+        g->fixes.push_back(fix);
+        svs[j] = vs[j];
+      }
+    }
+    g->fixes_end.push_back(g->fixes.size());
+  }
+
+  /* Record the outputs at the end of the first time-step that reaches each
+     sample time (as per guyton92_run_sampled()). */
+  const double *ps = (const double *) &p;
+  size_t k = g->handles.size();
+  size_t n = g->pix.size();
+  while (g->samples < g->times.size() && v.t >= g->times[g->samples]) {
+    size_t i = g->samples++;
+    for (size_t h = 0; h < k; h++) {
+      int ix = g->handles[h];
+      g->out[i * k + h] = (ix < VAR_COUNT) ? vs[ix] : ps[ix - VAR_COUNT];
+      for (size_t j = 0; g->mode == GRADIENT_FORWARD && j < n; j++) {
+        size_t c = j / DUAL_WIDTH;
+        const DUAL &d = (ix < VAR_COUNT) ? ((const DUAL *) &g->dv[c])[ix]
+          : ((const DUAL *) &g->dp[c])[ix - VAR_COUNT];
+        g->grad[(i * k + h) * n + j] = d.d[j % DUAL_WIDTH];
+      }
+    }
+    if (g->mode == GRADIENT_ADJOINT) {
+      g->sample_step.push_back(g->steps - 1);
+    }
+  }
+}
+
+/**
+ * Returns the number of samples that have been recorded.
+ *
+ * @param[in] g The state of the calculation (see gradient_new()).
+ */
+size_t gradient_samples(const GRADIENT *g) {
+  return g->samples;
+}
+
+/**
+ * Returns an adjoint number that is an input of the recorded time-step, and
+ * has its own entry on the tape.
+ */
+static ADJ adj_input(ADJ_TAPE *tape, double value) {
+  if (tape->size == tape->capacity) {
+    adj_tape_grow(tape);
+  }
+  ADJ_NODE &node = tape->nodes[tape->size];
+  node.a = -1;
+  node.b = -1;
+  node.da = 0;
+  node.db = 0;
+  ADJ a(value);
+  a.i = tape->size++;
+  return a;
+}
+
+/**
+ * Propagates the derivatives of the recorded samples backward through every
+ * time-step (adjoint mode), in segments of GRADIENT_SEGMENT time-steps.
+ *
+ * @param[in] g The state of the calculation.
+ * @param[out] lam The derivatives of each sample with respect to the state
+ *                 variables and parameters at the start of the simulation,
+ *                 indexed as per guyton92_handle() (ie, lam[x * m + c] for
+ *                 the state variable or parameter x and the sample c).
+ */
+static void gradient_reverse(GRADIENT *g, vector<double> &lam) {
+  size_t k = g->handles.size();
+  size_t m = g->samples * k;
+  const int inputs = VAR_COUNT + PARAM_COUNT;
+  lam.assign((size_t) inputs * m, 0);
+  if (m == 0) {
+    return;
+  }
+
+  ADJ_TAPE tape = {NULL, 0, 0};
+  ADJ_TAPE *prev_tape = adj_tape;
+  adj_tape = &tape;
+  vector<double> adj;
+  PARAMS_T<ADJ> ap;
+  VARS_T<ADJ> av;
+  ADJ *aps = (ADJ *) &ap;
+  ADJ *avs = (ADJ *) &av;
+
+  long next = (long) g->samples - 1;
+  unsigned long last = g->sample_step[next];
+  for (long seg = (long) (last / GRADIENT_SEGMENT); seg >= 0; seg--) {
+    /* Re-simulate the segment from its checkpoint, and keep the state at the
+       start of each time-step. */
+    unsigned long s0 = seg * GRADIENT_SEGMENT;
+    unsigned long s1 = s0 + GRADIENT_SEGMENT;
+    s1 = (s1 > last + 1) ? last + 1 : s1;
+    vector<PARAMS> pre_p(s1 - s0);
+    vector<VARS> pre_v(s1 - s0);
+    PARAMS cp = g->ckpt_p[seg];
+    VARS cv = g->ckpt_v[seg];
+    double *cps = (double *) &cp;
+    double *cvs = (double *) &cv;
+    for (unsigned long s = s0; s < s1; s++) {
+      for (size_t r = (s > 0) ? g->resets_end[s - 1] : 0;
+           r < g->resets_end[s]; r++) {
+        cps[g->resets[r].index] = g->resets[r].value;
+      }
+      pre_p[s - s0] = cp;
+      pre_v[s - s0] = cv;
+      guyton92_equations(cp, cv, NULL, g->t_next[s]);
+      for (size_t f = (s > 0) ? g->fixes_end[s - 1] : 0;
+           f < g->fixes_end[s]; f++) {
+        cvs[g->fixes[f].index] = g->fixes[f].value;
+      }
+    }
+
+    /* Reverse each time-step of the segment in turn. */
+    for (unsigned long s = s1; s-- > s0; ) {
+      while (next >= 0 && g->sample_step[next] == s) {
+        for (size_t h = 0; h < k; h++) {
+          lam[g->handles[h] * m + next * k + h] += 1;
+        }
+        next--;
+      }
+      /* Only the samples at or after this time-step have derivatives. */
+      size_t lo = (next + 1) * k;
+      size_t w = m - lo;
+
+      /* Record the time-step, with a tape entry for each input. */
+      tape.size = 0;
+      const double *pps = (const double *) &pre_p[s - s0];
+      const double *pvs = (const double *) &pre_v[s - s0];
+      for (int x = 0; x < inputs; x++) {
+        ADJ &a = (x < VAR_COUNT) ? avs[x] : aps[x - VAR_COUNT];
+        a = adj_input(&tape, (x < VAR_COUNT) ? pvs[x] : pps[x - VAR_COUNT]);
+      }
+      guyton92_equations(ap, av, NULL, g->t_next[s]);
+
+      /* Propagate the derivatives from the outputs to the inputs. */
+      adj.assign(tape.size * w, 0);
+      for (int x = 0; x < inputs; x++) {
+        long o = (x < VAR_COUNT) ? avs[x].i : aps[x - VAR_COUNT].i;
+        for (size_t c = 0; o >= 0 && c < w; c++) {
+          adj[o * w + c] += lam[x * m + lo + c];
+        }
+      }
+      for (long node = tape.size - 1; node >= inputs; node--) {
+        const ADJ_NODE &nd = tape.nodes[node];
+        const double *an = &adj[node * w];
+        for (size_t c = 0; c < w; c++) {
+          if (an[c] != 0) {
+            if (nd.a >= 0) {
+              adj[nd.a * w + c] += nd.da * an[c];
+            }
+            if (nd.b >= 0) {
+              adj[nd.b * w + c] += nd.db * an[c];
+            }
+          }
+        }
+      }
+      for (int x = 0; x < inputs; x++) {
+        for (size_t c = 0; c < w; c++) {
+          lam[x * m + lo + c] = adj[x * w + c];
+        }
+      }
+
+      /* The parameters that were replaced before this time-step do not
+         depend on their previous values (except for the initial values). */
+      for (size_t r = (s > 0) ? g->resets_end[s - 1] : g->resets_end[0];
+           r < g->resets_end[s]; r++) {
+        for (size_t c = 0; c < w; c++) {
+          lam[(VAR_COUNT + g->resets[r].index) * m + lo + c] = 0;
+        }
+      }
+    }
+  }
+
+  adj_tape = prev_tape;
+  free(tape.nodes);
+}
+
+/**
+ * Returns whether every derivative is finite and plausibly small (see
+ * GRADIENT_MAX_ELASTICITY), and otherwise reports the first derivative that
+ * is not. For each output and parameter, the largest derivative that exceeds
+ * GRADIENT_WARN_ELASTICITY is also reported.
+ *
+ * @param[in] g The state of the calculation.
+ * @param[in] grad The derivatives (see gradient_finish()).
+ */
+static bool gradient_check(const GRADIENT *g, const double *grad) {
+  size_t k = g->handles.size();
+  size_t n = g->pix.size();
+  for (size_t h = 0; h < k; h++) {
+    /* The scale of the output is its largest magnitude at any sample time,
+       so that an output that passes through zero is not rejected. */
+    double scale = 0;
+    for (size_t i = 0; i < g->samples; i++) {
+      scale = (fabs(g->out[i * k + h]) > scale) ? fabs(g->out[i * k + h])
+        : scale;
+    }
+    int ix = g->handles[h];
+    const char *name = (ix < VAR_COUNT) ? VAR_NAMES[ix]
+      : PARAM_NAMES[ix - VAR_COUNT];
+    for (size_t j = 0; j < n; j++) {
+      size_t largest = g->samples;
+      double e_max = GRADIENT_WARN_ELASTICITY;
+      for (size_t i = 0; i < g->samples; i++) {
+        double d = grad[(i * k + h) * n + j];
+        double e = (scale > 0) ? d * fabs(g->p0[j]) / scale : 0;
+        if (d == d && fabs(d) < HUGE_VAL
+            && fabs(e) <= GRADIENT_MAX_ELASTICITY) {
+          if (fabs(e) > e_max) {
+            largest = i;
+            e_max = fabs(e);
+          }
+          continue;
+        }
+        cerr << "ERROR: The derivative of '" << name << "' with respect to '"
+             << PARAM_NAMES[g->pix[j]] << "' at t = " << g->times[i]
+             << " is " << ((d == d && fabs(d) < HUGE_VAL)
+                           ? "implausibly large" : "not finite")
+             << " (" << d << ")" << endl;
+        return false;
+      }
+      if (largest < g->samples) {
+        cerr << "WARNING: The derivative of '" << name << "' with respect to '"
+             << PARAM_NAMES[g->pix[j]] << "' at t = " << g->times[largest]
+             << " (" << grad[(largest * k + h) * n + j] << ", elasticity "
+             << e_max << ") may not reflect a finite change" << endl;
+      }
+    }
+  }
+  return true;
+}
+
+/**
+ * Returns the recorded samples and their derivatives. In adjoint mode, this
+ * is when the derivatives are calculated.
+ *
+ * @param[in] g The state of the calculation (see gradient_new()).
+ * @param[out] out The value of each output at each sample time, which must
+ *                 hold (count * k) values (see guyton92_run_sampled()).
+ * @param[out] grad The derivative of each output at each sample time with
+ *                  respect to each parameter, which must hold
+ *                  (count * k * n) values, such that \c grad[(i * k + h) *
+ *                  n + j] is the derivative of \c handles[h] at \c times[i]
+ *                  with respect to \c pix[j].
+ *
+ * @return The number of samples that were recorded, or zero if any of the
+ *         derivatives is not finite or is implausibly large (see
+ *         gradient_check()).
+ */
+size_t gradient_finish(GRADIENT *g, double *out, double *grad) {
+  size_t k = g->handles.size();
+  size_t n = g->pix.size();
+  size_t m = g->samples * k;
+  for (size_t c = 0; c < m; c++) {
+    out[c] = g->out[c];
+  }
+
+  if (g->mode == GRADIENT_FORWARD) {
+    for (size_t c = 0; c < m * n; c++) {
+      grad[c] = g->grad[c];
+    }
+  } else {
+    vector<double> lam;
+    gradient_reverse(g, lam);
+    for (size_t c = 0; c < m; c++) {
+      for (size_t j = 0; j < n; j++) {
+        grad[c * n + j] = lam[(VAR_COUNT + g->pix[j]) * m + c];
+      }
+    }
+  }
+  if (! gradient_check(g, grad)) {
+    return 0;
+  }
+  return g->samples;
+}
+
+/**
+ * Deletes the state of a calculation of derivatives.
+ *
+ * @param[in] g The state of the calculation (see gradient_new()).
+ */
+void gradient_delete(GRADIENT *g) {
+  delete g;
+}
@@ -0,0 +1,16 @@
+/** Derivatives are propagated forward, alongside the simulation. */
+#define GRADIENT_FORWARD 0
+/** Derivatives are propagated backward, once the simulation has finished. */
+#define GRADIENT_ADJOINT 1
+
+/** The state of a calculation of derivatives (see gradient.cpp). */
+struct GRADIENT;
+
+int gradient_mode(const char *name);
+GRADIENT *gradient_new(PARAMS &p, VARS &v, Experiment *e, int mode,
+                       const int *pix, int n, const double *times,
+                       size_t count, const int *handles, int k);
+void gradient_step(GRADIENT *g);
+size_t gradient_samples(const GRADIENT *g);
+size_t gradient_finish(GRADIENT *g, double *out, double *grad);
+void gradient_delete(GRADIENT *g);
@@ -0,0 +1,509 @@
+/**
+ * @file
+ * A program to perform global sensitivity analyses of the entire Guyton
+ * model (as opposed to the analyses of individual modules that are performed
+ * by the sensitivity analyser, see sensitivity.cpp).
+ *
+ * The model outputs at a single time are analysed by either the method of
+ * Morris (elementary effects) or the method of Sobol (first-order and total
+ * variance-based indices, estimated from a Saltelli design). The simulations
+ * are run in parallel from a shared warm-start state (see batch.cpp), and are
+ * generated and analysed in fixed-size chunks, with online estimators, so
+ * that the memory required does not grow with the number of samples.
+ */
+
+#include <cstdlib>
+#include <cstring>
+#include <cmath>
+#include <iostream>
+#include <sstream>
+#include <queue>
+#include <vector>
+#include <string>
+#include <algorithm>
+
+#include <unistd.h>
+
+using namespace std;
+
+#include "params.h"
+#include "vars.h"
+#include "read_exp.h"
+#include "guyton92_step.h"
+/* Run batches of simulations in parallel from a shared warm-start state. */
+#include "batch.h"
+#include "gsa.h"
+
+/** The default number of base samples for the method of Sobol. */
+#define SOBOL_SAMPLES 256
+
+/** The default number of trajectories for the method of Morris. */
+#define MORRIS_TRAJECTORIES 20
+
+/** The default number of grid levels for the method of Morris. */
+#define MORRIS_LEVELS 4
+
+/**
+ * The number of base samples (Sobol) or trajectories (Morris) that are
+ * simulated at once. This determines the memory required by the analysis.
+ */
+#define GSA_CHUNK 64
+
+/** A parameter whose influence is analysed. */
+struct GSA_PARAM {
+  string name; /** The name of the parameter. */
+  int index; /** The index of the parameter in the PARAMS struct. */
+  double min; /** The lower bound. */
+  double max; /** The upper bound. */
+};
+
+/** A global sensitivity analysis. */
+struct GSA {
+  BATCH_START *start; /** The shared warm-start state. */
+  vector<GSA_PARAM> params; /** The parameters. */
+  vector<int> pix; /** The index of each parameter. */
+  vector<string> outputs; /** The names of the model outputs. */
+  vector<int> handles; /** The handles of the model outputs. */
+  double time; /** The time at which the outputs are analysed (mins). */
+  unsigned int threads; /** The number of worker threads. */
+  unsigned short seed[3]; /** The state of the random number generator. */
+};
+
+/**
+ * A chunk of simulations. Points are expressed in unit coordinates, where
+ * each parameter ranges from zero (lower bound) to one (upper bound).
+ */
+struct GSA_POINTS {
+  const GSA *gsa; /** The analysis. */
+  vector<vector<double> > x; /** The parameter values of each simulation. */
+  vector<vector<double> > y; /** The model outputs of each simulation. */
+  vector<char> ok; /** Whether each simulation was successful. */
+};
+
+/**
+ * Displays the command-line usage for the analysis program, then exits.
+ *
+ * @param progname The name of the program.
+ * @param exitcode The exit code to pass to exit().
+ */
+static void usage(char *progname, int exitcode) {
+  cerr << "\n  USAGE: " << progname << " [options] experiment" << endl;
+  cerr << "\n  OPTIONS:" << endl;
+  cerr << "    -p NAME:MIN:MAX   " <<
+    "Vary the parameter NAME, within the given bounds." << endl;
+  cerr << "    -o VARS           " <<
+    "The model outputs to analyse (comma-separated list)." << endl;
+  cerr << "    -t T              " <<
+    "Analyse the outputs at time T (default: the end)." << endl;
+  cerr << "    -m METHOD         " <<
+    "Use the method of Sobol (default) or Morris." << endl;
+  cerr << "    -n N              " <<
+    "The number of base samples (default: " << SOBOL_SAMPLES <<
+    ") or trajectories" << endl;
+  cerr << "                      " <<
+    "(default: " << MORRIS_TRAJECTORIES << ")." << endl;
+  cerr << "    -l N              " <<
+    "The number of grid levels for Morris (default: " << MORRIS_LEVELS <<
+    ")." << endl;
+  cerr << "    -s SEED           " <<
+    "Seed the random number generator (default: 1)." << endl;
+  cerr << "    -w T              " <<
+    "Start each simulation from the model state at time T" << endl;
+  cerr << "                      " <<
+    "(default: the first output time of the experiment)." << endl;
+  cerr << "    -x                " <<
+    "End time-steps exactly at each output time and event." << endl;
+  cerr << "    -j N              " <<
+    "Run N simulations at once (default: one per processor)." << endl;
+  cerr << "    -h                " << "Display this help and exit." << endl;
+  cerr << "\n  The parameters take their sampled values at the warm-start "
+    "time. The method" << endl;
+  cerr << "  of Sobol requires N * (P + 2) simulations for P parameters, "
+    "and Morris" << endl;
+  cerr << "  requires N * (P + 1). Elementary effects are the change in "
+    "the output over" << endl;
+  cerr << "  the full range of a parameter." << endl;
+  cerr << "\n  EXAMPLE:" << endl;
+  cerr << "    " << progname << " -p aldkns:1:8 -p adhtc:5:60 -o pa,vec " <<
+    "exps/uttamsingh_3.exp" << endl;
+  cerr << endl;
+  exit(exitcode);
+}
+
+/**
+ * Simulates the model for a single point of a chunk (see batch_run()).
+ */
+static void simulate_job(void *data, size_t index) {
+  GSA_POINTS *pts = (GSA_POINTS *) data;
+  const GSA &gsa = *pts->gsa;
+  const vector<double> &x = pts->x[index];
+  vector<double> values(x.size());
+  for (size_t i = 0; i < x.size(); i++) {
+    values[i] = gsa.params[i].min + x[i] * (gsa.params[i].max
+                                            - gsa.params[i].min);
+  }
+
+  vector<double> &y = pts->y[index];
+  y.resize(gsa.handles.size());
+  bool ok = batch_simulate(gsa.start, &gsa.pix[0], &values[0],
+                           (int) values.size(), &gsa.time, 1,
+                           &gsa.handles[0], (int) y.size(), &y[0]);
+  for (size_t j = 0; j < y.size(); j++) {
+    ok = ok && y[j] == y[j] && fabs(y[j]) < HUGE_VAL;
+  }
+  pts->ok[index] = ok;
+}
+
+/**
+ * Simulates the model for every point of a chunk, in parallel.
+ */
+static void simulate(const GSA &gsa, GSA_POINTS &pts) {
+  pts.gsa = &gsa;
+  pts.y.assign(pts.x.size(), vector<double>());
+  pts.ok.assign(pts.x.size(), false);
+  batch_run(pts.x.size(), gsa.threads, simulate_job, &pts);
+}
+
+/**
+ * Estimates the first-order and total Sobol indices of each parameter.
+ *
+ * Each base sample consists of two independent points (A and B), and one
+ * point for each parameter, which is equal to A except for the value of the
+ * parameter, which is taken from B. The first-order indices are estimated as
+ * per Saltelli et al. (2010) and the total indices as per Jansen (1999).
+ *
+ * @param[in] gsa The analysis.
+ * @param[in] samples The number of base samples.
+ */
+static void sobol(GSA &gsa, unsigned long samples) {
+  size_t d = gsa.params.size();
+  size_t k = gsa.handles.size();
+
+  /* The variance of each output, over every A and B point. */
+  vector<MOMENTS> var(k);
+  for (size_t j = 0; j < k; j++) {
+    var[j].n = 0;
+    var[j].mean = 0;
+    var[j].m2 = 0;
+  }
+  /* The sums of the estimators for each parameter and output. */
+  vector<double> first(d * k, 0.0), total(d * k, 0.0);
+  /* The outputs are shifted by the first output of A, which does not change
+     the estimates but improves their numerical accuracy. */
+  vector<double> shift;
+  unsigned long used = 0;
+
+  for (unsigned long done = 0; done < samples; done += GSA_CHUNK) {
+    unsigned long n = samples - done;
+    n = (n < GSA_CHUNK) ? n : GSA_CHUNK;
+
+    /* Generate the points of each base sample: A, B, then each AB_i. */
+    GSA_POINTS pts;
+    for (unsigned long r = 0; r < n; r++) {
+      vector<double> a(d), b(d);
+      for (size_t i = 0; i < d; i++) {
+        a[i] = erand48(gsa.seed);
+      }
+      for (size_t i = 0; i < d; i++) {
+        b[i] = erand48(gsa.seed);
+      }
+      pts.x.push_back(a);
+      pts.x.push_back(b);
+      for (size_t i = 0; i < d; i++) {
+        pts.x.push_back(a);
+        pts.x.back()[i] = b[i];
+      }
+    }
+    simulate(gsa, pts);
+
+    /* Only use the base samples for which every simulation succeeded. */
+    for (unsigned long r = 0; r < n; r++) {
+      size_t base = r * (d + 2);
+      bool ok = true;
+      for (size_t i = 0; i < d + 2; i++) {
+        ok = ok && pts.ok[base + i];
+      }
+      if (! ok) {
+        continue;
+      }
+
+      used++;
+      const vector<double> &fa = pts.y[base];
+      const vector<double> &fb = pts.y[base + 1];
+      if (shift.empty()) {
+        shift = fa;
+      }
+      for (size_t j = 0; j < k; j++) {
+        moments_add(var[j], fa[j] - shift[j]);
+        moments_add(var[j], fb[j] - shift[j]);
+        for (size_t i = 0; i < d; i++) {
+          double fab = pts.y[base + 2 + i][j];
+          first[i * k + j] += (fb[j] - shift[j]) * (fab - fa[j]);
+          total[i * k + j] += (fa[j] - fab) * (fa[j] - fab) / 2;
+        }
+      }
+    }
+  }
+
+  if (used < samples) {
+    cerr << "WARNING: " << samples - used << " of " << samples
+         << " base samples failed" << endl;
+  }
+
+  cout << "param output S1 ST" << endl;
+  for (size_t i = 0; i < d; i++) {
+    for (size_t j = 0; j < k; j++) {
+      double v = moments_var(var[j]);
+      double s1 = (used && v > 0) ? first[i * k + j] / used / v : 0;
+      double st = (used && v > 0) ? total[i * k + j] / used / v : 0;
+      cout << gsa.params[i].name << " " << gsa.outputs[j] << " " << s1
+           << " " << st << endl;
+    }
+  }
+}
+
+/**
+ * Estimates the elementary effects of each parameter, as per Morris (1991),
+ * along with the mean absolute effect (mu*) of Campolongo et al. (2007).
+ *
+ * Each trajectory starts at a random point on a grid, and changes the value
+ * of one parameter at a time (in a random order) by a fixed step.
+ *
+ * @param[in] gsa The analysis.
+ * @param[in] trajectories The number of trajectories.
+ * @param[in] levels The number of grid levels (an even number).
+ */
+static void morris(GSA &gsa, unsigned long trajectories, int levels) {
+  size_t d = gsa.params.size();
+  size_t k = gsa.handles.size();
+  double delta = levels / (2.0 * (levels - 1));
+
+  /* The elementary effects, and their absolute values. */
+  vector<MOMENTS> effects(d * k);
+  vector<double> abs_sum(d * k, 0.0);
+  for (size_t i = 0; i < d * k; i++) {
+    effects[i].n = 0;
+    effects[i].mean = 0;
+    effects[i].m2 = 0;
+  }
+  unsigned long used = 0;
+
+  for (unsigned long done = 0; done < trajectories; done += GSA_CHUNK) {
+    unsigned long n = trajectories - done;
+    n = (n < GSA_CHUNK) ? n : GSA_CHUNK;
+
+    /* Generate each trajectory, and record which parameter is changed at
+       each step (and in which direction). */
+    GSA_POINTS pts;
+    vector<size_t> order;
+    vector<double> steps;
+    for (unsigned long r = 0; r < n; r++) {
+      vector<double> x(d);
+      vector<size_t> perm(d);
+      for (size_t i = 0; i < d; i++) {
+        int level = (int) (erand48(gsa.seed) * levels);
+        level = (level < levels) ? level : levels - 1;
+        x[i] = level / (levels - 1.0);
+        perm[i] = i;
+      }
+      for (size_t i = d; i > 1; i--) {
+        size_t j = (size_t) (erand48(gsa.seed) * i);
+        j = (j < i) ? j : i - 1;
+        swap(perm[i - 1], perm[j]);
+      }
+
+      pts.x.push_back(x);
+      for (size_t s = 0; s < d; s++) {
+        size_t i = perm[s];
+        double step = (x[i] + delta <= 1 + 1e-12) ? delta : -delta;
+        x[i] += step;
+        pts.x.push_back(x);
+        order.push_back(i);
+        steps.push_back(step);
+      }
+    }
+    simulate(gsa, pts);
+
+    /* Only use the trajectories for which every simulation succeeded. */
+    for (unsigned long r = 0; r < n; r++) {
+      size_t base = r * (d + 1);
+      bool ok = true;
+      for (size_t s = 0; s <= d; s++) {
+        ok = ok && pts.ok[base + s];
+      }
+      if (! ok) {
+        continue;
+      }
+
+      used++;
+      for (size_t s = 0; s < d; s++) {
+        size_t i = order[r * d + s];
+        const vector<double> &y0 = pts.y[base + s];
+        const vector<double> &y1 = pts.y[base + s + 1];
+        for (size_t j = 0; j < k; j++) {
+          double ee = (y1[j] - y0[j]) / steps[r * d + s];
+          moments_add(effects[i * k + j], ee);
+          abs_sum[i * k + j] += fabs(ee);
+        }
+      }
+    }
+  }
+
+  if (used < trajectories) {
+    cerr << "WARNING: " << trajectories - used << " of " << trajectories
+         << " trajectories failed" << endl;
+  }
+
+  cout << "param output mu mu_star sigma" << endl;
+  for (size_t i = 0; i < d; i++) {
+    for (size_t j = 0; j < k; j++) {
+      const MOMENTS &m = effects[i * k + j];
+      double mu_star = (used) ? abs_sum[i * k + j] / used : 0;
+      cout << gsa.params[i].name << " " << gsa.outputs[j] << " " << m.mean
+           << " " << mu_star << " " << sqrt(moments_var(m)) << endl;
+    }
+  }
+}
+
+/**
+ * The entry point for the global sensitivity analysis program.
+ *
+ * @param[in] argc The number of arguments on the command line.
+ * @param[in] argv The arguments provided on the command line.
+ */
+int main(int argc, char *argv[]) {
+  GSA gsa;
+  gsa.threads = batch_threads();
+  gsa.time = -1;
+  double t_warm = -1;
+  bool exact = false;
+  bool use_morris = false;
+  long samples = 0;
+  int levels = MORRIS_LEVELS;
+  unsigned long seed = 1;
+
+  int c;
+  while ((c = getopt(argc, argv, "hxp:o:t:m:n:l:s:w:j:")) != -1) {
+    istringstream ss((optarg) ? optarg : "");
+    vector<string> fields = split_fields((optarg) ? optarg : "", ':');
+    switch (c) {
+    case 'p': {
+      GSA_PARAM gp;
+      if (fields.size() != 3 || ! read_number(fields[1], gp.min)
+          || ! read_number(fields[2], gp.max) || gp.min >= gp.max) {
+        cerr << "ERROR: Invalid parameter: '" << optarg << "'" << endl;
+        usage(argv[0], EXIT_FAILURE);
+      }
+      gp.name = fields[0];
+      gp.index = param_index(gp.name.c_str());
+      if (gp.index < 0) {
+        cerr << "ERROR: Unknown parameter: '" << gp.name << "'" << endl;
+        usage(argv[0], EXIT_FAILURE);
+      }
+      gsa.params.push_back(gp);
+      gsa.pix.push_back(gp.index);
+      break;
+    }
+    case 'o':
+      fields = split_fields(optarg, ',');
+      for (size_t i = 0; i < fields.size(); i++) {
+        int h = guyton92_handle(fields[i].c_str());
+        if (h < 0) {
+          cerr << "ERROR: Unknown output: '" << fields[i] << "'" << endl;
+          usage(argv[0], EXIT_FAILURE);
+        }
+        gsa.outputs.push_back(fields[i]);
+        gsa.handles.push_back(h);
+      }
+      break;
+    case 't':
+      if (! read_number(optarg, gsa.time) || gsa.time < 0) {
+        cerr << "ERROR: Invalid time: '" << optarg << "'" << endl;
+        usage(argv[0], EXIT_FAILURE);
+      }
+      break;
+    case 'm':
+      if (! strcmp(optarg, "morris")) {
+        use_morris = true;
+      } else if (! strcmp(optarg, "sobol")) {
+        use_morris = false;
+      } else {
+        cerr << "ERROR: Invalid method: '" << optarg << "'" << endl;
+        usage(argv[0], EXIT_FAILURE);
+      }
+      break;
+    case 'n':
+      if (! (ss >> samples) || samples < 1) {
+        cerr << "ERROR: Invalid number of samples: '" << optarg << "'"
+             << endl;
+        usage(argv[0], EXIT_FAILURE);
+      }
+      break;
+    case 'l':
+      if (! (ss >> levels) || levels < 2 || levels % 2) {
+        cerr << "ERROR: Invalid number of levels: '" << optarg << "'"
+             << endl;
+        usage(argv[0], EXIT_FAILURE);
+      }
+      break;
+    case 's':
+      if (! (ss >> seed)) {
+        cerr << "ERROR: Invalid seed: '" << optarg << "'" << endl;
+        usage(argv[0], EXIT_FAILURE);
+      }
+      break;
+    case 'w':
+      if (! read_number(optarg, t_warm) || t_warm < 0) {
+        cerr << "ERROR: Invalid warm-start time: '" << optarg << "'" << endl;
+        usage(argv[0], EXIT_FAILURE);
+      }
+      break;
+    case 'x':
+      exact = true;
+      break;
+    case 'j':
+      if (! (ss >> gsa.threads) || gsa.threads < 1) {
+        cerr << "ERROR: Invalid number of jobs: '" << optarg << "'" << endl;
+        usage(argv[0], EXIT_FAILURE);
+      }
+      break;
+    case 'h':
+      usage(argv[0], EXIT_SUCCESS);
+      break;
+    default:
+      usage(argv[0], EXIT_FAILURE);
+      break;
+    }
+  }
+  if (optind != argc - 1 || gsa.params.empty() || gsa.outputs.empty()) {
+    usage(argv[0], EXIT_FAILURE);
+  }
+
+  /* Simulate the experiment up to the warm-start time, once. */
+  gsa.start = batch_start(argv[optind], t_warm, exact);
+  if (! gsa.start) {
+    return EXIT_FAILURE;
+  }
+  batch_check_schedule(gsa.start, &gsa.pix[0], (int) gsa.pix.size());
+  if (gsa.time < 0) {
+    gsa.time = gsa.start->stop;
+  }
+  if (gsa.time < gsa.start->v.t) {
+    cerr << "ERROR: The outputs are analysed before the warm-start time (t = "
+         << gsa.start->v.t << ")" << endl;
+    return EXIT_FAILURE;
+  }
+
+  gsa.seed[0] = 0x330E;
+  gsa.seed[1] = (unsigned short) seed;
+  gsa.seed[2] = (unsigned short) (seed >> 16);
+
+  if (use_morris) {
+    morris(gsa, (samples) ? samples : MORRIS_TRAJECTORIES, levels);
+  } else {
+    sobol(gsa, (samples) ? samples : SOBOL_SAMPLES);
+  }
+
+  delete gsa.start;
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,868 @@
+/**
+ * @file
+ * The command-line interface to the modular Guyton 1992 model, which is
+ * shared by the model binary (guyton92) and the simulation daemon
+ * (guyton92d).
+ */
+
+#include <cstdlib>
+#include <cstring>
+#include <cfloat>
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <queue>
+#include <vector>
+#include <map>
+#include <list>
+#include <getopt.h>
+#include <stdint.h>
+
+using namespace std;
+
+/* Collect parameters into a single struct and allow parameter values to be
+   specified in an external file. */
+#include "read_params.h"
+/* Collect state variables into a single struct and allow the initial values
+   to be specified in an external file. */
+#include "read_vars.h"
+/* Parse experiment definitions and automatically update model parameters. */
+#include "read_exp.h"
+/* An experiment in transfusion and blood loss. */
+#include "exp_transfuse.h"
+/* Variants of the model that are required by specific experiments. */
+#include "exp_variants.h"
+
+/* Simulate a single time-step of the model. */
+#include "guyton92_step.h"
+/* A cache of equilibrated model states. */
+#include "baseline.h"
+/* A cache of simulation results. */
+#include "result_cache.h"
+/* Derivatives of model outputs with respect to parameters. */
+#include "gradient.h"
+/* Skip the modules whose inputs have not changed. */
+#include "dataflow.h"
+/* The command-line interface to the model. */
+#include "guyton92_main.h"
+
+/* The debugging and instrumentation module. */
+#include "debug.h"
+/* A filter to reduce the number of notifications. */
+#include "filter_times.h"
+/* Filters that permit every Nth notification, or one per time interval. */
+#include "filter_stride.h"
+#include "filter_interval.h"
+/* A filter that only permits notifications when outputs change. */
+#include "filter_deadband.h"
+/* An instrument that selects notifications to preserve the output shape. */
+#include "instr_decimate.h"
+/* An instrument to print an arbitrary list of module outputs. */
+#include "instr_vars.h"
+/* An instrument to record module outputs in a binary trajectory file. */
+#include "instr_traj.h"
+/* An instrument that notifies another instrument from a separate thread. */
+#include "instr_async.h"
+/* An instrument to record every state variable and parameter. */
+#include "instr_record.h"
+/* An instrument that publishes live telemetry in shared memory. */
+#include "instr_telemetry.h"
+
+/**
+ * The number of model states that can be buffered by each asynchronous
+ * instrument.
+ */
+#define ASYNC_SLOTS 1024
+
+/**
+ * The default amount of memory (MB) that is used by a full-state recording
+ * before it is written to disk.
+ */
+#define RECORD_BUDGET 256
+
+/**
+ * The default maximum size (MB) of the cache of simulation results.
+ */
+#define RESULT_CACHE_MB 256
+
+/**
+ * The minimum time (mins) between checkpoints of an experiment, from which
+ * the simulation can be resumed after the experiment has been edited.
+ */
+#define CHECKPOINT_INTERVAL (60 * 24)
+
+/**
+ * Displays the command-line usage for the model, then exits.
+ *
+ * @param progname The name of the program.
+ * @param exitcode The exit code to pass to exit().
+ */
+void usage(char* progname, int exitcode) {
+  cerr << "\n  USAGE: " << progname << " [options] [parameter file]" << endl;
+  cerr << "\n  OPTIONS:" << endl;
+  cerr << "    -a, --no-filter     " <<
+    "Display the output variables after each time-step." << endl;
+  cerr << "    -n, --no-exp     " <<
+    "Do not print the experiment definition." << endl;
+  cerr << "    -o, --outputs=VARS  " <<
+    "Set the output variables (comma-separated list)." << endl;
+  cerr << "    -b, --binary=FILE   " <<
+    "Also record the output variables in a binary trajectory." << endl;
+  cerr << "    -x, --exact         " <<
+    "End time-steps exactly at each output time and event." << endl;
+  cerr << "    -s, --stride=N      " <<
+    "Only display the output variables every N notifications." << endl;
+  cerr << "    -d, --interval=DT   " <<
+    "Only display the output variables every DT minutes." << endl;
+  cerr << "    -D, --deadband=VAR:ABS[:REL]" << endl;
+  cerr << "                        " <<
+    "Only display the output variables when VAR has changed by" << endl;
+  cerr << "                        " <<
+    "more than ABS, or by more than the fraction REL." << endl;
+  cerr << "    -L, --decimate=VAR:N" << endl;
+  cerr << "                        " <<
+    "Display one in N notifications, preserving the shape of VAR." << endl;
+  cerr << "    -r, --record=FILE   " <<
+    "Record every state variable and parameter in a file." << endl;
+  cerr << "    -m, --memory=MB     " <<
+    "The memory available to the recording (default: " <<
+    RECORD_BUDGET << " MB)." << endl;
+  cerr << "    -T, --telemetry=NAME[:DT]" << endl;
+  cerr << "                        " <<
+    "Publish the output variables in shared memory (NAME), at" << endl;
+  cerr << "                        " <<
+    "most once every DT minutes." << endl;
+  cerr << "    -A, --async[=POLICY]" << endl;
+  cerr << "                        " <<
+    "Write the output from a separate thread. When the buffer" << endl;
+  cerr << "                        " <<
+    "is full, wait (POLICY=block, the default) or drop output." << endl;
+  cerr << "    -N, --no-cache      " <<
+    "Always simulate, rather than using a cached result." << endl;
+  cerr << "    -C, --cache-size=MB " <<
+    "The maximum size of the result cache (default: " <<
+    RESULT_CACHE_MB << " MB)." << endl;
+  cerr << "    -I, --incremental[=TOLS]" << endl;
+  cerr << "                        " <<
+    "Report the modules whose inputs have not changed by more" << endl;
+  cerr << "                        " <<
+    "than their tolerance, and how much their outputs differ." << endl;
+  cerr << "                        " <<
+    "TOLS is a comma-separated list of TOL (for every input)" << endl;
+  cerr << "                        " <<
+    "and NAME=TOL (for one input) items (default: 0)." << endl;
+  cerr << "    -K, --skip          " <<
+    "As per -I, but skip these modules and reuse their outputs." << endl;
+  cerr << "    -F, --float         " <<
+    "Evaluate the model equations in single precision." << endl;
+  cerr << "    -h, --help          " <<
+    "Display this help and exit." << endl;
+  cerr << "\n  Results are cached in $GUYTON92_CACHE (default: " <<
+    "$XDG_CACHE_HOME/guyton92)," << endl;
+  cerr << "  unless a trajectory, recording or telemetry channel is " <<
+    "requested. Edited" << endl;
+  cerr << "  experiments resume from the last checkpoint before the " <<
+    "first edited change." << endl;
+  cerr << "\n  EXAMPLE:" << endl;
+  cerr << "    " << progname << " -a -o pa,rbf,vud ./exps/hypertension.exp\n";
+  cerr << endl;
+  exit(exitcode);
+}
+
+/**
+ * A filter that only applies to the notifications of a single instrument.
+ */
+struct SCOPED_FILTER {
+  filter filt; /** A pointer to the filter function. */
+  void *data; /** A pointer to the filter-specific data (if any). */
+};
+
+/**
+ * Registers an instrument. If asynchronous output was requested, the
+ * instrument is notified from a separate writer thread.
+ *
+ * @param[in] instr A pointer to the instrument function.
+ * @param[in] data A pointer to the instrument-specific data (if any).
+ * @param[in] async Whether to notify the instrument asynchronously.
+ * @param[in] policy What to do when the buffer is full (see async_policy).
+ * @param[out] wrappers The options of each asynchronous instrument, which
+ *             must be closed once the simulation is complete.
+ * @param[in] fields The state variables and parameters that the instrument
+ *            reads, other than the time, or \c NULL if it reads the entire
+ *            model state (see instr_async_opts()).
+ * @param[in] filters The filters that only apply to this instrument (may be
+ *            \c NULL).
+ */
+void register_instrument(instrument instr, void *data, bool async,
+                         int policy, vector<void *> &wrappers,
+                         const vector<string> *fields,
+                         const vector<SCOPED_FILTER> *filters = NULL) {
+  if (async) {
+    void *opts = instr_async_opts(instr, data, ASYNC_SLOTS, policy, fields);
+    if (! opts) {
+      exit(EXIT_FAILURE);
+    }
+    wrappers.push_back(opts);
+    instr = instr_async;
+    data = opts;
+  }
+
+  add_instrument(instr, data);
+
+  /* The filters are applied before the model state is copied (if async). */
+  for (size_t i = 0; filters && i < filters->size(); i++) {
+    add_instrument_filter(instr, data, filters->at(i).filt,
+                          filters->at(i).data);
+  }
+}
+
+/**
+ * Splits a command-line argument of the form "NAME:X[:Y]" into a name and up
+ * to two numbers.
+ *
+ * @param[in] arg The command-line argument.
+ * @param[out] name The name.
+ * @param[out] vals The numbers.
+ *
+ * @return The number of numbers that were read, or -1 if the argument is not
+ *         valid.
+ */
+int split_arg(const char *arg, string &name, double *vals) {
+  istringstream ss(arg);
+  if (! getline(ss, name, ':') || name.empty()) {
+    return -1;
+  }
+
+  int count = 0;
+  string field;
+  while (getline(ss, field, ':')) {
+    istringstream fs(field);
+    if (count == 2 || ! (fs >> vals[count])) {
+      return -1;
+    }
+    count++;
+  }
+  return count;
+}
+
+/**
+ * Prepares to calculate the derivatives of the model outputs at each output
+ * time with respect to the parameters selected by the experiment (see the
+ * "sens=" directive of Experiment).
+ *
+ * @param[in] p The struct of model parameters.
+ * @param[in] v The struct of state variables.
+ * @param[in] e The experiment.
+ * @param[in] outputs The names of the model outputs.
+ *
+ * @return The state of the calculation, or \c NULL if any output is not a
+ *         state variable or parameter.
+ */
+GRADIENT *sensitivity_new(PARAMS &p, VARS &v, Experiment *e,
+                          const vector<string> &outputs) {
+  const vector<string> &names = e->sensitivity_params();
+  vector<int> pix(names.size());
+  for (size_t j = 0; j < names.size(); j++) {
+    pix[j] = param_index(names[j].c_str());
+  }
+  vector<int> handles(outputs.size());
+  for (size_t h = 0; h < outputs.size(); h++) {
+    handles[h] = guyton92_handle(outputs[h].c_str());
+    if (handles[h] < 0) {
+      cerr << "ERROR: Unknown sensitivity output: '" << outputs[h] << "'"
+           << endl;
+      return NULL;
+    }
+  }
+  if (handles.empty()) {
+    cerr << "ERROR: No outputs for sensitivity analysis" << endl;
+    return NULL;
+  }
+
+  const double *times = e->output_times();
+  size_t count = 0;
+  while (times[count] != DBL_MAX) {
+    count++;
+  }
+  GRADIENT *g = gradient_new(p, v, e,
+                             gradient_mode(e->sensitivity_mode().c_str()),
+                             &pix[0], (int) pix.size(), times, count,
+                             &handles[0], (int) handles.size());
+  delete[] times;
+  return g;
+}
+
+/**
+ * Prints the derivatives of the model outputs at each output time, with one
+ * row for each output at each time and one column for each parameter.
+ *
+ * @param[in] g The state of the calculation (see sensitivity_new()).
+ * @param[in] e The experiment.
+ * @param[in] outputs The names of the model outputs.
+ * @param[in] out The stream to which the derivatives are written.
+ *
+ * @return \c false if the derivatives were rejected (see gradient_finish()),
+ *         in which case nothing is written, otherwise \c true.
+ */
+bool sensitivity_print(GRADIENT *g, Experiment *e,
+                       const vector<string> &outputs, ostream &out) {
+  const vector<string> &names = e->sensitivity_params();
+  size_t k = outputs.size();
+  size_t n = names.size();
+  size_t count = gradient_samples(g);
+  vector<double> values(count * k);
+  vector<double> grad(count * k * n);
+  if (gradient_finish(g, &values[0], n ? &grad[0] : NULL) < count) {
+    return false;
+  }
+
+  const double *times = e->output_times();
+  out << endl << "t output";
+  for (size_t j = 0; j < n; j++) {
+    out << " " << names[j];
+  }
+  out << endl;
+  for (size_t i = 0; i < count; i++) {
+    for (size_t h = 0; h < k; h++) {
+      out << times[i] << " " << outputs[h];
+      for (size_t j = 0; j < n; j++) {
+        out << " " << grad[(i * k + h) * n + j];
+      }
+      out << endl;
+    }
+  }
+  delete[] times;
+  return true;
+}
+
+/**
+ * Runs the modular Guyton 1992 model, as per the model binary (guyton92).
+ * This is separated from the entry point so that it can also be run by the
+ * simulation daemon (guyton92d), in a forked worker process.
+ *
+ * @param[in] argc The number of arguments on the command line.
+ * @param[in] argv The arguments provided on the command line.
+ * @param[in] cache The cache of equilibrated model states (may be \c NULL).
+ *
+ * @return The exit code for the model binary.
+ */
+int guyton92_main(int argc, char *argv[], BASELINE_CACHE *cache) {
+  /* This struct holds pointers to all model parameters. */
+  PARAMS p;
+  /* This struct holds pointers to all state variables. */
+  VARS v;
+
+  /* Initialise the PARAMS struct (p). */
+  PARAMS_INIT(p);
+  /* Initialise the VARS struct (V). */
+  VARS_INIT(v);
+
+  /* Options that can be set by command-line parameters. */
+  bool use_filter = true; /* Whether or not to filter notifications. */
+  bool use_outs = false; /* Whether output variables have been specified. */
+  bool write_exp = true; /* Whether to print the experiment definition. */
+  bool exact = false; /* Whether to end time-steps at each output time. */
+  vector<string> outs; /* The specified output variables. */
+  char *traj_file = NULL; /* The binary trajectory file (if any). */
+  char *record_file = NULL; /* The full-state recording file (if any). */
+  unsigned long record_mb = RECORD_BUDGET; /* The memory for the recording. */
+  vector<SCOPED_FILTER> text_filters; /* The filters for the text output. */
+  void *deadband = NULL; /* The deadband filter for the text output. */
+  string decimate_var; /* The variable whose shape should be preserved. */
+  unsigned long decimate_n = 0; /* The number of notifications per bucket. */
+  string telem_name; /* The name of the telemetry channel (if any). */
+  double telem_dt = 0; /* The minimum time between telemetry snapshots. */
+  bool use_async = false; /* Whether to write output asynchronously. */
+  int async_policy = ASYNC_BLOCK; /* What to do when the buffer is full. */
+  bool use_cache = true; /* Whether to use the cache of results. */
+  unsigned long cache_mb = RESULT_CACHE_MB; /* The size of the cache. */
+  bool incremental = false; /* Whether to track unchanged module inputs. */
+  bool skip = false; /* Whether to skip modules (see dataflow.cpp). */
+  string tolerances; /* The relative changes in inputs that are ignored. */
+  bool single = false; /* Whether to evaluate in single precision. */
+
+  static struct option long_options[] = {
+    /* Options are distinguished by a single character. */
+    {"no-filter", no_argument,       0, 'a'},
+    {"no-exp",    no_argument,       0, 'n'},
+    {"outputs",   required_argument, 0, 'o'},
+    {"binary",    required_argument, 0, 'b'},
+    {"exact",     no_argument,       0, 'x'},
+    {"stride",    required_argument, 0, 's'},
+    {"interval",  required_argument, 0, 'd'},
+    {"deadband",  required_argument, 0, 'D'},
+    {"decimate",  required_argument, 0, 'L'},
+    {"record",    required_argument, 0, 'r'},
+    {"memory",    required_argument, 0, 'm'},
+    {"telemetry", required_argument, 0, 'T'},
+    {"async",     optional_argument, 0, 'A'},
+    {"no-cache",  no_argument,       0, 'N'},
+    {"cache-size", required_argument, 0, 'C'},
+    {"incremental", optional_argument, 0, 'I'},
+    {"skip",      no_argument,       0, 'K'},
+    {"float",     no_argument,       0, 'F'},
+    {"help",      no_argument,       0, 'h'},
+    {NULL, 0, 0, 0}
+    };
+  int option_index = 0;
+  int c;
+
+  /* Allow the arguments to be processed more than once per process. */
+  optind = 1;
+
+  /* Process every parameter that has been given. */
+  while (1) {
+    c = getopt_long(argc, argv, "hanxNKFo:b:s:d:D:L:r:m:T:A::C:I::", long_options, &option_index);
+    if (c == -1) {
+      break; /* No more parameters to process. */
+    }
+
+    /* Local variables for processing the list of output variables. */
+    istringstream ss;
+    string outname;
+    /* Local variables for processing the filter options. */
+    SCOPED_FILTER sf;
+    unsigned long n;
+    int count;
+    double vals[2] = {0, 0};
+
+    switch (c) {
+    case 'a':
+      /* Don't filter the notifications of the model state. */
+      use_filter = false;
+      break;
+    case 'n':
+      write_exp = false;
+      break;
+    case 'o':
+      /* Use the output variables specified on the command line. */
+      use_outs = true;
+      ss.str(optarg);
+      while (getline(ss, outname, ',')) {
+        outs.push_back(outname);
+      }
+      break;
+    case 'x':
+      /* End time-steps exactly at each output time and scheduled change. */
+      exact = true;
+      break;
+    case 'b':
+      /* Record the output variables in a binary trajectory file. */
+      traj_file = optarg;
+      break;
+    case 's':
+      /* Only display every Nth notification. */
+      ss.str(optarg);
+      if (! (ss >> n) || n == 0) {
+        cerr << "ERROR: Invalid stride: '" << optarg << "'" << endl;
+        usage(argv[0], EXIT_FAILURE);
+      }
+      sf.filt = filter_stride;
+      sf.data = filter_stride_opts(n);
+      text_filters.push_back(sf);
+      break;
+    case 'd':
+      /* Only display one notification per time interval. */
+      ss.str(optarg);
+      if (! (ss >> vals[0]) || vals[0] <= 0) {
+        cerr << "ERROR: Invalid interval: '" << optarg << "'" << endl;
+        usage(argv[0], EXIT_FAILURE);
+      }
+      sf.filt = filter_interval;
+      sf.data = filter_interval_opts(vals[0]);
+      text_filters.push_back(sf);
+      break;
+    case 'D':
+      /* Only display notifications when a variable changes sufficiently. */
+      if (split_arg(optarg, outname, vals) < 1) {
+        cerr << "ERROR: Invalid deadband: '" << optarg << "'" << endl;
+        usage(argv[0], EXIT_FAILURE);
+      }
+      if (! deadband) {
+        /* Every variable is monitored by a single filter. */
+        deadband = filter_deadband_opts();
+        sf.filt = filter_deadband;
+        sf.data = deadband;
+        text_filters.push_back(sf);
+      }
+      if (! filter_deadband_add(deadband, outname.c_str(), vals[0], vals[1])) {
+        exit(EXIT_FAILURE);
+      }
+      break;
+    case 'L':
+      /* Select notifications so as to preserve the shape of a variable. */
+      if (split_arg(optarg, decimate_var, vals) != 1 || vals[0] < 1) {
+        cerr << "ERROR: Invalid decimation: '" << optarg << "'" << endl;
+        usage(argv[0], EXIT_FAILURE);
+      }
+      decimate_n = (unsigned long) vals[0];
+      break;
+    case 'r':
+      /* Record every state variable and parameter. */
+      record_file = optarg;
+      break;
+    case 'm':
+      /* Set the memory available to the recording. */
+      ss.str(optarg);
+      if (! (ss >> record_mb)) {
+        cerr << "ERROR: Invalid memory size: '" << optarg << "'" << endl;
+        usage(argv[0], EXIT_FAILURE);
+      }
+      break;
+    case 'T':
+      /* Publish the output variables in a live telemetry channel. */
+      count = split_arg(optarg, telem_name, vals);
+      if (count < 0 || count > 1 || vals[0] < 0) {
+        cerr << "ERROR: Invalid telemetry: '" << optarg << "'" << endl;
+        usage(argv[0], EXIT_FAILURE);
+      }
+      if (telem_name[0] != '/') {
+        telem_name.insert(0, "/");
+      }
+      telem_dt = vals[0];
+      break;
+    case 'A':
+      /* Write the output from a separate thread. */
+      use_async = true;
+      if (! optarg || ! strcmp(optarg, "block")) {
+        async_policy = ASYNC_BLOCK;
+      } else if (! strcmp(optarg, "drop")) {
+        async_policy = ASYNC_DROP;
+      } else {
+        cerr << "ERROR: Invalid policy: '" << optarg << "'" << endl;
+        usage(argv[0], EXIT_FAILURE);
+      }
+      break;
+    case 'N':
+      /* Do not use the cache of results. */
+      use_cache = false;
+      break;
+    case 'C':
+      /* Set the maximum size of the cache of results. */
+      ss.str(optarg);
+      if (! (ss >> cache_mb)) {
+        cerr << "ERROR: Invalid cache size: '" << optarg << "'" << endl;
+        usage(argv[0], EXIT_FAILURE);
+      }
+      break;
+    case 'I':
+      /* Count the modules whose inputs have not changed. */
+      incremental = true;
+      if (optarg) {
+        tolerances = optarg;
+      }
+      break;
+    case 'K':
+      /* Skip the modules whose inputs have not changed. */
+      incremental = true;
+      skip = true;
+      break;
+    case 'F':
+      /* Evaluate the model equations in single precision. */
+      single = true;
+      break;
+    case 'h':
+      /* Print the usage information. */
+      usage(argv[0], EXIT_SUCCESS);
+      break;
+    case ':':
+    case '?':
+    default:
+      /* Incorrect usage, print the usage information. */
+      usage(argv[0], EXIT_FAILURE);
+      break;
+    }
+  }
+
+  /* The options that affect the output (the experiment file is identified
+     by its contents, rather than by its name). */
+  vector<string> opt_args(argv + 1, argv + optind);
+
+  /* Shift argc and argv so that the processed parameters are ignored. */
+  argc -= optind;
+  argv += optind;
+
+  /* Allow an experiment definition to be provided in an external file. */
+  Experiment *e = NULL;
+  ifstream input;
+  switch (argc) {
+  case 0:
+    /* No experiment definition. */
+    break;
+  case 1:
+    /* One argument, which specifies the experiment file. */
+    input.open(argv[0]);
+    if (input.fail()) {
+      cerr << "ERROR: Unable to open experiment: '" << argv[0] << "'" << endl;
+      exit(EXIT_FAILURE);
+    } else {
+      e = new Experiment(p, input);
+      if (e->failed()) {
+        cerr << "ERROR: Invalid experiment: '" << argv[0] << "': "
+             << *e->errmsg() << endl;
+        exit(EXIT_FAILURE);
+      }
+      e->set_exact_times(exact);
+    }
+    input.close();
+    break;
+  default:
+    /* Incorrect usage, print the usage information. */
+    usage(argv[-optind], EXIT_FAILURE);
+  }
+
+  /* The simulation begins at time t = 0. */
+  v.t = 0.0;
+  /* The time-step size (min). */
+  v.i = 0.0030;
+  /* The duration of the simulation (min). The default value is four weeks. */
+  double tend = 60 * 24 * 7 * 4;
+  if (e) {
+    tend = e->stop_at();
+  }
+
+  /* Track the modules whose inputs have not changed, if requested. */
+  if (incremental) {
+    dataflow = dataflow_new(! skip);
+    if (! dataflow_tolerances(dataflow, tolerances)) {
+      usage(argv[0], EXIT_FAILURE);
+    }
+  }
+
+  /* Reuse the output of an identical simulation, if there is one. The
+     cache is not used when the output includes files or shared memory, or
+     when output may be dropped, or when the skipped modules are counted, or
+     in single precision. */
+  void *capture = NULL;
+  string cache_dir;
+  uint64_t prefix_key = 0;
+  bool sens = e && ! e->sensitivity_params().empty();
+  bool cacheable = use_cache && ! traj_file && ! record_file && ! sens
+    && ! incremental && ! single && telem_name.empty()
+    && ! (use_async && async_policy == ASYNC_DROP);
+  if (cacheable) {
+    ostringstream exp;
+    exp.precision(17);
+    if (e) {
+      e->write_exp(exp);
+    }
+    uint64_t key = result_key(p, v, exp.str(), opt_args);
+    cache_dir = result_cache_dir();
+    if (result_fetch(cache_dir, key, cout)) {
+      delete e;
+      return EXIT_SUCCESS;
+    }
+    capture = result_capture(cache_dir, key, cout);
+
+    /* The checkpoints are identified by everything except the scheduled
+       changes, which are identified separately (see result_checkpoints()). */
+    if (e) {
+      ostringstream outs_defn;
+      outs_defn.precision(17);
+      e->write_outputs(outs_defn);
+      prefix_key = result_key(p, v, outs_defn.str(), opt_args);
+    }
+  }
+
+  if (e && write_exp) {
+    e->write_exp(cout);
+  }
+
+  /* Filter the notifications. */
+  const double *output_times = NULL;
+  void *times_opts = NULL;
+  if (use_filter) {
+    output_times = (e) ? e->output_times() : NULL;
+    times_opts = filter_times_opts(output_times);
+    add_filter(filter_times, times_opts);
+  }
+  /* Display the specified model outputs. */
+  vector<string> const *outputs =
+    (use_outs) ? &outs : (e) ? &e->output_vars() : NULL;
+  vector<void *> async_opts;
+  /* The fields that the text and trajectory outputs read (see
+     register_instrument()). */
+  vector<string> out_fields;
+  if (outputs) {
+    out_fields = *outputs;
+  }
+  vector<string> text_fields = out_fields;
+  instrument text_instr = instr_vars;
+  void *text_opts = instr_vars_opts(NULL, outputs);
+  void *decimate_opts = NULL;
+  if (decimate_n) {
+    /* Select which notifications are displayed. */
+    decimate_opts = instr_decimate_opts(text_instr, text_opts,
+                                        decimate_var.c_str(), decimate_n);
+    if (! decimate_opts) {
+      exit(EXIT_FAILURE);
+    }
+    text_instr = instr_decimate;
+    text_opts = decimate_opts;
+    text_fields.push_back(decimate_var);
+  }
+  register_instrument(text_instr, text_opts, use_async, async_policy,
+                      async_opts, &text_fields, &text_filters);
+  /* Record the specified model outputs in a binary trajectory file. */
+  void *traj_opts = NULL;
+  if (traj_file) {
+    traj_opts = instr_traj_opts(traj_file, outputs, NULL);
+    if (! traj_opts) {
+      exit(EXIT_FAILURE);
+    }
+    register_instrument(instr_traj, traj_opts, use_async, async_policy,
+                        async_opts, &out_fields);
+  }
+  /* Record every state variable and parameter. */
+  void *record_opts = NULL;
+  if (record_file) {
+    record_opts = instr_record_opts(record_file, record_mb << 20);
+    if (! record_opts) {
+      exit(EXIT_FAILURE);
+    }
+    register_instrument(instr_record, record_opts, use_async, async_policy,
+                        async_opts, NULL);
+  }
+
+  /* Publish the specified model outputs in a live telemetry channel. */
+  void *telem_opts = NULL;
+  if (! telem_name.empty()) {
+    telem_opts = instr_telemetry_opts(telem_name.c_str(), outputs, 0);
+    if (! telem_opts) {
+      exit(EXIT_FAILURE);
+    }
+    add_instrument(instr_telemetry, telem_opts);
+    if (telem_dt > 0) {
+      add_instrument_filter(instr_telemetry, telem_opts, filter_interval,
+                            filter_interval_opts(telem_dt));
+    }
+  }
+
+  /* Resume from the latest checkpoint that is consistent with the
+     experiment, if there is one. This is only possible when the output
+     consists of the filtered text output. */
+  void *checkpoints = NULL;
+  bool resumed = false;
+  if (cacheable && e && use_filter && text_filters.empty() && ! decimate_n
+      && ! use_async) {
+    checkpoints = result_checkpoints(cache_dir, prefix_key, e,
+                                     CHECKPOINT_INTERVAL, cout);
+    resumed = result_resume(checkpoints, p, v, e, times_opts, text_opts);
+  }
+
+  /* Calculate the derivatives of the outputs, if the experiment selects any
+     parameters. These are only defined for the simulation as a whole, so
+     they preclude resuming from a checkpoint or a cached state. */
+  GRADIENT *grad = NULL;
+  if (sens && single) {
+    cerr << "ERROR: Derivatives are only defined in double precision" << endl;
+    exit(EXIT_FAILURE);
+  }
+  if (sens) {
+    grad = sensitivity_new(p, v, e, *outputs);
+    if (! grad) {
+      exit(EXIT_FAILURE);
+    }
+  }
+
+  /* Notify all registered instruments of the initial model state. */
+  if (! resumed) {
+    notify_instruments(p, v);
+  }
+
+  /* Resume from a cached state, if there is one (see baseline.cpp). This is
+     only possible when no notifications can pass the output filter until
+     the first output time. */
+  BASELINE *prev = NULL;
+  uint64_t key = 0;
+  if (cache && ! resumed && ! sens && ! incremental && ! single
+      && output_times && output_times[0] > 0 && output_times[0] < tend) {
+    /* Apply the initial parameter changes, as per the first time-step. */
+    e->update(v.t);
+    /* The continuous inputs are only applied as the simulation proceeds,
+       so every change that is scheduled before the first output time is
+       part of the key. */
+    ostringstream prefix;
+    prefix.precision(17);
+    param_changes cs(e->schedule());
+    while (! cs.empty() && cs.front().at_time < output_times[0]) {
+      prefix << "t= " << cs.front().at_time << endl;
+      Experiment::write_changes(prefix, cs.front());
+      cs.pop();
+    }
+    key = baseline_key(p, v, output_times[0], e->exact_times(),
+                       e->variant()->name, prefix.str());
+    if (! baseline_find(cache, key, p, v)) {
+      prev = new BASELINE;
+    }
+  }
+
+  /* The main simulation loop. */
+  while (v.t < tend) {
+    if (prev) {
+      memcpy(&prev->p, &p, sizeof(PARAMS));
+      memcpy(&prev->v, &v, sizeof(VARS));
+    }
+    result_checkpoint(checkpoints, p, v, e, times_opts);
+    if (grad) {
+      gradient_step(grad);
+    } else if (! single) {
+      guyton92_step(p, v, e);
+    } else if (! guyton92_step_float(p, v, e)) {
+      cerr << "ERROR: Model variants and experiments that intervene in the "
+           << "model are only defined in double precision" << endl;
+      exit(EXIT_FAILURE);
+    }
+    if (prev && v.t >= output_times[0]) {
+      /* Cache the state before the time-step that reached this time. */
+      baseline_store(cache, key, prev->p, prev->v);
+      delete prev;
+      prev = NULL;
+    }
+  }
+
+  /* Wait for the asynchronous instruments to process every notification.
+     The writer threads may still be notifying the decimation instrument, and
+     so this must precede closing it. */
+  for (size_t i = 0; i < async_opts.size(); i++) {
+    instr_async_close(async_opts[i]);
+  }
+  /* Display the final selected notifications (from this thread, once the
+     writer threads have finished). */
+  instr_decimate_close(decimate_opts);
+  /* Write any remaining rows to the binary trajectory file. */
+  instr_traj_close(traj_opts);
+  /* Write the full-state recording to disk. */
+  instr_record_close(record_opts);
+  /* Close the live telemetry channel. */
+  if (telem_opts) {
+    remove_instrument(instr_telemetry, telem_opts);
+    instr_telemetry_close(telem_opts);
+  }
+
+  /* Display the derivatives of the outputs. */
+  if (grad) {
+    bool ok = sensitivity_print(grad, e, *outputs, cout);
+    gradient_delete(grad);
+    if (! ok) {
+      exit(EXIT_FAILURE);
+    }
+  }
+
+  /* Report the number of modules that were skipped. */
+  if (dataflow) {
+    dataflow_print(dataflow, cerr);
+    dataflow_delete(dataflow);
+    dataflow = NULL;
+  }
+
+  /* Add the output to the cache of results. */
+  result_checkpoints_close(checkpoints, cache_mb << 20);
+  result_commit(capture, cache_mb << 20);
+
+  if (output_times) {
+    delete[] output_times;
+  }
+  delete e;
+  return EXIT_SUCCESS;
+}
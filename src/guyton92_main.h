@@ -0,0 +1 @@
+int guyton92_main(int argc, char *argv[], BASELINE_CACHE *cache);
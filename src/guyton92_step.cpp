@@ -1,9 +1,12 @@
 #include <queue>
+#include <vector>
 #include <string>
+#include <sstream>
 #include <iostream>
 #include <fstream>
 #include <cfloat>
 #include <cstdio>
+#include <cmath>
 
 using namespace std;
 
@@ -11,6 +14,8 @@ using namespace std;
 #include "params.h"
 /* Collect state variables into a single struct. */
 #include "vars.h"
+/* The scalar types with which the model equations are instantiated. */
+#include "scalar.h"
 /* Parse experiment definitions and automatically update model parameters. */
 #include "read_exp.h"
 
@@ -55,24 +60,68 @@ using namespace std;
 #include "exp_rapidreg.h"
 /* An experiment in transfusion and blood loss. */
 #include "exp_transfuse.h"
+/* Variants of the model that are required by specific experiments. */
+#include "exp_variants.h"
 
 /* The debugging and instrumentation module. */
 #include "debug.h"
+/* An instrument that publishes live telemetry in shared memory. */
+#include "instr_telemetry.h"
+/* A filter that permits one notification per time interval. */
+#include "filter_interval.h"
+/* Derivatives of model outputs with respect to parameters. */
+#include "gradient.h"
+/* Skip the modules whose inputs have not changed. */
+#include "dataflow.h"
+/* Compile-time descriptions of the sequence of modules in each time-step. */
+#include "pipeline.h"
+
+/* The functions that are provided by the shared library. */
+#include "guyton92_step.h"
 
 /**
- * Simulates a single time-step of the model.
+ * Applies the scheduled changes of an experiment (if any) at the start of a
+ * time-step (see guyton92_step()).
  *
  * @param[in] p      The struct of model parameters.
  * @param[in] v      The struct of state variables.
  * @param[in] e      The chosen experiment (if any) to run.
+ *
+ * @return The time at which the time-step must end, if the experiment
+ *         requires time-steps to end exactly at each output time and
+ *         scheduled change, otherwise \c DBL_MAX.
  */
-extern "C" void guyton92_step(PARAMS &p, VARS &v, Experiment *e) {
+double guyton92_update(PARAMS &p, VARS &v, Experiment *e) {
   fflush(stdout);
   if (e) {
     e->update(v.t);
   }
   fflush(stdout);
 
+  if (e && e->exact_times()) {
+    return e->next_time(v.t);
+  }
+  return DBL_MAX;
+}
+
+/**
+ * Evaluates the model equations for a single time-step, once the scheduled
+ * changes have been applied (see guyton92_update()). This is instantiated
+ * for each scalar type (see scalar.h), but the model variant and the
+ * experiments that intervene in the model only apply to \c double structs.
+ *
+ * @param[in] p      The struct of model parameters.
+ * @param[in] v      The struct of state variables.
+ * @param[in] var    The variant of the model, or \c NULL for the standard
+ *                   model without any intervening experiments.
+ * @param[in] t_next The time at which the time-step must end.
+ *
+ * @return \c false if the time-step was restarted (see module_autonom()),
+ *         otherwise \c true.
+ */
+template <typename T>
+bool guyton92_equations(PARAMS_T<T> &p, VARS_T<T> &v,
+                        const EXP_VARIANT *var, double t_next) {
   /* Disable autoregulation if AURG is negative. */
   if (v.aurg <= 0) {
     p.poz = 0;
@@ -88,42 +137,108 @@ extern "C" void guyton92_step(PARAMS &p, VARS &v, Experiment *e) {
     v.ram = 180;
   }
 
-  /* Simulate each module of the Guyton 1992 model in turn. */
-  module_circdyn(p, v);
-  if (! module_autonom(p, v)) {
-    /* If the autonomic circulation control module fails a stability check,
-       we restart the main simulation loop.
-       NOTE: this is the module that increases the simulation time. */
-    return;
-    /* When p.newkidney == 1, this check always fails at t = 14526.197550
-       and the simulation livelocks. */
-  }
-  module_aldost(p, v);
-  module_angio(p, v);
-  module_anp(p, v);
-  module_rbc(p, v);
-  module_o2deliv(p, v);
-  module_volrec(p, v);
-  module_adh(p, v);
-  module_stress(p, v);
-  module_thirst(p, v);
-  module_baro(p, v);
-  module_special(p, v);
-  module_capdyn(p, v);
-  module_puldyn(p, v);
-  if (p.newkidney) {
-    module_kidney(p, v); /* Run the replacement renal module. */
-  } else {
-    module_renal(p, v); /* Run the original renal module. */
+  /* Simulate each module of the Guyton 1992 model in turn, as per the
+     pipeline of the model variant (see pipeline.h). If the autonomic
+     circulation control module fails a stability check, the pipeline stops
+     and we restart the main simulation loop.
+     NOTE: the autonomic module is the module that increases the simulation
+     time. When p.newkidney == 1, this check always fails at
+     t = 14526.197550 and the simulation livelocks. */
+  STEP_STATE<T> s;
+  s.var = var;
+  s.t_next = t_next;
+  s.t0 = v.t;
+  s.step = v.i;
+  if (p.newkidney != 0) {
+    /* Run the replacement renal module. */
+    if (var) {
+      return PIPELINE_VARIANT_NEWKIDNEY::run(p, v, s);
+    }
+    return PIPELINE_NEWKIDNEY::run(p, v, s);
+  }
+  if (var) {
+    return PIPELINE_VARIANT::run(p, v, s);
+  }
+  return PIPELINE_STANDARD::run(p, v, s);
+}
+
+/* Instantiate the model equations for each scalar type (see scalar.h). */
+#define INSTANTIATE(T) \
+  template bool guyton92_equations<T>(PARAMS_T<T> &, VARS_T<T> &, \
+                                      const EXP_VARIANT *, double);
+FOR_EACH_SCALAR(INSTANTIATE)
+
+/**
+ * Simulates a single time-step of the model.
+ *
+ * @param[in] p      The struct of model parameters.
+ * @param[in] v      The struct of state variables.
+ * @param[in] e      The chosen experiment (if any) to run.
+ */
+extern "C" void guyton92_step(PARAMS &p, VARS &v, Experiment *e) {
+  double t_next = guyton92_update(p, v, e);
+
+  /* The variant of the model that is required by the experiment. */
+  const EXP_VARIANT *var = (e) ? e->variant() : exp_variant_default();
+
+  /* Notify all registered instruments of the current model state. */
+  if (guyton92_equations(p, v, var, t_next)) {
+    notify_instruments(p, v);
+  }
+}
+
+/**
+ * Simulates a single time-step of the model in single precision (see
+ * scalar.h): the model state is rounded to \c float before the time-step,
+ * and widened again afterwards. The scheduled changes are still applied in
+ * double precision. This is only used to measure the drift of the outputs
+ * (see utils/mixed_report.sh).
+ *
+ * @param[in] p      The struct of model parameters.
+ * @param[in] v      The struct of state variables.
+ * @param[in] e      The chosen experiment (if any) to run.
+ *
+ * @return \c false if the time-step requires the model variant or an
+ *         experiment that intervenes in the model, which are only defined
+ *         for \c double structs, otherwise \c true.
+ */
+extern "C" bool guyton92_step_float(PARAMS &p, VARS &v, Experiment *e) {
+  double t_next = guyton92_update(p, v, e);
+  if ((e && e->variant() != exp_variant_default()) || v.autoC > 0
+      || p.timetr > 0) {
+    return false;
+  }
+
+  /* The structs only contain scalars, so they can be copied as arrays. */
+  PARAMS_T<float> fp;
+  VARS_T<float> fv;
+  const double *ps = (const double *) &p;
+  const double *vs = (const double *) &v;
+  float *fps = (float *) &fp;
+  float *fvs = (float *) &fv;
+  for (int j = 0; j < PARAM_COUNT; j++) {
+    fps[j] = (float) ps[j];
+  }
+  for (int j = 0; j < VAR_COUNT; j++) {
+    fvs[j] = (float) vs[j];
   }
-  module_electro(p, v);
 
-  /* Perform any experiments that have been defined. */
-  exp_rapidreg(p, v);
-  exp_transfuse(p, v);
+  bool done = guyton92_equations(fp, fv, NULL, t_next);
+
+  double *pd = (double *) &p;
+  double *vd = (double *) &v;
+  for (int j = 0; j < PARAM_COUNT; j++) {
+    pd[j] = fps[j];
+  }
+  for (int j = 0; j < VAR_COUNT; j++) {
+    vd[j] = fvs[j];
+  }
 
   /* Notify all registered instruments of the current model state. */
-  notify_instruments(p, v);
+  if (done) {
+    notify_instruments(p, v);
+  }
+  return true;
 }
 
 /**
@@ -249,6 +364,16 @@ extern "C" const char * exp_output_var(Experiment *e, unsigned int i) {
   }
 }
 
+/**
+ * Determines whether each time-step should end exactly at the next output
+ * time or scheduled change of the experiment.
+ */
+extern "C" void exp_set_exact_times(Experiment *e, bool enable) {
+  if (e) {
+    e->set_exact_times(enable);
+  }
+}
+
 /**
  * Returns the times at which the model outputs should be recorded. The array
  * is terminated by the sentinel value \c exp_sentinel_time().
@@ -267,3 +392,216 @@ extern "C" const double * exp_output_times(Experiment *e) {
 extern "C" double exp_sentinel_time() {
   return DBL_MAX;
 }
+
+/**
+ * Creates a new simulation context, which can then be advanced by
+ * guyton92_run_until() and guyton92_run_sampled(). The parameters, variables
+ * and experiment are not copied, and must outlive the context.
+ *
+ * @param[in] p The struct of model parameters.
+ * @param[in] v The struct of state variables.
+ * @param[in] e The experiment (if any) to run.
+ */
+extern "C" G92_CTX * guyton92_ctx(PARAMS *p, VARS *v, Experiment *e) {
+  G92_CTX *ctx = new G92_CTX;
+  ctx->p = p;
+  ctx->v = v;
+  ctx->e = e;
+  return ctx;
+}
+
+/**
+ * Deletes an existing simulation context (but not its parameters, variables
+ * or experiment).
+ */
+extern "C" void guyton92_ctx_delete(G92_CTX *ctx) {
+  delete ctx;
+}
+
+/**
+ * Returns the handle of a state variable or parameter, for use with
+ * guyton92_run_sampled(). State variables take precedence over parameters.
+ *
+ * @param[in] name The name of the state variable or parameter.
+ *
+ * @return The handle, or -1 if there is no such variable or parameter.
+ */
+extern "C" int guyton92_handle(const char *name) {
+  int ix = var_index(name);
+  if (ix >= 0) {
+    return ix;
+  }
+  ix = param_index(name);
+  return (ix >= 0) ? VAR_COUNT + ix : -1;
+}
+
+/**
+ * Simulates time-steps until the end time is reached.
+ *
+ * @param[in] ctx The simulation context (see guyton92_ctx()).
+ * @param[in] t_end The simulation time at which to stop (mins).
+ * @param[in] max_steps The maximum number of time-steps to simulate, or zero
+ *                      if there is no limit.
+ *
+ * @return The number of time-steps that were simulated.
+ */
+extern "C" unsigned long guyton92_run_until(G92_CTX *ctx, double t_end,
+                                            unsigned long max_steps) {
+  PARAMS &p = *ctx->p;
+  VARS &v = *ctx->v;
+  unsigned long steps = 0;
+  while (v.t < t_end && (max_steps == 0 || steps < max_steps)) {
+    guyton92_step(p, v, ctx->e);
+    steps++;
+  }
+  return steps;
+}
+
+/**
+ * Simulates time-steps until each of the sample times is reached in turn, and
+ * records the value of the selected state variables and parameters at the
+ * end of the first time-step that reaches each sample time (as per the
+ * output of the model binary).
+ *
+ * The samples are written to the output buffer in row-major order, so that
+ * \c out[i * k + j] holds the value of \c handles[j] at \c times[i].
+ *
+ * @param[in] ctx The simulation context (see guyton92_ctx()).
+ * @param[in] times The sample times, in ascending order (mins).
+ * @param[in] n The number of sample times.
+ * @param[in] handles The handles of the state variables and parameters to
+ *                    record (see guyton92_handle()).
+ * @param[in] k The number of handles.
+ * @param[out] out The output buffer, which must hold (n * k) values.
+ *
+ * @return The number of samples that were recorded, or zero if any of the
+ *         handles are invalid.
+ */
+extern "C" unsigned long guyton92_run_sampled(G92_CTX *ctx,
+                                              const double *times,
+                                              unsigned long n,
+                                              const int *handles, int k,
+                                              double *out) {
+  for (int j = 0; j < k; j++) {
+    if (handles[j] < 0 || handles[j] >= VAR_COUNT + PARAM_COUNT) {
+      return 0;
+    }
+  }
+
+  /* The structs only contain doubles, so they can be read as arrays. */
+  const double *vs = (const double *) ctx->v;
+  const double *ps = (const double *) ctx->p;
+  for (unsigned long i = 0; i < n; i++) {
+    guyton92_run_until(ctx, times[i], 0);
+    double *row = out + i * k;
+    for (int j = 0; j < k; j++) {
+      int h = handles[j];
+      row[j] = (h < VAR_COUNT) ? vs[h] : ps[h - VAR_COUNT];
+    }
+  }
+  return n;
+}
+
+/**
+ * Simulates time-steps until each of the sample times is reached in turn, as
+ * per guyton92_run_sampled(), and also calculates the derivative of each
+ * sample with respect to the selected parameters (see gradient.cpp).
+ *
+ * @param[in] ctx The simulation context (see guyton92_ctx()).
+ * @param[in] mode The mode of calculation (eg, GRADIENT_FORWARD).
+ * @param[in] params The handles of the parameters (see guyton92_handle()).
+ * @param[in] n The number of parameters.
+ * @param[in] times The sample times, in ascending order (mins).
+ * @param[in] count The number of sample times.
+ * @param[in] handles The handles of the state variables and parameters to
+ *                    record (see guyton92_handle()).
+ * @param[in] k The number of handles.
+ * @param[out] out The output buffer, which must hold (count * k) values.
+ * @param[out] grad The derivative buffer, which must hold (count * k * n)
+ *                  values, such that \c grad[(i * k + h) * n + j] is the
+ *                  derivative of \c handles[h] at \c times[i] with respect
+ *                  to \c params[j].
+ *
+ * @return The number of samples that were recorded, or zero if any of the
+ *         arguments are invalid or any of the derivatives are rejected (see
+ *         gradient_finish()).
+ */
+extern "C" unsigned long guyton92_run_gradient(G92_CTX *ctx, int mode,
+                                               const int *params, int n,
+                                               const double *times,
+                                               unsigned long count,
+                                               const int *handles, int k,
+                                               double *out, double *grad) {
+  if (n <= 0) {
+    return 0;
+  }
+  vector<int> pix(n);
+  for (int j = 0; j < n; j++) {
+    if (params[j] < VAR_COUNT) {
+      return 0;
+    }
+    pix[j] = params[j] - VAR_COUNT;
+  }
+
+  GRADIENT *g = gradient_new(*ctx->p, *ctx->v, ctx->e, mode, &pix[0], n,
+                             times, count, handles, k);
+  if (! g) {
+    return 0;
+  }
+  while (gradient_samples(g) < count) {
+    gradient_step(g);
+  }
+  unsigned long samples = gradient_finish(g, out, grad);
+  gradient_delete(g);
+  return samples;
+}
+
+/**
+ * Starts publishing snapshots of the model state in a live telemetry channel
+ * (see instr_telemetry()), which can be read while the simulation is running
+ * (eg, by interface/telemetry.py).
+ *
+ * @param[in] name The name of the shared-memory object to create.
+ * @param[in] vars The comma-separated names of the state variables to
+ *                 publish, or \c NULL to publish every state variable.
+ * @param[in] slots The number of snapshots in the ring buffer, or zero for
+ *                  the default.
+ * @param[in] interval The minimum simulation time between snapshots (mins),
+ *                     or zero to publish a snapshot after every time-step.
+ *
+ * @return The telemetry channel, or \c NULL if it could not be created.
+ */
+extern "C" void * guyton92_telemetry_open(const char *name, const char *vars,
+                                          unsigned long slots,
+                                          double interval) {
+  vector<string> names;
+  if (vars) {
+    istringstream ss(vars);
+    string vname;
+    while (getline(ss, vname, ',')) {
+      names.push_back(vname);
+    }
+  }
+
+  void *opts = instr_telemetry_opts(name, (vars) ? &names : NULL, slots);
+  if (! opts) {
+    return NULL;
+  }
+  add_instrument(instr_telemetry, opts);
+  if (interval > 0) {
+    add_instrument_filter(instr_telemetry, opts, filter_interval,
+                          filter_interval_opts(interval));
+  }
+  return opts;
+}
+
+/**
+ * Stops publishing snapshots of the model state and closes the telemetry
+ * channel (see guyton92_telemetry_open()).
+ */
+extern "C" void guyton92_telemetry_close(void *channel) {
+  if (channel) {
+    remove_instrument(instr_telemetry, channel);
+    instr_telemetry_close(channel);
+  }
+}
@@ -1,4 +1,19 @@
+/**
+ * The state of a simulation that is advanced by guyton92_run_until() and
+ * guyton92_run_sampled(), rather than one time-step at a time.
+ */
+struct G92_CTX {
+  PARAMS *p; /** The struct of model parameters. */
+  VARS *v; /** The struct of state variables. */
+  Experiment *e; /** The experiment (if any) to run. */
+};
+
+double guyton92_update(PARAMS &p, VARS &v, Experiment *e);
+template <typename T>
+bool guyton92_equations(PARAMS_T<T> &p, VARS_T<T> &v,
+                        const EXP_VARIANT *var, double t_next);
 extern "C" void guyton92_step(PARAMS &p, VARS &v, Experiment *e);
+extern "C" bool guyton92_step_float(PARAMS &p, VARS &v, Experiment *e);
 extern "C" PARAMS * new_params();
 extern "C" VARS * new_vars();
 extern "C" void del_params(PARAMS *p);
@@ -11,5 +26,26 @@ extern "C" const char * exp_errmsg(Experiment *e);
 extern "C" double exp_stop_at(Experiment *e);
 extern "C" int exp_output_count(Experiment *e);
 extern "C" const char * exp_output_var(Experiment *e, unsigned int i);
+extern "C" void exp_set_exact_times(Experiment *e, bool enable);
 extern "C" const double * exp_output_times(Experiment *e);
 extern "C" double exp_sentinel_time();
+extern "C" G92_CTX * guyton92_ctx(PARAMS *p, VARS *v, Experiment *e);
+extern "C" void guyton92_ctx_delete(G92_CTX *ctx);
+extern "C" int guyton92_handle(const char *name);
+extern "C" unsigned long guyton92_run_until(G92_CTX *ctx, double t_end,
+                                            unsigned long max_steps);
+extern "C" unsigned long guyton92_run_sampled(G92_CTX *ctx,
+                                              const double *times,
+                                              unsigned long n,
+                                              const int *handles, int k,
+                                              double *out);
+extern "C" unsigned long guyton92_run_gradient(G92_CTX *ctx, int mode,
+                                               const int *params, int n,
+                                               const double *times,
+                                               unsigned long count,
+                                               const int *handles, int k,
+                                               double *out, double *grad);
+extern "C" void * guyton92_telemetry_open(const char *name, const char *vars,
+                                          unsigned long slots,
+                                          double interval);
+extern "C" void guyton92_telemetry_close(void *channel);
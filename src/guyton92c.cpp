@@ -0,0 +1,143 @@
+/**
+ * @file
+ * A client of the simulation daemon (see guyton92d.cpp). The client accepts
+ * exactly the same arguments as the model binary (guyton92), and the output
+ * of the job is written directly to the client's standard output and
+ * standard error, so that scripts can use either program interchangeably.
+ *
+ * If the daemon is not running, the client runs the model binary (from the
+ * same directory as the client) instead.
+ */
+
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+
+#include <limits.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+using namespace std;
+
+#include "daemon_proto.h"
+#include "guyton92c.h"
+
+/**
+ * Runs the model binary in place of the client, when the daemon cannot be
+ * reached. This function only returns if the model binary cannot be run.
+ *
+ * @param[in] argv The arguments provided on the command line.
+ */
+static void run_locally(char *argv[]) {
+  string model(argv[0]);
+  size_t slash = model.rfind('/');
+  model = (slash == string::npos) ? "guyton92"
+    : model.substr(0, slash + 1) + "guyton92";
+  argv[0] = (char *) model.c_str();
+  execvp(argv[0], argv);
+  cerr << "ERROR: Unable to run the model: '" << model << "'" << endl;
+}
+
+/**
+ * Writes exactly the given number of bytes to a file descriptor.
+ *
+ * @return \c true if every byte was written, otherwise \c false.
+ */
+static bool write_all(int fd, const char *buf, size_t len) {
+  while (len > 0) {
+    ssize_t n = write(fd, buf, len);
+    if (n <= 0) {
+      return false;
+    }
+    buf += n;
+    len -= (size_t) n;
+  }
+  return true;
+}
+
+/**
+ * The entry point for the client of the simulation daemon.
+ *
+ * @param[in] argc The number of arguments on the command line.
+ * @param[in] argv The arguments provided on the command line.
+ */
+int main(int argc, char *argv[]) {
+  string path = daemon_socket_path(false);
+  if (path.empty()) {
+    run_locally(argv);
+    return EXIT_FAILURE;
+  }
+
+  struct sockaddr_un addr;
+  memset(&addr, 0, sizeof(addr));
+  addr.sun_family = AF_UNIX;
+  strncpy(addr.sun_path, path.c_str(), sizeof(addr.sun_path) - 1);
+
+  int sock = socket(AF_UNIX, SOCK_STREAM, 0);
+  if (sock < 0 || connect(sock, (struct sockaddr *) &addr, sizeof(addr))) {
+    run_locally(argv);
+    return EXIT_FAILURE;
+  }
+
+  /* Only submit the job to a daemon that belongs to the same user. */
+  if (! daemon_peer_ok(sock)) {
+    cerr << "WARNING: The daemon on '" << path << "' belongs to another user"
+         << endl;
+    close(sock);
+    run_locally(argv);
+    return EXIT_FAILURE;
+  }
+
+  /* The job consists of the working directory and the model arguments. */
+  char cwd[PATH_MAX];
+  if (! getcwd(cwd, sizeof(cwd))) {
+    cerr << "ERROR: Unable to determine the working directory" << endl;
+    return EXIT_FAILURE;
+  }
+  string job(cwd, strlen(cwd) + 1);
+  for (int i = 1; i < argc; i++) {
+    job.append(argv[i], strlen(argv[i]) + 1);
+  }
+  if (job.size() > DAEMON_MAX_JOB) {
+    cerr << "ERROR: Too many arguments" << endl;
+    return EXIT_FAILURE;
+  }
+
+  /* Send the size of the job, along with standard output and error. */
+  uint32_t len = (uint32_t) job.size();
+  struct iovec iov;
+  iov.iov_base = &len;
+  iov.iov_len = sizeof(len);
+  int fds[DAEMON_FDS] = {STDOUT_FILENO, STDERR_FILENO};
+  char ctrl[CMSG_SPACE(sizeof(fds))];
+  memset(ctrl, 0, sizeof(ctrl));
+  struct msghdr msg;
+  memset(&msg, 0, sizeof(msg));
+  msg.msg_iov = &iov;
+  msg.msg_iovlen = 1;
+  msg.msg_control = ctrl;
+  msg.msg_controllen = sizeof(ctrl);
+  struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg);
+  cmsg->cmsg_level = SOL_SOCKET;
+  cmsg->cmsg_type = SCM_RIGHTS;
+  cmsg->cmsg_len = CMSG_LEN(sizeof(fds));
+  memcpy(CMSG_DATA(cmsg), fds, sizeof(fds));
+
+  if (sendmsg(sock, &msg, 0) != sizeof(len)
+      || ! write_all(sock, job.data(), job.size())) {
+    cerr << "ERROR: Unable to submit the job" << endl;
+    return EXIT_FAILURE;
+  }
+
+  /* Wait for the job to finish. */
+  int32_t code;
+  if (read(sock, &code, sizeof(code)) != sizeof(code)) {
+    cerr << "ERROR: The daemon did not complete the job" << endl;
+    return EXIT_FAILURE;
+  }
+  close(sock);
+  return code;
+}
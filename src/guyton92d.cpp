@@ -0,0 +1,385 @@
+/**
+ * @file
+ * A daemon that runs simulations of the Guyton 1992 model on behalf of
+ * clients (see guyton92c.cpp), so that scripts which run many simulations
+ * need not start a new model process for each one.
+ *
+ * Each job is run in a worker process that is forked from the daemon, with
+ * the same command-line arguments as the model binary (guyton92). Workers
+ * write directly to the client's standard output and standard error. The
+ * daemon limits the number of concurrent workers, and retains a cache of
+ * equilibrated model states (see baseline.cpp) that is shared with every
+ * worker, so that jobs which share a common starting point resume from it.
+ */
+
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <sstream>
+#include <vector>
+#include <string>
+#include <map>
+#include <list>
+
+#include <errno.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+
+using namespace std;
+
+#include "params.h"
+#include "vars.h"
+#include "baseline.h"
+#include "guyton92_main.h"
+#include "daemon_proto.h"
+#include "guyton92d.h"
+
+/** The default maximum number of cached model states. */
+#define CACHE_STATES 256
+
+/** A job that is being run by a worker process. */
+struct JOB {
+  pid_t pid; /** The worker process. */
+  int client; /** The connection to the client. */
+  int states; /** The pipe from which cached states are read. */
+};
+
+/** Whether the daemon has been asked to stop. */
+static volatile sig_atomic_t stopping = 0;
+
+/**
+ * Asks the daemon to stop, once the current jobs have finished.
+ */
+static void stop_daemon(int sig) {
+  stopping = 1;
+}
+
+/**
+ * Displays the command-line usage for the daemon, then exits.
+ *
+ * @param progname The name of the program.
+ * @param exitcode The exit code to pass to exit().
+ */
+static void usage(char *progname, int exitcode) {
+  cerr << "\n  USAGE: " << progname << " [options]" << endl;
+  cerr << "\n  OPTIONS:" << endl;
+  cerr << "    -j N        " <<
+    "Run at most N jobs at once (default: one per processor)." << endl;
+  cerr << "    -c N        " <<
+    "Cache at most N model states (default: " << CACHE_STATES << ")." << endl;
+  cerr << "    -s SOCKET   " <<
+    "Listen on SOCKET (default: $" << DAEMON_SOCKET_ENV << ", or " <<
+    DAEMON_SOCKET_NAME << " in $XDG_RUNTIME_DIR or " << DAEMON_DIR_FMT <<
+    ")." << endl;
+  cerr << "    -h          " << "Display this help and exit." << endl;
+  cerr << "\n  Jobs are submitted with guyton92c, which accepts the same " <<
+    "arguments as guyton92." << endl;
+  cerr << endl;
+  exit(exitcode);
+}
+
+/**
+ * Reads exactly the given number of bytes from a file descriptor.
+ *
+ * @return \c true if every byte was read, otherwise \c false.
+ */
+static bool read_all(int fd, char *buf, size_t len) {
+  while (len > 0) {
+    ssize_t n = read(fd, buf, len);
+    if (n <= 0) {
+      return false;
+    }
+    buf += n;
+    len -= (size_t) n;
+  }
+  return true;
+}
+
+/**
+ * Receives a job request from a client.
+ *
+ * @param[in] client The connection to the client.
+ * @param[out] fds The client's standard output and standard error.
+ * @param[out] args The client's working directory, followed by the
+ *                  command-line arguments for the model.
+ *
+ * @return \c true if the request was received, otherwise \c false.
+ */
+static bool recv_job(int client, int *fds, vector<string> &args) {
+  uint32_t len = 0;
+  struct iovec iov;
+  iov.iov_base = &len;
+  iov.iov_len = sizeof(len);
+  char ctrl[CMSG_SPACE(DAEMON_FDS * sizeof(int))];
+  struct msghdr msg;
+  memset(&msg, 0, sizeof(msg));
+  msg.msg_iov = &iov;
+  msg.msg_iovlen = 1;
+  msg.msg_control = ctrl;
+  msg.msg_controllen = sizeof(ctrl);
+
+  if (recvmsg(client, &msg, 0) != sizeof(len)) {
+    return false;
+  }
+  struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg);
+  if (! cmsg || cmsg->cmsg_type != SCM_RIGHTS
+      || cmsg->cmsg_len != CMSG_LEN(DAEMON_FDS * sizeof(int))) {
+    return false;
+  }
+  memcpy(fds, CMSG_DATA(cmsg), DAEMON_FDS * sizeof(int));
+
+  if (len == 0 || len > DAEMON_MAX_JOB) {
+    return false;
+  }
+  vector<char> buf(len);
+  if (! read_all(client, &buf[0], len) || buf[len - 1] != '\0') {
+    return false;
+  }
+  for (size_t start = 0; start < len; start += args.back().size() + 1) {
+    args.push_back(string(&buf[start]));
+  }
+  return true;
+}
+
+/**
+ * Runs a job in a new worker process. The job is received by the worker, so
+ * that a client which is slow to send its request cannot stall the daemon.
+ *
+ * @param[in] client The connection to the client.
+ * @param[in] listener The socket on which the daemon listens.
+ * @param[in] cache The cache of model states.
+ * @param[in,out] jobs The jobs that are currently running.
+ */
+static void start_job(int client, int listener, BASELINE_CACHE *cache,
+                      vector<JOB> &jobs) {
+  int states[2];
+  if (pipe(states) != 0) {
+    cerr << "ERROR: Unable to start a worker process" << endl;
+    close(client);
+    return;
+  }
+
+  pid_t pid = fork();
+  if (pid == 0) {
+    /* Only retain the descriptors that belong to this job. */
+    close(listener);
+    for (size_t i = 0; i < jobs.size(); i++) {
+      close(jobs[i].client);
+      close(jobs[i].states);
+    }
+    close(states[0]);
+    signal(SIGINT, SIG_DFL);
+    signal(SIGTERM, SIG_DFL);
+    signal(SIGPIPE, SIG_DFL);
+
+    /* Give up on clients that do not send their request in time. */
+    struct timeval timeout = {DAEMON_RECV_TIMEOUT, 0};
+    setsockopt(client, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    int fds[DAEMON_FDS] = {-1, -1};
+    vector<string> args;
+    if (! recv_job(client, fds, args)) {
+      cerr << "ERROR: Invalid job request" << endl;
+      exit(EXIT_FAILURE);
+    }
+    close(client);
+
+    /* Write new model states to the daemon, rather than to the cache. */
+    cache->fd = states[1];
+
+    dup2(fds[0], STDOUT_FILENO);
+    dup2(fds[1], STDERR_FILENO);
+    close(fds[0]);
+    close(fds[1]);
+    if (chdir(args[0].c_str()) != 0) {
+      cerr << "ERROR: Unable to change directory: '" << args[0] << "'"
+           << endl;
+      exit(EXIT_FAILURE);
+    }
+
+    /* The first argument is the program name. */
+    vector<char *> argv;
+    argv.push_back((char *) "guyton92");
+    for (size_t i = 1; i < args.size(); i++) {
+      argv.push_back((char *) args[i].c_str());
+    }
+    argv.push_back(NULL);
+    exit(guyton92_main((int) argv.size() - 1, &argv[0], cache));
+  }
+
+  close(states[1]);
+  if (pid < 0) {
+    cerr << "ERROR: Unable to start a worker process" << endl;
+    close(states[0]);
+    close(client);
+    return;
+  }
+
+  JOB job;
+  job.pid = pid;
+  job.client = client;
+  job.states = states[0];
+  jobs.push_back(job);
+}
+
+/**
+ * Waits for a worker process to exit, and sends its exit code to the client.
+ *
+ * @param[in] job The job that has finished.
+ */
+static void finish_job(const JOB &job) {
+  int status = 0;
+  while (waitpid(job.pid, &status, 0) < 0 && errno == EINTR) {
+  }
+  int32_t code = EXIT_FAILURE;
+  if (WIFEXITED(status)) {
+    code = WEXITSTATUS(status);
+  } else if (WIFSIGNALED(status)) {
+    code = 128 + WTERMSIG(status);
+  }
+  if (write(job.client, &code, sizeof(code)) != sizeof(code)) {
+    cerr << "WARNING: A client disconnected before its job finished" << endl;
+  }
+  close(job.client);
+  close(job.states);
+}
+
+/**
+ * The entry point for the simulation daemon.
+ *
+ * @param[in] argc The number of arguments on the command line.
+ * @param[in] argv The arguments provided on the command line.
+ */
+int main(int argc, char *argv[]) {
+  long max_jobs = sysconf(_SC_NPROCESSORS_ONLN);
+  unsigned long capacity = CACHE_STATES;
+  string path;
+
+  int c;
+  while ((c = getopt(argc, argv, "hj:c:s:")) != -1) {
+    istringstream ss((optarg) ? optarg : "");
+    switch (c) {
+    case 'j':
+      if (! (ss >> max_jobs) || max_jobs < 1) {
+        cerr << "ERROR: Invalid number of jobs: '" << optarg << "'" << endl;
+        usage(argv[0], EXIT_FAILURE);
+      }
+      break;
+    case 'c':
+      if (! (ss >> capacity)) {
+        cerr << "ERROR: Invalid cache size: '" << optarg << "'" << endl;
+        usage(argv[0], EXIT_FAILURE);
+      }
+      break;
+    case 's':
+      path = optarg;
+      break;
+    case 'h':
+      usage(argv[0], EXIT_SUCCESS);
+      break;
+    default:
+      usage(argv[0], EXIT_FAILURE);
+      break;
+    }
+  }
+  if (max_jobs < 1) {
+    max_jobs = 1;
+  }
+  if (path.empty()) {
+    path = daemon_socket_path(true);
+    if (path.empty()) {
+      return EXIT_FAILURE;
+    }
+  }
+
+  struct sockaddr_un addr;
+  memset(&addr, 0, sizeof(addr));
+  addr.sun_family = AF_UNIX;
+  if (path.size() >= sizeof(addr.sun_path)) {
+    cerr << "ERROR: Socket path is too long: '" << path << "'" << endl;
+    return EXIT_FAILURE;
+  }
+  strcpy(addr.sun_path, path.c_str());
+
+  /* Refuse to replace the socket of a daemon that is still running. */
+  int listener = socket(AF_UNIX, SOCK_STREAM, 0);
+  if (listener >= 0 &&
+      connect(listener, (struct sockaddr *) &addr, sizeof(addr)) == 0) {
+    cerr << "ERROR: A daemon is already listening on '" << path << "'"
+         << endl;
+    return EXIT_FAILURE;
+  }
+  close(listener);
+  unlink(path.c_str());
+
+  /* Only the user may connect to the socket. */
+  listener = socket(AF_UNIX, SOCK_STREAM, 0);
+  mode_t mask = umask(0077);
+  bool bound = listener >= 0
+    && bind(listener, (struct sockaddr *) &addr, sizeof(addr)) == 0;
+  umask(mask);
+  if (! bound || chmod(path.c_str(), 0600) != 0
+      || listen(listener, 64) != 0) {
+    cerr << "ERROR: Unable to listen on '" << path << "'" << endl;
+    return EXIT_FAILURE;
+  }
+
+  /* Stop once the current jobs have finished; do not restart poll(). */
+  struct sigaction sa;
+  memset(&sa, 0, sizeof(sa));
+  sa.sa_handler = stop_daemon;
+  sigaction(SIGINT, &sa, NULL);
+  sigaction(SIGTERM, &sa, NULL);
+  signal(SIGPIPE, SIG_IGN);
+
+  cerr << "Listening on '" << path << "' (" << max_jobs << " jobs)" << endl;
+
+  BASELINE_CACHE *cache = baseline_cache(capacity);
+  vector<JOB> jobs;
+  while (! stopping || ! jobs.empty()) {
+    /* Only accept new jobs when there is a free worker. */
+    vector<struct pollfd> fds;
+    bool accepting = ! stopping && (long) jobs.size() < max_jobs;
+    for (size_t i = 0; i < jobs.size(); i++) {
+      struct pollfd pfd = {jobs[i].states, POLLIN, 0};
+      fds.push_back(pfd);
+    }
+    if (accepting) {
+      struct pollfd pfd = {listener, POLLIN, 0};
+      fds.push_back(pfd);
+    }
+
+    if (poll(&fds[0], fds.size(), -1) < 0) {
+      continue;
+    }
+
+    /* A worker has either sent a new model state, or has exited. */
+    for (size_t i = jobs.size(); i-- > 0; ) {
+      if (fds[i].revents && ! baseline_read(cache, jobs[i].states)) {
+        finish_job(jobs[i]);
+        jobs.erase(jobs.begin() + i);
+      }
+    }
+
+    if (accepting && fds.back().revents & POLLIN) {
+      int client = accept(listener, NULL, NULL);
+      if (client >= 0 && ! daemon_peer_ok(client)) {
+        cerr << "WARNING: Refused a job from another user" << endl;
+        close(client);
+      } else if (client >= 0) {
+        start_job(client, listener, cache, jobs);
+      }
+    }
+  }
+
+  close(listener);
+  unlink(path.c_str());
+  baseline_cache_delete(cache);
+  return EXIT_SUCCESS;
+}
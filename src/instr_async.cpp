@@ -0,0 +1,260 @@
+#include <cstring>
+#include <iostream>
+#include <vector>
+#include <string>
+using namespace std;
+
+#include <pthread.h>
+#include <sched.h>
+#include <time.h>
+
+#include "params.h"
+#include "vars.h"
+#include "debug.h"
+#include "instr_async.h"
+
+/** The maximum number of slots in the ring buffer. */
+#define ASYNC_MAX_SLOTS (1UL << 24)
+
+/**
+ * This struct type stores the options and the state of this instrument.
+ *
+ * The ring buffer has a single producer (the simulation thread) and a single
+ * consumer (the writer thread). The producer only modifies \c head and the
+ * consumer only modifies \c tail, so no locks are required.
+ *
+ * Each slot of the ring buffer holds the values of the fields that the
+ * wrapped instrument reads (see instr_async_opts()), rather than the entire
+ * model state, so that each slot is small. The writer thread copies these
+ * values into its own PARAMS and VARS structs, and passes these structs to
+ * the wrapped instrument; the other fields of these structs retain their
+ * initial values.
+ */
+struct INSTR_ASYNC_OPTIONS {
+  instrument instr; /** The instrument that is run by the writer thread. */
+  void *data; /** The instrument-specific data (if any). */
+  int policy; /** What to do when the buffer is full (see async_policy). */
+  unsigned long size; /** The number of slots (a power of two). */
+  vector<int> fields; /** The index of each copied field, where a state
+                          variable \c j has index \c j and a parameter
+                          \c j has index \c VAR_COUNT + j. */
+  vector<double> slots; /** The preallocated slots, each of which holds
+                            the value of every field in \c fields. */
+  PARAMS p; /** The model parameters passed to the instrument. */
+  VARS v; /** The state variables passed to the instrument. */
+  unsigned long head; /** The number of slots that have been filled. */
+  unsigned long tail; /** The number of slots that have been consumed. */
+  unsigned long dropped; /** The number of notifications that were dropped. */
+  bool done; /** Whether the simulation has finished. */
+  bool removed; /** Whether the instrument asked to be removed. */
+  pthread_t thread; /** The writer thread. */
+};
+
+/**
+ * Waits briefly for the other thread to make progress. The first few waits
+ * only yield the processor; subsequent waits sleep, so that an idle thread
+ * does not consume an entire processor.
+ *
+ * @param[in,out] spins The number of consecutive waits.
+ */
+static void async_wait(int *spins) {
+  if (++(*spins) < 64) {
+    sched_yield();
+  } else {
+    struct timespec ts = {0, 100000};
+    nanosleep(&ts, NULL);
+  }
+}
+
+/**
+ * The writer thread, which passes each model state in the ring buffer to the
+ * instrument.
+ *
+ * @param[in] data The options for the instrument (see instr_async_opts()).
+ */
+static void *async_writer(void *data) {
+  INSTR_ASYNC_OPTIONS *opts = (INSTR_ASYNC_OPTIONS *) data;
+  unsigned long tail = opts->tail;
+  int spins = 0;
+
+  while (1) {
+    unsigned long head = __atomic_load_n(&opts->head, __ATOMIC_ACQUIRE);
+    if (tail == head) {
+      /* The buffer is empty; stop once the simulation has finished. */
+      if (__atomic_load_n(&opts->done, __ATOMIC_ACQUIRE)) {
+        head = __atomic_load_n(&opts->head, __ATOMIC_ACQUIRE);
+        if (tail == head) {
+          break;
+        }
+      } else {
+        async_wait(&spins);
+        continue;
+      }
+    }
+    spins = 0;
+
+    /* Notify the instrument of each model state, in order. */
+    double *vs = (double *) &opts->v;
+    double *ps = (double *) &opts->p;
+    size_t width = opts->fields.size();
+    while (tail != head) {
+      const double *slot = &opts->slots[(tail & (opts->size - 1)) * width];
+      for (size_t j = 0; j < width; j++) {
+        int ix = opts->fields[j];
+        if (ix < VAR_COUNT) {
+          vs[ix] = slot[j];
+        } else {
+          ps[ix - VAR_COUNT] = slot[j];
+        }
+      }
+      if (! opts->removed && ! opts->instr(opts->p, opts->v, opts->data)) {
+        __atomic_store_n(&opts->removed, true, __ATOMIC_RELEASE);
+      }
+      tail++;
+      __atomic_store_n(&opts->tail, tail, __ATOMIC_RELEASE);
+    }
+  }
+
+  return NULL;
+}
+
+/**
+ * The options for this instrument are:
+ *
+ * @param[in] instr The instrument that will be notified of the model state
+ *                  by the writer thread.
+ * @param[in] data The instrument-specific data (if any).
+ * @param[in] slots The minimum number of model states that can be buffered.
+ *                  This is limited to \c ASYNC_MAX_SLOTS and rounded up
+ *                  to the nearest power of two.
+ * @param[in] policy What to do when the buffer is full (see async_policy).
+ * @param[in] fields The names of the state variables and parameters that
+ *                   the instrument reads, in addition to the time (\c t).
+ *                   If this is \c NULL, the entire model state is copied
+ *                   (about 5 KB per slot).
+ *
+ * @return The options for the instrument, or \c NULL if the writer thread
+ *         could not be started.
+ */
+void *instr_async_opts(instrument instr, void *data, unsigned int slots,
+                       int policy, const vector<string> *fields) {
+  INSTR_ASYNC_OPTIONS *opts = new INSTR_ASYNC_OPTIONS;
+  opts->instr = instr;
+  opts->data = data;
+  opts->policy = policy;
+  opts->size = 1;
+  if (slots > ASYNC_MAX_SLOTS) {
+    slots = ASYNC_MAX_SLOTS;
+  }
+  while (opts->size < slots) {
+    opts->size *= 2;
+  }
+  if (fields) {
+    opts->fields.push_back(var_index("t"));
+    for (size_t j = 0; j < fields->size(); j++) {
+      int ix = var_index(fields->at(j).c_str());
+      if (ix < 0) {
+        ix = param_index(fields->at(j).c_str());
+        ix = (ix < 0) ? -1 : VAR_COUNT + ix;
+      }
+      /* The instrument reports any unknown names itself. */
+      if (ix >= 0) {
+        opts->fields.push_back(ix);
+      }
+    }
+  } else {
+    for (int ix = 0; ix < VAR_COUNT + PARAM_COUNT; ix++) {
+      opts->fields.push_back(ix);
+    }
+  }
+  opts->slots.resize(opts->size * opts->fields.size());
+  PARAMS_INIT(opts->p);
+  VARS_INIT(opts->v);
+  opts->head = 0;
+  opts->tail = 0;
+  opts->dropped = 0;
+  opts->done = false;
+  opts->removed = false;
+
+  if (pthread_create(&opts->thread, NULL, async_writer, opts) != 0) {
+    cerr << "ERROR: Unable to start the writer thread" << endl;
+    delete opts;
+    return NULL;
+  }
+
+  return (void *) opts;
+}
+
+/**
+ * Waits for the writer thread to process every buffered model state, then
+ * frees all of the resources that were allocated to this instrument. This
+ * must be called once the simulation is complete, before the wrapped
+ * instrument is closed.
+ *
+ * @param[in] data The options for the instrument (see instr_async_opts()).
+ */
+void instr_async_close(void *data) {
+  INSTR_ASYNC_OPTIONS *opts = (INSTR_ASYNC_OPTIONS *) data;
+  if (! opts) {
+    return;
+  }
+
+  __atomic_store_n(&opts->done, true, __ATOMIC_RELEASE);
+  pthread_join(opts->thread, NULL);
+
+  if (opts->dropped) {
+    cerr << "WARNING: " << opts->dropped << " notifications were dropped"
+         << endl;
+  }
+
+  delete opts;
+}
+
+/**
+ * This instrument copies the model state into a ring buffer, from which
+ * another instrument is notified by a separate writer thread. This allows
+ * the simulation to proceed while the output is formatted and written.
+ *
+ * @param[in] p The struct of model parameters.
+ * @param[in] v The struct of state variables.
+ * @param[in] data The options for the instrument (see instr_async_opts()).
+ *
+ * \ingroup instruments
+ */
+bool instr_async(const PARAMS &p, const VARS &v, void *data) {
+  INSTR_ASYNC_OPTIONS *opts = (INSTR_ASYNC_OPTIONS *) data;
+
+  /* If no options were provided, no notifications can be made. */
+  if (! opts) {
+    return false;
+  }
+  /* Remove this instrument once the wrapped instrument has been removed. */
+  if (__atomic_load_n(&opts->removed, __ATOMIC_ACQUIRE)) {
+    return false;
+  }
+
+  /* Wait for a free slot, or drop this notification if the buffer is full. */
+  unsigned long head = opts->head;
+  int spins = 0;
+  while (head - __atomic_load_n(&opts->tail, __ATOMIC_ACQUIRE) == opts->size) {
+    if (opts->policy == ASYNC_DROP) {
+      opts->dropped++;
+      return true;
+    }
+    async_wait(&spins);
+  }
+
+  /* Copy the fields into the free slot and publish it. The structs only
+     contain doubles, so they can be read as arrays. */
+  const double *vs = (const double *) &v;
+  const double *ps = (const double *) &p;
+  size_t width = opts->fields.size();
+  double *slot = &opts->slots[(head & (opts->size - 1)) * width];
+  for (size_t j = 0; j < width; j++) {
+    int ix = opts->fields[j];
+    slot[j] = (ix < VAR_COUNT) ? vs[ix] : ps[ix - VAR_COUNT];
+  }
+  __atomic_store_n(&opts->head, head + 1, __ATOMIC_RELEASE);
+
+  return true;
+}
@@ -0,0 +1,12 @@
+/**
+ * What the asynchronous instrument does when its buffer is full.
+ */
+enum async_policy {
+  ASYNC_BLOCK, /** Wait for the writer thread to free a slot. */
+  ASYNC_DROP /** Discard the notification. */
+};
+
+void *instr_async_opts(instrument instr, void *data, unsigned int slots,
+                       int policy, const std::vector<std::string> *fields);
+void instr_async_close(void *data);
+bool instr_async(const PARAMS &p, const VARS &v, void *data);
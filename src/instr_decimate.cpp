@@ -0,0 +1,219 @@
+#include <cmath>
+#include <cstring>
+#include <iostream>
+using namespace std;
+
+#include "params.h"
+#include "vars.h"
+#include "debug.h"
+#include "instr_decimate.h"
+
+/**
+ * A copy of the model state at a single notification.
+ */
+struct DECIMATE_POINT {
+  PARAMS p; /** The struct of model parameters. */
+  VARS v; /** The struct of state variables. */
+};
+
+/**
+ * This struct type stores the options and the state of this instrument.
+ *
+ * The notifications are divided into buckets of equal size, and a single
+ * notification is selected from each bucket. Selecting a notification from
+ * one bucket requires the average of the next bucket, so two buckets are
+ * retained at any time.
+ */
+struct INSTR_DECIMATE_OPTIONS {
+  instrument instr; /** The instrument that receives the notifications. */
+  void *data; /** The instrument-specific data (if any). */
+  int index; /** The index of the state variable in the VARS struct. */
+  unsigned long bucket; /** The number of notifications in each bucket. */
+  DECIMATE_POINT *curr; /** The bucket from which a point will be selected. */
+  DECIMATE_POINT *next; /** The bucket that follows the current bucket. */
+  unsigned long n_curr; /** The number of notifications in \c curr. */
+  unsigned long n_next; /** The number of notifications in \c next. */
+  bool started; /** Whether the first notification has been passed on. */
+  bool removed; /** Whether the instrument asked to be removed. */
+  double a_t; /** The time of the last notification passed on. */
+  double a_x; /** The value of the state variable at that time. */
+};
+
+/**
+ * Returns the value of the monitored state variable at a notification.
+ */
+static double value(const INSTR_DECIMATE_OPTIONS *opts,
+                    const DECIMATE_POINT &pt) {
+  return ((const double *) &pt.v)[opts->index];
+}
+
+/**
+ * Passes a single notification on to the instrument.
+ */
+static void emit(INSTR_DECIMATE_OPTIONS *opts, const DECIMATE_POINT &pt) {
+  opts->a_t = pt.v.t;
+  opts->a_x = value(opts, pt);
+  if (! opts->removed && ! opts->instr(pt.p, pt.v, opts->data)) {
+    opts->removed = true;
+  }
+}
+
+/**
+ * Selects the notification in the current bucket that forms the largest
+ * triangle with the last notification that was passed on and the point
+ * (c_t, c_x), and passes it on to the instrument.
+ *
+ * @param[in] opts The options for the instrument.
+ * @param[in] count The number of notifications in the current bucket that
+ *                  may be selected.
+ * @param[in] c_t The time of the third point of the triangle.
+ * @param[in] c_x The value of the third point of the triangle.
+ */
+static void select(INSTR_DECIMATE_OPTIONS *opts, unsigned long count,
+                   double c_t, double c_x) {
+  unsigned long best = 0;
+  double best_area = -1;
+  for (unsigned long i = 0; i < count; i++) {
+    double b_t = opts->curr[i].v.t;
+    double b_x = value(opts, opts->curr[i]);
+    double area = fabs((opts->a_t - c_t) * (b_x - opts->a_x)
+                       - (opts->a_t - b_t) * (c_x - opts->a_x));
+    if (area > best_area) {
+      best_area = area;
+      best = i;
+    }
+  }
+  emit(opts, opts->curr[best]);
+}
+
+/**
+ * Selects a notification from the current bucket, using the average of the
+ * next bucket, and then moves on to the next bucket.
+ */
+static void advance(INSTR_DECIMATE_OPTIONS *opts) {
+  double c_t = 0, c_x = 0;
+  for (unsigned long i = 0; i < opts->n_next; i++) {
+    c_t += opts->next[i].v.t;
+    c_x += value(opts, opts->next[i]);
+  }
+  c_t /= opts->n_next;
+  c_x /= opts->n_next;
+  select(opts, opts->n_curr, c_t, c_x);
+
+  DECIMATE_POINT *tmp = opts->curr;
+  opts->curr = opts->next;
+  opts->next = tmp;
+  opts->n_curr = opts->n_next;
+  opts->n_next = 0;
+}
+
+/**
+ * The options for this instrument are:
+ *
+ * @param[in] instr The instrument that receives the selected notifications.
+ * @param[in] data The instrument-specific data (if any).
+ * @param[in] name The name of the state variable whose shape is preserved.
+ * @param[in] bucket The number of notifications from which each selected
+ *                   notification is chosen.
+ *
+ * @return The options for the instrument, or \c NULL if there is no state
+ *         variable with the given name.
+ */
+void *instr_decimate_opts(instrument instr, void *data, const char *name,
+                          unsigned long bucket) {
+  int index = var_index(name);
+  if (index < 0) {
+    cerr << "ERROR: Unknown variable name \"" << name << "\"" << endl;
+    return NULL;
+  }
+
+  INSTR_DECIMATE_OPTIONS *opts = new INSTR_DECIMATE_OPTIONS;
+  opts->instr = instr;
+  opts->data = data;
+  opts->index = index;
+  opts->bucket = (bucket > 0) ? bucket : 1;
+  opts->curr = new DECIMATE_POINT[opts->bucket];
+  opts->next = new DECIMATE_POINT[opts->bucket];
+  opts->n_curr = 0;
+  opts->n_next = 0;
+  opts->started = false;
+  opts->removed = false;
+  opts->a_t = 0;
+  opts->a_x = 0;
+  return (void *) opts;
+}
+
+/**
+ * Passes on the remaining selected notifications, including the final
+ * notification, then frees all of the resources that were allocated to this
+ * instrument. This must be called once the simulation is complete.
+ *
+ * @param[in] data The options for the instrument (see instr_decimate_opts()).
+ */
+void instr_decimate_close(void *data) {
+  INSTR_DECIMATE_OPTIONS *opts = (INSTR_DECIMATE_OPTIONS *) data;
+  if (! opts) {
+    return;
+  }
+
+  if (opts->n_next > 0) {
+    /* Select from the current bucket, then pass on the final notification. */
+    advance(opts);
+    emit(opts, opts->curr[opts->n_curr - 1]);
+  } else if (opts->n_curr > 0) {
+    /* Select from all but the final notification, which is passed on. */
+    const DECIMATE_POINT &last = opts->curr[opts->n_curr - 1];
+    if (opts->n_curr > 1) {
+      select(opts, opts->n_curr - 1, last.v.t, value(opts, last));
+    }
+    emit(opts, last);
+  }
+
+  delete[] opts->curr;
+  delete[] opts->next;
+  delete opts;
+}
+
+/**
+ * This instrument passes a reduced number of notifications on to another
+ * instrument, using the largest-triangle-three-buckets algorithm to preserve
+ * the visual shape of a single state variable. The first and final
+ * notifications are always passed on, and one notification is selected from
+ * each bucket. Since the selection depends on the following bucket, the
+ * notifications are delayed by up to two buckets.
+ *
+ * @param[in] p The struct of model parameters.
+ * @param[in] v The struct of state variables.
+ * @param[in] data The options for the instrument (see instr_decimate_opts()).
+ *
+ * \ingroup instruments
+ */
+bool instr_decimate(const PARAMS &p, const VARS &v, void *data) {
+  INSTR_DECIMATE_OPTIONS *opts = (INSTR_DECIMATE_OPTIONS *) data;
+  if (! opts || opts->removed) {
+    return false;
+  }
+
+  DECIMATE_POINT pt;
+  memcpy(&pt.p, &p, sizeof(PARAMS));
+  memcpy(&pt.v, &v, sizeof(VARS));
+
+  /* The first notification is always passed on. */
+  if (! opts->started) {
+    opts->started = true;
+    emit(opts, pt);
+    return ! opts->removed;
+  }
+
+  /* Fill the current bucket, then the next bucket. */
+  if (opts->n_curr < opts->bucket) {
+    opts->curr[opts->n_curr++] = pt;
+  } else {
+    opts->next[opts->n_next++] = pt;
+    if (opts->n_next == opts->bucket) {
+      advance(opts);
+    }
+  }
+
+  return ! opts->removed;
+}
@@ -0,0 +1,4 @@
+void *instr_decimate_opts(instrument instr, void *data, const char *name,
+                          unsigned long bucket);
+void instr_decimate_close(void *data);
+bool instr_decimate(const PARAMS &p, const VARS &v, void *data);
@@ -0,0 +1,295 @@
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <vector>
+#include <string>
+using namespace std;
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+#include "params.h"
+#include "vars.h"
+#include "record_format.h"
+#include "read_record.h"
+#include "instr_record.h"
+
+/** The number of fields in each record. */
+#define REC_FIELDS (VAR_COUNT + PARAM_COUNT)
+
+/**
+ * This struct type stores the options and the state of this instrument.
+ *
+ * Chunks are allocated from memory until the memory budget is exhausted;
+ * subsequent chunks are memory-mapped from the recording file. Each chunk
+ * has a fixed location in the recording file, so the chunks that reside in
+ * memory are simply written to their locations once the simulation is
+ * complete.
+ */
+struct INSTR_RECORD_OPTIONS {
+  int fd; /** The recording file (or an anonymous temporary file). */
+  bool save; /** Whether the recording file should be kept. */
+  uint32_t header_size; /** The size of the recording header (bytes). */
+  unsigned long mem_chunks; /** The number of chunks allowed in memory. */
+  std::vector<unsigned char *> chunks; /** The location of each chunk. */
+  uint64_t used; /** The number of bytes used in the current chunk. */
+  uint64_t records; /** The number of records. */
+  uint64_t prev[REC_FIELDS]; /** The fields of the previous record. */
+};
+
+/**
+ * Writes the recording header at the start of the recording file.
+ *
+ * @return The size of the header (bytes).
+ */
+static uint32_t write_header(INSTR_RECORD_OPTIONS *opts) {
+  REC_HEADER hdr;
+  memset(&hdr, 0, sizeof(hdr));
+  strncpy(hdr.magic, REC_MAGIC, REC_MAGIC_LEN);
+  hdr.version = REC_VERSION;
+  hdr.var_count = VAR_COUNT;
+  hdr.param_count = PARAM_COUNT;
+  hdr.chunk_size = REC_CHUNK_SIZE;
+  hdr.chunks = opts->chunks.size();
+  hdr.records = opts->records;
+
+  /* The names of every state variable and parameter follow the header. */
+  string names;
+  for (int i = 0; i < VAR_COUNT; i++) {
+    names.append(VAR_NAMES[i]);
+    names.push_back('\0');
+  }
+  for (int i = 0; i < PARAM_COUNT; i++) {
+    names.append(PARAM_NAMES[i]);
+    names.push_back('\0');
+  }
+
+  /* Pad the header so that each chunk is aligned to a page boundary. */
+  size_t page = (size_t) sysconf(_SC_PAGESIZE);
+  size_t size = sizeof(hdr) + names.size();
+  size = (size + page - 1) / page * page;
+  hdr.header_size = (uint32_t) size;
+
+  pwrite(opts->fd, &hdr, sizeof(hdr), 0);
+  pwrite(opts->fd, names.data(), names.size(), sizeof(hdr));
+  return hdr.header_size;
+}
+
+/**
+ * Allocates a new chunk, either from memory or from the recording file.
+ *
+ * @return \c true if the chunk was allocated, otherwise \c false.
+ */
+static bool new_chunk(INSTR_RECORD_OPTIONS *opts) {
+  unsigned char *chunk = NULL;
+  size_t c = opts->chunks.size();
+
+  if (c < opts->mem_chunks) {
+    chunk = new unsigned char[REC_CHUNK_SIZE];
+  } else {
+    /* Spill this chunk to the recording file. */
+    off_t offset = opts->header_size + (off_t) c * REC_CHUNK_SIZE;
+    if (ftruncate(opts->fd, offset + REC_CHUNK_SIZE) != 0) {
+      cerr << "ERROR: Unable to extend the recording" << endl;
+      return false;
+    }
+    void *addr = mmap(NULL, REC_CHUNK_SIZE, PROT_READ | PROT_WRITE,
+                      MAP_SHARED, opts->fd, offset);
+    if (addr == MAP_FAILED) {
+      cerr << "ERROR: Unable to map the recording" << endl;
+      return false;
+    }
+    chunk = (unsigned char *) addr;
+  }
+
+  opts->chunks.push_back(chunk);
+  opts->used = REC_CHUNK_HDR;
+  memcpy(chunk, &opts->used, sizeof(opts->used));
+  /* The first record in each chunk is relative to zero (a keyframe). */
+  memset(opts->prev, 0, sizeof(opts->prev));
+  return true;
+}
+
+/**
+ * Encodes a single record, relative to the previous record.
+ *
+ * @param[in] cur The value of each field.
+ * @param[in,out] prev The value of each field in the previous record, which
+ *                     are replaced by the values in this record.
+ * @param[out] out The location at which the record is written.
+ *
+ * @return The size of the record (bytes).
+ */
+static size_t encode(const uint64_t *cur, uint64_t *prev, unsigned char *out) {
+  unsigned char *counts = out;
+  unsigned char *bytes = out + (REC_FIELDS + 1) / 2;
+  memset(counts, 0, (REC_FIELDS + 1) / 2);
+
+  for (int f = 0; f < REC_FIELDS; f++) {
+    uint64_t x = cur[f] ^ prev[f];
+    prev[f] = cur[f];
+
+    /* Only store the low-order bytes that are non-zero. */
+    int count = 0;
+    while (x) {
+      bytes[count++] = (unsigned char) (x & 0xFF);
+      x >>= 8;
+    }
+    counts[f / 2] |= count << (4 * (f % 2));
+    bytes += count;
+  }
+
+  return bytes - out;
+}
+
+/**
+ * The options for this instrument are:
+ *
+ * @param[in] filename The name of the recording file to create. If this is
+ *                     \c NULL, the recording is only available until
+ *                     instr_record_close() is called.
+ * @param[in] budget The amount of memory (bytes) that may be used before the
+ *                   recording is written to disk.
+ *
+ * @return The options for the instrument, or \c NULL if the recording file
+ *         could not be created.
+ */
+void *instr_record_opts(const char *filename, unsigned long budget) {
+  int fd = -1;
+  if (filename) {
+    fd = open(filename, O_RDWR | O_CREAT | O_TRUNC, 0644);
+  } else {
+    FILE *tmp = tmpfile();
+    fd = (tmp) ? dup(fileno(tmp)) : -1;
+    if (tmp) {
+      fclose(tmp);
+    }
+  }
+  if (fd < 0) {
+    cerr << "ERROR: Unable to create recording: '"
+         << ((filename) ? filename : "(temporary)") << "'" << endl;
+    return NULL;
+  }
+
+  INSTR_RECORD_OPTIONS *opts = new INSTR_RECORD_OPTIONS;
+  opts->fd = fd;
+  opts->save = (filename != NULL);
+  opts->mem_chunks = budget / REC_CHUNK_SIZE;
+  opts->used = 0;
+  opts->records = 0;
+  opts->header_size = write_header(opts);
+  return (void *) opts;
+}
+
+/**
+ * Obtains the entire history of a single state variable or parameter from
+ * the recording that is in progress.
+ *
+ * @param[in] data The options for the instrument (see instr_record_opts()).
+ * @param[in] name The name of the state variable or parameter.
+ * @param[out] times The times at which each record was made.
+ * @param[out] values The value of the state variable or parameter.
+ *
+ * @return \c true if the history was obtained, or \c false if there is no
+ *         state variable or parameter with the given name.
+ */
+bool instr_record_history(void *data, const char *name,
+                          std::vector<double> &times,
+                          std::vector<double> &values) {
+  INSTR_RECORD_OPTIONS *opts = (INSTR_RECORD_OPTIONS *) data;
+  int field = var_index(name);
+  if (field < 0) {
+    field = param_index(name);
+    if (field < 0) {
+      return false;
+    }
+    field += VAR_COUNT;
+  }
+
+  for (size_t c = 0; c < opts->chunks.size(); c++) {
+    record_chunk_history(opts->chunks[c], REC_FIELDS, var_index("t"), field,
+                         times, values);
+  }
+  return true;
+}
+
+/**
+ * Writes the recording to disk (if a file name was provided) and frees all
+ * of the resources that were allocated to this instrument. This must be
+ * called once the simulation is complete.
+ *
+ * @param[in] data The options for the instrument (see instr_record_opts()).
+ */
+void instr_record_close(void *data) {
+  INSTR_RECORD_OPTIONS *opts = (INSTR_RECORD_OPTIONS *) data;
+  if (! opts) {
+    return;
+  }
+
+  for (size_t c = 0; c < opts->chunks.size(); c++) {
+    if (c < opts->mem_chunks) {
+      /* Write this chunk to its location in the recording file. */
+      if (opts->save) {
+        off_t offset = opts->header_size + (off_t) c * REC_CHUNK_SIZE;
+        if (pwrite(opts->fd, opts->chunks[c], REC_CHUNK_SIZE, offset)
+            != REC_CHUNK_SIZE) {
+          cerr << "ERROR: Unable to write the recording" << endl;
+        }
+      }
+      delete[] opts->chunks[c];
+    } else {
+      munmap(opts->chunks[c], REC_CHUNK_SIZE);
+    }
+  }
+
+  /* Record the number of chunks and records in the header. */
+  if (opts->save) {
+    write_header(opts);
+  }
+  close(opts->fd);
+  delete opts;
+}
+
+/**
+ * This instrument records the value of every state variable and parameter,
+ * so that the history of any of these values can be obtained once the
+ * simulation has finished (see read_record.cpp).
+ *
+ * Each record is stored relative to the previous record (see
+ * record_format.h), so that unchanged values occupy very little space.
+ *
+ * @param[in] p The struct of model parameters.
+ * @param[in] v The struct of state variables.
+ * @param[in] data The options for the instrument (see instr_record_opts()).
+ *
+ * \ingroup instruments
+ */
+bool instr_record(const PARAMS &p, const VARS &v, void *data) {
+  INSTR_RECORD_OPTIONS *opts = (INSTR_RECORD_OPTIONS *) data;
+
+  /* If no options were provided, no recording can be made. */
+  if (! opts) {
+    return false;
+  }
+
+  /* Start a new chunk if there is insufficient space in the current one. */
+  if (opts->chunks.empty() ||
+      REC_CHUNK_SIZE - opts->used < REC_MAX_SIZE(REC_FIELDS)) {
+    if (! new_chunk(opts)) {
+      return false;
+    }
+  }
+
+  /* The structs only contain doubles, so they can be copied as arrays. */
+  uint64_t cur[REC_FIELDS];
+  memcpy(cur, &v, sizeof(VARS));
+  memcpy(cur + VAR_COUNT, &p, sizeof(PARAMS));
+
+  unsigned char *chunk = opts->chunks.back();
+  opts->used += encode(cur, opts->prev, chunk + opts->used);
+  memcpy(chunk, &opts->used, sizeof(opts->used));
+  opts->records++;
+
+  return true;
+}
@@ -0,0 +1,6 @@
+void *instr_record_opts(const char *filename, unsigned long budget);
+bool instr_record_history(void *data, const char *name,
+                          std::vector<double> &times,
+                          std::vector<double> &values);
+void instr_record_close(void *data);
+bool instr_record(const PARAMS &p, const VARS &v, void *data);
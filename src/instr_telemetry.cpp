@@ -0,0 +1,193 @@
+#include <cstring>
+#include <iostream>
+#include <vector>
+#include <string>
+using namespace std;
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+#include "params.h"
+#include "vars.h"
+#include "telemetry_format.h"
+#include "instr_telemetry.h"
+
+/**
+ * This struct type stores the options and the state of this instrument.
+ */
+struct INSTR_TELEMETRY_OPTIONS {
+  std::string name; /** The name of the shared-memory object. */
+  void *base; /** The start of the shared-memory object. */
+  size_t size; /** The size of the shared-memory object (bytes). */
+  TELEM_HEADER *hdr; /** The channel header. */
+  unsigned char *slots; /** The first slot of the ring buffer. */
+  std::vector<int> cols; /** The index of each column in the VARS struct. */
+  uint64_t head; /** The number of snapshots that have been published. */
+};
+
+/**
+ * The options for this instrument are:
+ *
+ * @param[in] name The name of the shared-memory object to create (eg,
+ *                 "/guyton92"). Any existing object with this name is
+ *                 replaced.
+ * @param[in] vars The names of the model variables to publish in each
+ *                 snapshot. If this is \c NULL, every state variable is
+ *                 published.
+ * @param[in] slots The number of snapshots that the ring buffer can hold,
+ *                  which is rounded up to a power of two. If this is zero,
+ *                  the default (\c TELEM_SLOTS) is used.
+ *
+ * @return The options for the instrument, or \c NULL if a variable name is
+ *         unknown or the shared-memory object could not be created.
+ */
+void *instr_telemetry_opts(const char *name,
+                           const std::vector<std::string> *vars,
+                           unsigned long slots) {
+  /* The first column is always time. */
+  vector<int> cols(1, var_index("t"));
+  if (vars) {
+    for (size_t i = 0; i < vars->size(); i++) {
+      int ix = var_index(vars->at(i).c_str());
+      if (ix < 0) {
+        cerr << "ERROR: Unknown variable name \"" << vars->at(i) << "\""
+             << endl;
+        return NULL;
+      }
+      cols.push_back(ix);
+    }
+  } else {
+    for (int ix = 0; ix < VAR_COUNT; ix++) {
+      if (ix != cols[0]) {
+        cols.push_back(ix);
+      }
+    }
+  }
+
+  /* The number of slots must be a power of two. */
+  unsigned long size = 1;
+  while (size < ((slots) ? slots : TELEM_SLOTS)) {
+    size <<= 1;
+  }
+
+  /* Calculate the size of the header, including the column names. */
+  string names;
+  for (size_t c = 0; c < cols.size(); c++) {
+    names.append(VAR_NAMES[cols[c]]);
+    names.push_back('\0');
+  }
+  size_t header_size = sizeof(TELEM_HEADER) + names.size();
+  header_size = (header_size + 7) / 8 * 8;
+  size_t slot_size = sizeof(uint64_t) + cols.size() * sizeof(double);
+
+  int fd = shm_open(name, O_RDWR | O_CREAT | O_TRUNC, 0644);
+  if (fd < 0) {
+    cerr << "ERROR: Unable to create telemetry channel: '" << name << "'"
+         << endl;
+    return NULL;
+  }
+  size_t total = header_size + size * slot_size;
+  void *base = MAP_FAILED;
+  if (ftruncate(fd, (off_t) total) == 0) {
+    base = mmap(NULL, total, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  }
+  close(fd);
+  if (base == MAP_FAILED) {
+    cerr << "ERROR: Unable to map telemetry channel: '" << name << "'"
+         << endl;
+    shm_unlink(name);
+    return NULL;
+  }
+
+  INSTR_TELEMETRY_OPTIONS *opts = new INSTR_TELEMETRY_OPTIONS;
+  opts->name = name;
+  opts->base = base;
+  opts->size = total;
+  opts->hdr = (TELEM_HEADER *) base;
+  opts->slots = (unsigned char *) base + header_size;
+  opts->cols = cols;
+  opts->head = 0;
+
+  /* The new object is zero-filled, so only the header must be written. */
+  memcpy((char *) base + sizeof(TELEM_HEADER), names.data(), names.size());
+  strncpy(opts->hdr->magic, TELEM_MAGIC, TELEM_MAGIC_LEN);
+  opts->hdr->version = TELEM_VERSION;
+  opts->hdr->ncols = (uint32_t) cols.size();
+  opts->hdr->slots = size;
+  opts->hdr->slot_size = slot_size;
+  opts->hdr->header_size = header_size;
+
+  return (void *) opts;
+}
+
+/**
+ * Marks the telemetry channel as finished and removes its name, so that no
+ * new readers can connect to it (existing readers can continue to read the
+ * final snapshots). The instrument must no longer be registered (see
+ * remove_instrument()) when this is called.
+ *
+ * @param[in] data The options for the instrument (see
+ *                 instr_telemetry_opts()).
+ */
+void instr_telemetry_close(void *data) {
+  INSTR_TELEMETRY_OPTIONS *opts = (INSTR_TELEMETRY_OPTIONS *) data;
+  if (! opts) {
+    return;
+  }
+
+  __atomic_store_n(&opts->hdr->done, 1, __ATOMIC_RELEASE);
+  munmap(opts->base, opts->size);
+  shm_unlink(opts->name.c_str());
+  delete opts;
+}
+
+/**
+ * This instrument publishes a snapshot of the time and an arbitrary list of
+ * model outputs in a shared-memory ring buffer (see telemetry_format.h), so
+ * that other threads and processes can display the simulation as it runs.
+ * The writer never waits for readers; once the ring buffer is full, the
+ * oldest snapshots are overwritten.
+ *
+ * Filters such as filter_interval() can be registered for this instrument
+ * (see add_instrument_filter()) to limit the rate at which snapshots are
+ * published.
+ *
+ * @param[in] p The struct of model parameters.
+ * @param[in] v The struct of state variables.
+ * @param[in] data The options for the instrument (see
+ *                 instr_telemetry_opts()).
+ *
+ * \ingroup instruments
+ */
+bool instr_telemetry(const PARAMS &p, const VARS &v, void *data) {
+  INSTR_TELEMETRY_OPTIONS *opts = (INSTR_TELEMETRY_OPTIONS *) data;
+
+  /* If no options were provided, no snapshots can be published. */
+  if (! opts) {
+    return false;
+  }
+
+  uint64_t n = opts->head;
+  unsigned char *slot = opts->slots
+    + (n & (opts->hdr->slots - 1)) * opts->hdr->slot_size;
+  uint64_t *seq = (uint64_t *) slot;
+  double *values = (double *) (slot + sizeof(uint64_t));
+
+  /* Mark the slot as being written before any values are modified. */
+  __atomic_store_n(seq, 2 * n + 1, __ATOMIC_RELAXED);
+  __atomic_thread_fence(__ATOMIC_RELEASE);
+
+  /* The struct only contains doubles, so it can be read as an array. */
+  const double *vs = (const double *) &v;
+  for (size_t c = 0; c < opts->cols.size(); c++) {
+    values[c] = vs[opts->cols[c]];
+  }
+
+  /* Publish the snapshot. */
+  __atomic_store_n(seq, 2 * n + 2, __ATOMIC_RELEASE);
+  opts->head = n + 1;
+  __atomic_store_n(&opts->hdr->head, opts->head, __ATOMIC_RELEASE);
+
+  return true;
+}
@@ -0,0 +1,5 @@
+void *instr_telemetry_opts(const char *name,
+                           const std::vector<std::string> *vars,
+                           unsigned long slots);
+void instr_telemetry_close(void *data);
+bool instr_telemetry(const PARAMS &p, const VARS &v, void *data);
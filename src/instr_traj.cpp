@@ -0,0 +1,170 @@
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <vector>
+#include <string>
+using namespace std;
+
+#include "params.h"
+#include "vars.h"
+#include "traj_format.h"
+#include "instr_traj.h"
+
+/**
+ * This struct type stores the options and the state of this instrument.
+ */
+struct INSTR_TRAJ_OPTIONS {
+  FILE *out; /** The trajectory file. */
+  const std::vector<std::string> *vars; /** The model variables to output. */
+  uint32_t ncols; /** The number of columns, including time. */
+  uint32_t chunk_rows; /** The maximum number of rows in each chunk. */
+  uint64_t rows; /** The number of rows in the current chunk. */
+  double *chunk; /** The current chunk, stored column by column. */
+};
+
+/**
+ * Writes a NUL-terminated string to the trajectory file header.
+ *
+ * @return The number of bytes that were written.
+ */
+static size_t write_str(FILE *out, const char *str) {
+  size_t len = strlen(str) + 1;
+  fwrite(str, 1, len, out);
+  return len;
+}
+
+/**
+ * Writes the current chunk to the trajectory file and empties the chunk.
+ *
+ * @param[in] opts The options for the instrument.
+ */
+static void write_chunk(INSTR_TRAJ_OPTIONS *opts) {
+  if (opts->rows == 0) {
+    return;
+  }
+
+  fwrite(&opts->rows, sizeof(opts->rows), 1, opts->out);
+  /* Only write the rows that have been recorded in each column. */
+  for (uint32_t c = 0; c < opts->ncols; c++) {
+    fwrite(opts->chunk + c * opts->chunk_rows, sizeof(double),
+           (size_t) opts->rows, opts->out);
+  }
+  opts->rows = 0;
+}
+
+/**
+ * The options for this instrument are:
+ *
+ * @param[in] filename The name of the trajectory file to create.
+ * @param[in] vars The names of the model variables to output for each state
+ *                 notification. If this is \c NULL, no output is produced.
+ * @param[in] units The units of each model variable (may be \c NULL).
+ *
+ * @return The options for the instrument, or \c NULL if the trajectory file
+ *         could not be created.
+ */
+void *instr_traj_opts(const char *filename,
+                      const std::vector<std::string> *vars,
+                      const std::vector<std::string> *units) {
+  FILE *out = fopen(filename, "wb");
+  if (! out) {
+    cerr << "ERROR: Unable to create trajectory: '" << filename << "'" << endl;
+    return NULL;
+  }
+
+  INSTR_TRAJ_OPTIONS *opts = new INSTR_TRAJ_OPTIONS;
+  opts->out = out;
+  opts->vars = vars;
+  opts->ncols = 1 + ((vars) ? vars->size() : 0);
+  opts->chunk_rows = TRAJ_CHUNK_ROWS;
+  opts->rows = 0;
+  opts->chunk = new double[opts->ncols * opts->chunk_rows];
+
+  /* Write the fixed-size portion of the header, which is completed below. */
+  TRAJ_HEADER hdr;
+  memset(&hdr, 0, sizeof(hdr));
+  strncpy(hdr.magic, TRAJ_MAGIC, TRAJ_MAGIC_LEN);
+  hdr.version = TRAJ_VERSION;
+  hdr.ncols = opts->ncols;
+  hdr.chunk_rows = opts->chunk_rows;
+  fwrite(&hdr, sizeof(hdr), 1, out);
+
+  /* Write the name and units of each column. */
+  size_t size = sizeof(hdr);
+  size += write_str(out, "t");
+  size += write_str(out, "min");
+  for (uint32_t c = 1; c < opts->ncols; c++) {
+    size += write_str(out, vars->at(c - 1).c_str());
+    if (units && c - 1 < units->size()) {
+      size += write_str(out, units->at(c - 1).c_str());
+    } else {
+      size += write_str(out, "");
+    }
+  }
+
+  /* Pad the header so that the data is aligned to 8 bytes. */
+  while (size % 8) {
+    fputc(0, out);
+    size++;
+  }
+
+  /* Record the size of the header. */
+  hdr.header_size = (uint32_t) size;
+  fseek(out, 0, SEEK_SET);
+  fwrite(&hdr, sizeof(hdr), 1, out);
+  fseek(out, 0, SEEK_END);
+
+  return (void *) opts;
+}
+
+/**
+ * Writes any remaining rows to the trajectory file and closes it. This must
+ * be called once the simulation is complete.
+ *
+ * @param[in] data The options for the instrument (see instr_traj_opts()).
+ */
+void instr_traj_close(void *data) {
+  INSTR_TRAJ_OPTIONS *opts = (INSTR_TRAJ_OPTIONS *) data;
+  if (! opts) {
+    return;
+  }
+
+  write_chunk(opts);
+  fclose(opts->out);
+  delete[] opts->chunk;
+  delete opts;
+}
+
+/**
+ * This instrument records the time and an arbitrary list of model outputs in
+ * a binary trajectory file (see traj_format.h).
+ *
+ * @param[in] p The struct of model parameters.
+ * @param[in] v The struct of state variables.
+ * @param[in] data The options for the instrument (see instr_traj_opts()).
+ *
+ * \ingroup instruments
+ */
+bool instr_traj(const PARAMS &p, const VARS &v, void *data) {
+  INSTR_TRAJ_OPTIONS *opts = (INSTR_TRAJ_OPTIONS *) data;
+
+  /* If no options were provided, no output can be produced. */
+  if (! opts) {
+    return false;
+  }
+
+  /* Record the time and each output variable in the current chunk. */
+  double *row = opts->chunk + opts->rows;
+  row[0] = v.t;
+  for (uint32_t c = 1; c < opts->ncols; c++) {
+    row[c * opts->chunk_rows] = get_var(v, opts->vars->at(c - 1).c_str());
+  }
+
+  /* Write the chunk to the trajectory file once it is full. */
+  opts->rows++;
+  if (opts->rows == opts->chunk_rows) {
+    write_chunk(opts);
+  }
+
+  return true;
+}
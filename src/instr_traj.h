@@ -0,0 +1,5 @@
+void *instr_traj_opts(const char *filename,
+                      const std::vector<std::string> *vars,
+                      const std::vector<std::string> *units);
+void instr_traj_close(void *data);
+bool instr_traj(const PARAMS &p, const VARS &v, void *data);
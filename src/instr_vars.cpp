@@ -13,6 +13,7 @@ using namespace std;
 struct INSTR_VARS_OPTIONS {
   char *sep; /** The field separator. */
   const std::vector<std::string> *vars; /** The model variables to output. */
+  bool header; /** Whether the column headers have been printed. */
 };
 
 /**
@@ -27,9 +28,23 @@ void *instr_vars_opts(char* sep, const std::vector<std::string> *vars) {
   INSTR_VARS_OPTIONS *opts = new INSTR_VARS_OPTIONS;
   opts->sep = sep;
   opts->vars = vars;
+  opts->header = false;
   return (void *) opts;
 }
 
+/**
+ * Prevents the column headers from being printed, because they have already
+ * been printed (eg, when resuming a simulation from a saved model state).
+ *
+ * @param[in] data The options for the instrument (see instr_vars_opts()).
+ */
+void instr_vars_skip_header(void *data) {
+  INSTR_VARS_OPTIONS *opts = (INSTR_VARS_OPTIONS *) data;
+  if (opts) {
+    opts->header = true;
+  }
+}
+
 /**
  * This instrument prints the time and an arbitrary list of model outputs.
  *
@@ -40,7 +55,6 @@ void *instr_vars_opts(char* sep, const std::vector<std::string> *vars) {
  * \ingroup instruments
  */
 bool instr_vars(const PARAMS &p, const VARS &v, void *data) {
-  static bool first_time = true;
   char *sep = (char *) " ";
   INSTR_VARS_OPTIONS *opts = (INSTR_VARS_OPTIONS *) data;
 
@@ -59,8 +73,8 @@ bool instr_vars(const PARAMS &p, const VARS &v, void *data) {
   }
 
   /* Print the column headers. */
-  if (first_time) {
-    first_time = false;
+  if (! opts->header) {
+    opts->header = true;
 
     cout << "t";
     for (int i = 0; i < (int) opts->vars->size(); i++) {
@@ -1,2 +1,3 @@
 void *instr_vars_opts(char* sep, const std::vector<std::string> *vars);
+void instr_vars_skip_header(void *data);
 bool instr_vars(const PARAMS &p, const VARS &v, void *data);
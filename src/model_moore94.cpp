@@ -11,6 +11,8 @@
 
 #include "params.h"
 #include "vars.h"
+#include "scalar.h"
+#include "fastmath.h"
 #include "model_moore94.h"
 
 /** The parameters for the Moore94 model. */
@@ -90,7 +92,8 @@ struct MOORE94VARS {
  *
  * @param[in] c The protein concentration (<b>g/dL, presumably</b>).
  */
-double oncotic(double c) {
+template <typename T>
+T oncotic(T c) {
   return 2.1 * c + 0.16 * c * c + 0.009 * c * c * c;
 }
 
@@ -101,7 +104,8 @@ double oncotic(double c) {
  * @param[in] p      The struct of model parameters.
  * @param[in] v      The struct of state variables.
  */
-void solve_gfr_model(const PARAMS &p, VARS &v) {
+template <typename T>
+void solve_gfr_model(const PARAMS_T<T> &p, VARS_T<T> &v) {
   /* Initial estimates of the outputs. */
   v.Pg0 = v.Pas * 0.4; /* Glomerular pressure at x=0 (mmHg). */
   v.GFR = 20.0; /* Single-nephron filtration rate (nL/min). */
@@ -109,14 +113,14 @@ void solve_gfr_model(const PARAMS &p, VARS &v) {
   /* Solve the equations iteratively until they converge. */
   while (true) {
     /* Local variables for this loop. */
-    double Ba = (v.Pas - v.Pg0) / v.Ra; /* Afferent blood flow (nL/min). */
-    double Be = Ba - v.GFR; /* Efferent blood flow (nL/min). */
-    double Q0 = Ba * (1 - p.H0); /* Afferent plasma flow (nL/min). */
-    double Pt = 7.5 + 0.13 * v.GFR; /* Bowman's space pressure (mmHg). */
+    T Ba = (v.Pas - v.Pg0) / v.Ra; /* Afferent blood flow (nL/min). */
+    T Be = Ba - v.GFR; /* Efferent blood flow (nL/min). */
+    T Q0 = Ba * (1 - p.H0); /* Afferent plasma flow (nL/min). */
+    T Pt = 7.5 + 0.13 * v.GFR; /* Bowman's space pressure (mmHg). */
 
     /* Integration variables. */
-    double Q = Q0;
-    double Pg = v.Pg0;
+    T Q = Q0;
+    T Pg = v.Pg0;
 
     /* Integration step variables. */
     double dx = 1e-3; /* The size of the integration step. */
@@ -124,14 +128,14 @@ void solve_gfr_model(const PARAMS &p, VARS &v) {
     /* Integrate dQ/dx and dPg/dx from x=0 to x=1. */
     for (double x = dx; x <= 1.0; x += dx) {
       /* The protein concentration at x. */
-      double Cx = p.C0 * Q0 / Q;
+      T Cx = p.C0 * Q0 / Q;
       /* The glomerular oncotic pressure at x. */
-      double Ponc = oncotic(Cx);
+      T Ponc = oncotic(Cx);
 
       /* Calculate dQ/dx at x. */
-      double dQ = - p.Kf * (Pg - Ponc - Pt);
+      T dQ = - p.Kf * (Pg - Ponc - Pt);
       /* Calculate dPg/dx at x. */
-      double dPg = - p.Rg * Q;
+      T dPg = - p.Rg * Q;
 
       /* Use Euler's method to calculate Q(x) and Pg(x). */
       Q += dx * dQ;
@@ -139,11 +143,11 @@ void solve_gfr_model(const PARAMS &p, VARS &v) {
     }
 
     /* Collect the values of Q(x) and Pg(x) at x=1. */
-    double Q1 = Q;
-    double Pg1 = Pg;
+    T Q1 = Q;
+    T Pg1 = Pg;
 
     /* Check if the conservation condition has been met. */
-    double diff = v.Pas - Ba * v.Ra - Be * p.Re - p.Pc - (v.Pg0 - Pg1);
+    T diff = v.Pas - Ba * v.Ra - Be * p.Re - p.Pc - (v.Pg0 - Pg1);
     if (fabs(diff) < 1e-3) {
       return;
     }
@@ -161,16 +165,17 @@ void solve_gfr_model(const PARAMS &p, VARS &v) {
  * @param[in] p      The struct of model parameters.
  * @param[in] v      The struct of state variables.
  */
-void solve_proximal_model(const PARAMS &p, VARS &v) {
+template <typename T>
+void solve_proximal_model(const PARAMS_T<T> &p, VARS_T<T> &v) {
   /* Decrease Fp by 0.9% for each mmHg that Pas is above 100 mmHg.
      See paragraph 3 on page 400 of Moore et al. 1994. */
-  double Fp1 = p.Fp;
+  T Fp1 = p.Fp;
   if (v.Pas > 100.0) {
     Fp1 = Fp1 * (1.0 - (v.Pas - 100.0) * 0.009);
   }
 
-  double Qtp = v.GFR * (1.0 - Fp1) - p.Rp + p.Ip;
-  double Qep = Qtp * (1 - p.Fs) - p.Rs;
+  T Qtp = v.GFR * (1.0 - Fp1) - p.Rp + p.Ip;
+  T Qep = Qtp * (1 - p.Fs) - p.Rs;
 
   v.Qalh = Qep * p.Cic / p.Cim;
   v.Calh = p.Cim;
@@ -183,18 +188,19 @@ void solve_proximal_model(const PARAMS &p, VARS &v) {
  * @param[in] p      The struct of model parameters.
  * @param[in] v      The struct of state variables.
  */
-void solve_alh_model(const PARAMS &p, VARS &v) {
-  double pv_sq = (p.Ps + p.Vm) * (p.Ps + p.Vm);
+template <typename T>
+void solve_alh_model(const PARAMS_T<T> &p, VARS_T<T> &v) {
+  T pv_sq = (p.Ps + p.Vm) * (p.Ps + p.Vm);
 
-  double a = p.Ps * p.Cim / (p.Ps + p.Vm);
-  double b = p.Ps * p.K1 * v.Qalh / (2 * M_PI * p.alr * pv_sq);
+  T a = p.Ps * p.Cim / (p.Ps + p.Vm);
+  T b = p.Ps * p.K1 * v.Qalh / (2 * M_PI * p.alr * pv_sq);
   b *= 1e-6; /* Convert (mM nL)/(cm^3) to (mM nL)/(nL) = mM. */
-  double c = 2 * M_PI * p.alr * (p.Ps + p.Vm) / v.Qalh;
+  T c = 2 * M_PI * p.alr * (p.Ps + p.Vm) / v.Qalh;
   c *= 1e6; /* Convert (c * p.alx) from (cm^3)/(nL) to having no units. */
-  double d = p.K1 * p.Ps / (p.Ps + p.Vm);
+  T d = p.K1 * p.Ps / (p.Ps + p.Vm);
 
   /* The NaCl concentration at the cortico-medullary junction. */
-  double Ci1 = (v.Calh - a - b) * exp(- c * p.alx) - p.alx * d + a + b;
+  T Ci1 = (v.Calh - a - b) * fm_exp(- c * p.alx) - p.alx * d + a + b;
 
   /* Change the equation parameters for the cortical segment. */
   a = p.Ps * p.Cic / (p.Ps + p.Vm);
@@ -202,7 +208,7 @@ void solve_alh_model(const PARAMS &p, VARS &v) {
   d = 0;
 
   /* The NaCl concentration at the macula densa. */
-  v.Ci = (Ci1 - a - b) * exp(- c * p.alx) - p.alx * d + a + b;
+  v.Ci = (Ci1 - a - b) * fm_exp(- c * p.alx) - p.alx * d + a + b;
 }
 
 /**
@@ -212,8 +218,9 @@ void solve_alh_model(const PARAMS &p, VARS &v) {
  * @param[in] p      The struct of model parameters.
  * @param[in] v      The struct of state variables.
  */
-void solve_tgf_model(const PARAMS &p, VARS &v) {
-  double Ci = v.Ci;
+template <typename T>
+void solve_tgf_model(const PARAMS_T<T> &p, VARS_T<T> &v) {
+  T Ci = v.Ci;
 
   if (v.Ci < p.Ct) {
     Ci = p.Ct;
@@ -232,8 +239,9 @@ void solve_tgf_model(const PARAMS &p, VARS &v) {
  * @param[in] p      The struct of model parameters.
  * @param[in] v      The struct of state variables.
  */
-void solve_moore94_model(const PARAMS &p, VARS &v) {
-  double prev_dRtgf = -1.0;
+template <typename T>
+void solve_moore94_model(const PARAMS_T<T> &p, VARS_T<T> &v) {
+  T prev_dRtgf = -1.0;
 
   /* Initially, we assume that the myogenic and TGF resistances are zero. */
   v.dRma = 0;
@@ -255,10 +263,10 @@ void solve_moore94_model(const PARAMS &p, VARS &v) {
     prev_dRtgf = v.dRtgf;
 
     /* Calculate the new predictions for dRma, dRmd and Ra. */
-    if (p.moore94amyo) {
+    if (p.moore94amyo != 0) {
         v.dRma = p.Ga * v.dRtgf * (p.Rb + v.dRmd) / (p.Rg + p.Re);
     }
-    if (p.moore94dmyo) {
+    if (p.moore94dmyo != 0) {
         v.dRmd = p.Gd * (v.Pas / p.Paso - 1.0) *
                  (p.Rb + v.dRma + v.dRtgf + p.Rg + p.Re);
     }
@@ -274,3 +282,8 @@ void solve_moore94_model(const PARAMS &p, VARS &v) {
     v.dRtgf = 0.5 * (v.dRtgf + prev_dRtgf);
   }
 }
+
+/* Instantiate the model for each scalar type (see scalar.h). */
+#define INSTANTIATE(T) \
+  template void solve_moore94_model<T>(const PARAMS_T<T> &, VARS_T<T> &);
+FOR_EACH_SCALAR(INSTANTIATE)
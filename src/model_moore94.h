@@ -1 +1,2 @@
-void solve_moore94_model(const PARAMS &p, VARS &v);
+template <typename T>
+void solve_moore94_model(const PARAMS_T<T> &p, VARS_T<T> &v);
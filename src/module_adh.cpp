@@ -6,6 +6,8 @@
 
 #include "params.h"
 #include "vars.h"
+#include "scalar.h"
+#include "fastmath.h"
 #include "utils.h"
 #include "module_adh.h"
 
@@ -19,7 +21,8 @@
  *
  * \ingroup modules
  */
-void module_adh(const PARAMS &p, VARS &v) {
+template <typename T>
+void module_adh(const PARAMS_T<T> &p, VARS_T<T> &v) {
   /* The influence of osmoreceptors. */
   v.adhna = (v.cna - p.cnr) / (142 - p.cnr);
   if (v.adhna < 0) {
@@ -32,14 +35,14 @@ void module_adh(const PARAMS &p, VARS &v) {
   }
 
   /* The production of ADH. */
-  v.adhpr = pow(p.adhpul - v.adhpa, 2) * p.adhpam;
+  v.adhpr = fm_ipow<2>(p.adhpul - v.adhpa) * p.adhpam;
   v.adh = v.adhna + v.adhpr + p.adhinf;
   if (v.adh < 0) {
     v.adh = 0;
   }
 
   v.adhc = v.adhc + (v.adh - v.adhc)
-            * (1 - 1 / pow(2.7183, v.i / p.adhtc / p.z16));
+            * lag_fraction(v.i / p.adhtc / p.z16);
 
   /* The effect of ADH on the kidneys. */
   v.adhz = p.adhkll - p.adhkul;
@@ -57,3 +60,8 @@ void module_adh(const PARAMS &p, VARS &v) {
     v.adhmv = p.adhvll;
   }
 }
+
+/* Instantiate the module for each scalar type (see scalar.h). */
+#define INSTANTIATE(T) \
+  template void module_adh<T>(const PARAMS_T<T> &, VARS_T<T> &);
+FOR_EACH_SCALAR(INSTANTIATE)
@@ -6,6 +6,7 @@
 
 #include "params.h"
 #include "vars.h"
+#include "scalar.h"
 #include "utils.h"
 #include "module_aldost.h"
 
@@ -18,7 +19,8 @@
  *
  * \ingroup modules
  */
-void module_aldost(const PARAMS &p, VARS &v) {
+template <typename T>
+void module_aldost(const PARAMS_T<T> &p, VARS_T<T> &v) {
   /* Aldosterone secretion. */
   v.amrbsc = ((v.anm - 1) * p.anmald + 1) * 0.909 * (v.cke - 3.3);
 
@@ -32,7 +34,7 @@ void module_aldost(const PARAMS &p, VARS &v) {
     v.amr1 = p.aldkns;
   }
 
-  v.amc = v.amc + (v.amr1 - v.amc) * (1 - 1 / pow(2.7183, v.i / p.amt));
+  v.amc = v.amc + (v.amr1 - v.amc) * lag_fraction(v.i / p.amt);
   v.am1 = p.am1ul - (p.am1ul - 1) / ((p.am1ll - 1)
            / (p.am1ll - p.am1ul) * (v.amc - 1) * p.amcsns + 1);
   v.am = (v.am1 - 1) * p.aldmm + 1;
@@ -52,3 +54,8 @@ void module_aldost(const PARAMS &p, VARS &v) {
     v.amna = p.amnaul;
   }
 }
+
+/* Instantiate the module for each scalar type (see scalar.h). */
+#define INSTANTIATE(T) \
+  template void module_aldost<T>(const PARAMS_T<T> &, VARS_T<T> &);
+FOR_EACH_SCALAR(INSTANTIATE)
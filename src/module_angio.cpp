@@ -6,6 +6,7 @@
 
 #include "params.h"
 #include "vars.h"
+#include "scalar.h"
 #include "utils.h"
 #include "module_angio.h"
 
@@ -20,7 +21,8 @@
  *
  * \ingroup modules
  */
-void module_angio(const PARAMS &p, VARS &v) {
+template <typename T>
+void module_angio(const PARAMS_T<T> &p, VARS_T<T> &v) {
   v.mdflw3 = v.mdflw3 + (v.mdflw - v.mdflw3) * p.mdflwx;
   if (v.mdflw3 > 1) {
     v.angscr = 1 / (1 + (v.mdflw3 - 1) * 72);
@@ -43,7 +45,7 @@ void module_angio(const PARAMS &p, VARS &v) {
   }
 
   v.anc = v.anc + (v.anpr1 - v.anc)
-           * (1 - 1 / pow(2.7183, v.i / p.ant / p.z12));
+           * lag_fraction(v.i / p.ant / p.z12);
   v.anm = p.anmul - (p.anmul - 1) / ((p.anmll - 1)
            / (p.anmll - p.anmul) * (v.anc - 1) * p.ancsns + 1);
 
@@ -54,3 +56,8 @@ void module_angio(const PARAMS &p, VARS &v) {
 
   v.anuvn = (v.anu - 1) * p.anuvm + 1;
 }
+
+/* Instantiate the module for each scalar type (see scalar.h). */
+#define INSTANTIATE(T) \
+  template void module_angio<T>(const PARAMS_T<T> &, VARS_T<T> &);
+FOR_EACH_SCALAR(INSTANTIATE)
@@ -6,6 +6,7 @@
 
 #include "params.h"
 #include "vars.h"
+#include "scalar.h"
 #include "utils.h"
 #include "module_anp.h"
 
@@ -18,7 +19,8 @@
  *
  * \ingroup modules
  */
-void module_anp(const PARAMS &p, VARS &v) {
+template <typename T>
+void module_anp(const PARAMS_T<T> &p, VARS_T<T> &v) {
   /* ANP in the left atrium. */
   v.anpl = v.pla - 1;
   if (v.anpl < 0) {
@@ -38,7 +40,7 @@ void module_anp(const PARAMS &p, VARS &v) {
   }
 
   v.anpc = v.anpc + (v.anp1 - v.anpc)
-            * (1 - 1 / pow(2.7183, v.i / p.anptc / p.z14));
+            * lag_fraction(v.i / p.anptc / p.z14);
 
   /* The effect of ANP on the resistance of the afferent arteriole. */
   v.anpx = p.anpxul - p.anpxul / (0.5555556 * (1 + v.anpc));
@@ -46,3 +48,8 @@ void module_anp(const PARAMS &p, VARS &v) {
     v.anpx = -1;
   }
 }
+
+/* Instantiate the module for each scalar type (see scalar.h). */
+#define INSTANTIATE(T) \
+  template void module_anp<T>(const PARAMS_T<T> &, VARS_T<T> &);
+FOR_EACH_SCALAR(INSTANTIATE)
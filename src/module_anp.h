@@ -1 +1,2 @@
-void module_anp(const PARAMS &p, VARS &v);
+template <typename T>
+void module_anp(const PARAMS_T<T> &p, VARS_T<T> &v);
@@ -6,6 +6,8 @@
 
 #include "params.h"
 #include "vars.h"
+#include "scalar.h"
+#include "fastmath.h"
 #include "utils.h"
 #include "module_autonom.h"
 
@@ -20,7 +22,8 @@
  *
  * \ingroup modules
  */
-bool module_autonom(const PARAMS &p, VARS &v) {
+template <typename T>
+bool module_autonom(const PARAMS_T<T> &p, VARS_T<T> &v) {
   if (p.sta - p.aumin > 0) {
     v.au = p.sta;
   } else {
@@ -73,14 +76,14 @@ bool module_autonom(const PARAMS &p, VARS &v) {
     v.au6c = v.au6 + (v.au6 - v.au6b) * p.mdmp;
     v.aulp = (15 / (v.pla + v.pra + v.ppa) - 1) * p.aulpm + 1;
     v.auttl = (v.aulp * (v.auc + v.auc2 + v.au6c + v.aun) \
-                * pow(p.exc, p.excxp) - 1) * p.excml + 1;
+                * fm_pow(p.exc, p.excxp) - 1) * p.excml + 1;
     if (v.auttl < 0) {
       v.auttl = 0;
     }
 
     v.dau = v.auttl - v.au1;
     v.au1 = v.au1 + v.dau * p.i2 / p.audmp;
-    v.au = p.aumax - (p.aumax - 1) / pow(2.7183, p.auslp * (v.au1 - 1));
+    v.au = p.aumax - (p.aumax - 1) / fm_pow(2.7183, p.auslp * (v.au1 - 1));
     if (v.au < p.aumin) {
       v.au = p.aumin;
     }
@@ -91,7 +94,7 @@ bool module_autonom(const PARAMS &p, VARS &v) {
   v.auh = v.auo * p.auv + 1; /* Heart strength. */
   v.aur = v.auo * p.aus + 1; /* Heart rate. */
   v.vvr = p.vv9 - (v.au * p.aul) + p.aul; /* Basic venous volume. */
-  v.aum = pow(v.auo * p.aum1 + 1, p.aum2); /* Arterial resistance. */
+  v.aum = fm_pow(v.auo * p.aum1 + 1, p.aum2); /* Arterial resistance. */
   v.ave = v.auo * v.auy + 1; /* Venous resistance. */
 
   /* Stability: repeat the short loop (dT = I2) if the change is too large. */
@@ -118,8 +121,16 @@ bool module_autonom(const PARAMS &p, VARS &v) {
   if (v.i1 < v.i) {
     v.i = v.i1;
   }
+  /* Derivatives are taken along the chosen sequence of time-steps, rather
+     than through the step-size control (see gradient.cpp). */
+  v.i = scalar_const(v.i);
 
   /* Increase the simulation time by one time-step. */
   v.t = v.t + v.i;
   return true;
 }
+
+/* Instantiate the module for each scalar type (see scalar.h). */
+#define INSTANTIATE(T) \
+  template bool module_autonom<T>(const PARAMS_T<T> &, VARS_T<T> &);
+FOR_EACH_SCALAR(INSTANTIATE)
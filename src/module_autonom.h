@@ -1 +1,2 @@
-bool module_autonom(const PARAMS &p, VARS &v);
+template <typename T>
+bool module_autonom(const PARAMS_T<T> &p, VARS_T<T> &v);
@@ -6,6 +6,7 @@
 
 #include "params.h"
 #include "vars.h"
+#include "scalar.h"
 #include "utils.h"
 #include "module_baro.h"
 
@@ -17,7 +18,8 @@
  *
  * \ingroup modules
  */
-void module_baro(const PARAMS &p, VARS &v) {
+template <typename T>
+void module_baro(const PARAMS_T<T> &p, VARS_T<T> &v) {
   v.au2 = v.au6 - 1;
   v.au8 = p.auk * v.au2;
   v.au4 = v.au4 + v.au8 * v.i;
@@ -28,3 +30,8 @@ void module_baro(const PARAMS &p, VARS &v) {
     v.hmd = 1;
   }
 }
+
+/* Instantiate the module for each scalar type (see scalar.h). */
+#define INSTANTIATE(T) \
+  template void module_baro<T>(const PARAMS_T<T> &, VARS_T<T> &);
+FOR_EACH_SCALAR(INSTANTIATE)
@@ -6,6 +6,8 @@
 
 #include "params.h"
 #include "vars.h"
+#include "scalar.h"
+#include "fastmath.h"
 #include "utils.h"
 #include "module_capdyn.h"
 
@@ -18,7 +20,8 @@
  *
  * \ingroup modules
  */
-void module_capdyn(const PARAMS &p, VARS &v) {
+template <typename T>
+void module_capdyn(const PARAMS_T<T> &p, VARS_T<T> &v) {
   /* fun6: vts, vg, fun6 */
   double fun6[12] = {0, 0, 12, 11.4, 15, 14, 18, 16, 21, 17.3, 24, 18};
 
@@ -40,7 +43,7 @@ void module_capdyn(const PARAMS &p, VARS &v) {
     v.cppd = 0;
   }
   /* Protein balance. */
-  v.dlp = p.lppr - pow(v.cppd, p.lpde) * p.lpk;
+  v.dlp = p.lppr - fm_pow(v.cppd, p.lpde) * p.lpk;
 
   /* The driving pressure for plasma leakage. */
   v.prcd = v.pc - p.pcr;
@@ -48,7 +51,7 @@ void module_capdyn(const PARAMS &p, VARS &v) {
     v.prcd = 0;
   }
   /* Fluid leakage. */
-  v.vtcpl = pow(v.prcd * p.cpk, p.pce);
+  v.vtcpl = fm_pow(v.prcd * p.cpk, p.pce);
   /* Protein leakage. */
   v.dpc = v.vtcpl * v.cpp + (v.cpp - v.cpi) * 0.00104;
   /* The net shift of protein in to or out of the plasma. */
@@ -57,7 +60,7 @@ void module_capdyn(const PARAMS &p, VARS &v) {
   /* Total plasma protein. */
   v.prp = v.prp + v.dpp * v.i;
   /* Oncotic pressure of the plasma. */
-  v.ppc = 0.28 * v.cpp + 0.0019 * pow(v.cpp, 2);
+  v.ppc = 0.28 * v.cpp + 0.0019 * fm_ipow<2>(v.cpp);
 
   /* Systemic tissue fluid volume. */
   v.vts = v.vec - v.vp - v.vpf;
@@ -72,10 +75,10 @@ void module_capdyn(const PARAMS &p, VARS &v) {
   /* Lymph protein flow. */
   v.dpl = v.cpi * v.vtl;
   /* Interstitial oncotic pressure. */
-  v.ptcpr = 0.28 * v.cpi + 0.0019 * pow(v.cpi, 2);
+  v.ptcpr = 0.28 * v.cpi + 0.0019 * fm_ipow<2>(v.cpi);
 
   /* Tissue gel and fluid. */
-  v.chy = pow(p.hyl / v.vts / 5, p.cmptss);
+  v.chy = fm_pow(p.hyl / v.vts / 5, p.cmptss);
   /* The hydrostatic pressure of the tissue gel. */
   v.pgh = v.chy * p.pghf + v.ptt;
   v.poshyl = v.chy * 2;
@@ -83,7 +86,7 @@ void module_capdyn(const PARAMS &p, VARS &v) {
   v.ptc = v.poshyl * v.ptcpr * p.gcopf;
 
   /* The total tissue pressure. */
-  v.ptt = pow((v.vts1 - p.vtsf) / p.vtsf, 2);
+  v.ptt = fm_ipow<2>((v.vts1 - p.vtsf) / p.vtsf);
   /* Interstitial free-fluid pressure. */
   v.pif = v.pgh - v.poshyl;
   /* Solid tissue pressure. */
@@ -106,3 +109,8 @@ void module_capdyn(const PARAMS &p, VARS &v) {
   /* The variables VIG and VG are only used for displaying output. */
   v.vif = v.vts - v.vg;
 }
+
+/* Instantiate the module for each scalar type (see scalar.h). */
+#define INSTANTIATE(T) \
+  template void module_capdyn<T>(const PARAMS_T<T> &, VARS_T<T> &);
+FOR_EACH_SCALAR(INSTANTIATE)
@@ -1 +1,2 @@
-void module_capdyn(const PARAMS &p, VARS &v);
+template <typename T>
+void module_capdyn(const PARAMS_T<T> &p, VARS_T<T> &v);
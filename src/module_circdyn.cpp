@@ -6,6 +6,8 @@
 
 #include "params.h"
 #include "vars.h"
+#include "scalar.h"
+#include "fastmath.h"
 #include "utils.h"
 #include "module_circdyn.h"
 
@@ -17,7 +19,8 @@
  *
  * \ingroup modules
  */
-void module_circdyn(const PARAMS &p, VARS &v) {
+template <typename T>
+void module_circdyn(const PARAMS_T<T> &p, VARS_T<T> &v) {
   /* fun1: pa2, lvm, fun1 */
   double fun1[12] = {0, 1.04, 60, 1.025, 125, 0.97,
                      160, 0.88, 200, 0.59, 240, 0};
@@ -49,16 +52,16 @@ void module_circdyn(const PARAMS &p, VARS &v) {
            hypertensive person, whose blood vessels would be less compliant. */
   v.pa = v.vae / 0.00155;
   /* The effect of pressure on arterial distension. */
-  v.pam = pow(v.pa / 100, p.paex);
+  v.pam = fm_pow(v.pa / 100, p.paex);
 
   /* Myogenic autoregulation. */
   v.myogrs = 1;
   if (p.tensgn > 0) {
-    v.tens1 = (v.pa + v.pc) / 117 * pow(v.pam, 0.25);
+    v.tens1 = (v.pa + v.pc) / 117 * fm_rpow<1, 4>(v.pam);
     v.tens2 = (v.tens1 - 1) / (p.tensgn + 1) + 1;
     v.tens = v.tens1 * v.rad;
     v.rad = v.rad + (v.tens2 - v.tens) / p.tenstc * p.i2;
-    v.myogrs = pow(1 / v.rad, 4);
+    v.myogrs = fm_ipow<4>(1 / v.rad);
   }
 
   /* The Korner effect
@@ -91,7 +94,7 @@ void module_circdyn(const PARAMS &p, VARS &v) {
   if (v.pp1 < 1e-5) {
     v.pp1 = 1e-5;
   }
-  v.cpa = pow(v.pp1, 0.5);
+  v.cpa = fm_rpow<1, 2>(v.pp1);
   v.rpa = 1 / v.cpa;
 
   /* The effect of pressure on pumping in the right ventricle. */
@@ -128,7 +131,7 @@ void module_circdyn(const PARAMS &p, VARS &v) {
   }
   v.pgv = v.pvs - v.pr1;
   /* Venous pressure and resistance. */
-  v.rvg = 0.74 / pow((v.pvs / v.vim / 3.7), 0.5);
+  v.rvg = 0.74 / fm_rpow<1, 2>(v.pvs / v.vim / 3.7);
   v.qvo = v.pgv / v.rvg;
   v.cn3 = v.cn3 + (((v.pc - 17) * p.cn7 + 17) * p.cn2 - v.cn3) * 0.1;
   v.rv1 = p.rvsm / v.cn3;
@@ -171,3 +174,8 @@ void module_circdyn(const PARAMS &p, VARS &v) {
   v.dla = v.qpo - v.qlo; /* Left atrium volume. */
   v.dra = v.qvo - v.qro; /* Right atrium volume. */
 }
+
+/* Instantiate the module for each scalar type (see scalar.h). */
+#define INSTANTIATE(T) \
+  template void module_circdyn<T>(const PARAMS_T<T> &, VARS_T<T> &);
+FOR_EACH_SCALAR(INSTANTIATE)
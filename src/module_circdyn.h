@@ -1 +1,2 @@
-void module_circdyn(const PARAMS &p, VARS &v);
+template <typename T>
+void module_circdyn(const PARAMS_T<T> &p, VARS_T<T> &v);
@@ -6,6 +6,7 @@
 
 #include "params.h"
 #include "vars.h"
+#include "scalar.h"
 #include "utils.h"
 #include "module_electro.h"
 
@@ -18,7 +19,21 @@
  *
  * \ingroup modules
  */
-void module_electro(const PARAMS &p, VARS &v) {
+template <typename T>
+void module_electro(const PARAMS_T<T> &p, VARS_T<T> &v) {
+  module_electro_balance(p, v);
+  module_electro_fluids(p, v);
+}
+
+/**
+ * This function calculates the sodium, potassium and water balance (the
+ * first part of module_electro()).
+ *
+ * @param[in] p      The struct of model parameters.
+ * @param[in] v      The struct of state variables.
+ */
+template <typename T>
+void module_electro_balance(const PARAMS_T<T> &p, VARS_T<T> &v) {
   /* Sodium balance. */
   v.ned = p.nid * v.sth - v.nod + p.trpl * 142;
   v.nae = v.nae + v.ned * v.i;
@@ -30,12 +45,18 @@ void module_electro(const PARAMS &p, VARS &v) {
 
   /* Water balance. */
   v.vtw = v.vtw + (v.tvd - v.vud) * v.i;
-#ifdef UTTAMSINGH1
-  if (v.t < 40320.0 && (v.t + v.i) >= 40320.0) {
-    v.vtw += 1.0;
-  }
-#endif
+}
 
+/**
+ * This function distributes water between the intracellular and
+ * extracellular fluid, and calculates the extracellular sodium and
+ * potassium concentrations (the second part of module_electro()).
+ *
+ * @param[in] p      The struct of model parameters.
+ * @param[in] v      The struct of state variables.
+ */
+template <typename T>
+void module_electro_fluids(const PARAMS_T<T> &p, VARS_T<T> &v) {
   v.i15 = 0;
   do {
     v.ke = (v.ktot - 3000) / v.amk1 / 9.3333;
@@ -65,3 +86,10 @@ void module_electro(const PARAMS &p, VARS &v) {
   /* The extracellular potassium concentration. */
   v.cke = v.ke / v.vec;
 }
+
+/* Instantiate the module for each scalar type (see scalar.h). */
+#define INSTANTIATE(T) \
+  template void module_electro<T>(const PARAMS_T<T> &, VARS_T<T> &); \
+  template void module_electro_balance<T>(const PARAMS_T<T> &, VARS_T<T> &); \
+  template void module_electro_fluids<T>(const PARAMS_T<T> &, VARS_T<T> &);
+FOR_EACH_SCALAR(INSTANTIATE)
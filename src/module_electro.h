@@ -1 +1,6 @@
-void module_electro(const PARAMS &p, VARS &v);
+template <typename T>
+void module_electro(const PARAMS_T<T> &p, VARS_T<T> &v);
+template <typename T>
+void module_electro_balance(const PARAMS_T<T> &p, VARS_T<T> &v);
+template <typename T>
+void module_electro_fluids(const PARAMS_T<T> &p, VARS_T<T> &v);
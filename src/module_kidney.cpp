@@ -5,15 +5,19 @@
  * et al, Bull Math Biol 56:3 391-410, 1994</a>.
  */
 
+#include <cmath>    /* for pow(), fabs() */
+
 #include "params.h"
 #include "vars.h"
+#include "scalar.h"
 #include "module_kidney.h"
 #include "model_moore94.h"
 
 /**
  * Forward declaration of translate_state().
  */
-void translate_state(PARAMS &p, VARS &v);
+template <typename T>
+void translate_state(PARAMS_T<T> &p, VARS_T<T> &v);
 
 /**
  * This function calculates the amount of sodium, potassium and water excretion
@@ -37,7 +41,8 @@ void translate_state(PARAMS &p, VARS &v);
  *
  * \ingroup modules
  */
-void module_kidney(PARAMS &p, VARS &v) {
+template <typename T>
+void module_kidney(PARAMS_T<T> &p, VARS_T<T> &v) {
   /* Translate Guyton92 parameters and variables into Moore94 equivalents. */
   translate_state(p, v);
 
@@ -45,7 +50,7 @@ void module_kidney(PARAMS &p, VARS &v) {
   solve_moore94_model(p, v);
 
   /* A linear regression was used to estimate MDFLW from Qalh. */
-  if (p.glmcubic) {
+  if (p.glmcubic != 0) {
     v.mdflw = -3374.8165 + 1978.1256 * v.Qalh
       - 386.4192 * v.Qalh * v.Qalh + 25.1648 * v.Qalh * v.Qalh * v.Qalh;
   } else {
@@ -56,7 +61,7 @@ void module_kidney(PARAMS &p, VARS &v) {
 
    /* Scale values to the human body (~2x10^6 nephrons) so that the mean RBF
       is equivalent to the mean RBF as calculated by the original module. */
-  double scale = 2e6 * 3.531067;
+  T scale = 2e6 * 3.531067;
   scale *= p.rek; /* Account for the functional mass. */
 
   /* Renal blood flow. */
@@ -64,9 +69,9 @@ void module_kidney(PARAMS &p, VARS &v) {
   v.rbf *= scale;
 
   /* Distal delivery of water, sodium and potassium. */
-  double EDCT_in_vol = scale * 1e-9 * v.Qalh; /* L/min */
-  double EDCT_in_Na = EDCT_in_vol * v.Ci; /* mmol/min */
-  double EDCT_in_K = EDCT_in_vol * v.Ci * v.cke / v.cna; /* mmol/min */
+  T EDCT_in_vol = scale * 1e-9 * v.Qalh; /* L/min */
+  T EDCT_in_Na = EDCT_in_vol * v.Ci; /* mmol/min */
+  T EDCT_in_K = EDCT_in_vol * v.Ci * v.cke / v.cna; /* mmol/min */
 
   /* Fractional reabsorption of volume, sodium and potassium, in the early
      distal convoluted tubule (EDCT), the connecting tubule (CNT), and the
@@ -87,42 +92,42 @@ void module_kidney(PARAMS &p, VARS &v) {
   /* EDCT fractional reabsorption from DOI: 10.1152/ajprenal.00043.2005
      http://dx.doi.org/10.1152/ajprenal.00043.2005
      Text (F709--F710) and Table 5 (F711). */
-  double EDCT_reab_Na = 0.40;
-  double EDCT_reab_K = -0.86;
-  double EDCT_reab_vol = 0.10;
+  T EDCT_reab_Na = 0.40;
+  T EDCT_reab_K = -0.86;
+  T EDCT_reab_vol = 0.10;
   /* CNT fractional reabsorption from DOI: 10.1152/ajprenal.00044.2005
      http://dx.doi.org/10.1152/ajprenal.00044.2005
      Text (F729) and Table 4 (F730). */
-  double CNT_reab_Na = 0.36;
-  double CNT_reab_K = -5.60;
-  double CNT_reab_vol = 0.42;
+  T CNT_reab_Na = 0.36;
+  T CNT_reab_K = -5.60;
+  T CNT_reab_vol = 0.42;
   /* CCD fractional reabsorption from AJP Renal 280:F1072-F1092, 2001.
      Table 5 (F1085). */
-  double CCD_reab_Na = 0.19;
-  double CCD_reab_K = 0.06;
-  double CCD_reab_vol = 0.29; /* The cited value is 0.63. */
+  T CCD_reab_Na = 0.19;
+  T CCD_reab_K = 0.06;
+  T CCD_reab_vol = 0.29; /* The cited value is 0.63. */
   /* OMCD fractional reabsorption from AJP Renal 279:F24-F45, 2000.
      Table 5 (F35). */
-  double OMCD_reab_Na = -0.25;
-  double OMCD_reab_K = 0.42;
-  double OMCD_reab_vol = 0.52; /* The cited value is 0.54. */
+  T OMCD_reab_Na = -0.25;
+  T OMCD_reab_K = 0.42;
+  T OMCD_reab_vol = 0.52; /* The cited value is 0.54. */
   /* IMCD fractional reabsorption from AJP Renal 274:F841-F855, 1998.
      Text (F846), calculated volume reabsorption from Na reabsorption
      and end-tubule Na concentration. */
-  double IMCD_reab_Na = 0.67;
-  double IMCD_reab_K = 0.65;
-  double IMCD_reab_vol = 0.66; /* The cited value is 0.77. */
+  T IMCD_reab_Na = 0.67;
+  T IMCD_reab_K = 0.65;
+  T IMCD_reab_vol = 0.66; /* The cited value is 0.77. */
 
   /* The effect of Angiotensin II on volume, Na and K fluxes in the EDCT and
      CNT, as per Wang and Giebisch, AJP Renal 271(1):F143-F149, 1996.
      Tables 1 (F144) and 3 (F147). Effects were calculated by:
      (angiotensin II flux) / (control flux). */
-  double EDCT_ang_Na = 1.77;
-  double EDCT_ang_K = 1.0;
-  double EDCT_ang_vol = 1.62;
-  double CNT_ang_Na = 1.98;
-  double CNT_ang_K = 0.46;
-  double CNT_ang_vol = 2.26;
+  T EDCT_ang_Na = 1.77;
+  T EDCT_ang_K = 1.0;
+  T EDCT_ang_vol = 1.62;
+  T CNT_ang_Na = 1.98;
+  T CNT_ang_K = 0.46;
+  T CNT_ang_vol = 2.26;
   /* The effect of ADH on volume, Na and K fluxes in the DT, as per
      Field, Stanton and Giebisch, Kidney Int 25(3):502-511, 1984.
      http://dx.doi.org/10.1038/ki.1984.46
@@ -135,9 +140,9 @@ void module_kidney(PARAMS &p, VARS &v) {
   /* TODO: use the formula frac^(1/change) ???
      eg, f(x,y) = x**(1/y) for x in [0,1], y in (0, N). */
 
-  double Na_Frac = (1 - (1 - EDCT_reab_Na) / EDCT_ang_Na);
-  double K_Frac = (1 - (1 - EDCT_reab_K) / EDCT_ang_K);
-  double vol_Frac = (1 - (1 - EDCT_reab_vol) / EDCT_ang_vol);
+  T Na_Frac = (1 - (1 - EDCT_reab_Na) / EDCT_ang_Na);
+  T K_Frac = (1 - (1 - EDCT_reab_K) / EDCT_ang_K);
+  T vol_Frac = (1 - (1 - EDCT_reab_vol) / EDCT_ang_vol);
   Na_Frac = (1 - (1 - Na_Frac) / CNT_ang_Na);
   K_Frac = (1 - (1 - K_Frac) / CNT_ang_K);
   vol_Frac = (1 - (1 - vol_Frac) / CNT_ang_vol);
@@ -217,7 +222,8 @@ void module_kidney(PARAMS &p, VARS &v) {
  * @param[in] p      The struct of model parameters.
  * @param[in] v      The struct of state variables.
  */
-void translate_state(PARAMS &p, VARS &v) {
+template <typename T>
+void translate_state(PARAMS_T<T> &p, VARS_T<T> &v) {
   /* Calculate the arterial pressure (v.Pas) for the Moore 1994 model. */
   if (p.raprsp > 0) {
     /* The renal arterial pressure (PAR) is controlled by the parameter
@@ -329,3 +335,8 @@ void translate_state(PARAMS &p, VARS &v) {
      i VTW total body water
    */
 }
+
+/* Instantiate the module for each scalar type (see scalar.h). */
+#define INSTANTIATE(T) \
+  template void module_kidney<T>(PARAMS_T<T> &, VARS_T<T> &);
+FOR_EACH_SCALAR(INSTANTIATE)
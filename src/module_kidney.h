@@ -1 +1,2 @@
-void module_kidney(PARAMS &p, VARS &v);
+template <typename T>
+void module_kidney(PARAMS_T<T> &p, VARS_T<T> &v);
@@ -7,6 +7,8 @@
 
 #include "params.h"
 #include "vars.h"
+#include "scalar.h"
+#include "fastmath.h"
 #include "utils.h"
 #include "module_o2deliv.h"
 
@@ -20,16 +22,17 @@
  *
  * \ingroup modules
  */
-void module_o2deliv(const PARAMS &p, VARS &v) {
+template <typename T>
+void module_o2deliv(const PARAMS_T<T> &p, VARS_T<T> &v) {
   v.aom = v.auo * p.o2a + 1;
 
   /* Oxygen consumption. */
-  v.mmo = v.aom * p.omm * p.exc * (1 - pow(38.0001 - v.p2o, 3) / 54872);
+  v.mmo = v.aom * p.omm * p.exc * (1 - fm_ipow<3>(38.0001 - v.p2o) / 54872);
   v.ovs = v.ovs + ((v.bfm * v.ova - v.rmo)
            / v.hm / 5.25 / v.bfm - v.ovs) / p.z6;
 
   /* Venous oxygen pressure in the muscle tissue. */
-  v.pvo = 57.14 * v.ovs * pow(p.exc, p.excxp2);
+  v.pvo = 57.14 * v.ovs * fm_pow(p.exc, p.excxp2);
 
   /* Oxygen pressure in the muscle tissue. */
   v.i13 = 0;
@@ -87,7 +90,7 @@ void module_o2deliv(const PARAMS &p, VARS &v) {
   /* Venous oxygen pressure in the non-muscle tissue. */
   v.pov = v.osv * 57.14;
   /* Oxygen consumption in non-muscle tissue. */
-  v.mo2 = v.aom * p.o2m * (1 - pow(35.0001 - v.p1o, 3.) / 42875);
+  v.mo2 = v.aom * p.o2m * (1 - fm_ipow<3>(35.0001 - v.p1o) / 42875);
 
   /* Oxygen pressure in the non-muscle tissue. */
   v.i11 = 0;
@@ -163,3 +166,8 @@ void module_o2deliv(const PARAMS &p, VARS &v) {
   /* Overall blood flow autoregulation. */
   v.arm = (v.ar1 * v.ar2 * v.ar3 - 1) * p.autosn + 1;
 }
+
+/* Instantiate the module for each scalar type (see scalar.h). */
+#define INSTANTIATE(T) \
+  template void module_o2deliv<T>(const PARAMS_T<T> &, VARS_T<T> &);
+FOR_EACH_SCALAR(INSTANTIATE)
@@ -1 +1,2 @@
-void module_o2deliv(const PARAMS &p, VARS &v);
+template <typename T>
+void module_o2deliv(const PARAMS_T<T> &p, VARS_T<T> &v);
@@ -6,6 +6,8 @@
 
 #include "params.h"
 #include "vars.h"
+#include "scalar.h"
+#include "fastmath.h"
 #include "utils.h"
 #include "module_puldyn.h"
 
@@ -18,7 +20,8 @@
  *
  * \ingroup modules
  */
-void module_puldyn(const PARAMS &p, VARS &v) {
+template <typename T>
+void module_puldyn(const PARAMS_T<T> &p, VARS_T<T> &v) {
   v.pcp = (v.ppa - v.pla) * v.rpv / (v.rpv + v.rpa) + v.pla;
   v.ppi = 2 - 0.15 / v.vpf;
   v.cpn = v.ppr / v.vpf;
@@ -47,8 +50,13 @@ void module_puldyn(const PARAMS &p, VARS &v) {
   v.ppr = v.ppr + v.ppd * v.i;
 
   /* Hypertrophy of the heart. */
-  v.hpl = v.hpl + (pow((v.pa * v.qao / 500 / p.hsl), p.z13) - v.hpl)
+  v.hpl = v.hpl + (fm_pow(v.pa * v.qao / 500 / p.hsl, p.z13) - v.hpl)
            * v.i / 57600;
-  v.hpr = v.hpr + (pow((v.ppa * v.qao / 75 / p.hsr), p.z13) - v.hpr)
+  v.hpr = v.hpr + (fm_pow(v.ppa * v.qao / 75 / p.hsr, p.z13) - v.hpr)
            * v.i / 57600;
 }
+
+/* Instantiate the module for each scalar type (see scalar.h). */
+#define INSTANTIATE(T) \
+  template void module_puldyn<T>(const PARAMS_T<T> &, VARS_T<T> &);
+FOR_EACH_SCALAR(INSTANTIATE)
@@ -6,6 +6,7 @@
 
 #include "params.h"
 #include "vars.h"
+#include "scalar.h"
 #include "utils.h"
 #include "module_rbc.h"
 
@@ -18,7 +19,8 @@
  *
  * \ingroup modules
  */
-void module_rbc(const PARAMS &p, VARS &v) {
+template <typename T>
+void module_rbc(const PARAMS_T<T> &p, VARS_T<T> &v) {
   v.vb = v.vp + v.vrc;
 
   /* The hematocrit of the blood. */
@@ -108,3 +110,8 @@ void module_rbc(const PARAMS &p, VARS &v) {
   v.o2vad1 = v.o2vad1 + v.do2vad * v.i;
   v.o2vad2 = v.o2vad1 + 1;
 }
+
+/* Instantiate the module for each scalar type (see scalar.h). */
+#define INSTANTIATE(T) \
+  template void module_rbc<T>(const PARAMS_T<T> &, VARS_T<T> &);
+FOR_EACH_SCALAR(INSTANTIATE)
@@ -6,6 +6,8 @@
 
 #include "params.h"
 #include "vars.h"
+#include "scalar.h"
+#include "fastmath.h"
 #include "module_renal.h"
 
 /**
@@ -98,7 +100,8 @@
  *
  * \ingroup modules
  */
-void module_renal(const PARAMS &p, VARS &v) {
+template <typename T>
+void module_renal(const PARAMS_T<T> &p, VARS_T<T> &v) {
   /**
    * Local variables that don't need explicit initialisation:
    * - PAR Renal arterial pressure (mmHg).
@@ -165,7 +168,7 @@ void module_renal(const PARAMS &p, VARS &v) {
    */
 
   /* The original code includes a single local variable. */
-  double aar1;
+  T aar1;
 
   /* The loop variable I5 is shared with the autonomic control module, but it
      is always set to zero before reaching the renal module. */
@@ -237,7 +240,7 @@ void module_renal(const PARAMS &p, VARS &v) {
       if (v.efafpr < 1) {
         v.efafpr = 1;
       }
-      v.glpc = v.glpc + (pow(v.efafpr, 1.35) * v.ppc * 0.98 - v.glpc) / p.gppd;
+      v.glpc = v.glpc + (fm_pow(v.efafpr, 1.35) * v.ppc * 0.98 - v.glpc) / p.gppd;
     } else {
       v.glpc = v.ppc + 4; /* Glomerular oncotic pressure. */
     }
@@ -315,7 +318,7 @@ void module_renal(const PARAMS &p, VARS &v) {
     v.mdflk = 0.1;
   }
   /* Potassium secretion. */
-  v.dtksc = pow(v.cke / 4.4, p.ckeex) * v.amk * 0.08 * v.mdflk / v.anmke;
+  v.dtksc = fm_pow(v.cke / 4.4, p.ckeex) * v.amk * 0.08 * v.mdflk / v.anmke;
 
   /* The loop for solving urinary excretion. */
   do {
@@ -351,6 +354,11 @@ void module_renal(const PARAMS &p, VARS &v) {
   /* Urea dynamics. */
   v.plur = v.plur + (p.urform - v.urod) * v.i;
   v.plurc = v.plur / v.vtw;
-  v.dturi = pow(v.gfn, 2) * v.plurc * 3.84;
+  v.dturi = fm_ipow<2>(v.gfn) * v.plurc * 3.84;
   v.urod = v.dturi * p.rek;
 }
+
+/* Instantiate the module for each scalar type (see scalar.h). */
+#define INSTANTIATE(T) \
+  template void module_renal<T>(const PARAMS_T<T> &, VARS_T<T> &);
+FOR_EACH_SCALAR(INSTANTIATE)
@@ -6,6 +6,8 @@
 
 #include "params.h"
 #include "vars.h"
+#include "scalar.h"
+#include "fastmath.h"
 #include "utils.h"
 #include "module_special.h"
 
@@ -19,14 +21,15 @@
  *
  * \ingroup modules
  */
-void module_special(const PARAMS &p, VARS &v) {
+template <typename T>
+void module_special(const PARAMS_T<T> &p, VARS_T<T> &v) {
   /* Mean circulatory pressures. */
   v.pmc = (v.vae + v.vve + v.vre + v.vpe + v.vle) / 0.11;
   v.pms = (v.vae + v.vve + v.vre) / 0.09375;
   v.pmp = (v.vpe + v.vle) / 0.01625;
 
   /* Heart rate. */
-  v.hr = (72 * v.aur + pow(v.pr1, 0.5) * 5) * ((v.hmd - 1) * 0.5 + 1);
+  v.hr = (72 * v.aur + fm_rpow<1, 2>(v.pr1) * 5) * ((v.hmd - 1) * 0.5 + 1);
 
   /* Total peripheral resistance. */
   v.rtp = (v.pa - v.pra) / v.qao;
@@ -34,3 +37,8 @@ void module_special(const PARAMS &p, VARS &v) {
   /* Stroke volume. */
   v.svo = v.qlo / v.hr;
 }
+
+/* Instantiate the module for each scalar type (see scalar.h). */
+#define INSTANTIATE(T) \
+  template void module_special<T>(const PARAMS_T<T> &, VARS_T<T> &);
+FOR_EACH_SCALAR(INSTANTIATE)
@@ -6,6 +6,7 @@
 
 #include "params.h"
 #include "vars.h"
+#include "scalar.h"
 #include "utils.h"
 #include "module_stress.h"
 
@@ -18,9 +19,15 @@
  *
  * \ingroup modules
  */
-void module_stress(const PARAMS &p, VARS &v) {
+template <typename T>
+void module_stress(const PARAMS_T<T> &p, VARS_T<T> &v) {
   v.vv6 = v.vv6 + ((v.vve - 0.74) * p.sr2 - v.vv6) / p.srk2 * v.i;
 
   v.vv7 = v.vv7 + ((v.vve - 0.74) * p.sr - v.vv7)
-           * (1 - 1 / pow(2.7183, v.i / p.srk));
+           * lag_fraction(v.i / p.srk);
 }
+
+/* Instantiate the module for each scalar type (see scalar.h). */
+#define INSTANTIATE(T) \
+  template void module_stress<T>(const PARAMS_T<T> &, VARS_T<T> &);
+FOR_EACH_SCALAR(INSTANTIATE)
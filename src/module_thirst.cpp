@@ -6,6 +6,8 @@
 
 #include "params.h"
 #include "vars.h"
+#include "scalar.h"
+#include "fastmath.h"
 #include "utils.h"
 #include "module_thirst.h"
 
@@ -18,10 +20,11 @@
  *
  * \ingroup modules
  */
-void module_thirst(const PARAMS &p, VARS &v) {
+template <typename T>
+void module_thirst(const PARAMS_T<T> &p, VARS_T<T> &v) {
   v.anmsml = (v.anm - 1) * p.anmslt + 1;
 
-  v.sth = pow(p.z10 - v.pot, 2) * p.z11 * v.anmsml;
+  v.sth = fm_ipow<2>(p.z10 - v.pot) * p.z11 * v.anmsml;
   if (v.sth < 0.8) {
     v.sth = 0.8;
   }
@@ -42,9 +45,9 @@ void module_thirst(const PARAMS &p, VARS &v) {
   }
 
   v.tvd = v.tvd + (v.tvz + p.dr - v.tvd) / p.tvddl * v.i;
-#ifdef UTTAMSINGH2
-  if (v.t >= 39360 && v.t <= 40320) {
-    v.tvd = 0;
-  }
-#endif
 }
+
+/* Instantiate the module for each scalar type (see scalar.h). */
+#define INSTANTIATE(T) \
+  template void module_thirst<T>(const PARAMS_T<T> &, VARS_T<T> &);
+FOR_EACH_SCALAR(INSTANTIATE)
@@ -6,6 +6,8 @@
 
 #include "params.h"
 #include "vars.h"
+#include "scalar.h"
+#include "fastmath.h"
 #include "utils.h"
 #include "module_volrec.h"
 
@@ -18,9 +20,10 @@
  *
  * \ingroup modules
  */
-void module_volrec(const PARAMS &p, VARS &v) {
+template <typename T>
+void module_volrec(const PARAMS_T<T> &p, VARS_T<T> &v) {
   /* Volume receptor output is a function of PRA (right atrial pressure). */
-  v.ahz = pow(fabs(v.pra), p.ah10);
+  v.ahz = fm_pow(fabs(v.pra), p.ah10);
   if (v.pra <= 0) {
     v.ahz = -v.ahz;
   }
@@ -36,3 +39,8 @@ void module_volrec(const PARAMS &p, VARS &v) {
   /* The volume receptor effect on the unstressed venous volume. */
   v.atrvfb = v.ah7 * v.atrvm;
 }
+
+/* Instantiate the module for each scalar type (see scalar.h). */
+#define INSTANTIATE(T) \
+  template void module_volrec<T>(const PARAMS_T<T> &, VARS_T<T> &);
+FOR_EACH_SCALAR(INSTANTIATE)
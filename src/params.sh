@@ -7,7 +7,8 @@
 # by name.
 #
 # This script produces the following files:
-#   * params.h   -- Defines the PARAMS type, set_param() and PARAMS_INIT.
+#   * params.h   -- Defines the PARAMS_T and PARAMS types, set_param() and
+#                   PARAMS_INIT.
 #   * params.cpp -- Implements the set_param() function.
 #
 # NOTE: This script requires the file "params.lst" to contain all of the model
@@ -50,18 +51,21 @@ if [ ! -r ${PARAMS_VALS} ]; then
 fi
 
 #
-# Build the header file.
+# Build the header file. The struct is a template over the scalar type of its
+# fields (see scalar.h), and PARAMS is the double-precision struct.
 #
 cat ${PARAMS_LIST} |
-  awk 'BEGIN { print "struct PARAMS {"; } ;
-       { print "double " $1 ";" } ;
-       END { print "};"; }' > ${PARAMS_DEFN}
+  awk 'BEGIN { print "template <typename T>"; print "struct PARAMS_T {"; } ;
+       { print "T " $1 ";" } ;
+       END { print "};"; print "typedef PARAMS_T<double> PARAMS;"; }' > ${PARAMS_DEFN}
 
 echo "void set_param(PARAMS &p, const char *name, double value);" >> ${PARAMS_DEFN}
 echo "double get_param(const PARAMS &p, const char *name);" >> ${PARAMS_DEFN}
 
 PARAM_COUNT=`wc -l ${PARAMS_LIST} | awk '{ print $1; }'`
 echo "#define PARAM_COUNT ${PARAM_COUNT}" >> ${PARAMS_DEFN};
+echo "extern const char *PARAM_NAMES[PARAM_COUNT];" >> ${PARAMS_DEFN}
+echo "int param_index(const char *name);" >> ${PARAMS_DEFN}
 
 #
 # Produce the code fragment that will initialise the parameters.
@@ -99,3 +103,19 @@ cat ${PARAMS_LIST} |
        END { print "  fprintf(stderr, \"ERROR: Unknown parameter name \\\"%s\\\"\\n\", name);";
              print "  return nan(\"\");";
              print "}"; }' >> ${PARAMS_CODE}
+
+#
+# Build the table of parameter names (in the same order as the struct),
+# and the code for param_index().
+#
+cat ${PARAMS_LIST} |
+  awk 'BEGIN { print "const char *PARAM_NAMES[PARAM_COUNT] = {"; }
+       { print "  \"" $1 "\","; }
+       END { print "};"; print ""; }' >> ${PARAMS_CODE}
+
+cat ${PARAMS_LIST} |
+  awk 'BEGIN { print "int param_index(const char *name) {"; }
+       { print "  if (! strcmp(name, \"" $1 "\")) {";
+         print "    return " NR - 1 ";";
+         print "  }"; }
+       END { print "  return -1;"; print "}"; }' >> ${PARAMS_CODE}
@@ -0,0 +1,367 @@
+/**
+ * Compile-time descriptions of the sequence of modules that is evaluated in
+ * each time-step (see guyton92_equations()).
+ *
+ * Each stage of a pipeline is a struct that evaluates a single module (or
+ * performs a single task, such as shortening the time-step) and declares the
+ * state variables and parameters that the module refers to and assigns (as
+ * found by vars.sh). A pipeline is a list of up to 20 stages (see PIPELINE),
+ * which is itself a stage, and evaluates each stage in turn with a direct
+ * call, so that the sequence of modules is fixed when the model is compiled.
+ * The model variants (eg, the replacement renal module, or the experiments
+ * that intervene in the model) are separate pipelines, rather than branches
+ * that are taken in every time-step, and reduced models (eg, the circulation
+ * alone) are simply shorter pipelines.
+ *
+ * The stages are evaluated in the translation unit that evaluates the
+ * pipeline, while the modules are evaluated in their own translation units,
+ * and so are only inlined by link-time optimisation (see "make release").
+ *
+ * This file must be included after the headers of each module, along with
+ * those of the experiments (exp_*.h) and dataflow.h.
+ */
+
+/**
+ * The state of a time-step, which is shared by the stages of a pipeline.
+ */
+template <typename T>
+struct STEP_STATE {
+  const EXP_VARIANT *var; /** The model variant, or NULL for none. */
+  double t_next; /** The time at which the time-step must end. */
+  T t0; /** The time at which the time-step began. */
+  T step; /** The full time-step size (see STAGE_exact_time). */
+};
+
+/**
+ * The description of a module that is evaluated by a stage, which lists the
+ * names of the fields that it refers to and assigns. Each list is terminated
+ * by \c NULL.
+ */
+struct STAGE_INFO {
+  const char *name; /** The name of the module (eg, "circdyn"). */
+  void (*eval)(PARAMS &p, VARS &v); /** Evaluates the module by itself. */
+  const char *const *vars_in; /** The state variables that it refers to. */
+  const char *const *vars_out; /** The state variables that it assigns. */
+  const char *const *params_in; /** The parameters that it refers to. */
+};
+
+/** A function that is called for each module of a pipeline, in order. */
+typedef void (*STAGE_VISITOR)(const STAGE_INFO &info, void *data);
+
+/**
+ * Runs a module of the model, unless it is skipped by the incremental
+ * evaluation (if any) of the current thread (see dataflow.cpp). Modules are
+ * only skipped for \c double structs.
+ */
+template <typename T>
+inline void run_module(int id,
+                       void (*module)(const PARAMS_T<T> &p, VARS_T<T> &v),
+                       const PARAMS_T<T> &p, VARS_T<T> &v) {
+  module(p, v);
+}
+
+inline void run_module(int id, void (*module)(const PARAMS &p, VARS &v),
+                       const PARAMS &p, VARS &v) {
+  if (dataflow) {
+    dataflow_run(dataflow, id, module, p, v);
+  } else {
+    module(p, v);
+  }
+}
+
+/* Lists the names of the fields in each view of a module (see vars.sh). */
+#define STAGE_FIELD(name) #name,
+
+/** Defines the visit() function of a stage that evaluates a module. */
+#define STAGE_VISIT(MOD, EVAL) \
+  static void visit(STAGE_VISITOR f, void *data) { \
+    static const char *const vars_in[] = { \
+      VARS_IN_module_##MOD(STAGE_FIELD) NULL }; \
+    static const char *const vars_out[] = { \
+      VARS_OUT_module_##MOD(STAGE_FIELD) NULL }; \
+    static const char *const params_in[] = { \
+      PARAMS_IN_module_##MOD(STAGE_FIELD) NULL }; \
+    const STAGE_INFO info = { #MOD, EVAL, vars_in, vars_out, params_in }; \
+    f(info, data); \
+  }
+
+/**
+ * Defines the stage STAGE_<MOD>, which evaluates a module whose evaluation
+ * may be skipped when its inputs have not changed (see DATAFLOW_MODULES).
+ */
+#define PIPELINE_STAGE(MOD) \
+  struct STAGE_##MOD { \
+    template <typename T> \
+    static bool run(PARAMS_T<T> &p, VARS_T<T> &v, STEP_STATE<T> &s) { \
+      run_module(DATAFLOW_module_##MOD, module_##MOD, p, v); \
+      return true; \
+    } \
+    static void eval(PARAMS &p, VARS &v) { \
+      module_##MOD(p, v); \
+    } \
+    STAGE_VISIT(MOD, eval) \
+  };
+
+PIPELINE_STAGE(circdyn)
+PIPELINE_STAGE(aldost)
+PIPELINE_STAGE(angio)
+PIPELINE_STAGE(anp)
+PIPELINE_STAGE(rbc)
+PIPELINE_STAGE(o2deliv)
+PIPELINE_STAGE(volrec)
+PIPELINE_STAGE(adh)
+PIPELINE_STAGE(stress)
+PIPELINE_STAGE(thirst)
+PIPELINE_STAGE(baro)
+PIPELINE_STAGE(special)
+PIPELINE_STAGE(capdyn)
+PIPELINE_STAGE(puldyn)
+PIPELINE_STAGE(renal)
+PIPELINE_STAGE(electro)
+
+/**
+ * Evaluates the autonomic circulation control module, which advances the
+ * simulation time. If this module fails a stability check, the remaining
+ * stages are not evaluated and the time-step is restarted.
+ */
+struct STAGE_autonom {
+  template <typename T>
+  static bool run(PARAMS_T<T> &p, VARS_T<T> &v, STEP_STATE<T> &s) {
+    return module_autonom(p, v);
+  }
+  static void eval(PARAMS &p, VARS &v) {
+    module_autonom(p, v);
+  }
+  STAGE_VISIT(autonom, eval)
+};
+
+/**
+ * Evaluates the replacement for the original renal module.
+ */
+struct STAGE_kidney {
+  template <typename T>
+  static bool run(PARAMS_T<T> &p, VARS_T<T> &v, STEP_STATE<T> &s) {
+    module_kidney(p, v);
+    return true;
+  }
+  static void eval(PARAMS &p, VARS &v) {
+    module_kidney(p, v);
+  }
+  STAGE_VISIT(kidney, eval)
+};
+
+/**
+ * Evaluates the thirst drive module of the model variant, or the standard
+ * module. Model variants are only defined for \c double structs.
+ */
+struct STAGE_variant_thirst {
+  template <typename T>
+  static bool run(PARAMS_T<T> &p, VARS_T<T> &v, STEP_STATE<T> &s) {
+    return STAGE_thirst::run(p, v, s);
+  }
+  static bool run(PARAMS &p, VARS &v, STEP_STATE<double> &s) {
+    if (s.var && s.var->thirst != module_thirst<double>) {
+      s.var->thirst(p, v);
+      return true;
+    }
+    return STAGE_thirst::run(p, v, s);
+  }
+  static void visit(STAGE_VISITOR f, void *data) {
+    STAGE_thirst::visit(f, data);
+  }
+};
+
+/**
+ * Evaluates the electrolytes module of the model variant, or the standard
+ * module. Model variants are only defined for \c double structs.
+ */
+struct STAGE_variant_electro {
+  template <typename T>
+  static bool run(PARAMS_T<T> &p, VARS_T<T> &v, STEP_STATE<T> &s) {
+    return STAGE_electro::run(p, v, s);
+  }
+  static bool run(PARAMS &p, VARS &v, STEP_STATE<double> &s) {
+    if (s.var && s.var->electro != module_electro<double>) {
+      s.var->electro(p, v);
+      return true;
+    }
+    return STAGE_electro::run(p, v, s);
+  }
+  static void visit(STAGE_VISITOR f, void *data) {
+    STAGE_electro::visit(f, data);
+  }
+};
+
+/**
+ * Performs the experiments that intervene in the model, as required by the
+ * model variant. These are only defined for \c double structs.
+ */
+struct STAGE_experiments {
+  template <typename T>
+  static bool run(PARAMS_T<T> &p, VARS_T<T> &v, STEP_STATE<T> &s) {
+    return true;
+  }
+  static bool run(PARAMS &p, VARS &v, STEP_STATE<double> &s) {
+    if (s.var) {
+      exp_rapidreg(p, v);
+      exp_transfuse_with(p, v, s.var->fluid);
+    }
+    return true;
+  }
+  static void visit(STAGE_VISITOR f, void *data) {
+  }
+};
+
+/**
+ * Shortens the time-step (once the autonomic module has advanced the
+ * simulation time), so that it ends exactly at the next output time or
+ * scheduled change. The full time-step size is restored by
+ * STAGE_restore_step, so that subsequent time-steps are not affected.
+ */
+struct STAGE_exact_time {
+  template <typename T>
+  static bool run(PARAMS_T<T> &p, VARS_T<T> &v, STEP_STATE<T> &s) {
+    s.step = v.i;
+    if (v.t > s.t_next) {
+      v.i = s.t_next - s.t0;
+      v.t = s.t_next;
+    }
+    return true;
+  }
+  static void visit(STAGE_VISITOR f, void *data) {
+  }
+};
+
+/**
+ * Restores the time-step size, in case it was shortened by STAGE_exact_time.
+ */
+struct STAGE_restore_step {
+  template <typename T>
+  static bool run(PARAMS_T<T> &p, VARS_T<T> &v, STEP_STATE<T> &s) {
+    v.i = s.step;
+    return true;
+  }
+  static void visit(STAGE_VISITOR f, void *data) {
+  }
+};
+
+/** An empty stage, which pads the unused stages of a pipeline. */
+struct STAGE_NONE {
+  template <typename T>
+  static bool run(PARAMS_T<T> &p, VARS_T<T> &v, STEP_STATE<T> &s) {
+    return true;
+  }
+  static void visit(STAGE_VISITOR f, void *data) {
+  }
+};
+
+/**
+ * A pipeline of up to 20 stages, which are evaluated in turn until a stage
+ * fails (ie, returns \c false). A pipeline is also a stage, so that longer
+ * pipelines can be composed of shorter ones.
+ */
+template <typename S1, typename S2 = STAGE_NONE, typename S3 = STAGE_NONE,
+          typename S4 = STAGE_NONE, typename S5 = STAGE_NONE,
+          typename S6 = STAGE_NONE, typename S7 = STAGE_NONE,
+          typename S8 = STAGE_NONE, typename S9 = STAGE_NONE,
+          typename S10 = STAGE_NONE, typename S11 = STAGE_NONE,
+          typename S12 = STAGE_NONE, typename S13 = STAGE_NONE,
+          typename S14 = STAGE_NONE, typename S15 = STAGE_NONE,
+          typename S16 = STAGE_NONE, typename S17 = STAGE_NONE,
+          typename S18 = STAGE_NONE, typename S19 = STAGE_NONE,
+          typename S20 = STAGE_NONE>
+struct PIPELINE {
+  /** Evaluates each stage in turn, and returns whether every stage
+      succeeded. */
+  template <typename T>
+  static bool run(PARAMS_T<T> &p, VARS_T<T> &v, STEP_STATE<T> &s) {
+    return S1::run(p, v, s) && S2::run(p, v, s) && S3::run(p, v, s)
+      && S4::run(p, v, s) && S5::run(p, v, s) && S6::run(p, v, s)
+      && S7::run(p, v, s) && S8::run(p, v, s) && S9::run(p, v, s)
+      && S10::run(p, v, s) && S11::run(p, v, s) && S12::run(p, v, s)
+      && S13::run(p, v, s) && S14::run(p, v, s) && S15::run(p, v, s)
+      && S16::run(p, v, s) && S17::run(p, v, s) && S18::run(p, v, s)
+      && S19::run(p, v, s) && S20::run(p, v, s);
+  }
+
+  /** Calls a function for each module of the pipeline, in order. */
+  static void visit(STAGE_VISITOR f, void *data) {
+    S1::visit(f, data); S2::visit(f, data); S3::visit(f, data);
+    S4::visit(f, data); S5::visit(f, data); S6::visit(f, data);
+    S7::visit(f, data); S8::visit(f, data); S9::visit(f, data);
+    S10::visit(f, data); S11::visit(f, data); S12::visit(f, data);
+    S13::visit(f, data); S14::visit(f, data); S15::visit(f, data);
+    S16::visit(f, data); S17::visit(f, data); S18::visit(f, data);
+    S19::visit(f, data); S20::visit(f, data);
+  }
+};
+
+/**
+ * The modules of the Guyton 1992 model that precede the thirst drive module.
+ * The autonomic module advances the simulation time, after which the
+ * time-step may be shortened.
+ */
+typedef PIPELINE<STAGE_circdyn, STAGE_autonom, STAGE_exact_time,
+                 STAGE_aldost, STAGE_angio, STAGE_anp, STAGE_rbc,
+                 STAGE_o2deliv, STAGE_volrec, STAGE_adh, STAGE_stress>
+  PIPELINE_HEAD;
+
+/**
+ * The modules of the Guyton 1992 model that lie between the thirst drive
+ * module and the renal module.
+ */
+typedef PIPELINE<STAGE_baro, STAGE_special, STAGE_capdyn, STAGE_puldyn>
+  PIPELINE_BODY;
+
+/** The Guyton 1992 model. */
+typedef PIPELINE<PIPELINE_HEAD, STAGE_thirst, PIPELINE_BODY, STAGE_renal,
+                 STAGE_electro, STAGE_restore_step> PIPELINE_STANDARD;
+
+/** The Guyton 1992 model, with the replacement renal module. */
+typedef PIPELINE<PIPELINE_HEAD, STAGE_thirst, PIPELINE_BODY, STAGE_kidney,
+                 STAGE_electro, STAGE_restore_step> PIPELINE_NEWKIDNEY;
+
+/**
+ * The Guyton 1992 model, with the modules and experiments of a model variant
+ * (see exp_variants.h).
+ */
+typedef PIPELINE<PIPELINE_HEAD, STAGE_variant_thirst, PIPELINE_BODY,
+                 STAGE_renal, STAGE_variant_electro, STAGE_experiments,
+                 STAGE_restore_step> PIPELINE_VARIANT;
+
+/**
+ * The Guyton 1992 model, with the replacement renal module and with the
+ * modules and experiments of a model variant.
+ */
+typedef PIPELINE<PIPELINE_HEAD, STAGE_variant_thirst, PIPELINE_BODY,
+                 STAGE_kidney, STAGE_variant_electro, STAGE_experiments,
+                 STAGE_restore_step> PIPELINE_VARIANT_NEWKIDNEY;
+
+/**
+ * The circulation alone: the circulatory dynamics, their autonomic control,
+ * autoregulation and stress relaxation, and the capillary and pulmonary fluid
+ * dynamics. The hormones, kidneys, thirst and electrolytes are held at their
+ * current state.
+ */
+typedef PIPELINE<STAGE_circdyn, STAGE_autonom, STAGE_exact_time,
+                 STAGE_o2deliv, STAGE_stress, STAGE_baro, STAGE_special,
+                 STAGE_capdyn, STAGE_puldyn, STAGE_restore_step>
+  PIPELINE_CIRCULATION;
+
+/**
+ * Every module, each of which can be evaluated by itself (see STAGE_INFO).
+ */
+typedef PIPELINE<PIPELINE_STANDARD, STAGE_kidney> PIPELINE_MODULES;
+
+/**
+ * Evaluates a pipeline for a single time-step of a \c double model, without
+ * a model variant and without shortening the time-step.
+ *
+ * @param[in] p The struct of model parameters.
+ * @param[in] v The struct of state variables.
+ */
+template <typename L>
+void pipeline_eval(PARAMS &p, VARS &v) {
+  STEP_STATE<double> s = { NULL, DBL_MAX, v.t, v.i };
+  L::run(p, v, s);
+}
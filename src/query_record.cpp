@@ -0,0 +1,76 @@
+/**
+ * @file
+ * A program to print the history of state variables and parameters from a
+ * full-state recording of the model (as recorded by "guyton92 -r FILE").
+ * The output has the same format as that produced by the model itself.
+ */
+
+#include <cstdlib>
+#include <iostream>
+#include <sstream>
+#include <vector>
+#include <string>
+
+using namespace std;
+
+#include "record_format.h"
+#include "read_record.h"
+#include "query_record.h"
+
+/**
+ * The entry point for the recording query program.
+ *
+ * @param[in] argc The number of arguments on the command line.
+ * @param[in] argv The arguments provided on the command line.
+ */
+int main(int argc, char *argv[]) {
+  if (argc != 3) {
+    cerr << "USAGE: " << argv[0] << " recording outputs" << endl;
+    cerr << "\n  EXAMPLE:" << endl;
+    cerr << "    " << argv[0] << " hypertension.rec pa,rbf,vud" << endl;
+    return EXIT_FAILURE;
+  }
+
+  RECORDING *rec = record_open(argv[1]);
+  if (! rec) {
+    return EXIT_FAILURE;
+  }
+
+  /* Obtain the history of each output variable. */
+  vector<string> names;
+  vector< vector<double> > values;
+  vector<double> times;
+  istringstream ss(argv[2]);
+  string name;
+  while (getline(ss, name, ',')) {
+    vector<double> ts, xs;
+    if (! record_history(rec, name.c_str(), ts, xs)) {
+      cerr << "ERROR: Unknown variable name \"" << name << "\"" << endl;
+      record_close(rec);
+      return EXIT_FAILURE;
+    }
+    names.push_back(name);
+    values.push_back(xs);
+    times.swap(ts);
+  }
+
+  /* Print the column headers. */
+  cout << "t";
+  for (size_t i = 0; i < names.size(); i++) {
+    cout << " " << names[i];
+  }
+  cout << endl;
+
+  /* Print the value of each output variable in each record. */
+  cout.setf(ios::left);
+  for (size_t r = 0; r < times.size(); r++) {
+    cout << times[r];
+    for (size_t i = 0; i < values.size(); i++) {
+      cout << " " << values[i][r];
+    }
+    cout << endl;
+  }
+
+  record_close(rec);
+  return EXIT_SUCCESS;
+}
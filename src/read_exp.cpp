@@ -5,15 +5,21 @@
 
 #include <queue>
 #include <vector>
+#include <algorithm>
 #include <iostream>
 #include <istream>
 #include <ostream>
+#include <fstream>
 #include <string>
 #include <sstream>
 #include <cstring>
 #include <cfloat>
+#include <cmath>
 
 #include "read_params.h"
+#include "vars.h"
+#include "exp_transfuse.h"
+#include "exp_variants.h"
 #include "read_exp.h"
 
 using namespace std;
@@ -36,6 +42,31 @@ using namespace std;
  *   simulate_model(params, variables);
  * }
  * @endcode
+ *
+ * An experiment definition contains the following lines (other lines set
+ * the value of a parameter, eg, "nid 0.5"):
+ * - <b>o= VAR ...</b> the model variables to include in the output.
+ * - <b>t= TIME</b> the time (mins) at which the subsequent changes occur;
+ *   the model outputs are also recorded at this time. The final time is
+ *   the end of the simulation.
+ * - <b>every= DT [FROM [TO]]</b> also record the model outputs every DT
+ *   minutes after time FROM (by default, the time of the current changes)
+ *   until time TO (by default, the end of the simulation).
+ * - <b>ramp= PARAM DT1 V1 [DT2 V2 ...]</b> vary the parameter linearly
+ *   between the values V1, V2, ..., which are reached DT1, DT2, ... minutes
+ *   after the time of the current changes.
+ * - <b>schedule= PARAM PERIOD DT1 V1 [DT2 V2 ...]</b> set the parameter to
+ *   V1, V2, ... at DT1, DT2, ... minutes into each period.
+ * - <b>table= PARAM FILE</b> as per "ramp=", where the times and values are
+ *   read from the two columns of a data file (eg, exps/data/ *.dat).
+ * - <b>variant= NAME</b> the variant of the model (see exp_variants.cpp).
+ * - <b>sens= MODE PARAM ...</b> also calculate the derivatives of the model
+ *   outputs at each output time with respect to the initial value of each
+ *   parameter, in "forward" or "adjoint" MODE (see gradient.cpp).
+ * - <b>end-exp</b> the end of the experiment definition.
+ *
+ * A continuously-varying parameter remains in effect until its value is
+ * changed, or a new "ramp=", "schedule=" or "table=" is given for it.
  */
 
 /**
@@ -48,6 +79,9 @@ using namespace std;
  */
 Experiment::Experiment(PARAMS &p, std::istream &input) : params(p) {
   err = NULL;
+  exact = false;
+  applied = 0;
+  var = exp_variant_default();
 
   /* The initial parameter values are applied before the simulation starts. */
   PARAM_CHANGES *cs = new PARAM_CHANGES;
@@ -96,6 +130,59 @@ Experiment::Experiment(PARAMS &p, std::istream &input) : params(p) {
         str >> varname;
         outputs.push_back(varname);
       }
+    } else if (! pname.compare("variant=")) {
+      /* If the parameter name is "variant=", this selects the variant of
+         the model that is required by this experiment (see
+         exp_variants.cpp). */
+      string vname;
+      str >> vname;
+      var = exp_variant(vname.c_str());
+      if (! var) {
+        var = exp_variant_default();
+        if (! err) {
+          err = new string("Unknown variant: '" + vname + "'");
+        }
+      }
+    } else if (! pname.compare("sens=")) {
+      /* If the parameter name is "sens=", this requests the derivatives of
+         the model outputs with respect to the listed parameters. */
+      str >> sens_mode;
+      if (sens_mode.compare("forward") && sens_mode.compare("adjoint")) {
+        fail("Unknown sensitivity mode: '" + sens_mode + "'");
+      }
+      string sname;
+      while (str >> sname) {
+        if (param_index(sname.c_str()) < 0) {
+          fail("Unknown parameter: '" + sname + "'");
+        }
+        sens_params.push_back(sname);
+      }
+    } else if (! pname.compare("ramp=") || ! pname.compare("schedule=")
+               || ! pname.compare("table=")) {
+      /* The parameter varies continuously over time, beginning at the time
+         of the current set of changes. */
+      PARAM_INPUT input;
+      if (read_input(str, pname, input)) {
+        cs->inputs.push_back(input);
+      }
+    } else if (! pname.compare("every=")) {
+      /* Record the model outputs at regular intervals, without defining any
+         scheduled changes. */
+      OUTPUT_SAMPLING sampling;
+      double from, to;
+      sampling.from = cs->at_time;
+      sampling.to = DBL_MAX;
+      if (! (str >> sampling.interval) || sampling.interval <= 0) {
+        fail("Invalid output interval: '" + line + "'");
+      } else {
+        if (str >> from) {
+          sampling.from = from;
+          if (str >> to) {
+            sampling.to = to;
+          }
+        }
+        every.push_back(sampling);
+      }
     } else if (! pname.compare("end-exp")) {
       break;
     } else {
@@ -123,6 +210,192 @@ Experiment::Experiment(PARAMS &p, std::istream &input) : params(p) {
   delete cs;
 
   orig = new queue<PARAM_CHANGES>(changes);
+
+  /* Add the regularly-spaced output times (if any). */
+  samples = times;
+  if (! every.empty()) {
+    double end = stop_at();
+    for (size_t i = 0; i < every.size(); i++) {
+      OUTPUT_SAMPLING &s = every[i];
+      s.to = (s.to < end) ? s.to : end;
+      for (long k = 1; s.from + k * s.interval <= s.to; k++) {
+        samples.push_back(s.from + k * s.interval);
+      }
+    }
+    sort(samples.begin(), samples.end());
+    samples.erase(unique(samples.begin(), samples.end()), samples.end());
+  }
+  sorted_samples = samples;
+  sort(sorted_samples.begin(), sorted_samples.end());
+}
+
+/**
+ * Records an error in the experiment definition. Only the first error is
+ * retained.
+ *
+ * @param msg The description of the error.
+ */
+void Experiment::fail(const string &msg) {
+  if (! err) {
+    err = new string(msg);
+  }
+}
+
+/**
+ * Reads the definition of a continuously-varying parameter.
+ *
+ * @param str The remainder of the line that defines the parameter.
+ * @param kind The kind of definition ("ramp=", "schedule=" or "table=").
+ * @param input The definition of the parameter.
+ *
+ * @return \c true if the definition is valid, otherwise \c false.
+ */
+bool Experiment::read_input(istream &str, const string &kind,
+                            PARAM_INPUT &input) {
+  str >> input.name;
+  input.index = param_index(input.name.c_str());
+  input.period = 0;
+  if (input.index < 0) {
+    fail("Unknown parameter: '" + input.name + "'");
+    return false;
+  }
+
+  if (! kind.compare("schedule=")
+      && (! (str >> input.period) || input.period <= 0)) {
+    fail("Invalid schedule period for '" + input.name + "'");
+    return false;
+  }
+
+  double t, value;
+  if (! kind.compare("table=")) {
+    /* Read each time and value from the data file. */
+    string fname;
+    str >> fname;
+    ifstream data(fname.c_str());
+    if (data.fail()) {
+      fail("Unable to open data file: '" + fname + "'");
+      return false;
+    }
+    string row;
+    while (getline(data, row)) {
+      size_t start = row.find_first_not_of(" \t\r\n");
+      if (start == string::npos || row[start] == '#') {
+        continue;
+      }
+      istringstream fields(row);
+      if (! (fields >> t >> value)) {
+        fail("Invalid data in '" + fname + "': '" + row + "'");
+        return false;
+      }
+      input.times.push_back(t);
+      input.values.push_back(value);
+    }
+  } else {
+    while (str >> t) {
+      if (! (str >> value)) {
+        fail("Missing value for '" + input.name + "'");
+        return false;
+      }
+      input.times.push_back(t);
+      input.values.push_back(value);
+    }
+  }
+
+  /* The times must be in order (and within a single period). */
+  if (input.times.empty()) {
+    fail("No values for '" + input.name + "'");
+    return false;
+  }
+  for (size_t i = 0; i < input.times.size(); i++) {
+    if ((i > 0 && input.times[i] < input.times[i - 1])
+        || (input.period > 0
+            && (input.times[i] < 0 || input.times[i] >= input.period))) {
+      fail("Invalid times for '" + input.name + "'");
+      return false;
+    }
+  }
+  return true;
+}
+
+/**
+ * Applies a set of changes: parameter values are set (if requested) and
+ * continuously-varying parameters are started or stopped.
+ *
+ * @param cs The set of changes.
+ * @param set Whether to set the parameter values, or only to update the
+ *            continuously-varying parameters (when the parameter values
+ *            have already been set, see Experiment::skip_events).
+ */
+void Experiment::apply(const PARAM_CHANGES &cs, bool set) {
+  /* A new value or a new input replaces any existing input. */
+  for (size_t i = 0; i < cs.changes.size(); i++) {
+    int ix = param_index(cs.changes[i].name);
+    for (size_t j = active.size(); j-- > 0; ) {
+      if (active[j].input.index == ix) {
+        active.erase(active.begin() + j);
+      }
+    }
+    if (set) {
+      set_param(params, cs.changes[i].name, cs.changes[i].value);
+      updated.push_back(ix);
+    }
+  }
+
+  for (size_t i = 0; i < cs.inputs.size(); i++) {
+    for (size_t j = active.size(); j-- > 0; ) {
+      if (active[j].input.index == cs.inputs[i].index) {
+        active.erase(active.begin() + j);
+      }
+    }
+    ACTIVE_INPUT a;
+    a.input = cs.inputs[i];
+    a.start = cs.at_time;
+    a.cursor = 0;
+    active.push_back(a);
+  }
+}
+
+/**
+ * Returns the value of a continuously-varying parameter.
+ *
+ * @param a The continuously-varying parameter.
+ * @param time The current simulation time (mins).
+ */
+double Experiment::input_value(ACTIVE_INPUT &a, double time) {
+  const vector<double> &ts = a.input.times;
+  const vector<double> &vs = a.input.values;
+  size_t n = ts.size();
+  double tau = time - a.start;
+
+  if (a.input.period > 0) {
+    /* Before the first point of each period, the schedule retains the
+       value from the end of the previous period. */
+    tau = fmod(tau, a.input.period);
+    if (tau < 0) {
+      tau += a.input.period;
+    }
+    if (tau < ts[0]) {
+      return vs[n - 1];
+    }
+  } else if (tau <= ts[0]) {
+    return vs[0];
+  } else if (tau >= ts[n - 1]) {
+    return vs[n - 1];
+  }
+
+  /* Time normally increases, so the search begins at the previous point. */
+  if (a.cursor >= n || ts[a.cursor] > tau) {
+    a.cursor = 0;
+  }
+  while (a.cursor + 1 < n && ts[a.cursor + 1] <= tau) {
+    a.cursor++;
+  }
+
+  size_t i = a.cursor;
+  if (a.input.period > 0 || ts[i + 1] <= ts[i]) {
+    return vs[i];
+  }
+  return vs[i] + (vs[i + 1] - vs[i]) * (tau - ts[i]) / (ts[i + 1] - ts[i]);
 }
 
 /**
@@ -172,27 +445,41 @@ const string* Experiment::errmsg() {
  * @param time The current simulation time (mins).
  */
 void Experiment::update(double time) {
+  updated.clear();
+
   /* Check if it's time to apply the next set of scheduled changes. */
-  if (changes.empty()) {
-    return;
-  }
+  if (! changes.empty() && changes.front().at_time <= time) {
+    /* If so, remove this set of changes from the queue. */
+    PARAM_CHANGES cs = changes.front();
+    changes.pop();
+    applied++;
 
-  PARAM_CHANGES cs = changes.front();
-  if (cs.at_time > time) {
-    return;
+    /* Set each new parameter value. */
+    apply(cs, true);
+    vector<PARAM_CHANGE>::iterator it;
+    for (it = cs.changes.begin() ; it != cs.changes.end(); it++) {
+      delete it->name;
+    }
   }
 
-  /* If so, remove this set of changes from the queue. */
-  changes.pop();
-
-  /* Set each new parameter value. */
-  vector<PARAM_CHANGE>::iterator it;
-  for (it = cs.changes.begin() ; it != cs.changes.end(); it++) {
-    set_param(params, it->name, it->value);
-    delete it->name;
+  /* Update the continuously-varying parameters. The struct only contains
+     doubles, so it can be treated as an array. */
+  double *values = (double *) &params;
+  for (size_t i = 0; i < active.size(); i++) {
+    values[active[i].input.index] = input_value(active[i], time);
+    updated.push_back(active[i].input.index);
   }
 }
 
+/**
+ * Returns the index of each parameter that was set by the most recent call
+ * to Experiment::update (see param_index()), including parameters that were
+ * set to their current value.
+ */
+const std::vector<int>& Experiment::updated_params() const {
+  return updated;
+}
+
 /**
  * Returns the time at which the experiment should end (mins).
  */
@@ -207,18 +494,103 @@ double Experiment::stop_at() {
   return changes.back().at_time;
 }
 
+/**
+ * Determines whether each time-step should be shortened, if necessary, so
+ * that it ends exactly at the next output time or scheduled change (see
+ * Experiment::next_time). This is disabled by default, in which case the
+ * model outputs are recorded at the end of the first time-step that reaches
+ * each output time, which may be up to \c p.i3 minutes later.
+ *
+ * @param enable Whether to shorten the time-steps.
+ */
+void Experiment::set_exact_times(bool enable) {
+  exact = enable;
+}
+
+/**
+ * Returns whether each time-step should end exactly at the next output time
+ * or scheduled change (see Experiment::set_exact_times).
+ */
+bool Experiment::exact_times() const {
+  return exact;
+}
+
+/**
+ * Returns the first output time or scheduled change that occurs after the
+ * given time, or \c DBL_MAX if there are none.
+ *
+ * @param time The current simulation time (mins).
+ */
+double Experiment::next_time(double time) const {
+  vector<double>::const_iterator it =
+    upper_bound(sorted_samples.begin(), sorted_samples.end(), time);
+  return (it == sorted_samples.end()) ? DBL_MAX : *it;
+}
+
+/**
+ * Returns the time at which the next set of scheduled changes will be
+ * applied, or \c DBL_MAX if there are none.
+ */
+double Experiment::next_event() const {
+  if (changes.empty()) {
+    return DBL_MAX;
+  }
+  return changes.front().at_time;
+}
+
+/**
+ * Returns the number of sets of scheduled changes that have been applied
+ * (or skipped, see Experiment::skip_events). The initial parameter values
+ * are the first set of changes.
+ */
+size_t Experiment::events_applied() const {
+  return applied;
+}
+
+/**
+ * Discards the next sets of scheduled changes without applying them. This is
+ * used when resuming a simulation from a model state in which these changes
+ * have already been applied.
+ *
+ * @param count The number of sets of changes to discard.
+ */
+void Experiment::skip_events(size_t count) {
+  for (size_t i = 0; i < count && ! changes.empty(); i++) {
+    PARAM_CHANGES cs = changes.front();
+    changes.pop();
+    applied++;
+
+    /* The continuously-varying parameters must still be started. */
+    apply(cs, false);
+    vector<PARAM_CHANGE>::iterator it;
+    for (it = cs.changes.begin() ; it != cs.changes.end(); it++) {
+      delete it->name;
+    }
+  }
+}
+
+/**
+ * Returns every set of scheduled changes, including the initial parameter
+ * values. Note that the parameter names are only valid until the changes
+ * are applied (or skipped), so this must be used before the simulation
+ * begins.
+ */
+const param_changes& Experiment::schedule() const {
+  return *orig;
+}
+
 /**
  * Returns the times at which the model outputs should be recorded. The array
  * is terminated by the value DBL_MAX.
  */
 const double* Experiment::output_times() {
   /* Allocate space for each time and the terminal value. */
-  int size = (int) times.size();
+  int size = (int) samples.size();
   double* output_times = new double[size + 1];
 
   /* Record each output time. */
   for (int i = 0; i < size; i++) {
-    output_times[i] = times[i];
+    output_times[i] = samples[i];
   }
 
   /* Terminate the array with DBL_MAX and then return the array. */
@@ -231,11 +603,37 @@ const std::vector<std::string>& Experiment::output_vars() const {
 }
 
 /**
- * Writes the experiment definition to an output stream.
+ * Returns the names of the parameters with respect to which the derivatives
+ * of the model outputs should be calculated (see gradient.cpp).
+ */
+const std::vector<std::string>& Experiment::sensitivity_params() const {
+  return sens_params;
+}
+
+/**
+ * Returns the mode ("forward" or "adjoint") in which the derivatives of the
+ * model outputs should be calculated, if any (see gradient.cpp).
+ */
+const std::string& Experiment::sensitivity_mode() const {
+  return sens_mode;
+}
+
+/**
+ * Returns the variant of the model that is required by this experiment (see
+ * exp_variants.cpp).
+ */
+const EXP_VARIANT *Experiment::variant() const {
+  return var;
+}
+
+/**
+ * Writes the parts of the experiment definition that are not scheduled
+ * changes (the output names and times, the model variant and the requested
+ * derivatives) to an output stream.
  *
- * @param out The output stream to which the experiment definition is written.
+ * @param out The output stream to which the definition is written.
  */
-void Experiment::write_exp(std::ostream &out) {
+void Experiment::write_outputs(std::ostream &out) {
   /* Print the output names. */
   out << "o=";
   int names = (int) outputs.size();
@@ -244,6 +642,65 @@ void Experiment::write_exp(std::ostream &out) {
   }
   out << endl;
 
+  /* Print the model variant, unless it is the default. */
+  if (var != exp_variant_default()) {
+    out << "variant= " << var->name << endl;
+  }
+
+  /* Print the requested derivatives (if any). */
+  if (! sens_params.empty()) {
+    out << "sens= " << sens_mode;
+    for (size_t i = 0; i < sens_params.size(); i++) {
+      out << " " << sens_params[i];
+    }
+    out << endl;
+  }
+
+  /* Print the regularly-spaced output times. */
+  for (size_t i = 0; i < every.size(); i++) {
+    out << "every= " << every[i].interval << " " << every[i].from << " "
+        << every[i].to << endl;
+  }
+}
+
+/**
+ * Writes a set of scheduled changes (other than the time at which they
+ * occur) to an output stream. Tabulated parameters are written as ramps.
+ *
+ * @param out The output stream to which the changes are written.
+ * @param cs The set of changes.
+ */
+void Experiment::write_changes(std::ostream &out, const PARAM_CHANGES &cs) {
+  /* Print the parameter changes (if any). */
+  int count = (int) cs.changes.size();
+  for (int j = 0; j < count; j++) {
+    PARAM_CHANGE c = cs.changes[j];
+    out << c.name << " " << c.value << endl;
+  }
+
+  /* Print the continuously-varying parameters (if any). */
+  for (size_t j = 0; j < cs.inputs.size(); j++) {
+    const PARAM_INPUT &in = cs.inputs[j];
+    if (in.period > 0) {
+      out << "schedule= " << in.name << " " << in.period;
+    } else {
+      out << "ramp= " << in.name;
+    }
+    for (size_t k = 0; k < in.times.size(); k++) {
+      out << " " << in.times[k] << " " << in.values[k];
+    }
+    out << endl;
+  }
+}
+
+/**
+ * Writes the experiment definition to an output stream.
+ *
+ * @param out The output stream to which the experiment definition is written.
+ */
+void Experiment::write_exp(std::ostream &out) {
+  write_outputs(out);
+
   /* Print the output times and parameter changes. */
   param_changes cs(*orig);
   int size = (int) cs.size();
@@ -257,12 +714,7 @@ void Experiment::write_exp(std::ostream &out) {
       out << "t= " << cx.at_time << endl;
     }
 
-    /* Print the parameter changes (if any). */
-    int count = (int) cx.changes.size();
-    for (int j = 0; j < count; j++) {
-      PARAM_CHANGE c = cx.changes[j];
-      out << c.name << " " << c.value << endl;
-    }
+    write_changes(out, cx);
   }
 
   /* Finish with the end-exp marker, so that more data can be appended to
@@ -7,15 +7,50 @@ struct PARAM_CHANGE {
 /** A vector of parameter changes. */
 typedef std::vector<PARAM_CHANGE> vec_changes;
 
+/**
+ * A parameter that varies continuously over time, either as a
+ * piecewise-linear function of time ("ramp=" and "table=") or as a
+ * repeating step function ("schedule=").
+ */
+struct PARAM_INPUT {
+  std::string name; /** The name of the parameter. */
+  int index; /** The index of the parameter in the PARAMS struct. */
+  double period; /** The period of a schedule (mins), or zero for a ramp. */
+  std::vector<double> times; /** The time of each point (mins), relative to
+                                 the start of the input. */
+  std::vector<double> values; /** The parameter value at each point. */
+};
+
+/** A vector of continuously-varying parameters. */
+typedef std::vector<PARAM_INPUT> vec_inputs;
+
 /** A set of parameter changes is scheduled to occur at a specific time. */
 struct PARAM_CHANGES {
   double at_time; /** The scheduled time in the simulation (mins). */
   vec_changes changes; /** The vecotr of parameter changes to apply. */
+  vec_inputs inputs; /** The continuously-varying parameters to start. */
+};
+
+/** A continuously-varying parameter that is currently in effect. */
+struct ACTIVE_INPUT {
+  PARAM_INPUT input; /** The definition of the parameter's values. */
+  double start; /** The time at which the input started (mins). */
+  size_t cursor; /** The index of the most recent point. */
+};
+
+/** Regularly-spaced output times ("every="). */
+struct OUTPUT_SAMPLING {
+  double interval; /** The time between outputs (mins). */
+  double from; /** The time after which outputs begin (mins). */
+  double to; /** The time after which outputs end (mins). */
 };
 
 /** A queue of scheduled parameter changes. */
 typedef std::queue<PARAM_CHANGES> param_changes;
 
+/** A variant of the model (see exp_variants.cpp). */
+struct EXP_VARIANT;
+
 class Experiment {
 private:
   param_changes changes;
@@ -23,15 +58,43 @@ private:
   PARAMS &params;
   std::string *err;
   std::vector<double> times;
+  std::vector<double> samples;
+  std::vector<double> sorted_samples;
+  std::vector<OUTPUT_SAMPLING> every;
+  std::vector<ACTIVE_INPUT> active;
+  std::vector<int> updated;
   std::vector<std::string> outputs;
+  std::string sens_mode;
+  std::vector<std::string> sens_params;
+  bool exact;
+  size_t applied;
+  const EXP_VARIANT *var;
+  void fail(const std::string &msg);
+  bool read_input(std::istream &str, const std::string &kind,
+                  PARAM_INPUT &input);
+  void apply(const PARAM_CHANGES &cs, bool set);
+  double input_value(ACTIVE_INPUT &a, double time);
 public:
   Experiment(PARAMS &p, std::istream &input);
   ~Experiment();
   void update(double time);
+  const std::vector<int>& updated_params() const;
   double stop_at();
+  void set_exact_times(bool enable);
+  bool exact_times() const;
+  double next_time(double time) const;
+  double next_event() const;
+  size_t events_applied() const;
+  void skip_events(size_t count);
+  const param_changes& schedule() const;
   bool failed();
   const std::string* errmsg();
   const double* output_times();
   const std::vector<std::string>& output_vars() const;
+  const EXP_VARIANT *variant() const;
+  const std::vector<std::string>& sensitivity_params() const;
+  const std::string& sensitivity_mode() const;
+  void write_outputs(std::ostream &out);
+  static void write_changes(std::ostream &out, const PARAM_CHANGES &cs);
   void write_exp(std::ostream &out);
 };
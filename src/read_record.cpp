@@ -0,0 +1,234 @@
+/**
+ * @file
+ * Functions for reading full-state recordings of the model (see
+ * record_format.h), so that the history of any state variable or parameter
+ * can be obtained once a simulation has finished.
+ *
+ * @code
+ * RECORDING *rec = record_open("hypertension.rec");
+ * vector<double> times, values;
+ * record_history(rec, "pa", times, values);
+ * record_close(rec);
+ * @endcode
+ */
+
+#include <cstring>
+#include <iostream>
+#include <vector>
+#include <string>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+using namespace std;
+
+#include "record_format.h"
+#include "read_record.h"
+
+/** An open (memory-mapped) recording of the model state. */
+struct RECORDING {
+  void *base; /** The start of the memory-mapped file. */
+  size_t size; /** The size of the file (bytes). */
+  const REC_HEADER *hdr; /** The recording header. */
+  std::vector<const char *> names; /** The name of each field. */
+};
+
+/**
+ * Decodes a single record, updating the value of each field in place.
+ *
+ * @param[in] in The start of the record.
+ * @param[in,out] prev The value of each field in the previous record, which
+ *                     are replaced by the values in this record.
+ * @param[in] fields The number of fields in each record.
+ *
+ * @return The start of the next record.
+ */
+const unsigned char *record_decode(const unsigned char *in, uint64_t *prev,
+                                   int fields) {
+  const unsigned char *counts = in;
+  const unsigned char *bytes = in + (fields + 1) / 2;
+
+  for (int f = 0; f < fields; f++) {
+    int count = (counts[f / 2] >> (4 * (f % 2))) & 0x0F;
+    uint64_t x = 0;
+    for (int b = 0; b < count; b++) {
+      x |= ((uint64_t) bytes[b]) << (8 * b);
+    }
+    prev[f] ^= x;
+    bytes += count;
+  }
+
+  return bytes;
+}
+
+/**
+ * Decodes every record in a single chunk, and records the time and the value
+ * of a single field.
+ *
+ * @param[in] chunk The start of the chunk.
+ * @param[in] fields The number of fields in each record.
+ * @param[in] tfield The index of the field that contains the time.
+ * @param[in] field The index of the field whose value should be recorded.
+ * @param[out] times The times at which each record was made.
+ * @param[out] values The value of the field in each record.
+ *
+ * @return The number of records in this chunk.
+ */
+unsigned long record_chunk_history(const unsigned char *chunk,
+                                   int fields, int tfield, int field,
+                                   std::vector<double> &times,
+                                   std::vector<double> &values) {
+  uint64_t used;
+  memcpy(&used, chunk, sizeof(used));
+
+  /* The first record is a keyframe, which is relative to zero. */
+  vector<uint64_t> state(fields, 0);
+  const unsigned char *in = chunk + REC_CHUNK_HDR;
+  const unsigned char *end = chunk + used;
+  unsigned long count = 0;
+
+  while (in < end) {
+    in = record_decode(in, &state[0], fields);
+    double t, x;
+    memcpy(&t, &state[tfield], sizeof(t));
+    memcpy(&x, &state[field], sizeof(x));
+    times.push_back(t);
+    values.push_back(x);
+    count++;
+  }
+
+  return count;
+}
+
+/**
+ * Reports an error in a recording and frees all associated resources.
+ *
+ * @return \c NULL, so that this can be returned by record_open().
+ */
+static RECORDING *record_fail(RECORDING *rec, const char *filename,
+                              const char *msg) {
+  cerr << "ERROR: Invalid recording '" << filename << "' -- " << msg << endl;
+  record_close(rec);
+  return NULL;
+}
+
+/**
+ * Opens a recording and maps it into memory.
+ *
+ * @param[in] filename The name of the recording.
+ *
+ * @return The recording, or \c NULL if the file could not be read.
+ */
+RECORDING *record_open(const char *filename) {
+  int fd = open(filename, O_RDONLY);
+  if (fd < 0) {
+    cerr << "ERROR: Unable to open recording: '" << filename << "'" << endl;
+    return NULL;
+  }
+
+  struct stat buf;
+  if (fstat(fd, &buf) != 0 || buf.st_size < (off_t) sizeof(REC_HEADER)) {
+    close(fd);
+    cerr << "ERROR: Invalid recording '" << filename << "'" << endl;
+    return NULL;
+  }
+
+  RECORDING *rec = new RECORDING;
+  rec->size = (size_t) buf.st_size;
+  rec->base = mmap(NULL, rec->size, PROT_READ, MAP_SHARED, fd, 0);
+  close(fd);
+  if (rec->base == MAP_FAILED) {
+    rec->base = NULL;
+    return record_fail(rec, filename, "mmap");
+  }
+
+  /* Check the fixed-size portion of the header. */
+  const char *bytes = (const char *) rec->base;
+  rec->hdr = (const REC_HEADER *) bytes;
+  if (strncmp(rec->hdr->magic, REC_MAGIC, REC_MAGIC_LEN) != 0) {
+    return record_fail(rec, filename, "not a recording");
+  }
+  if (rec->hdr->version != REC_VERSION) {
+    return record_fail(rec, filename, "unsupported version");
+  }
+  if (rec->hdr->header_size + rec->hdr->chunks * rec->hdr->chunk_size
+      > rec->size) {
+    return record_fail(rec, filename, "truncated");
+  }
+
+  /* Read the name of each field. */
+  const char *str = bytes + sizeof(REC_HEADER);
+  const char *end = bytes + rec->hdr->header_size;
+  int fields = rec->hdr->var_count + rec->hdr->param_count;
+  for (int f = 0; f < fields; f++) {
+    const char *nul = (const char *) memchr(str, 0, end - str);
+    if (! nul) {
+      return record_fail(rec, filename, "corrupt field names");
+    }
+    rec->names.push_back(str);
+    str = nul + 1;
+  }
+
+  return rec;
+}
+
+/**
+ * Closes a recording.
+ */
+void record_close(RECORDING *rec) {
+  if (! rec) {
+    return;
+  }
+  if (rec->base) {
+    munmap(rec->base, rec->size);
+  }
+  delete rec;
+}
+
+/**
+ * Returns the number of records (ie, the number of notifications).
+ */
+unsigned long record_count(const RECORDING *rec) {
+  return (unsigned long) rec->hdr->records;
+}
+
+/**
+ * Obtains the entire history of a single state variable or parameter.
+ *
+ * @param[in] rec The recording.
+ * @param[in] name The name of the state variable or parameter.
+ * @param[out] times The times at which each record was made.
+ * @param[out] values The value of the state variable or parameter.
+ *
+ * @return \c true if the history was obtained, or \c false if there is no
+ *         field with the given name.
+ */
+bool record_history(const RECORDING *rec, const char *name,
+                    std::vector<double> &times, std::vector<double> &values) {
+  int field = -1;
+  int tfield = -1;
+  /* State variables precede the parameters, so they take precedence. */
+  for (int f = (int) rec->names.size() - 1; f >= 0; f--) {
+    if (! strcmp(rec->names[f], name)) {
+      field = f;
+    }
+    if (! strcmp(rec->names[f], "t") && f < (int) rec->hdr->var_count) {
+      tfield = f;
+    }
+  }
+  if (field < 0 || tfield < 0) {
+    return false;
+  }
+
+  const unsigned char *chunks = (const unsigned char *) rec->base
+    + rec->hdr->header_size;
+  for (uint64_t c = 0; c < rec->hdr->chunks; c++) {
+    record_chunk_history(chunks + c * rec->hdr->chunk_size,
+                         (int) rec->names.size(), tfield, field,
+                         times, values);
+  }
+
+  return true;
+}
@@ -0,0 +1,15 @@
+/** An open (memory-mapped) recording of the model state. */
+struct RECORDING;
+
+const unsigned char *record_decode(const unsigned char *in, uint64_t *prev,
+                                   int fields);
+unsigned long record_chunk_history(const unsigned char *chunk,
+                                   int fields, int tfield, int field,
+                                   std::vector<double> &times,
+                                   std::vector<double> &values);
+
+RECORDING *record_open(const char *filename);
+void record_close(RECORDING *rec);
+unsigned long record_count(const RECORDING *rec);
+bool record_history(const RECORDING *rec, const char *name,
+                    std::vector<double> &times, std::vector<double> &values);
@@ -0,0 +1,289 @@
+/**
+ * @file
+ * A small library for reading binary trajectory files (see traj_format.h).
+ * The file is memory-mapped, so that each column of each chunk can be viewed
+ * in place without copying or parsing any of the data.
+ *
+ * @code
+ * TRAJ_FILE *traj = traj_open("hypertension.traj");
+ * int col = traj_find(traj, "pa");
+ * for (unsigned int c = 0; c < traj_nchunks(traj); c++) {
+ *   unsigned long rows;
+ *   const double *pa = traj_chunk(traj, c, col, &rows);
+ *   ...
+ * }
+ * traj_close(traj);
+ * @endcode
+ */
+
+#include <cstring>
+#include <iostream>
+#include <vector>
+#include <string>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+using namespace std;
+
+#include "traj_format.h"
+#include "read_traj.h"
+
+/** The location and size of a single chunk. */
+struct TRAJ_CHUNK {
+  const double *data; /** The first value of the first column. */
+  unsigned long rows; /** The number of rows in this chunk. */
+};
+
+/** An open (memory-mapped) trajectory file. */
+struct TRAJ_FILE {
+  void *base; /** The start of the memory-mapped file. */
+  size_t size; /** The size of the file (bytes). */
+  unsigned int ncols; /** The number of columns, including time. */
+  unsigned long nrows; /** The total number of rows. */
+  std::vector<const char *> names; /** The name of each column. */
+  std::vector<const char *> units; /** The units of each column. */
+  std::vector<TRAJ_CHUNK> chunks; /** The location of each chunk. */
+};
+
+/**
+ * Reports an error in a trajectory file and frees all associated resources.
+ *
+ * @return \c NULL, so that this can be returned by traj_open().
+ */
+static TRAJ_FILE * traj_fail(TRAJ_FILE *traj, const char *filename,
+                             const char *msg) {
+  cerr << "ERROR: Invalid trajectory '" << filename << "' -- " << msg << endl;
+  traj_close(traj);
+  return NULL;
+}
+
+/**
+ * Opens a trajectory file and maps it into memory.
+ *
+ * @param[in] filename The name of the trajectory file.
+ *
+ * @return The trajectory, or \c NULL if the file could not be read.
+ */
+extern "C" TRAJ_FILE * traj_open(const char *filename) {
+  int fd = open(filename, O_RDONLY);
+  if (fd < 0) {
+    cerr << "ERROR: Unable to open trajectory: '" << filename << "'" << endl;
+    return NULL;
+  }
+
+  struct stat buf;
+  if (fstat(fd, &buf) != 0 || buf.st_size < (off_t) sizeof(TRAJ_HEADER)) {
+    close(fd);
+    cerr << "ERROR: Invalid trajectory '" << filename << "'" << endl;
+    return NULL;
+  }
+
+  TRAJ_FILE *traj = new TRAJ_FILE;
+  traj->size = (size_t) buf.st_size;
+  traj->base = mmap(NULL, traj->size, PROT_READ, MAP_SHARED, fd, 0);
+  /* The mapping remains valid once the file descriptor is closed. */
+  close(fd);
+  if (traj->base == MAP_FAILED) {
+    traj->base = NULL;
+    return traj_fail(traj, filename, "mmap");
+  }
+
+  /* Check the fixed-size portion of the header. */
+  const char *bytes = (const char *) traj->base;
+  const TRAJ_HEADER *hdr = (const TRAJ_HEADER *) bytes;
+  if (strncmp(hdr->magic, TRAJ_MAGIC, TRAJ_MAGIC_LEN) != 0) {
+    return traj_fail(traj, filename, "not a trajectory file");
+  }
+  if (hdr->version != TRAJ_VERSION) {
+    return traj_fail(traj, filename, "unsupported version");
+  }
+  if (hdr->header_size < sizeof(TRAJ_HEADER) || hdr->header_size > traj->size
+      || hdr->header_size % 8 || ! hdr->ncols || ! hdr->chunk_rows) {
+    return traj_fail(traj, filename, "corrupt header");
+  }
+  traj->ncols = hdr->ncols;
+
+  /* Read the name and units of each column. */
+  const char *str = bytes + sizeof(TRAJ_HEADER);
+  const char *end = bytes + hdr->header_size;
+  for (unsigned int c = 0; c < 2 * traj->ncols; c++) {
+    const char *nul = (const char *) memchr(str, 0, end - str);
+    if (! nul) {
+      return traj_fail(traj, filename, "corrupt column names");
+    }
+    if (c % 2) {
+      traj->units.push_back(str);
+    } else {
+      traj->names.push_back(str);
+    }
+    str = nul + 1;
+  }
+
+  /* Record the location of each chunk. */
+  traj->nrows = 0;
+  size_t offset = hdr->header_size;
+  while (offset < traj->size) {
+    if (traj->size - offset < sizeof(uint64_t)) {
+      return traj_fail(traj, filename, "truncated chunk");
+    }
+    uint64_t rows = *(const uint64_t *) (bytes + offset);
+    offset += sizeof(uint64_t);
+    /* Check the number of rows before calculating the size of the chunk,
+       so that the size cannot overflow. */
+    size_t row_len = (size_t) traj->ncols * sizeof(double);
+    if (rows > hdr->chunk_rows || rows > (traj->size - offset) / row_len) {
+      return traj_fail(traj, filename, "truncated chunk");
+    }
+    size_t len = (size_t) rows * row_len;
+
+    TRAJ_CHUNK chunk;
+    chunk.data = (const double *) (bytes + offset);
+    chunk.rows = (unsigned long) rows;
+    traj->chunks.push_back(chunk);
+    traj->nrows += chunk.rows;
+    offset += len;
+  }
+
+  return traj;
+}
+
+/**
+ * Closes a trajectory file. Any views of the data become invalid.
+ */
+extern "C" void traj_close(TRAJ_FILE *traj) {
+  if (! traj) {
+    return;
+  }
+  if (traj->base) {
+    munmap(traj->base, traj->size);
+  }
+  delete traj;
+}
+
+/**
+ * Returns the number of columns, including time.
+ */
+extern "C" unsigned int traj_ncols(const TRAJ_FILE *traj) {
+  return traj->ncols;
+}
+
+/**
+ * Returns the total number of rows.
+ */
+extern "C" unsigned long traj_nrows(const TRAJ_FILE *traj) {
+  return traj->nrows;
+}
+
+/**
+ * Returns the number of chunks.
+ */
+extern "C" unsigned int traj_nchunks(const TRAJ_FILE *traj) {
+  return traj->chunks.size();
+}
+
+/**
+ * Returns the name of a column, or \c NULL if the column does not exist.
+ */
+extern "C" const char * traj_name(const TRAJ_FILE *traj, unsigned int col) {
+  return (col < traj->ncols) ? traj->names[col] : NULL;
+}
+
+/**
+ * Returns the units of a column (an empty string if they are unknown), or
+ * \c NULL if the column does not exist.
+ */
+extern "C" const char * traj_units(const TRAJ_FILE *traj, unsigned int col) {
+  return (col < traj->ncols) ? traj->units[col] : NULL;
+}
+
+/**
+ * Returns the index of the column with the given name, or -1 if there is no
+ * such column.
+ */
+extern "C" int traj_find(const TRAJ_FILE *traj, const char *name) {
+  for (unsigned int c = 0; c < traj->ncols; c++) {
+    if (! strcmp(traj->names[c], name)) {
+      return (int) c;
+    }
+  }
+  return -1;
+}
+
+/**
+ * Returns a view of a single column of a single chunk. The data is not copied
+ * and remains valid until the trajectory is closed.
+ *
+ * @param[in] traj The trajectory.
+ * @param[in] chunk The index of the chunk.
+ * @param[in] col The index of the column.
+ * @param[out] rows The number of values in the view (may be \c NULL).
+ *
+ * @return The first value in the view, or \c NULL if the chunk or column does
+ *         not exist.
+ */
+extern "C" const double * traj_chunk(const TRAJ_FILE *traj, unsigned int chunk,
+                                     unsigned int col, unsigned long *rows) {
+  if (chunk >= traj->chunks.size() || col >= traj->ncols) {
+    return NULL;
+  }
+  const TRAJ_CHUNK &ch = traj->chunks[chunk];
+  if (rows) {
+    *rows = ch.rows;
+  }
+  return ch.data + col * ch.rows;
+}
+
+/**
+ * Returns a view of an entire column, which is only possible when the
+ * trajectory consists of a single chunk; otherwise, use traj_chunk() or
+ * traj_copy().
+ *
+ * @return The first value in the column, or \c NULL if the column does not
+ *         exist or spans multiple chunks.
+ */
+extern "C" const double * traj_column(const TRAJ_FILE *traj, unsigned int col) {
+  if (traj->chunks.size() != 1) {
+    return NULL;
+  }
+  return traj_chunk(traj, 0, col, NULL);
+}
+
+/**
+ * Copies a contiguous range of values from a single column.
+ *
+ * @param[in] traj The trajectory.
+ * @param[in] col The index of the column.
+ * @param[in] start The index of the first row to copy.
+ * @param[in] count The number of rows to copy.
+ * @param[out] out The array into which the values are copied.
+ *
+ * @return The number of values that were copied.
+ */
+extern "C" unsigned long traj_copy(const TRAJ_FILE *traj, unsigned int col,
+                                   unsigned long start, unsigned long count,
+                                   double *out) {
+  if (col >= traj->ncols) {
+    return 0;
+  }
+
+  unsigned long copied = 0;
+  unsigned long first = 0; /* The index of the first row in each chunk. */
+  for (size_t c = 0; c < traj->chunks.size() && copied < count; c++) {
+    const TRAJ_CHUNK &ch = traj->chunks[c];
+    if (start < first + ch.rows) {
+      unsigned long from = start - first;
+      unsigned long n = ch.rows - from;
+      if (n > count - copied) {
+        n = count - copied;
+      }
+      memcpy(out + copied, ch.data + col * ch.rows + from, n * sizeof(double));
+      copied += n;
+      start += n;
+    }
+    first += ch.rows;
+  }
+  return copied;
+}
@@ -0,0 +1,17 @@
+/** An open (memory-mapped) trajectory file. */
+struct TRAJ_FILE;
+
+extern "C" TRAJ_FILE * traj_open(const char *filename);
+extern "C" void traj_close(TRAJ_FILE *traj);
+extern "C" unsigned int traj_ncols(const TRAJ_FILE *traj);
+extern "C" unsigned long traj_nrows(const TRAJ_FILE *traj);
+extern "C" unsigned int traj_nchunks(const TRAJ_FILE *traj);
+extern "C" const char * traj_name(const TRAJ_FILE *traj, unsigned int col);
+extern "C" const char * traj_units(const TRAJ_FILE *traj, unsigned int col);
+extern "C" int traj_find(const TRAJ_FILE *traj, const char *name);
+extern "C" const double * traj_chunk(const TRAJ_FILE *traj, unsigned int chunk,
+                                     unsigned int col, unsigned long *rows);
+extern "C" const double * traj_column(const TRAJ_FILE *traj, unsigned int col);
+extern "C" unsigned long traj_copy(const TRAJ_FILE *traj, unsigned int col,
+                                   unsigned long start, unsigned long count,
+                                   double *out);
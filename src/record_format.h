@@ -0,0 +1,60 @@
+/**
+ * @file
+ * The layout of full-state recordings, which are written by instr_record()
+ * and read by the functions in read_record.cpp.
+ *
+ * A recording consists of a header, followed by a number of fixed-size
+ * chunks. All values are stored in the native byte order of the host.
+ *
+ * <b>Header:</b>
+ * - The magic string \c REC_MAGIC (8 bytes).
+ * - The fixed-size fields of \c REC_HEADER.
+ * - The name of each state variable and then each parameter, in the order
+ *   that they appear in the VARS and PARAMS structs, each stored as a
+ *   NUL-terminated string.
+ * - Padding, so that the header size is a multiple of the page size (so that
+ *   each chunk can be memory-mapped).
+ *
+ * <b>Chunk:</b>
+ * - The number of bytes used in this chunk, including this field (uint64).
+ * - A sequence of records, one per notification of the model state.
+ *
+ * <b>Record:</b>
+ * Each record is the state variables followed by the parameters, where each
+ * value is stored as the bitwise XOR of the value and the previous value of
+ * the same field. The first record in each chunk is a keyframe, which is
+ * encoded relative to zero so that each chunk can be decoded on its own.
+ * - For each field, a 4-bit count (0 to 8) of the number of low-order bytes
+ *   that are needed to store the XOR (a count of zero means that the field
+ *   has not changed). Two counts are packed into each byte, with the first
+ *   field in the low 4 bits.
+ * - For each field, the low-order bytes of the XOR (least significant first).
+ */
+
+#include <stdint.h>
+
+/** The magic string that identifies a recording. */
+#define REC_MAGIC "G92REC"
+/** The length of the magic string, including the terminating NUL. */
+#define REC_MAGIC_LEN 8
+/** The version of the recording format. */
+#define REC_VERSION 1
+/** The size of each chunk (bytes); this must be a multiple of the page size. */
+#define REC_CHUNK_SIZE (1 << 20)
+/** The size of the field that stores the number of bytes used in a chunk. */
+#define REC_CHUNK_HDR sizeof(uint64_t)
+
+/** The fixed-size portion of the recording header. */
+struct REC_HEADER {
+  char magic[REC_MAGIC_LEN]; /** The magic string (REC_MAGIC). */
+  uint32_t version; /** The format version (REC_VERSION). */
+  uint32_t var_count; /** The number of state variables. */
+  uint32_t param_count; /** The number of parameters. */
+  uint32_t header_size; /** The size of the entire header (bytes). */
+  uint64_t chunk_size; /** The size of each chunk (bytes). */
+  uint64_t chunks; /** The number of chunks. */
+  uint64_t records; /** The number of records. */
+};
+
+/** The maximum size of a record with the given number of fields. */
+#define REC_MAX_SIZE(fields) (((fields) + 1) / 2 + 8 * (fields))
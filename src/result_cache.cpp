@@ -0,0 +1,567 @@
+/**
+ * @file
+ * A content-addressed cache of simulation results, so that an experiment
+ * which has already been run need not be simulated again.
+ *
+ * Each result is the complete text output of a simulation, and is stored in
+ * a file whose name is derived from everything that determines the output:
+ * the canonical form of the experiment (see Experiment::write_exp()), the
+ * initial parameters and state variables, the command-line options, and the
+ * model engine itself (its source code, compiler and compiler flags). Any
+ * change to the model therefore invalidates every cached result.
+ *
+ * Simulations of experiments also save checkpoints (the model state and the
+ * output so far) immediately before some of the scheduled parameter
+ * changes. Each checkpoint is identified by the part of the experiment that
+ * precedes it, so when an experiment is edited, the simulation resumes from
+ * the last checkpoint before the first change that was edited.
+ *
+ * The cache directory is given by the environment variable GUYTON92_CACHE,
+ * or is "guyton92" in the user's cache directory ($XDG_CACHE_HOME, or
+ * ~/.cache). Once the cache exceeds its size limit, the least recently used
+ * results are removed.
+ */
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <algorithm>
+#include <map>
+#include <list>
+#include <queue>
+#include <cfloat>
+#include <vector>
+#include <string>
+
+#include <dirent.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <utime.h>
+#include <sys/stat.h>
+
+using namespace std;
+
+#include "params.h"
+#include "vars.h"
+#include "read_exp.h"
+#include "filter_times.h"
+#include "instr_vars.h"
+#include "baseline.h"
+#include "result_cache.h"
+
+/**
+ * The identity of the model engine, which is defined by the Makefile as a
+ * checksum of the model source code and the compiler flags. This is always
+ * an unsigned long, whatever its value, so that the profiled and optimised
+ * builds of the release target (which have different checksums) are
+ * identical other than this value.
+ */
+#ifndef ENGINE_ID
+#define ENGINE_ID 0UL
+#endif
+
+/** The version of the cache format, which is included in every key. */
+#define RESULT_VERSION 1
+
+/** The magic string that identifies a checkpoint file. */
+#define CKPT_MAGIC "G92CKPT"
+/** The length of the magic string, including the terminating NUL. */
+#define CKPT_MAGIC_LEN 8
+
+/** Temporary files older than this (secs) belong to failed simulations. */
+#define RESULT_STALE (60 * 60 * 24)
+
+/**
+ * A stream buffer that writes all output to two other stream buffers.
+ */
+class TeeBuf : public std::streambuf {
+private:
+  std::streambuf *out; /** The original output. */
+  std::streambuf *copy; /** The copy of the output. */
+public:
+  TeeBuf(std::streambuf *out, std::streambuf *copy) : out(out), copy(copy) {}
+protected:
+  int overflow(int c) {
+    if (traits_type::eq_int_type(c, traits_type::eof())) {
+      return traits_type::not_eof(c);
+    }
+    copy->sputc((char) c);
+    return out->sputc((char) c);
+  }
+  std::streamsize xsputn(const char *s, std::streamsize n) {
+    copy->sputn(s, n);
+    return out->sputn(s, n);
+  }
+  int sync() {
+    copy->pubsync();
+    return out->pubsync();
+  }
+};
+
+/**
+ * This struct type stores the state of a result that is being captured.
+ */
+struct RESULT_CAPTURE {
+  std::ostream *out; /** The captured output stream. */
+  std::streambuf *orig; /** The original buffer of the output stream. */
+  TeeBuf *tee; /** The buffer that copies the output to the file. */
+  std::ofstream file; /** The file that will hold the result. */
+  std::string dir; /** The cache directory. */
+  std::string tmp; /** The name of the file while it is being written. */
+  std::string path; /** The name of the file once it is complete. */
+};
+
+/**
+ * This struct type stores the checkpoints of a simulation, and the output
+ * of the simulation so far.
+ */
+struct RESULT_CHECKPOINTS {
+  std::string dir; /** The cache directory. */
+  std::vector<uint64_t> keys; /** The key for each set of changes. */
+  double interval; /** The minimum time between checkpoints (mins). */
+  double last; /** The time of the most recent checkpoint (mins). */
+  std::ostream *out; /** The captured output stream. */
+  std::streambuf *orig; /** The original buffer of the output stream. */
+  TeeBuf *tee; /** The buffer that copies the output to the text. */
+  std::ostringstream text; /** The output of the simulation so far. */
+};
+
+/**
+ * The fixed-size header of a checkpoint file, which is followed by the
+ * model parameters, the state variables and the output so far.
+ */
+struct CKPT_HEADER {
+  char magic[CKPT_MAGIC_LEN]; /** The magic string (CKPT_MAGIC). */
+  uint32_t params; /** The size of the PARAMS struct (bytes). */
+  uint32_t vars; /** The size of the VARS struct (bytes). */
+  int32_t index; /** The number of output times that have passed. */
+  uint32_t pad; /** Padding, which is always zero. */
+  uint64_t text; /** The length of the output so far (bytes). */
+};
+
+/**
+ * Returns the name of the file that holds a cached result or checkpoint.
+ */
+static string result_path(const string &dir, uint64_t key,
+                          const char *ext = "out") {
+  char name[40];
+  snprintf(name, sizeof(name), "/%016llx.%s", (unsigned long long) key, ext);
+  return dir + name;
+}
+
+/**
+ * Returns whether a file name ends with the given extension.
+ */
+static bool has_ext(const string &name, const char *ext) {
+  size_t len = strlen(ext);
+  return name.size() > len && name.compare(name.size() - len, len, ext) == 0;
+}
+
+/**
+ * Creates a directory and any missing parent directories.
+ *
+ * @return \c true if the directory exists, otherwise \c false.
+ */
+static bool make_dirs(const string &dir) {
+  for (size_t pos = dir.find('/', 1); pos != string::npos;
+       pos = dir.find('/', pos + 1)) {
+    mkdir(dir.substr(0, pos).c_str(), 0755);
+  }
+  mkdir(dir.c_str(), 0755);
+  struct stat st;
+  return stat(dir.c_str(), &st) == 0 && S_ISDIR(st.st_mode);
+}
+
+/**
+ * Returns the cache directory, or an empty string if there is none.
+ */
+string result_cache_dir() {
+  const char *env = getenv("GUYTON92_CACHE");
+  if (env && *env) {
+    return env;
+  }
+  env = getenv("XDG_CACHE_HOME");
+  if (env && *env) {
+    return string(env) + "/guyton92";
+  }
+  env = getenv("HOME");
+  if (env && *env) {
+    return string(env) + "/.cache/guyton92";
+  }
+  return "";
+}
+
+/**
+ * Returns the key that identifies the result of a simulation.
+ *
+ * @param[in] p The initial model parameters.
+ * @param[in] v The initial state variables.
+ * @param[in] exp The canonical form of the experiment (if any).
+ * @param[in] opts The command-line options that affect the output.
+ */
+uint64_t result_key(const PARAMS &p, const VARS &v, const string &exp,
+                    const vector<string> &opts) {
+  ostringstream engine;
+  engine << RESULT_VERSION << " " << ENGINE_ID << " " << __VERSION__;
+  string id = engine.str();
+
+  uint64_t hash = baseline_hash(0, id.c_str(), id.size() + 1);
+  hash = baseline_hash(hash, exp.c_str(), exp.size() + 1);
+  for (size_t i = 0; i < opts.size(); i++) {
+    hash = baseline_hash(hash, opts[i].c_str(), opts[i].size() + 1);
+  }
+  hash = baseline_hash(hash, &p, sizeof(PARAMS));
+  return baseline_hash(hash, &v, sizeof(VARS));
+}
+
+/**
+ * Writes a cached result to an output stream, if it exists.
+ *
+ * @param[in] dir The cache directory.
+ * @param[in] key The key that identifies the result (see result_key()).
+ * @param[in] out The output stream.
+ *
+ * @return \c true if the result was cached, otherwise \c false.
+ */
+bool result_fetch(const string &dir, uint64_t key, ostream &out) {
+  if (dir.empty()) {
+    return false;
+  }
+  string path = result_path(dir, key);
+  ifstream file(path.c_str(), ios::in | ios::binary);
+  if (! file) {
+    return false;
+  }
+
+  /* Mark the result as recently used. */
+  utime(path.c_str(), NULL);
+  if (file.peek() != EOF) {
+    out << file.rdbuf();
+  }
+  out.flush();
+  return true;
+}
+
+/**
+ * Starts to capture everything that is written to an output stream, so that
+ * it can be added to the cache (see result_commit()). The output is still
+ * written to the stream as normal.
+ *
+ * @param[in] dir The cache directory.
+ * @param[in] key The key that identifies the result (see result_key()).
+ * @param[in] out The output stream.
+ *
+ * @return The state of the capture, or \c NULL if the result cannot be
+ *         cached.
+ */
+void *result_capture(const string &dir, uint64_t key, ostream &out) {
+  if (dir.empty() || ! make_dirs(dir)) {
+    return NULL;
+  }
+
+  RESULT_CAPTURE *cap = new RESULT_CAPTURE;
+  cap->dir = dir;
+  cap->path = result_path(dir, key);
+  ostringstream tmp;
+  tmp << cap->path << "." << getpid() << ".tmp";
+  cap->tmp = tmp.str();
+  cap->file.open(cap->tmp.c_str(), ios::out | ios::binary | ios::trunc);
+  if (! cap->file) {
+    delete cap;
+    return NULL;
+  }
+
+  out.flush();
+  cap->out = &out;
+  cap->orig = out.rdbuf();
+  cap->tee = new TeeBuf(cap->orig, cap->file.rdbuf());
+  out.rdbuf(cap->tee);
+  return (void *) cap;
+}
+
+/**
+ * Stops capturing an output stream and adds the captured output to the
+ * cache, then removes the least recently used results if the cache has
+ * grown too large.
+ *
+ * @param[in] data The state of the capture (see result_capture()).
+ * @param[in] limit The maximum size of the cache (bytes).
+ */
+void result_commit(void *data, unsigned long limit) {
+  RESULT_CAPTURE *cap = (RESULT_CAPTURE *) data;
+  if (! cap) {
+    return;
+  }
+
+  cap->out->flush();
+  cap->out->rdbuf(cap->orig);
+  delete cap->tee;
+  cap->file.close();
+
+  /* Only complete results are visible to other processes. */
+  if (cap->file.fail() || rename(cap->tmp.c_str(), cap->path.c_str()) != 0) {
+    unlink(cap->tmp.c_str());
+  } else {
+    result_evict(cap->dir, limit);
+  }
+  delete cap;
+}
+
+/**
+ * A cached result, as considered for eviction.
+ */
+struct RESULT_FILE {
+  std::string path; /** The name of the file. */
+  off_t size; /** The size of the file (bytes). */
+  time_t used; /** The time at which the result was last used. */
+};
+
+/**
+ * Orders cached results from the least to the most recently used.
+ */
+static bool used_before(const RESULT_FILE &a, const RESULT_FILE &b) {
+  return a.used < b.used;
+}
+
+/**
+ * Removes the least recently used results and checkpoints until the cache is
+ * no larger than the size limit. Temporary files that were left behind by
+ * simulations that did not finish are also removed.
+ *
+ * @param[in] dir The cache directory.
+ * @param[in] limit The maximum size of the cache (bytes).
+ */
+void result_evict(const string &dir, unsigned long limit) {
+  DIR *d = opendir(dir.c_str());
+  if (! d) {
+    return;
+  }
+
+  vector<RESULT_FILE> files;
+  unsigned long long total = 0;
+  time_t now = time(NULL);
+  struct dirent *ent;
+  while ((ent = readdir(d)) != NULL) {
+    string name(ent->d_name);
+    string path = dir + "/" + name;
+    struct stat st;
+    if (stat(path.c_str(), &st) != 0 || ! S_ISREG(st.st_mode)) {
+      continue;
+    }
+    if (has_ext(name, ".tmp")) {
+      if (now - st.st_mtime > RESULT_STALE) {
+        unlink(path.c_str());
+      }
+    } else if (has_ext(name, ".out") || has_ext(name, ".ckpt")) {
+      RESULT_FILE f;
+      f.path = path;
+      f.size = st.st_size;
+      f.used = st.st_mtime;
+      files.push_back(f);
+      total += (unsigned long long) st.st_size;
+    }
+  }
+  closedir(d);
+
+  sort(files.begin(), files.end(), used_before);
+  for (size_t i = 0; i < files.size() && total > limit; i++) {
+    if (unlink(files[i].path.c_str()) == 0) {
+      total -= (unsigned long long) files[i].size;
+    }
+  }
+}
+
+/**
+ * Prepares to save (and resume from) checkpoints of a simulation. Everything
+ * that is subsequently written to the output stream is retained, so that it
+ * can be saved in each checkpoint. This must be called before the
+ * simulation begins, and before any of the experiment's scheduled changes
+ * have been applied.
+ *
+ * @param[in] dir The cache directory.
+ * @param[in] key The key that identifies everything, other than the
+ *                experiment's scheduled changes, that determines the
+ *                output (see result_key()).
+ * @param[in] e The experiment.
+ * @param[in] interval The minimum time between checkpoints (mins).
+ * @param[in] out The output stream.
+ *
+ * @return The checkpoints, or \c NULL if checkpoints cannot be saved.
+ */
+void *result_checkpoints(const string &dir, uint64_t key, const Experiment *e,
+                         double interval, ostream &out) {
+  if (dir.empty() || ! e || ! make_dirs(dir)) {
+    return NULL;
+  }
+
+  RESULT_CHECKPOINTS *cps = new RESULT_CHECKPOINTS;
+  cps->dir = dir;
+  cps->interval = interval;
+  cps->last = 0;
+
+  /* The state before each set of changes is identified by the time of the
+     changes and by every preceding set of changes. */
+  param_changes cs(e->schedule());
+  uint64_t hash = key;
+  while (! cs.empty()) {
+    PARAM_CHANGES cx = cs.front();
+    cs.pop();
+    cps->keys.push_back(baseline_hash(hash, &cx.at_time, sizeof(double)));
+
+    ostringstream defn;
+    defn.precision(17);
+    defn << "t= " << cx.at_time << endl;
+    Experiment::write_changes(defn, cx);
+    string str = defn.str();
+    hash = baseline_hash(hash, str.c_str(), str.size());
+  }
+
+  out.flush();
+  cps->out = &out;
+  cps->orig = out.rdbuf();
+  cps->tee = new TeeBuf(cps->orig, cps->text.rdbuf());
+  out.rdbuf(cps->tee);
+  return (void *) cps;
+}
+
+/**
+ * Resumes a simulation from the latest checkpoint that is consistent with
+ * the experiment, if there is one. The output of the simulation up to the
+ * checkpoint is written to the output stream.
+ *
+ * @param[in] data The checkpoints (see result_checkpoints()).
+ * @param[out] p The model parameters.
+ * @param[out] v The state variables.
+ * @param[in] e The experiment.
+ * @param[in] times_opts The options for the output filter (see
+ *                       filter_times_opts()).
+ * @param[in] text_opts The options for the output instrument (see
+ *                      instr_vars_opts()).
+ *
+ * @return \c true if the simulation was resumed, otherwise \c false.
+ */
+bool result_resume(void *data, PARAMS &p, VARS &v, Experiment *e,
+                   void *times_opts, void *text_opts) {
+  RESULT_CHECKPOINTS *cps = (RESULT_CHECKPOINTS *) data;
+  if (! cps) {
+    return false;
+  }
+
+  for (size_t k = cps->keys.size(); k-- > 1; ) {
+    string path = result_path(cps->dir, cps->keys[k], "ckpt");
+    ifstream file(path.c_str(), ios::in | ios::binary);
+    if (! file) {
+      continue;
+    }
+
+    CKPT_HEADER hdr;
+    PARAMS cp;
+    VARS cv;
+    file.read((char *) &hdr, sizeof(hdr));
+    if (! file || strncmp(hdr.magic, CKPT_MAGIC, CKPT_MAGIC_LEN)
+        || hdr.params != sizeof(PARAMS) || hdr.vars != sizeof(VARS)) {
+      continue;
+    }
+    file.read((char *) &cp, sizeof(PARAMS));
+    file.read((char *) &cv, sizeof(VARS));
+    string text(hdr.text, '\0');
+    if (hdr.text > 0) {
+      file.read(&text[0], (streamsize) hdr.text);
+    }
+    if (! file) {
+      continue;
+    }
+
+    /* Mark the checkpoint as recently used. */
+    utime(path.c_str(), NULL);
+
+    memcpy(&p, &cp, sizeof(PARAMS));
+    memcpy(&v, &cv, sizeof(VARS));
+    e->skip_events(k);
+    filter_times_seek(times_opts, hdr.index);
+    if (! text.empty()) {
+      instr_vars_skip_header(text_opts);
+    }
+    *cps->out << text;
+    cps->last = v.t;
+    return true;
+  }
+
+  return false;
+}
+
+/**
+ * Saves a checkpoint of the simulation if the next set of scheduled changes
+ * is about to be applied, unless a checkpoint was saved too recently. This
+ * should be called before each time-step.
+ *
+ * @param[in] data The checkpoints (see result_checkpoints()).
+ * @param[in] p The model parameters.
+ * @param[in] v The state variables.
+ * @param[in] e The experiment.
+ * @param[in] times_opts The options for the output filter (see
+ *                       filter_times_opts()).
+ */
+void result_checkpoint(void *data, const PARAMS &p, const VARS &v,
+                       const Experiment *e, void *times_opts) {
+  RESULT_CHECKPOINTS *cps = (RESULT_CHECKPOINTS *) data;
+  if (! cps || e->next_event() > v.t || v.t - cps->last < cps->interval) {
+    return;
+  }
+  size_t k = e->events_applied();
+  if (k < 1 || k >= cps->keys.size()) {
+    return;
+  }
+  cps->last = v.t;
+
+  string path = result_path(cps->dir, cps->keys[k], "ckpt");
+  ostringstream tmp;
+  tmp << path << "." << getpid() << ".tmp";
+  ofstream file(tmp.str().c_str(), ios::out | ios::binary | ios::trunc);
+  if (! file) {
+    return;
+  }
+
+  cps->out->flush();
+  string text = cps->text.str();
+  CKPT_HEADER hdr;
+  memset(&hdr, 0, sizeof(hdr));
+  strncpy(hdr.magic, CKPT_MAGIC, CKPT_MAGIC_LEN);
+  hdr.params = sizeof(PARAMS);
+  hdr.vars = sizeof(VARS);
+  hdr.index = filter_times_index(times_opts);
+  hdr.text = text.size();
+  file.write((const char *) &hdr, sizeof(hdr));
+  file.write((const char *) &p, sizeof(PARAMS));
+  file.write((const char *) &v, sizeof(VARS));
+  file.write(text.data(), (streamsize) text.size());
+  file.close();
+
+  /* Only complete checkpoints are visible to other processes. */
+  if (file.fail() || rename(tmp.str().c_str(), path.c_str()) != 0) {
+    unlink(tmp.str().c_str());
+  }
+}
+
+/**
+ * Stops retaining the output of a simulation, and removes the least recently
+ * used results and checkpoints if the cache has grown too large.
+ *
+ * @param[in] data The checkpoints (see result_checkpoints()).
+ * @param[in] limit The maximum size of the cache (bytes).
+ */
+void result_checkpoints_close(void *data, unsigned long limit) {
+  RESULT_CHECKPOINTS *cps = (RESULT_CHECKPOINTS *) data;
+  if (! cps) {
+    return;
+  }
+
+  cps->out->flush();
+  cps->out->rdbuf(cps->orig);
+  delete cps->tee;
+  result_evict(cps->dir, limit);
+  delete cps;
+}
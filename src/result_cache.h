@@ -0,0 +1,15 @@
+std::string result_cache_dir();
+uint64_t result_key(const PARAMS &p, const VARS &v, const std::string &exp,
+                    const std::vector<std::string> &opts);
+bool result_fetch(const std::string &dir, uint64_t key, std::ostream &out);
+void *result_capture(const std::string &dir, uint64_t key, std::ostream &out);
+void result_commit(void *data, unsigned long limit);
+void result_evict(const std::string &dir, unsigned long limit);
+void *result_checkpoints(const std::string &dir, uint64_t key,
+                         const Experiment *e, double interval,
+                         std::ostream &out);
+bool result_resume(void *data, PARAMS &p, VARS &v, Experiment *e,
+                   void *times_opts, void *text_opts);
+void result_checkpoint(void *data, const PARAMS &p, const VARS &v,
+                       const Experiment *e, void *times_opts);
+void result_checkpoints_close(void *data, unsigned long limit);
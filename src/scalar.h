@@ -0,0 +1,273 @@
+/**
+ * The number of derivatives that are carried by each DUAL number.
+ */
+#define DUAL_WIDTH 8
+
+/**
+ * A forward-mode dual number: a value and its derivatives with respect to
+ * (up to) DUAL_WIDTH inputs. Instantiating the model equations with this
+ * type propagates the derivatives alongside the values (see gradient.cpp).
+ */
+struct DUAL {
+  double v; /** The value. */
+  double d[DUAL_WIDTH]; /** The derivative with respect to each input. */
+
+  DUAL() {}
+  DUAL(double x) : v(x) {
+    for (int k = 0; k < DUAL_WIDTH; k++) {
+      d[k] = 0;
+    }
+  }
+};
+
+/**
+ * Returns a dual number whose derivatives are a linear combination of those
+ * of two other dual numbers (either of which may be \c NULL). A zero
+ * derivative contributes nothing, even if the partial derivative is infinite
+ * (eg, pow(x, 0.5) at x = 0), as per constants in reverse mode (see ADJ).
+ */
+inline DUAL dual_chain(double v, const DUAL *a, double da, const DUAL *b,
+                       double db) {
+  DUAL r;
+  r.v = v;
+  for (int k = 0; k < DUAL_WIDTH; k++) {
+    r.d[k] = (a && a->d[k] != 0 ? da * a->d[k] : 0)
+      + (b && b->d[k] != 0 ? db * b->d[k] : 0);
+  }
+  return r;
+}
+
+inline DUAL operator+(const DUAL &a, const DUAL &b) {
+  return dual_chain(a.v + b.v, &a, 1, &b, 1);
+}
+inline DUAL operator+(const DUAL &a, double b) {
+  return dual_chain(a.v + b, &a, 1, 0, 0);
+}
+inline DUAL operator+(double a, const DUAL &b) {
+  return dual_chain(a + b.v, &b, 1, 0, 0);
+}
+inline DUAL operator-(const DUAL &a, const DUAL &b) {
+  return dual_chain(a.v - b.v, &a, 1, &b, -1);
+}
+inline DUAL operator-(const DUAL &a, double b) {
+  return dual_chain(a.v - b, &a, 1, 0, 0);
+}
+inline DUAL operator-(double a, const DUAL &b) {
+  return dual_chain(a - b.v, &b, -1, 0, 0);
+}
+inline DUAL operator-(const DUAL &a) {
+  return dual_chain(- a.v, &a, -1, 0, 0);
+}
+inline DUAL operator*(const DUAL &a, const DUAL &b) {
+  return dual_chain(a.v * b.v, &a, b.v, &b, a.v);
+}
+inline DUAL operator*(const DUAL &a, double b) {
+  return dual_chain(a.v * b, &a, b, 0, 0);
+}
+inline DUAL operator*(double a, const DUAL &b) {
+  return dual_chain(a * b.v, &b, a, 0, 0);
+}
+inline DUAL operator/(const DUAL &a, const DUAL &b) {
+  return dual_chain(a.v / b.v, &a, 1 / b.v, &b, - a.v / (b.v * b.v));
+}
+inline DUAL operator/(const DUAL &a, double b) {
+  return dual_chain(a.v / b, &a, 1 / b, 0, 0);
+}
+inline DUAL operator/(double a, const DUAL &b) {
+  return dual_chain(a / b.v, &b, - a / (b.v * b.v), 0, 0);
+}
+inline DUAL &operator+=(DUAL &a, const DUAL &b) { return a = a + b; }
+inline DUAL &operator-=(DUAL &a, const DUAL &b) { return a = a - b; }
+inline DUAL &operator*=(DUAL &a, const DUAL &b) { return a = a * b; }
+inline DUAL &operator/=(DUAL &a, const DUAL &b) { return a = a / b; }
+
+inline DUAL pow(const DUAL &a, double b) {
+  double r = ::pow(a.v, b);
+  return dual_chain(r, &a, (b == 0) ? 0 : b * ::pow(a.v, b - 1), 0, 0);
+}
+inline DUAL pow(double a, const DUAL &b) {
+  double r = ::pow(a, b.v);
+  return dual_chain(r, &b, (r == 0) ? 0 : r * ::log(a), 0, 0);
+}
+inline DUAL pow(const DUAL &a, const DUAL &b) {
+  double r = ::pow(a.v, b.v);
+  return dual_chain(r, &a, (b.v == 0) ? 0 : b.v * ::pow(a.v, b.v - 1),
+                    &b, (r == 0) ? 0 : r * ::log(a.v));
+}
+inline DUAL exp(const DUAL &a) {
+  double r = ::exp(a.v);
+  return dual_chain(r, &a, r, 0, 0);
+}
+inline DUAL fabs(const DUAL &a) {
+  return dual_chain(::fabs(a.v), &a, (a.v < 0) ? -1 : 1, 0, 0);
+}
+
+/**
+ * A node of the tape that is recorded by reverse-mode (ADJ) arithmetic: the
+ * (up to two) operands of an operation, and the partial derivative of the
+ * result with respect to each operand. An operand index of -1 denotes an
+ * operand that does not depend on any input.
+ */
+struct ADJ_NODE {
+  long a; /** The tape index of the first operand. */
+  long b; /** The tape index of the second operand. */
+  double da; /** The partial derivative with respect to the first operand. */
+  double db; /** The partial derivative with respect to the second operand. */
+};
+
+/** The tape that is recorded by reverse-mode (ADJ) arithmetic. */
+struct ADJ_TAPE {
+  ADJ_NODE *nodes; /** The recorded operations, in order. */
+  long size; /** The number of recorded operations. */
+  long capacity; /** The number of operations that can be recorded. */
+};
+
+/** The tape to which the current thread records ADJ arithmetic. */
+extern __thread ADJ_TAPE *adj_tape;
+void adj_tape_grow(ADJ_TAPE *tape);
+
+/**
+ * A reverse-mode (adjoint) number: a value and the index of the operation on
+ * the current tape (see adj_tape) that produced it. Instantiating the model
+ * equations with this type records each time-step, so that the derivatives of
+ * its outputs can be propagated back to its inputs (see gradient.cpp).
+ */
+struct ADJ {
+  double v; /** The value. */
+  long i; /** The tape index, or -1 if the value is a constant. */
+
+  ADJ() : v(0), i(-1) {}
+  ADJ(double x) : v(x), i(-1) {}
+};
+
+/**
+ * Returns an adjoint number that is the result of an operation with (up to)
+ * two operands, and records the operation on the tape if the result depends
+ * on any input.
+ */
+inline ADJ adj_chain(double v, long a, double da, long b, double db) {
+  ADJ r(v);
+  if (a >= 0 || b >= 0) {
+    ADJ_TAPE *t = adj_tape;
+    if (t->size == t->capacity) {
+      adj_tape_grow(t);
+    }
+    ADJ_NODE &n = t->nodes[t->size];
+    n.a = a;
+    n.b = b;
+    n.da = da;
+    n.db = db;
+    r.i = t->size++;
+  }
+  return r;
+}
+
+inline ADJ operator+(const ADJ &a, const ADJ &b) {
+  return adj_chain(a.v + b.v, a.i, 1, b.i, 1);
+}
+inline ADJ operator+(const ADJ &a, double b) {
+  return adj_chain(a.v + b, a.i, 1, -1, 0);
+}
+inline ADJ operator+(double a, const ADJ &b) {
+  return adj_chain(a + b.v, b.i, 1, -1, 0);
+}
+inline ADJ operator-(const ADJ &a, const ADJ &b) {
+  return adj_chain(a.v - b.v, a.i, 1, b.i, -1);
+}
+inline ADJ operator-(const ADJ &a, double b) {
+  return adj_chain(a.v - b, a.i, 1, -1, 0);
+}
+inline ADJ operator-(double a, const ADJ &b) {
+  return adj_chain(a - b.v, b.i, -1, -1, 0);
+}
+inline ADJ operator-(const ADJ &a) {
+  return adj_chain(- a.v, a.i, -1, -1, 0);
+}
+inline ADJ operator*(const ADJ &a, const ADJ &b) {
+  return adj_chain(a.v * b.v, a.i, b.v, b.i, a.v);
+}
+inline ADJ operator*(const ADJ &a, double b) {
+  return adj_chain(a.v * b, a.i, b, -1, 0);
+}
+inline ADJ operator*(double a, const ADJ &b) {
+  return adj_chain(a * b.v, b.i, a, -1, 0);
+}
+inline ADJ operator/(const ADJ &a, const ADJ &b) {
+  return adj_chain(a.v / b.v, a.i, 1 / b.v, b.i, - a.v / (b.v * b.v));
+}
+inline ADJ operator/(const ADJ &a, double b) {
+  return adj_chain(a.v / b, a.i, 1 / b, -1, 0);
+}
+inline ADJ operator/(double a, const ADJ &b) {
+  return adj_chain(a / b.v, b.i, - a / (b.v * b.v), -1, 0);
+}
+inline ADJ &operator+=(ADJ &a, const ADJ &b) { return a = a + b; }
+inline ADJ &operator-=(ADJ &a, const ADJ &b) { return a = a - b; }
+inline ADJ &operator*=(ADJ &a, const ADJ &b) { return a = a * b; }
+inline ADJ &operator/=(ADJ &a, const ADJ &b) { return a = a / b; }
+
+inline ADJ pow(const ADJ &a, double b) {
+  double r = ::pow(a.v, b);
+  return adj_chain(r, a.i, (b == 0) ? 0 : b * ::pow(a.v, b - 1), -1, 0);
+}
+inline ADJ pow(double a, const ADJ &b) {
+  double r = ::pow(a, b.v);
+  return adj_chain(r, b.i, (r == 0) ? 0 : r * ::log(a), -1, 0);
+}
+inline ADJ pow(const ADJ &a, const ADJ &b) {
+  double r = ::pow(a.v, b.v);
+  return adj_chain(r, a.i, (b.v == 0) ? 0 : b.v * ::pow(a.v, b.v - 1),
+                   b.i, (r == 0) ? 0 : r * ::log(a.v));
+}
+inline ADJ exp(const ADJ &a) {
+  double r = ::exp(a.v);
+  return adj_chain(r, a.i, r, -1, 0);
+}
+inline ADJ fabs(const ADJ &a) {
+  return adj_chain(::fabs(a.v), a.i, (a.v < 0) ? -1 : 1, -1, 0);
+}
+
+/**
+ * Defines the comparison operators for a scalar type whose value is the
+ * member \c v, so that the model equations take the same branches for every
+ * scalar type.
+ */
+#define SCALAR_COMPARE(T, OP) \
+  inline bool operator OP(const T &a, const T &b) { return a.v OP b.v; } \
+  inline bool operator OP(const T &a, double b) { return a.v OP b; } \
+  inline bool operator OP(double a, const T &b) { return a OP b.v; }
+#define SCALAR_COMPARISONS(T) \
+  SCALAR_COMPARE(T, <) SCALAR_COMPARE(T, <=) SCALAR_COMPARE(T, >) \
+  SCALAR_COMPARE(T, >=) SCALAR_COMPARE(T, ==) SCALAR_COMPARE(T, !=)
+SCALAR_COMPARISONS(DUAL)
+SCALAR_COMPARISONS(ADJ)
+
+/**
+ * Returns a value without its derivatives, so that the model equations treat
+ * it as a constant (eg, the size of each time-step; see module_autonom()).
+ */
+template <typename T>
+inline T scalar_const(const T &x) {
+  return x;
+}
+inline DUAL scalar_const(const DUAL &x) {
+  return DUAL(x.v);
+}
+inline ADJ scalar_const(const ADJ &x) {
+  return ADJ(x.v);
+}
+
+/**
+ * Invokes the macro \c X once for each scalar type with which the model
+ * equations are instantiated (see PARAMS_T and VARS_T). Each module defines
+ * its equations as a function template, and instantiates it for every type in
+ * this list, so that a new scalar type only needs to be added here.
+ *
+ * The \c double instantiation is the model itself; \c DUAL and \c ADJ
+ * propagate derivatives in forward and reverse mode, respectively (see
+ * gradient.cpp). Note that the equations contain data-dependent branches, so
+ * each scalar type must support ordinary comparisons; a SIMD type is
+ * supported by instantiating the equations once per lane, rather than by a
+ * vector of lanes.
+ */
+#define FOR_EACH_SCALAR(X) X(double) X(float) X(DUAL) X(ADJ)
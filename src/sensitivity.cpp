@@ -4,17 +4,31 @@
  * Guyton model. Note that these analyses do not take the remaining modules
  * into account and therefore will generally produce output that differs
  * greatly from that observed when simulating the entire Guyton model.
+ * Reduced models that are composed of several modules (eg, "circulation",
+ * see pipeline.h) can be analysed in the same manner, over a single
+ * time-step.
+ *
+ * A module can be analysed over a grid of values for one or more controls,
+ * or over a Latin-hypercube sample of the controls. The points of each sweep
+ * are divided among several threads (see batch.cpp).
  */
 
 #include <cstdlib>
 #include <cstring>
+#include <cstdio>
 #include <iostream>
 #include <fstream>
+#include <sstream>
 #include <string>
+#include <vector>
 #include <map>
+#include <set>
+#include <algorithm>
+#include <cfloat>
 
 #include <sys/stat.h>
 #include <errno.h>
+#include <unistd.h>
 
 using namespace std;
 
@@ -24,8 +38,8 @@ using namespace std;
 /* Collect state variables into a single struct and allow the initial values
    to be specified in an external file. */
 #include "read_vars.h"
-
-#include "sensitivity.h"
+/* Run the points of each sweep in parallel. */
+#include "batch.h"
 
 /* Include all of the modules. */
 #include "module_renal.h"
@@ -47,10 +61,35 @@ using namespace std;
 #include "module_electro.h"
 #include "module_kidney.h"
 
+/* Include the experiments and the pipelines that are composed of modules. */
+#include "exp_rapidreg.h"
+#include "exp_transfuse.h"
+#include "exp_variants.h"
+#include "dataflow.h"
+#include "pipeline.h"
+
+#include "sensitivity.h"
+
+/**
+ * The maximum number of points in each block of a sweep.
+ */
+#define SWEEP_BLOCK 256
+
 /**
- * The map of module names to module functions.
+ * The number of blocks of a sweep that are assigned to each thread, so that
+ * the threads remain balanced.
  */
-map<string,modulefn> modules;
+#define SWEEP_BLOCKS_PER_THREAD 8
+
+/**
+ * The number of blocks of a sweep whose output is held in memory at once.
+ */
+#define SWEEP_CHUNK 256
+
+/**
+ * The map of module (and pipeline) names to module functions.
+ */
+map<string,SENS_MODULE> modules;
 
 /**
  * Determine whether a double is not a number (NaN) and therefore invalid.
@@ -61,6 +100,74 @@ inline bool isnan(double x) {
     return x != x;
 }
 
+/**
+ * Displays the command-line usage for the sensitivity analyser, then exits.
+ *
+ * @param progname The name of the program.
+ * @param exitcode The exit code to pass to exit().
+ */
+void usage(char *progname, int exitcode) {
+  cerr << "USAGE: " << progname;
+  cerr << " module_name param_name min_val incr max_val output(s) " << endl;
+  cerr << "       " << progname << " [options] module_name output(s)" << endl;
+  cerr << "\n  OPTIONS:" << endl;
+  cerr << "    -c NAME:MIN:INC:MAX " <<
+    "Sweep the control NAME over a grid of values. Repeat this" << endl;
+  cerr << "                        " <<
+    "option to sweep every combination of several controls." << endl;
+  cerr << "    -L N                " <<
+    "Sample N points from a Latin hypercube over the controls," << endl;
+  cerr << "                        " <<
+    "rather than a grid (INC may be omitted)." << endl;
+  cerr << "    -s SEED             " <<
+    "Seed the random number generator (default: 1)." << endl;
+  cerr << "    -f FILE             " <<
+    "Sweep each control in FILE separately; each line has the" << endl;
+  cerr << "                        " <<
+    "form 'control_name min_val incr max_val'." << endl;
+  cerr << "    -j N                " <<
+    "Use N threads (default: one per processor)." << endl;
+  cerr << "    -h                  " << "Display this help and exit." << endl;
+  cerr << "\n  A sweep of several controls is written to a single file, with "
+    "a column for" << endl;
+  cerr << "  each control, its normalised value and each output." << endl;
+  cerr << endl;
+  exit(exitcode);
+}
+
+/**
+ * Reads the definition of a control from a command-line argument of the form
+ * "NAME:MIN:INC:MAX" (or "NAME:MIN:MAX" for a Latin hypercube).
+ *
+ * @param[in] arg The command-line argument.
+ * @param[in] lhs Whether the increment may be omitted.
+ * @param[out] c The control.
+ *
+ * @return \c true if the control is valid, otherwise \c false.
+ */
+bool read_control(const char *arg, bool lhs, CONTROL &c) {
+  vector<double> vals;
+  istringstream ss(arg);
+  string field;
+  if (! getline(ss, c.name, ':') || c.name.empty()) {
+    return false;
+  }
+  while (getline(ss, field, ':')) {
+    double x;
+    if (1 != sscanf(field.c_str(), "%lf", &x)) {
+      return false;
+    }
+    vals.push_back(x);
+  }
+
+  if (vals.size() == 3) {
+    return init_control(c, c.name.c_str(), vals[0], vals[1], vals[2]);
+  } else if (vals.size() == 2 && lhs) {
+    return init_control(c, c.name.c_str(), vals[0], 0, vals[1]);
+  }
+  return false;
+}
+
 /**
  * The entry point for the sensitivity analysis program.
  *
@@ -68,148 +175,427 @@ inline bool isnan(double x) {
  * @param[in] argv The arguments provided on the command line.
  */
 int main(int argc, char *argv[]) {
-  /* Validate the command line arguments. In addition to the command there are:
-     an input name; minimum value; increment; maximum value; output name(s). */
-  if (argc < 7) {
-    cerr << "USAGE: " << argv[0];
-    cerr << " module_name param_name min_val incr max_val output(s) " << endl;
-    return EXIT_FAILURE;
+  SWEEP s;
+  vector<CONTROL> controls;
+  char *sweep_file = NULL;
+  unsigned long lhs_points = 0;
+  unsigned long seed = 1;
+  unsigned int threads = batch_threads();
+  vector<const char *> control_args;
+
+  /* Stop at the module name, so that negative values are not options. */
+  int c;
+  while ((c = getopt(argc, argv, "+hc:L:s:f:j:")) != -1) {
+    istringstream ss((optarg) ? optarg : "");
+    switch (c) {
+    case 'c':
+      control_args.push_back(optarg);
+      break;
+    case 'L':
+      if (! (ss >> lhs_points) || lhs_points < 1) {
+        cerr << "ERROR: Invalid number of points '" << optarg << "'" << endl;
+        usage(argv[0], EXIT_FAILURE);
+      }
+      break;
+    case 's':
+      if (! (ss >> seed)) {
+        cerr << "ERROR: Invalid seed '" << optarg << "'" << endl;
+        usage(argv[0], EXIT_FAILURE);
+      }
+      break;
+    case 'f':
+      sweep_file = optarg;
+      break;
+    case 'j':
+      if (! (ss >> threads) || threads < 1) {
+        cerr << "ERROR: Invalid number of threads '" << optarg << "'" << endl;
+        usage(argv[0], EXIT_FAILURE);
+      }
+      break;
+    case 'h':
+      usage(argv[0], EXIT_SUCCESS);
+      break;
+    default:
+      usage(argv[0], EXIT_FAILURE);
+      break;
+    }
+  }
+  for (size_t i = 0; i < control_args.size(); i++) {
+    CONTROL ctl;
+    if (! read_control(control_args[i], lhs_points > 0, ctl)) {
+      cerr << "ERROR: Invalid control '" << control_args[i] << "'" << endl;
+      usage(argv[0], EXIT_FAILURE);
+    }
+    controls.push_back(ctl);
   }
 
-  /* Extract the arguments. */
-  char* control_var = argv[2];
-  double min_val, inc_val, max_val;
-  char** outputs = &argv[6];
-  int output_count = argc - 6;
+  /* Without any options, the arguments define a single control. */
+  int first_output = optind + 1;
+  bool single = controls.empty() && ! sweep_file;
+  if (single) {
+    if (argc - optind < 6) {
+      usage(argv[0], EXIT_FAILURE);
+    }
+    double vals[3];
+    for (int i = 0; i < 3; i++) {
+      /* Check that the minimum, increment and maximum values of the control
+         parameter are valid. */
+      if (1 != sscanf(argv[optind + 2 + i], "%lf", &vals[i])) {
+        cerr << "ERROR: Incorrect numerical value '" << argv[optind + 2 + i]
+             << "'" << endl;
+        return EXIT_FAILURE;
+      }
+    }
+    CONTROL ctl;
+    if (! init_control(ctl, argv[optind + 1], vals[0], vals[1], vals[2])) {
+      cerr << "ERROR: Invalid control '" << argv[optind + 1] << "'" << endl;
+      return EXIT_FAILURE;
+    }
+    controls.push_back(ctl);
+    first_output = optind + 5;
+  } else if ((sweep_file && ! controls.empty()) || argc - optind < 2) {
+    usage(argv[0], EXIT_FAILURE);
+  }
 
-  /* Check that the minimum, increment and maximum values of the control
-     parameter are valid. */
-  if (1 != sscanf(argv[3], "%lf", &min_val)) {
-    cerr << "ERROR: Incorrect numerical value '" << argv[3] << "'" << endl;
+  /* Retrieve the function pointer for the specified module. */
+  init_modules();
+  string modname(argv[optind]);
+  if (modules.find(modname) == modules.end()) {
+    cerr << "ERROR: Unknown module '" << modname << "'" << endl;
     return EXIT_FAILURE;
   }
-  if (1 != sscanf(argv[4], "%lf", &inc_val)) {
-    cerr << "ERROR: Incorrect numerical value '" << argv[4] << "'" << endl;
-    return EXIT_FAILURE;
+  const SENS_MODULE &mod = modules[modname];
+  s.f = mod.f;
+
+  /* The outputs are always state variables. */
+  for (int i = first_output; i < argc; i++) {
+    int ix = var_index(argv[i]);
+    if (ix < 0) {
+      cerr << "ERROR: Unknown output '" << argv[i] << "'" << endl;
+      return EXIT_FAILURE;
+    }
+    if (mod.outputs.find(argv[i]) == mod.outputs.end()) {
+      cerr << "WARNING: output '" << argv[i] << "' is not assigned by '"
+           << modname << "'" << endl;
+    }
+    s.outputs.push_back(ix);
+    s.output_names.push_back(argv[i]);
   }
-  if (1 != sscanf(argv[5], "%lf", &max_val)) {
-    cerr << "ERROR: Incorrect numerical value '" << argv[5] << "'" << endl;
-    return EXIT_FAILURE;
+
+  /* Every sweep starts from the same default model state. */
+  PARAMS_INIT(s.p0);
+  VARS_INIT(s.v0);
+  s.threads = threads;
+
+  /* Each line of the sweep file defines a separate (1-D) sweep. */
+  vector<vector<CONTROL> > sweeps;
+  if (sweep_file) {
+    ifstream input(sweep_file);
+    if (input.fail()) {
+      cerr << "ERROR: Unable to open '" << sweep_file << "'" << endl;
+      return EXIT_FAILURE;
+    }
+    string line;
+    while (getline(input, line)) {
+      istringstream fields(line);
+      string name;
+      double vals[3];
+      if (! (fields >> name >> vals[0] >> vals[1] >> vals[2])) {
+        cerr << "ERROR: skipping invalid line '" << line << "'" << endl;
+        continue;
+      }
+      CONTROL ctl;
+      if (! init_control(ctl, name.c_str(), vals[0], vals[1], vals[2])) {
+        cerr << "ERROR: Invalid control '" << name << "'" << endl;
+        return EXIT_FAILURE;
+      }
+      sweeps.push_back(vector<CONTROL>(1, ctl));
+    }
+  } else {
+    sweeps.push_back(controls);
   }
 
-  /* Retrieve the function pointer for the specified module. */
-  init_modules();
-  string modname(argv[1]);
-  modulefn module = modules[modname];
-
-  /* The basename of the output files produced by this program. */
-  string basename (modname + "_" + control_var);
-
-  /* Analyse the module dynamics over the range of control values. */
-  string datafile (basename + ".ssv");
-  cout << datafile << " ... ";
-  cout.flush();
-  analyse(module, control_var, min_val, inc_val, max_val, outputs,
-          output_count, datafile);
-  cout << "done" << endl;
-
-  /* Create a gnuplot script to plot the results. */
-  string scriptfile (basename + ".gp");
-  cout << scriptfile << " ... ";
-  cout.flush();
-  gnuplot(control_var, output_count, scriptfile, datafile, basename + ".eps");
-  cout << "done" << endl;
+  unsigned short rng[3] = {0x330E, (unsigned short) seed,
+                           (unsigned short) (seed >> 16)};
+  for (size_t i = 0; i < sweeps.size(); i++) {
+    s.controls = sweeps[i];
+    s.design.clear();
+    if (lhs_points) {
+      latin_hypercube(s, lhs_points, rng);
+    }
+
+    /* The basename of the output files produced by this program. */
+    string basename (modname);
+    for (size_t j = 0; j < s.controls.size(); j++) {
+      basename += "_" + s.controls[j].name;
+    }
+
+    /* Analyse the module dynamics over the range of control values. */
+    string datafile (basename + ".ssv");
+    cout << datafile << " ... ";
+    cout.flush();
+    sweep(s, datafile);
+    cout << "done" << endl;
+
+    /* Create a gnuplot script to plot the results of a 1-D sweep. */
+    if (s.controls.size() == 1 && ! lhs_points) {
+      string scriptfile (basename + ".gp");
+      cout << scriptfile << " ... ";
+      cout.flush();
+      gnuplot((char *) s.controls[0].name.c_str(), s.outputs.size(),
+              scriptfile, datafile, basename + ".eps");
+      cout << "done" << endl;
+    }
+  }
+  return EXIT_SUCCESS;
+}
+
+/**
+ * Adds the state variables that a module assigns to a set of names.
+ */
+static void add_outputs(const STAGE_INFO &info, void *data) {
+  set<string> *outputs = (set<string> *) data;
+  for (const char *const *name = info.vars_out; *name; name++) {
+    outputs->insert(*name);
+  }
+}
+
+/**
+ * Adds a module of a pipeline to the module map.
+ */
+static void add_module(const STAGE_INFO &info, void *data) {
+  SENS_MODULE &mod = modules[info.name];
+  mod.f = info.eval;
+  add_outputs(info, &mod.outputs);
 }
 
 /**
- * Populate the module map with all of the Guyton model modules.
+ * Adds a pipeline to the module map, so that a single time-step of the
+ * pipeline can be analysed as per a single module.
+ */
+template <typename L>
+static void add_pipeline(const char *name) {
+  SENS_MODULE &mod = modules[name];
+  mod.f = pipeline_eval<L>;
+  L::visit(add_outputs, &mod.outputs);
+}
+
+/**
+ * Populate the module map with all of the Guyton model modules, and with the
+ * reduced models (see pipeline.h).
  */
 void init_modules() {
-  modules.insert(pair<string,modulefn>("renal", module_renal));
-  modules.insert(pair<string,modulefn>("circdyn", module_circdyn));
-  modules.insert(pair<string,modulefn>("autonom", (modulefn) module_autonom));
-  modules.insert(pair<string,modulefn>("aldost", module_aldost));
-  modules.insert(pair<string,modulefn>("angio", module_angio));
-  modules.insert(pair<string,modulefn>("anp", module_anp));
-  modules.insert(pair<string,modulefn>("rbc", module_rbc));
-  modules.insert(pair<string,modulefn>("o2deliv", module_o2deliv));
-  modules.insert(pair<string,modulefn>("volrec", module_volrec));
-  modules.insert(pair<string,modulefn>("adh", module_adh));
-  modules.insert(pair<string,modulefn>("stress", module_stress));
-  modules.insert(pair<string,modulefn>("thirst", module_thirst));
-  modules.insert(pair<string,modulefn>("baro", module_baro));
-  modules.insert(pair<string,modulefn>("special", module_special));
-  modules.insert(pair<string,modulefn>("capdyn", module_capdyn));
-  modules.insert(pair<string,modulefn>("puldyn", module_puldyn));
-  modules.insert(pair<string,modulefn>("electro", module_electro));
-  modules.insert(pair<string,modulefn>("kidney", (modulefn) module_kidney));
+  PIPELINE_MODULES::visit(add_module, NULL);
+  add_pipeline<PIPELINE_CIRCULATION>("circulation");
 }
 
 /**
- * Perform a sensitivity analysis of a single module of the Guyton model.
+ * Defines a control of a sweep, which is either a state variable or a
+ * parameter of the model. The values of the control in a grid sweep are
+ * min_val, min_val + inc_val, and so on, up to max_val.
  *
- * @param[in] f The function pointer of the module to analyse.
- * @param[in] control_var The name of the control variable/parameter.
+ * @param[out] c The control.
+ * @param[in] name The name of the control variable/parameter.
  * @param[in] min_val The minimum value of the control.
- * @param[in] inc_val The amount by which the control is incremented.
+ * @param[in] inc_val The amount by which the control is incremented (this is
+ *                    ignored if it is zero).
  * @param[in] max_val The maximum value of the control.
- * @param[in] outputs The names of the output variables.
- * @param[in] output_count The number of output variables.
- * @param[in] outfile The name of the file where the output will be written.
+ *
+ * @return \c true if the control is valid, otherwise \c false.
+ */
+bool init_control(CONTROL &c, const char *name, double min_val,
+                  double inc_val, double max_val) {
+  c.name = name;
+  c.min = min_val;
+  c.max = max_val;
+
+  /* Determine whether the control is a variable or parameter of the model. */
+  c.index = var_index(name);
+  c.is_var = (c.index >= 0);
+  if (! c.is_var) {
+    c.index = param_index(name);
+  }
+  if (c.index < 0 || inc_val < 0 || max_val < min_val) {
+    return false;
+  }
+
+  /* The values are accumulated in the same manner as the original (1-D)
+     sweeps, so that their output is unchanged. */
+  c.values.clear();
+  if (inc_val > 0) {
+    for (double x = min_val; x < (max_val + inc_val); x += inc_val) {
+      c.values.push_back(x);
+    }
+  }
+  return true;
+}
+
+/**
+ * Generates a Latin-hypercube design over the controls of a sweep. The range
+ * of each control is divided into equal strata, and each stratum is sampled
+ * exactly once (at a random point within the stratum).
+ *
+ * @param[in,out] s The sweep.
+ * @param[in] n The number of points.
+ * @param[in,out] rng The state of the random number generator (erand48).
  */
-void analyse(modulefn f, char* control_var, double min_val, double inc_val,
-             double max_val, char** outputs, int output_count, string outfile) {
-  /* This struct holds pointers to all model parameters. */
+void latin_hypercube(SWEEP &s, unsigned long n, unsigned short rng[3]) {
+  size_t d = s.controls.size();
+  s.design.resize(n * d);
+  vector<unsigned long> strata(n);
+  for (size_t j = 0; j < d; j++) {
+    for (unsigned long i = 0; i < n; i++) {
+      strata[i] = i;
+    }
+    /* Shuffle the strata (Fisher-Yates). */
+    for (unsigned long i = n; i > 1; i--) {
+      unsigned long k = (unsigned long) (erand48(rng) * i);
+      swap(strata[i - 1], strata[(k < i) ? k : i - 1]);
+    }
+    const CONTROL &c = s.controls[j];
+    for (unsigned long i = 0; i < n; i++) {
+      double u = (strata[i] + erand48(rng)) / n;
+      s.design[i * d + j] = c.min + u * (c.max - c.min);
+    }
+  }
+}
+
+/**
+ * Returns the number of points in a sweep.
+ */
+size_t sweep_points(const SWEEP &s) {
+  if (! s.design.empty()) {
+    return s.design.size() / s.controls.size();
+  }
+  size_t n = 1;
+  for (size_t j = 0; j < s.controls.size(); j++) {
+    n *= s.controls[j].values.size();
+  }
+  return n;
+}
+
+/**
+ * Returns the value of a control at a point of a sweep. Grid points are
+ * ordered so that the last control varies fastest.
+ */
+double sweep_value(const SWEEP &s, size_t point, size_t j) {
+  size_t d = s.controls.size();
+  if (! s.design.empty()) {
+    return s.design[point * d + j];
+  }
+  for (size_t k = d; k-- > j + 1; ) {
+    point /= s.controls[k].values.size();
+  }
+  return s.controls[j].values[point % s.controls[j].values.size()];
+}
+
+/**
+ * Runs the module for a block of consecutive points of a sweep (see
+ * batch_run()), and stores the row of output for each point.
+ */
+void sweep_job(void *data, size_t index) {
+  SWEEP_BLOCKS *blocks = (SWEEP_BLOCKS *) data;
+  const SWEEP &s = *blocks->s;
+  size_t d = s.controls.size();
+  size_t k = s.outputs.size();
+  size_t width = 2 * d + k;
+
   PARAMS p;
-  /* This struct holds pointers to all state variables. */
   VARS v;
-  /* The field separator for the sensitivity analysis output. */
-  const char output_sep[] = " ";
+  /* The structs only contain doubles, so they can be treated as arrays. */
+  double *ps = (double *) &p;
+  double *vs = (double *) &v;
 
-  /* Determine whether the control is a variable or parameter of the model. */
-  bool is_var = true;
-  if (isnan(get_var(v, control_var))) {
-    is_var = false;
+  size_t first = blocks->first + index * blocks->size;
+  size_t last = first + blocks->size;
+  last = (last < blocks->last) ? last : blocks->last;
+  for (size_t pt = first; pt < last; pt++) {
+    double *row = blocks->rows + (pt - blocks->first) * width;
+
+    /* Reset the model to the default state. */
+    memcpy(&p, &s.p0, sizeof(PARAMS));
+    memcpy(&v, &s.v0, sizeof(VARS));
+
+    /* Set the next value of each control. */
+    for (size_t j = 0; j < d; j++) {
+      const CONTROL &c = s.controls[j];
+      double x = sweep_value(s, pt, j);
+      if (c.is_var) {
+        vs[c.index] = x;
+      } else {
+        ps[c.index] = x;
+      }
+      row[j] = x;
+      row[d + j] = (x - c.min) / (c.max - c.min);
+    }
+
+    /* Run the module. */
+    s.f(p, v);
+
+    for (size_t i = 0; i < k; i++) {
+      row[2 * d + i] = vs[s.outputs[i]];
+    }
   }
+}
+
+/**
+ * Perform a sensitivity analysis of a single module of the Guyton model, over
+ * every point of a sweep. The points are divided into blocks that are run in
+ * parallel, and the output is written in the order of the points.
+ *
+ * @param[in] s The sweep.
+ * @param[in] outfile The name of the file where the output will be written.
+ */
+void sweep(const SWEEP &s, string outfile) {
+  /* The field separator for the sensitivity analysis output. */
+  const char output_sep[] = " ";
+  size_t d = s.controls.size();
+  size_t k = s.outputs.size();
+  size_t width = 2 * d + k;
 
   ofstream out_data (outfile.c_str());
   out_data.setf (ios::scientific);
 
-  /* Print the column titles. */
-  out_data << control_var << output_sep << control_var << output_sep;
-  for (int i = 0; i < output_count; i++) {
-    out_data << outputs[i] << output_sep;
+  /* Print the column titles: each control, its normalised value (which, for
+     a single control, is titled with the control name) and each output. */
+  for (size_t j = 0; j < d; j++) {
+    out_data << s.controls[j].name << output_sep;
   }
-  out_data << endl;
-
-  /* Initialise the model */
-  PARAMS_INIT(p);
-  VARS_INIT(v);
-  f(p, v);
-
-  /* Record the output for each value of the control. */
-  for (double x = min_val; x < (max_val + inc_val); x += inc_val) {
-    /* Initialise the model */
-    PARAMS_INIT(p);
-    VARS_INIT(v);
-
-    /* Set the next value of the control variable. */
-    if (is_var) {
-      set_var(v, control_var, x);
-    } else {
-      set_param(p, control_var, x);
-    }
+  for (size_t j = 0; j < d; j++) {
+    out_data << s.controls[j].name << ((d > 1) ? "_norm" : "") << output_sep;
+  }
+  for (size_t i = 0; i < k; i++) {
+    out_data << s.output_names[i] << output_sep;
+  }
+  out_data << '\n';
 
-    /* Run the module. */
-    f(p, v);
+  /* Divide the points into blocks, so that each thread has several blocks
+     and each block amortises the cost of scheduling it. */
+  size_t points = sweep_points(s);
+  size_t block = points / (s.threads * SWEEP_BLOCKS_PER_THREAD);
+  block = (block < 1) ? 1 : (block > SWEEP_BLOCK) ? SWEEP_BLOCK : block;
+
+  /* The output is held in memory for one chunk of blocks at a time. */
+  vector<double> rows(SWEEP_CHUNK * block * width);
+  for (size_t first = 0; first < points; first += SWEEP_CHUNK * block) {
+    SWEEP_BLOCKS blocks;
+    blocks.s = &s;
+    blocks.first = first;
+    blocks.last = first + SWEEP_CHUNK * block;
+    blocks.last = (blocks.last < points) ? blocks.last : points;
+    blocks.size = block;
+    blocks.rows = &rows[0];
+    batch_run((blocks.last - first + block - 1) / block, s.threads,
+              sweep_job, &blocks);
 
     /* Output the results. */
-    double norm_x = (x - min_val) / (max_val - min_val);
-    out_data << x << output_sep << norm_x << output_sep;
-    for (int i = 0; i < output_count; i++) {
-      out_data << get_var(v, outputs[i]) << output_sep;
+    for (size_t pt = first; pt < blocks.last; pt++) {
+      const double *row = &rows[(pt - first) * width];
+      for (size_t i = 0; i < width; i++) {
+        out_data << row[i] << output_sep;
+      }
+      out_data << '\n';
     }
-    out_data << endl;
   }
   out_data.close();
 }
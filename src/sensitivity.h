@@ -1,14 +1,65 @@
 /* Define a type that points to a module function. */
-typedef void (*modulefn)(const PARAMS &p, VARS &v);
+typedef void (*modulefn)(PARAMS &p, VARS &v);
 
-extern std::map<std::string,modulefn> modules;
+/** A module (or pipeline of modules) that can be analysed. */
+struct SENS_MODULE {
+  modulefn f; /** Evaluates the module. */
+  std::set<std::string> outputs; /** The state variables that it assigns. */
+};
+
+/** A state variable or parameter whose value is varied by a sweep. */
+struct CONTROL {
+  string name; /** The name of the control. */
+  int index; /** The index of the control in the VARS or PARAMS struct. */
+  bool is_var; /** Whether the control is a state variable. */
+  double min; /** The minimum value of the control. */
+  double max; /** The maximum value of the control. */
+  vector<double> values; /** The values of the control in a grid sweep. */
+};
+
+/** A sensitivity analysis of a module over several controls. */
+struct SWEEP {
+  modulefn f; /** The module to analyse. */
+  vector<CONTROL> controls; /** The controls. */
+  vector<int> outputs; /** The index of each output variable. */
+  vector<string> output_names; /** The name of each output variable. */
+  vector<double> design; /** The points of a Latin hypercube (if any). */
+  PARAMS p0; /** The default model parameters. */
+  VARS v0; /** The default state variables. */
+  unsigned int threads; /** The number of threads. */
+};
+
+/** Consecutive blocks of points in a sweep, which are run in parallel. */
+struct SWEEP_BLOCKS {
+  const SWEEP *s; /** The sweep. */
+  size_t first; /** The first point. */
+  size_t last; /** The point after the final point. */
+  size_t size; /** The number of points in each block. */
+  double *rows; /** The output for each point. */
+};
+
+extern std::map<std::string,SENS_MODULE> modules;
 
 void init_modules();
 
 bool isnan(double x);
 
-void analyse(modulefn f, char* control_var, double min_val, double inc_val,
-             double max_val, char** outputs, int output_count, string outfile);
+void usage(char *progname, int exitcode);
+
+bool read_control(const char *arg, bool lhs, CONTROL &c);
+
+bool init_control(CONTROL &c, const char *name, double min_val,
+                  double inc_val, double max_val);
+
+void latin_hypercube(SWEEP &s, unsigned long n, unsigned short rng[3]);
+
+size_t sweep_points(const SWEEP &s);
+
+double sweep_value(const SWEEP &s, size_t point, size_t j);
+
+void sweep_job(void *data, size_t index);
+
+void sweep(const SWEEP &s, string outfile);
 
 void gnuplot(char* control_var, int output_count, string scriptfile,
              string datafile, string epsfile);
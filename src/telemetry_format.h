@@ -0,0 +1,56 @@
+/**
+ * @file
+ * The layout of live telemetry channels, which are POSIX shared-memory
+ * objects that are written by instr_telemetry() and can be read by any
+ * number of other threads or processes (see interface/telemetry.py).
+ *
+ * A channel consists of a header, followed by a ring buffer of snapshots.
+ * All values are stored in the native byte order of the host.
+ *
+ * <b>Header:</b>
+ * - The magic string \c TELEM_MAGIC (8 bytes).
+ * - The format version, \c TELEM_VERSION (uint32).
+ * - The number of columns, including time (uint32).
+ * - The number of slots in the ring buffer, a power of two (uint64).
+ * - The size of each slot in bytes (uint64).
+ * - The size of the entire header in bytes (uint64).
+ * - The number of snapshots that have been published (uint64).
+ * - Whether the simulation has finished (uint64).
+ * - For each column, its name as a NUL-terminated string. The first column
+ *   is always time (\c t, in minutes).
+ * - Padding, so that the header size is a multiple of 8 bytes.
+ *
+ * <b>Slot:</b>
+ * - The sequence number of the slot (uint64).
+ * - The value of each column (float64).
+ *
+ * Snapshot \c n is stored in slot <tt>n % slots</tt>. While it is being
+ * written, the sequence number of that slot is <tt>2n + 1</tt>; once it has
+ * been written, the sequence number is <tt>2n + 2</tt> and the number of
+ * published snapshots is updated. A reader has obtained a consistent copy of
+ * snapshot \c n if the sequence number was <tt>2n + 2</tt> both before and
+ * after the values were read.
+ */
+
+#include <stdint.h>
+
+/** The magic string that identifies a telemetry channel. */
+#define TELEM_MAGIC "G92TELE"
+/** The length of the magic string, including the terminating NUL. */
+#define TELEM_MAGIC_LEN 8
+/** The version of the telemetry channel format. */
+#define TELEM_VERSION 1
+/** The default number of slots in the ring buffer. */
+#define TELEM_SLOTS 4096
+
+/** The fixed-size portion of the telemetry channel header. */
+struct TELEM_HEADER {
+  char magic[TELEM_MAGIC_LEN]; /** The magic string (TELEM_MAGIC). */
+  uint32_t version; /** The format version (TELEM_VERSION). */
+  uint32_t ncols; /** The number of columns, including time. */
+  uint64_t slots; /** The number of slots in the ring buffer. */
+  uint64_t slot_size; /** The size of each slot (bytes). */
+  uint64_t header_size; /** The size of the entire header (bytes). */
+  uint64_t head; /** The number of snapshots that have been published. */
+  uint64_t done; /** Whether the simulation has finished. */
+};
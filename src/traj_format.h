@@ -0,0 +1,49 @@
+/**
+ * @file
+ * The layout of binary trajectory files, which are written by instr_traj()
+ * and read by the functions in read_traj.cpp.
+ *
+ * A trajectory file consists of a header, followed by any number of chunks.
+ * All values are stored in the native byte order of the host.
+ *
+ * <b>Header:</b>
+ * - The magic string \c TRAJ_MAGIC (8 bytes).
+ * - The format version, \c TRAJ_VERSION (uint32).
+ * - The number of columns, including time (uint32).
+ * - The maximum number of rows in each chunk (uint32).
+ * - The size of the entire header in bytes (uint32).
+ * - For each column, its name and its units, each stored as a NUL-terminated
+ *   string. The first column is always time (\c t, in minutes). The units of
+ *   the other columns are only recorded when the writer is given them (see
+ *   instr_traj_opts()); the model binary does not know the units of its
+ *   variables, and so these are empty strings.
+ * - Padding, so that the header size is a multiple of 8 bytes.
+ *
+ * <b>Chunk:</b>
+ * - The number of rows in this chunk (uint64).
+ * - The data, stored column by column as float64 values. Each column
+ *   contains exactly as many values as there are rows in the chunk.
+ *
+ * Every chunk except the last contains the maximum number of rows, so that
+ * the location of each chunk is easily determined.
+ */
+
+#include <stdint.h>
+
+/** The magic string that identifies a trajectory file. */
+#define TRAJ_MAGIC "G92TRAJ"
+/** The length of the magic string, including the terminating NUL. */
+#define TRAJ_MAGIC_LEN 8
+/** The version of the trajectory file format. */
+#define TRAJ_VERSION 1
+/** The default maximum number of rows in each chunk. */
+#define TRAJ_CHUNK_ROWS 65536
+
+/** The fixed-size portion of the trajectory file header. */
+struct TRAJ_HEADER {
+  char magic[TRAJ_MAGIC_LEN]; /** The magic string (TRAJ_MAGIC). */
+  uint32_t version; /** The format version (TRAJ_VERSION). */
+  uint32_t ncols; /** The number of columns, including time. */
+  uint32_t chunk_rows; /** The maximum number of rows in each chunk. */
+  uint32_t header_size; /** The size of the entire header (bytes). */
+};
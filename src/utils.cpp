@@ -1,4 +1,12 @@
-void funct(double *xin, double *yout, double *fpwl, int size) {
+#include <cmath>
+#include <cstdlib>
+
+#include "scalar.h"
+#include "fastmath.h"
+#include "utils.h"
+
+template <typename T>
+void funct(T *xin, T *yout, double *fpwl, int size) {
   double x1 = 0, x2 = 0, y1 = 0, y2 = 0;
 
   for (int j = 1; (j * 2 + 2) < (size + 1); j++) {
@@ -13,3 +21,38 @@ void funct(double *xin, double *yout, double *fpwl, int size) {
     }
   }
 }
+
+/**
+ * Returns the fraction of the difference between the input and the output of
+ * a first-order lag that is closed over a time-step.
+ *
+ * @param[in] x The time-step, relative to the time constant of the lag.
+ */
+template <typename T>
+T lag_fraction(T x) {
+  return 1 - 1 / fm_pow(2.7183, x);
+}
+
+/* Instantiate the functions for each scalar type (see scalar.h). */
+#define INSTANTIATE(T) \
+  template void funct<T>(T *, T *, double *, int); \
+  template T lag_fraction<T>(T);
+FOR_EACH_SCALAR(INSTANTIATE)
+
+/**
+ * The tape to which the current thread records ADJ arithmetic (see
+ * scalar.h). Each thread that evaluates the model equations with the ADJ
+ * type must first provide its own tape.
+ */
+__thread ADJ_TAPE *adj_tape = NULL;
+
+/**
+ * Doubles the capacity of a tape of ADJ arithmetic.
+ *
+ * @param[in,out] tape The tape (see adj_tape).
+ */
+void adj_tape_grow(ADJ_TAPE *tape) {
+  long capacity = (tape->capacity > 0) ? 2 * tape->capacity : 4096;
+  tape->nodes = (ADJ_NODE *) realloc(tape->nodes, capacity * sizeof(ADJ_NODE));
+  tape->capacity = capacity;
+}
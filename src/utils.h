@@ -1 +1,4 @@
-void funct(double *xin, double *yout, double *fpwl, int size);
+template <typename T>
+void funct(T *xin, T *yout, double *fpwl, int size);
+template <typename T>
+T lag_fraction(T x);
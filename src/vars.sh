@@ -7,9 +7,20 @@
 # variables by name.
 #
 # This script produces the following files:
-#   * vars.h   -- Defines the VARS type, set_var() and VARS_INIT.
+#   * vars.h   -- Defines the VARS_T and VARS types, set_var(), VARS_INIT,
+#                 every state variable (VARS_ALL), the state variables that
+#                 are read and written by each module (VARS_IN_* and
+#                 VARS_OUT_*), and the parameters that each module reads
+#                 (PARAMS_IN_*).
 #   * vars.cpp -- Implements the set_var() function.
 #
+# The fields of the struct are not in the order of "vars.lst". The state
+# variables that each module reads and writes are found by find_vars.sh, and
+# the fields are grouped by the first module (in the order that they are run
+# by the pipelines of pipeline.h) that accesses them, so that each module
+# touches as few cache lines as possible. The fields that no module accesses
+# are placed at the end of the struct.
+#
 # NOTE: This script requires the file "vars.lst" to contain all of the model
 #       state variable names, each on a separate line, and the file "vars.val"
 #       to contain the default state variable values, each on a separate line.
@@ -22,6 +33,19 @@ VARS_LIST="vars.lst"
 VARS_VALS="vars.val"
 VARS_DEFN="vars.h"
 VARS_CODE="vars.cpp"
+PARAMS_LIST="params.lst"
+FIND_VARS="../utils/find_vars.sh"
+
+#
+# The modules that access the state variables, in the order that they are run
+# by the pipelines of the model equations (see pipeline.h), followed by the
+# experiments.
+#
+MODULES="guyton92_step module_circdyn module_autonom module_aldost
+  module_angio module_anp module_rbc module_o2deliv module_volrec module_adh
+  module_stress module_thirst module_baro module_special module_capdyn
+  module_puldyn module_kidney module_renal module_electro exp_rapidreg
+  exp_transfuse exp_variants"
 
 #
 # Check whether the list of state variable names exists and is readable.
@@ -50,18 +74,84 @@ if [ ! -r ${VARS_VALS} ]; then
 fi
 
 #
-# Build the header file.
+# Find the state variables that each module writes (on the left-hand side of
+# an equation) and reads (every other reference, including conditions), and
+# the parameters that each module reads (every reference).
+#
+LAYOUT=""
+VIEWS=""
+for MOD in ${MODULES}; do
+  if [ ! -r ${MOD}.cpp ]; then
+    echo "ERROR: module ${MOD}.cpp is not readable."
+    exit 2;
+  fi
+  WRITES=`${FIND_VARS} on-lhs ${MOD} | grep -Fxf ${VARS_LIST}`
+  REFS=`egrep -o '\<v\.[a-zA-Z0-9_]+' ${MOD}.cpp | cut -d '.' -f 2 |
+    sort -u | grep -Fxf ${VARS_LIST}`
+  READS=`(${FIND_VARS} on-rhs ${MOD}; echo "${REFS}" | grep -vFx "${WRITES}") |
+    sort -u | grep -Fxf ${VARS_LIST}`
+  PARAMS=`egrep -o '\<p\.[a-zA-Z0-9_]+' ${MOD}.cpp | cut -d '.' -f 2 |
+    sort -u | grep -Fxf ${PARAMS_LIST}`
+  for VAR in ${WRITES} ${READS}; do
+    LAYOUT="${LAYOUT}${MOD} ${VAR}
+"
+  done
+  VIEWS="${VIEWS}${MOD} in `echo ${READS}`
+${MOD} out `echo ${WRITES}`
+${MOD} params `echo ${PARAMS}`
+"
+done
+for VAR in `cat ${VARS_LIST}`; do
+  LAYOUT="${LAYOUT}- ${VAR}
+"
+done
+LAYOUT=`echo -n "${LAYOUT}" | awk '! seen[$2]++'`
+ORDER=`echo "${LAYOUT}" | awk '{ print $2; }'`
+
 #
-cat ${VARS_LIST} |
-  awk 'BEGIN { print "struct VARS {"; } ;
-       { print "double " $1 ";" } ;
-       END { print "};"; }' > ${VARS_DEFN}
+# Build the header file. The struct is a template over the scalar type of its
+# fields (see scalar.h), and VARS is the double-precision struct.
+#
+echo "${LAYOUT}" |
+  awk 'BEGIN { print "template <typename T>"; print "struct VARS_T {"; } ;
+       $1 != group { group = $1;
+                     if (group == "-") {
+                       print "/* The fields that no module accesses. */";
+                     } else {
+                       print "/* The fields first accessed by " group ". */";
+                     } } ;
+       { print "T " $2 ";" } ;
+       END { print "};"; print "typedef VARS_T<double> VARS;"; }' > ${VARS_DEFN}
+
+#
+# List every state variable (in the same order as the struct) as a macro that
+# applies the macro X to each name (eg, to copy a struct field by field).
+#
+echo "${ORDER}" |
+  awk 'BEGIN { printf "#define VARS_ALL(X)"; } ;
+       { printf " X(%s)", $1; } ;
+       END { printf "\n"; }' >> ${VARS_DEFN}
+
+#
+# List the state variables that each module reads and writes, and the
+# parameters that it reads, as macros that apply the macro X to each name (eg,
+# to declare a compact struct of the inputs of a module, or to copy them into
+# such a struct).
+#
+echo "${VIEWS}" |
+  awk 'BEGIN { view["in"] = "VARS_IN"; view["out"] = "VARS_OUT";
+               view["params"] = "PARAMS_IN"; } ;
+       NF >= 2 { printf "#define %s_%s(X)", view[$2], $1;
+                 for (i = 3; i <= NF; i++) { printf " X(%s)", $i; }
+                 printf "\n"; }' >> ${VARS_DEFN}
 
 echo "void set_var(VARS &v, const char *name, double value);" >> ${VARS_DEFN}
 echo "double get_var(const VARS &v, const char *name);" >> ${VARS_DEFN}
 
 VAR_COUNT=`wc -l ${VARS_LIST} | awk '{ print $1; }'`
 echo "#define VAR_COUNT ${VAR_COUNT}" >> ${VARS_DEFN};
+echo "extern const char *VAR_NAMES[VAR_COUNT];" >> ${VARS_DEFN}
+echo "int var_index(const char *name);" >> ${VARS_DEFN}
 
 #
 # Produce the code fragment that will initialise the state variables.
@@ -99,3 +189,19 @@ cat ${VARS_LIST} |
        END { print "  fprintf(stderr, \"ERROR: Unknown variable name \\\"%s\\\"\\n\", name);";
              print "  return nan(\"\");";
              print "}"; }' >> ${VARS_CODE}
+
+#
+# Build the table of state variable names (in the same order as the struct),
+# and the code for var_index().
+#
+echo "${ORDER}" |
+  awk 'BEGIN { print "const char *VAR_NAMES[VAR_COUNT] = {"; }
+       { print "  \"" $1 "\","; }
+       END { print "};"; print ""; }' >> ${VARS_CODE}
+
+echo "${ORDER}" |
+  awk 'BEGIN { print "int var_index(const char *name) {"; }
+       { print "  if (! strcmp(name, \"" $1 "\")) {";
+         print "    return " NR - 1 ";";
+         print "  }"; }
+       END { print "  return -1;"; print "}"; }' >> ${VARS_CODE}
@@ -0,0 +1,773 @@
+/**
+ * @file
+ * A program that simulates a virtual population of patients, whose parameter
+ * values are sampled from the distributions given in a population file, and
+ * summarises the distribution of the model outputs at each output time of an
+ * experiment.
+ *
+ * Each parameter is normally, log-normally or uniformly distributed, and the
+ * parameters may be correlated (through a Gaussian copula, so that each
+ * parameter retains its own distribution). The patients are simulated in
+ * parallel from a shared warm-start state (see batch.cpp), in fixed-size
+ * chunks, and each output is summarised by online estimators of its mean,
+ * variance and quantiles (the P-squared algorithm of Jain and Chlamtac,
+ * 1985), so that the memory required does not grow with the number of
+ * patients. The trajectories of a fixed number of patients, chosen uniformly
+ * at random (reservoir sampling), can also be kept for inspection.
+ *
+ * The population file contains one parameter per line, and any number of
+ * correlations between these parameters:
+ *
+ *     # NAME  DISTRIBUTION  ARGUMENTS
+ *     NAME normal MEAN SD
+ *     NAME lognormal MEAN SD
+ *     NAME uniform MIN MAX
+ *     corr NAME1 NAME2 R
+ */
+
+#include <cstdlib>
+#include <cstring>
+#include <cmath>
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <queue>
+#include <vector>
+#include <string>
+#include <algorithm>
+
+#include <unistd.h>
+
+using namespace std;
+
+#include "params.h"
+#include "vars.h"
+#include "read_exp.h"
+#include "guyton92_step.h"
+/* Run batches of simulations in parallel from a shared warm-start state. */
+#include "batch.h"
+#include "vpop.h"
+
+/** The default number of patients. */
+#define VPOP_PATIENTS 1000
+
+/**
+ * The number of patients that are simulated at once. This determines the
+ * memory required by the simulations.
+ */
+#define VPOP_CHUNK 256
+
+/** A normally-distributed parameter. */
+#define DIST_NORMAL 0
+/** A log-normally-distributed parameter. */
+#define DIST_LOGNORMAL 1
+/** A uniformly-distributed parameter. */
+#define DIST_UNIFORM 2
+
+/** A parameter whose value differs between patients. */
+struct VPOP_PARAM {
+  string name; /** The name of the parameter. */
+  int index; /** The index of the parameter in the PARAMS struct. */
+  int dist; /** The distribution of the parameter (eg, DIST_NORMAL). */
+  double a; /** The mean (or the lower bound, if uniform). */
+  double b; /** The standard deviation (or the upper bound, if uniform). */
+};
+
+/**
+ * The running estimate of a single quantile of a quantity, as per the
+ * P-squared algorithm, which maintains five markers: the minimum, the
+ * maximum, the quantile and a point midway between the quantile and each
+ * extreme. Until five values have been added, the values themselves are
+ * stored in the marker heights.
+ */
+struct P2 {
+  double p; /** The quantile to estimate (from zero to one). */
+  unsigned long count; /** The number of values. */
+  double q[5]; /** The height of each marker. */
+  double pos[5]; /** The actual position of each marker. */
+  double want[5]; /** The desired position of each marker. */
+};
+
+/** A virtual population. */
+struct VPOP {
+  BATCH_START *start; /** The shared warm-start state. */
+  vector<VPOP_PARAM> params; /** The parameters. */
+  vector<int> pix; /** The index of each parameter. */
+  vector<double> chol; /** The Cholesky factor of the correlation matrix. */
+  vector<string> outputs; /** The names of the model outputs. */
+  vector<int> handles; /** The handles of the model outputs. */
+  vector<double> times; /** The sample times (mins). */
+  vector<double> quantiles; /** The quantiles to estimate. */
+  unsigned int threads; /** The number of worker threads. */
+  unsigned short seed[3]; /** The state of the random number generator. */
+};
+
+/** A chunk of patients. */
+struct VPOP_PATIENTS_CHUNK {
+  const VPOP *pop; /** The virtual population. */
+  vector<vector<double> > x; /** The parameter values of each patient. */
+  vector<vector<double> > y; /** The model outputs of each patient. */
+  vector<char> ok; /** Whether each simulation was successful. */
+};
+
+/**
+ * The patients whose trajectories are kept, chosen uniformly at random from
+ * every successful simulation (Algorithm R of Vitter, 1985).
+ */
+struct RESERVOIR {
+  size_t size; /** The number of patients to keep. */
+  unsigned long seen; /** The number of patients offered. */
+  vector<unsigned long> ids; /** The number of each patient kept. */
+  vector<vector<double> > x; /** The parameter values of each patient. */
+  vector<vector<double> > y; /** The model outputs of each patient. */
+  unsigned short seed[3]; /** The state of the random number generator. */
+};
+
+/**
+ * Displays the command-line usage for the population program, then exits.
+ *
+ * @param progname The name of the program.
+ * @param exitcode The exit code to pass to exit().
+ */
+static void usage(char *progname, int exitcode) {
+  cerr << "\n  USAGE: " << progname << " [options] population experiment"
+       << endl;
+  cerr << "\n  OPTIONS:" << endl;
+  cerr << "    -o VARS           " <<
+    "The model outputs to summarise (comma-separated list)." << endl;
+  cerr << "    -n N              " <<
+    "The number of patients (default: " << VPOP_PATIENTS << ")." << endl;
+  cerr << "    -q Q1,Q2,...      " <<
+    "The quantiles to estimate (default: 0.05,0.5,0.95)." << endl;
+  cerr << "    -r K:FILE         " <<
+    "Write the trajectories of K randomly-chosen patients" << endl;
+  cerr << "                      " <<
+    "to FILE." << endl;
+  cerr << "    -s SEED           " <<
+    "Seed the random number generator (default: 1)." << endl;
+  cerr << "    -w T              " <<
+    "Start each simulation from the model state at time T" << endl;
+  cerr << "                      " <<
+    "(default: the first output time of the experiment)." << endl;
+  cerr << "    -x                " <<
+    "End time-steps exactly at each output time and event." << endl;
+  cerr << "    -j N              " <<
+    "Run N simulations at once (default: one per processor)." << endl;
+  cerr << "    -h                " << "Display this help and exit." << endl;
+  cerr << "\n  The population file gives the distribution of each "
+    "parameter, one per line:" << endl;
+  cerr << "  'NAME normal MEAN SD', 'NAME lognormal MEAN SD' or "
+    "'NAME uniform MIN MAX'." << endl;
+  cerr << "  Parameters are correlated by lines of the form "
+    "'corr NAME1 NAME2 R'." << endl;
+  cerr << "\n  The parameters take their sampled values at the warm-start "
+    "time, and the" << endl;
+  cerr << "  outputs are summarised at every output time of the "
+    "experiment from then on." << endl;
+  cerr << "\n  EXAMPLE:" << endl;
+  cerr << "    " << progname << " -n 10000 -o pa,vec exps/hypertension.pop "
+    "exps/hypertension.exp" << endl;
+  cerr << endl;
+  exit(exitcode);
+}
+
+/**
+ * Prepares to estimate a quantile.
+ */
+static void p2_init(P2 &e, double p) {
+  e.p = p;
+  e.count = 0;
+}
+
+/**
+ * Adds a value to the running estimate of a quantile.
+ */
+static void p2_add(P2 &e, double x) {
+  if (e.count < 5) {
+    e.q[e.count++] = x;
+    if (e.count == 5) {
+      sort(e.q, e.q + 5);
+      for (int i = 0; i < 5; i++) {
+        e.pos[i] = i;
+      }
+      e.want[0] = 0;
+      e.want[1] = 2 * e.p;
+      e.want[2] = 4 * e.p;
+      e.want[3] = 2 + 2 * e.p;
+      e.want[4] = 4;
+    }
+    return;
+  }
+
+  /* Find the cell that contains the value, and extend the extremes. */
+  int k;
+  if (x < e.q[0]) {
+    e.q[0] = x;
+    k = 0;
+  } else if (x >= e.q[4]) {
+    e.q[4] = x;
+    k = 3;
+  } else {
+    for (k = 0; x >= e.q[k + 1]; k++) {
+    }
+  }
+  for (int i = k + 1; i < 5; i++) {
+    e.pos[i]++;
+  }
+  const double step[5] = {0, e.p / 2, e.p, (1 + e.p) / 2, 1};
+  for (int i = 0; i < 5; i++) {
+    e.want[i] += step[i];
+  }
+  e.count++;
+
+  /* Move each middle marker towards its desired position, if possible. */
+  for (int i = 1; i < 4; i++) {
+    double d = e.want[i] - e.pos[i];
+    if ((d >= 1 && e.pos[i + 1] - e.pos[i] > 1)
+        || (d <= -1 && e.pos[i - 1] - e.pos[i] < -1)) {
+      int s = (d > 0) ? 1 : -1;
+      /* The piecewise-parabolic prediction of the new height. */
+      double q = e.q[i] + s / (e.pos[i + 1] - e.pos[i - 1])
+        * ((e.pos[i] - e.pos[i - 1] + s) * (e.q[i + 1] - e.q[i])
+           / (e.pos[i + 1] - e.pos[i])
+           + (e.pos[i + 1] - e.pos[i] - s) * (e.q[i] - e.q[i - 1])
+           / (e.pos[i] - e.pos[i - 1]));
+      if (! (e.q[i - 1] < q && q < e.q[i + 1])) {
+        /* Fall back to a linear prediction. */
+        q = e.q[i] + s * (e.q[i + s] - e.q[i]) / (e.pos[i + s] - e.pos[i]);
+      }
+      e.q[i] = q;
+      e.pos[i] += s;
+    }
+  }
+}
+
+/**
+ * Returns the running estimate of a quantile. With fewer than five values,
+ * this is the nearest value of the (sorted) values.
+ */
+static double p2_value(const P2 &e) {
+  if (e.count >= 5) {
+    return e.q[2];
+  } else if (e.count == 0) {
+    return 0;
+  }
+  double q[5];
+  memcpy(q, e.q, e.count * sizeof(double));
+  sort(q, q + e.count);
+  size_t i = (size_t) floor(e.p * (e.count - 1) + 0.5);
+  return q[i];
+}
+
+/**
+ * Returns a standard normal deviate (the Box-Muller transform).
+ */
+static double normal_deviate(unsigned short seed[3]) {
+  double u;
+  do {
+    u = erand48(seed);
+  } while (u <= 0);
+  return sqrt(-2 * log(u)) * cos(2 * M_PI * erand48(seed));
+}
+
+/**
+ * Converts a standard normal deviate into a value of a parameter.
+ */
+static double param_value(const VPOP_PARAM &vp, double z) {
+  switch (vp.dist) {
+  case DIST_LOGNORMAL: {
+    /* The mean and standard deviation of the log of the parameter. */
+    double s2 = log(1 + (vp.b * vp.b) / (vp.a * vp.a));
+    double mu = log(vp.a) - s2 / 2;
+    return exp(mu + sqrt(s2) * z);
+  }
+  case DIST_UNIFORM:
+    /* The standard normal distribution function. */
+    return vp.a + (vp.b - vp.a) * 0.5 * erfc(- z / sqrt(2.0));
+  default:
+    return vp.a + vp.b * z;
+  }
+}
+
+/**
+ * Samples the parameter values of a patient.
+ */
+static vector<double> sample_patient(VPOP &pop) {
+  size_t d = pop.params.size();
+  vector<double> z(d), values(d);
+  for (size_t i = 0; i < d; i++) {
+    z[i] = normal_deviate(pop.seed);
+  }
+  /* Correlate the deviates (the factor is lower triangular). */
+  for (size_t i = 0; i < d; i++) {
+    double zc = 0;
+    for (size_t j = 0; j <= i; j++) {
+      zc += pop.chol[i * d + j] * z[j];
+    }
+    values[i] = param_value(pop.params[i], zc);
+  }
+  return values;
+}
+
+/**
+ * Calculates the Cholesky factor of a correlation matrix, in place.
+ *
+ * @return \c true if the matrix is positive definite, otherwise \c false.
+ */
+static bool cholesky(vector<double> &a, size_t d) {
+  for (size_t j = 0; j < d; j++) {
+    double s = a[j * d + j];
+    for (size_t k = 0; k < j; k++) {
+      s -= a[j * d + k] * a[j * d + k];
+    }
+    if (s <= 0) {
+      return false;
+    }
+    a[j * d + j] = sqrt(s);
+    for (size_t i = j + 1; i < d; i++) {
+      double t = a[i * d + j];
+      for (size_t k = 0; k < j; k++) {
+        t -= a[i * d + k] * a[j * d + k];
+      }
+      a[i * d + j] = t / a[j * d + j];
+    }
+    for (size_t i = 0; i < j; i++) {
+      a[i * d + j] = 0;
+    }
+  }
+  return true;
+}
+
+/**
+ * Returns the position of the named parameter in the population, or -1 if
+ * the population does not include this parameter.
+ */
+static int find_param(const VPOP &pop, const string &name) {
+  for (size_t i = 0; i < pop.params.size(); i++) {
+    if (pop.params[i].name == name) {
+      return (int) i;
+    }
+  }
+  return -1;
+}
+
+/**
+ * Reads the distribution of each parameter, and any correlations between
+ * them, from a population file.
+ *
+ * @param[in,out] pop The virtual population.
+ * @param[in] file The population file.
+ *
+ * @return \c true if the file was read successfully, otherwise \c false.
+ */
+static bool read_population(VPOP &pop, const char *file) {
+  ifstream input(file);
+  if (input.fail()) {
+    cerr << "ERROR: Unable to open population: '" << file << "'" << endl;
+    return false;
+  }
+
+  string row;
+  vector<string> pairs;
+  vector<double> corrs;
+  while (getline(input, row)) {
+    size_t start = row.find_first_not_of(" \t\r\n");
+    if (start == string::npos || row[start] == '#') {
+      continue;
+    }
+    istringstream fields(row);
+    string name, kind;
+    fields >> name;
+    if (name == "corr") {
+      string other;
+      double r;
+      if (! (fields >> kind >> other >> r) || fabs(r) >= 1) {
+        cerr << "ERROR: Invalid correlation in '" << file << "': '" << row
+             << "'" << endl;
+        return false;
+      }
+      pairs.push_back(kind);
+      pairs.push_back(other);
+      corrs.push_back(r);
+      continue;
+    }
+
+    VPOP_PARAM vp;
+    vp.name = name;
+    vp.index = param_index(name.c_str());
+    if (vp.index < 0) {
+      cerr << "ERROR: Unknown parameter in '" << file << "': '" << name
+           << "'" << endl;
+      return false;
+    }
+    if (find_param(pop, name) >= 0) {
+      cerr << "ERROR: Repeated parameter in '" << file << "': '" << name
+           << "'" << endl;
+      return false;
+    }
+    bool ok = (fields >> kind >> vp.a >> vp.b);
+    if (kind == "normal") {
+      vp.dist = DIST_NORMAL;
+      ok = ok && vp.b >= 0;
+    } else if (kind == "lognormal") {
+      vp.dist = DIST_LOGNORMAL;
+      ok = ok && vp.a > 0 && vp.b >= 0;
+    } else if (kind == "uniform") {
+      vp.dist = DIST_UNIFORM;
+      ok = ok && vp.a < vp.b;
+    } else {
+      ok = false;
+    }
+    if (! ok) {
+      cerr << "ERROR: Invalid distribution in '" << file << "': '" << row
+           << "'" << endl;
+      return false;
+    }
+    pop.params.push_back(vp);
+    pop.pix.push_back(vp.index);
+  }
+
+  size_t d = pop.params.size();
+  if (d == 0) {
+    cerr << "ERROR: No parameters in '" << file << "'" << endl;
+    return false;
+  }
+  pop.chol.assign(d * d, 0.0);
+  for (size_t i = 0; i < d; i++) {
+    pop.chol[i * d + i] = 1;
+  }
+  for (size_t c = 0; c < corrs.size(); c++) {
+    int i = find_param(pop, pairs[2 * c]);
+    int j = find_param(pop, pairs[2 * c + 1]);
+    if (i < 0 || j < 0 || i == j) {
+      cerr << "ERROR: Invalid correlation in '" << file << "': '"
+           << pairs[2 * c] << "' and '" << pairs[2 * c + 1] << "'" << endl;
+      return false;
+    }
+    pop.chol[i * d + j] = corrs[c];
+    pop.chol[j * d + i] = corrs[c];
+  }
+  if (! cholesky(pop.chol, d)) {
+    cerr << "ERROR: The correlations in '" << file << "' are not positive "
+         << "definite" << endl;
+    return false;
+  }
+  return true;
+}
+
+/**
+ * Simulates the model for a single patient of a chunk (see batch_run()).
+ */
+static void simulate_job(void *data, size_t index) {
+  VPOP_PATIENTS_CHUNK *chunk = (VPOP_PATIENTS_CHUNK *) data;
+  const VPOP &pop = *chunk->pop;
+  const vector<double> &x = chunk->x[index];
+  vector<double> &y = chunk->y[index];
+  y.resize(pop.times.size() * pop.handles.size());
+  bool ok = batch_simulate(pop.start, &pop.pix[0], &x[0], (int) x.size(),
+                           &pop.times[0], pop.times.size(), &pop.handles[0],
+                           (int) pop.handles.size(), &y[0]);
+  for (size_t j = 0; j < y.size(); j++) {
+    ok = ok && y[j] == y[j] && fabs(y[j]) < HUGE_VAL;
+  }
+  chunk->ok[index] = ok;
+}
+
+/**
+ * Offers a patient to the reservoir, which keeps it with a probability that
+ * ensures every patient is equally likely to be kept.
+ */
+static void reservoir_offer(RESERVOIR &res, unsigned long id,
+                            const vector<double> &x,
+                            const vector<double> &y) {
+  unsigned long slot = res.seen++;
+  if (slot >= res.size) {
+    slot = (unsigned long) (erand48(res.seed) * res.seen);
+    if (slot >= res.size) {
+      return;
+    }
+  } else {
+    res.ids.push_back(0);
+    res.x.push_back(x);
+    res.y.push_back(y);
+  }
+  res.ids[slot] = id;
+  res.x[slot] = x;
+  res.y[slot] = y;
+}
+
+/**
+ * Writes the trajectories of the patients in the reservoir, with one row
+ * for each patient at each sample time.
+ *
+ * @return \c true if the trajectories were written, otherwise \c false.
+ */
+static bool reservoir_write(const RESERVOIR &res, const VPOP &pop,
+                            const char *file) {
+  ofstream out(file);
+  if (out.fail()) {
+    cerr << "ERROR: Unable to write trajectories: '" << file << "'" << endl;
+    return false;
+  }
+  out.precision(10);
+  out << "patient t";
+  for (size_t i = 0; i < pop.params.size(); i++) {
+    out << " " << pop.params[i].name;
+  }
+  for (size_t j = 0; j < pop.outputs.size(); j++) {
+    out << " " << pop.outputs[j];
+  }
+  out << endl;
+
+  /* The patients are written in the order in which they were sampled. */
+  vector<pair<unsigned long, size_t> > order;
+  for (size_t r = 0; r < res.ids.size(); r++) {
+    order.push_back(make_pair(res.ids[r], r));
+  }
+  sort(order.begin(), order.end());
+  size_t k = pop.handles.size();
+  for (size_t o = 0; o < order.size(); o++) {
+    size_t r = order[o].second;
+    for (size_t i = 0; i < pop.times.size(); i++) {
+      out << res.ids[r] << " " << pop.times[i];
+      for (size_t j = 0; j < res.x[r].size(); j++) {
+        out << " " << res.x[r][j];
+      }
+      for (size_t j = 0; j < k; j++) {
+        out << " " << res.y[r][i * k + j];
+      }
+      out << endl;
+    }
+  }
+  return ! out.fail();
+}
+
+/**
+ * Simulates every patient of the population, in chunks, and prints the
+ * summary of each model output at each sample time.
+ *
+ * @param[in,out] pop The virtual population.
+ * @param[in] patients The number of patients.
+ * @param[in,out] res The reservoir of patient trajectories (may be \c NULL).
+ */
+static void simulate_population(VPOP &pop, unsigned long patients,
+                                RESERVOIR *res) {
+  size_t m = pop.times.size() * pop.handles.size();
+  size_t nq = pop.quantiles.size();
+  vector<MOMENTS> moments(m);
+  vector<P2> quants(m * nq);
+  for (size_t c = 0; c < m; c++) {
+    moments[c].n = 0;
+    moments[c].mean = 0;
+    moments[c].m2 = 0;
+    for (size_t q = 0; q < nq; q++) {
+      p2_init(quants[c * nq + q], pop.quantiles[q]);
+    }
+  }
+  unsigned long used = 0;
+
+  for (unsigned long done = 0; done < patients; done += VPOP_CHUNK) {
+    unsigned long n = patients - done;
+    n = (n < VPOP_CHUNK) ? n : VPOP_CHUNK;
+
+    /* The patients are sampled, and their outputs are summarised, in the
+       same order regardless of the number of worker threads. */
+    VPOP_PATIENTS_CHUNK chunk;
+    chunk.pop = &pop;
+    for (unsigned long r = 0; r < n; r++) {
+      chunk.x.push_back(sample_patient(pop));
+    }
+    chunk.y.assign(n, vector<double>());
+    chunk.ok.assign(n, false);
+    batch_run(n, pop.threads, simulate_job, &chunk);
+
+    for (unsigned long r = 0; r < n; r++) {
+      if (! chunk.ok[r]) {
+        continue;
+      }
+      used++;
+      const vector<double> &y = chunk.y[r];
+      for (size_t c = 0; c < m; c++) {
+        moments_add(moments[c], y[c]);
+        for (size_t q = 0; q < nq; q++) {
+          p2_add(quants[c * nq + q], y[c]);
+        }
+      }
+      if (res) {
+        reservoir_offer(*res, done + r, chunk.x[r], y);
+      }
+    }
+  }
+
+  if (used < patients) {
+    cerr << "WARNING: " << patients - used << " of " << patients
+         << " patients failed" << endl;
+  }
+
+  cout << "t output n mean sd";
+  for (size_t q = 0; q < nq; q++) {
+    cout << " q" << pop.quantiles[q];
+  }
+  cout << endl;
+  size_t k = pop.handles.size();
+  for (size_t i = 0; i < pop.times.size(); i++) {
+    for (size_t j = 0; j < k; j++) {
+      size_t c = i * k + j;
+      cout << pop.times[i] << " " << pop.outputs[j] << " " << used << " "
+           << moments[c].mean << " " << sqrt(moments_var(moments[c]));
+      for (size_t q = 0; q < nq; q++) {
+        cout << " " << p2_value(quants[c * nq + q]);
+      }
+      cout << endl;
+    }
+  }
+}
+
+/**
+ * The entry point for the virtual population program.
+ *
+ * @param[in] argc The number of arguments on the command line.
+ * @param[in] argv The arguments provided on the command line.
+ */
+int main(int argc, char *argv[]) {
+  VPOP pop;
+  pop.threads = batch_threads();
+  double t_warm = -1;
+  bool exact = false;
+  long patients = VPOP_PATIENTS;
+  unsigned long seed = 1;
+  long keep = 0;
+  string keep_file;
+
+  int c;
+  while ((c = getopt(argc, argv, "hxo:n:q:r:s:w:j:")) != -1) {
+    istringstream ss((optarg) ? optarg : "");
+    vector<string> fields;
+    switch (c) {
+    case 'o':
+      fields = split_fields(optarg, ',');
+      for (size_t i = 0; i < fields.size(); i++) {
+        int h = guyton92_handle(fields[i].c_str());
+        if (h < 0) {
+          cerr << "ERROR: Unknown output: '" << fields[i] << "'" << endl;
+          usage(argv[0], EXIT_FAILURE);
+        }
+        pop.outputs.push_back(fields[i]);
+        pop.handles.push_back(h);
+      }
+      break;
+    case 'n':
+      if (! (ss >> patients) || patients < 1) {
+        cerr << "ERROR: Invalid number of patients: '" << optarg << "'"
+             << endl;
+        usage(argv[0], EXIT_FAILURE);
+      }
+      break;
+    case 'q':
+      fields = split_fields(optarg, ',');
+      pop.quantiles.clear();
+      for (size_t i = 0; i < fields.size(); i++) {
+        double q;
+        if (! read_number(fields[i], q) || q <= 0 || q >= 1) {
+          cerr << "ERROR: Invalid quantile: '" << fields[i] << "'" << endl;
+          usage(argv[0], EXIT_FAILURE);
+        }
+        pop.quantiles.push_back(q);
+      }
+      break;
+    case 'r':
+      fields = split_fields(optarg, ':');
+      ss.str((fields.size() == 2) ? fields[0] : "");
+      if (fields.size() != 2 || ! (ss >> keep) || keep < 1
+          || fields[1].empty()) {
+        cerr << "ERROR: Invalid trajectories: '" << optarg << "'" << endl;
+        usage(argv[0], EXIT_FAILURE);
+      }
+      keep_file = fields[1];
+      break;
+    case 's':
+      if (! (ss >> seed)) {
+        cerr << "ERROR: Invalid seed: '" << optarg << "'" << endl;
+        usage(argv[0], EXIT_FAILURE);
+      }
+      break;
+    case 'w':
+      if (! read_number(optarg, t_warm) || t_warm < 0) {
+        cerr << "ERROR: Invalid warm-start time: '" << optarg << "'" << endl;
+        usage(argv[0], EXIT_FAILURE);
+      }
+      break;
+    case 'x':
+      exact = true;
+      break;
+    case 'j':
+      if (! (ss >> pop.threads) || pop.threads < 1) {
+        cerr << "ERROR: Invalid number of jobs: '" << optarg << "'" << endl;
+        usage(argv[0], EXIT_FAILURE);
+      }
+      break;
+    case 'h':
+      usage(argv[0], EXIT_SUCCESS);
+      break;
+    default:
+      usage(argv[0], EXIT_FAILURE);
+      break;
+    }
+  }
+  if (optind != argc - 2 || pop.outputs.empty()) {
+    usage(argv[0], EXIT_FAILURE);
+  }
+  if (pop.quantiles.empty()) {
+    pop.quantiles.push_back(0.05);
+    pop.quantiles.push_back(0.5);
+    pop.quantiles.push_back(0.95);
+  }
+  if (! read_population(pop, argv[optind])) {
+    return EXIT_FAILURE;
+  }
+
+  /* Simulate the experiment up to the warm-start time, once. */
+  pop.start = batch_start(argv[optind + 1], t_warm, exact);
+  if (! pop.start) {
+    return EXIT_FAILURE;
+  }
+  batch_check_schedule(pop.start, &pop.pix[0], (int) pop.pix.size());
+
+  /* Summarise the outputs at every output time from the warm-start time. */
+  istringstream exp(pop.start->exp);
+  Experiment e(pop.start->p, exp);
+  const double *times = e.output_times();
+  for (size_t i = 0; times[i] <= pop.start->stop; i++) {
+    if (times[i] >= pop.start->v.t) {
+      pop.times.push_back(times[i]);
+    }
+  }
+  delete[] times;
+  if (pop.times.empty()) {
+    cerr << "ERROR: There are no output times after the warm-start time "
+         << "(t = " << pop.start->v.t << ")" << endl;
+    return EXIT_FAILURE;
+  }
+
+  pop.seed[0] = 0x330E;
+  pop.seed[1] = (unsigned short) seed;
+  pop.seed[2] = (unsigned short) (seed >> 16);
+
+  /* The reservoir has its own random numbers, so that keeping trajectories
+     does not change the patients that are sampled. */
+  RESERVOIR res;
+  res.size = (size_t) keep;
+  res.seen = 0;
+  res.seed[0] = 0x5DEE;
+  res.seed[1] = (unsigned short) seed;
+  res.seed[2] = (unsigned short) (seed >> 16);
+
+  simulate_population(pop, (unsigned long) patients, (keep) ? &res : NULL);
+  if (keep && ! reservoir_write(res, pop, keep_file.c_str())) {
+    delete pop.start;
+    return EXIT_FAILURE;
+  }
+
+  delete pop.start;
+  return EXIT_SUCCESS;
+}
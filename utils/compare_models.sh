@@ -0,0 +1,147 @@
+#!/bin/bash
+#
+# compare_models.sh
+#
+# Compares the outputs of each experiment when simulated by two builds of the
+# model (eg, with different compiler optimisations).
+#
+
+usage() {
+  cat <<EOF
+
+  USAGE       `basename $0` [-t seconds] [-e tolerance] model1 model2
+                [experiment ...]
+
+  Runs each experiment (by default, every experiment in the exps directory)
+  with both models, and reports the largest difference in each experiment,
+  relative to the range of the output variable in which it occurs, and the
+  variable and time at which it occurs. The time-steps end exactly at each
+  output time (see the --exact option of the model), so that both models
+  report the same times.
+
+  Note that the model is sensitive to small perturbations, so that even
+  changes in rounding can lead to visible differences in rapidly varying
+  outputs; compare these differences to the range of the outputs over time.
+
+  OPTIONS
+    -t        The maximum run time of each simulation (default: 600 s).
+              Simulations that exceed this time are reported as such.
+    -e        The largest relative difference that is accepted. If given,
+              the exit status is non-zero when any experiment exceeds this
+              difference, or when only one of the models fails (or exceeds
+              the maximum run time).
+EOF
+  exit 1
+}
+
+# The maximum run time of each simulation.
+TIMEOUT=600
+# The largest relative difference that is accepted (if any).
+TOLERANCE=
+
+while getopts "t:e:" OPT; do
+  case ${OPT} in
+  t) TIMEOUT="${OPTARG}" ;;
+  e) TOLERANCE="${OPTARG}" ;;
+  ?) usage ;;
+  esac
+done
+shift $(( OPTIND - 1 ))
+
+if [ "$#" -lt "2" ]; then
+  usage
+fi
+MODEL1="$1"
+MODEL2="$2"
+shift 2
+
+# The root directory of the repository.
+ROOT=`dirname $0`/".."
+
+# Default to every experiment.
+if [ "$#" = "0" ]; then
+  set -- ${ROOT}/exps/*.exp
+fi
+
+for MODEL in "${MODEL1}" "${MODEL2}"; do
+  if [ ! -x "${MODEL}" ]; then
+    echo "ERROR: unable to run ${MODEL}."
+    exit 2
+  fi
+done
+
+TMP_DIR=`mktemp -d`
+trap "rm -rf ${TMP_DIR}" EXIT
+
+# The number of experiments whose outputs differ.
+FAILED=0
+
+printf "%-20s %8s %8s %12s %10s %10s\n" "experiment" "time 1" "time 2" \
+  "max diff" "variable" "at time"
+for EXP in "$@"; do
+  NAME=`basename ${EXP} .exp`
+  START=`date +%s.%N`
+  timeout ${TIMEOUT} ${MODEL1} -N -n -x ${EXP} > ${TMP_DIR}/1.out 2>/dev/null
+  STATUS1=$?
+  MID=`date +%s.%N`
+  timeout ${TIMEOUT} ${MODEL2} -N -n -x ${EXP} > ${TMP_DIR}/2.out 2>/dev/null
+  STATUS2=$?
+  END=`date +%s.%N`
+  if [ "${STATUS1}" != "${STATUS2}" ]; then
+    printf "%-20s %s\n" "${NAME}" \
+      "(the exit status differs: ${STATUS1} and ${STATUS2})"
+    FAILED=$(( FAILED + 1 ))
+    continue
+  fi
+  if [ "${STATUS1}" = "124" ]; then
+    printf "%-20s %s\n" "${NAME}" "(exceeded ${TIMEOUT} s)"
+    continue
+  fi
+  TIME1=`awk "BEGIN { print ${MID} - ${START} }"`
+  TIME2=`awk "BEGIN { print ${END} - ${MID} }"`
+
+  # Compare the rows of the two outputs, which report the same times.
+  paste -d ' ' ${TMP_DIR}/1.out ${TMP_DIR}/2.out |
+    awk -v name="${NAME}" -v t1="${TIME1}" -v t2="${TIME2}" \
+        -v tol="${TOLERANCE}" '
+      NR == 1 { n = NF / 2; for (i = 1; i <= n; i++) { var[i] = $i; } next; }
+      NF != 2 * n || $1 != $(n + 1) { mismatch = 1; next; }
+      { rows++;
+        for (i = 2; i <= n; i++) {
+          a = $i; b = $(n + i);
+          if (rows == 1 || a < lo[i]) { lo[i] = a; }
+          if (rows == 1 || a > hi[i]) { hi[i] = a; }
+          d = (a > b) ? a - b : b - a;
+          if (d > diff[i]) { diff[i] = d; when[i] = $1; }
+        } }
+      END {
+        worst = 0;
+        for (i = 2; i <= n; i++) {
+          range = hi[i] - lo[i];
+          if (range <= 0) { range = (hi[i] > 0) ? hi[i] : -hi[i]; }
+          rel = (range > 0) ? diff[i] / range : diff[i];
+          if (worst == 0 || rel > max) { worst = i; max = rel; }
+        }
+        if (mismatch) {
+          printf "%-20s %s\n", name, "(the output times differ)";
+          exit 1;
+        } else if (worst == 0) {
+          printf "%-20s %s\n", name, "(no outputs)";
+        } else if (max == 0) {
+          printf "%-20s %8.2f %8.2f %12.3g %10s %10s\n", name, t1, t2,
+            0, "-", "-";
+        } else {
+          printf "%-20s %8.2f %8.2f %12.3g %10s %10s\n", name, t1, t2,
+            max, var[worst], when[worst];
+          if (tol != "" && max > tol) { exit 1; }
+        } }'
+  if [ "$?" != "0" ]; then
+    FAILED=$(( FAILED + 1 ))
+  fi
+done
+
+if [ -n "${TOLERANCE}" -a "${FAILED}" != "0" ]; then
+  echo "ERROR: the outputs of ${FAILED} experiment(s) differ (tolerance:" \
+    "${TOLERANCE})."
+  exit 1
+fi
@@ -0,0 +1,100 @@
+#!/bin/bash
+#
+# daemon_check.sh
+#
+# Checks that jobs run by the simulation daemon (guyton92d) produce the same
+# outputs as the model binary (guyton92), when each job follows a job that
+# shares its initial state but not its inputs (see src/baseline.cpp).
+#
+
+usage() {
+  cat <<EOF
+
+  USAGE       `basename $0` [-t seconds]
+
+  Builds the model, the daemon and its client, starts a daemon that runs
+  one job at a time, and submits pairs of experiments that differ only in
+  their model variant or continuous inputs. The output of each job must be
+  identical to that of the model binary.
+
+  OPTIONS
+    -t        The maximum run time of each simulation (default: 60 s).
+EOF
+  exit 1
+}
+
+# The maximum run time of each simulation.
+TIMEOUT=60
+
+while getopts "t:" OPT; do
+  case ${OPT} in
+  t) TIMEOUT="${OPTARG}" ;;
+  ?) usage ;;
+  esac
+done
+shift $(( OPTIND - 1 ))
+if [ $# -ne 0 ]; then
+  usage
+fi
+
+# The root directory of the repository.
+ROOT=`cd \`dirname $0\`/".." && pwd`
+MODEL="${ROOT}/build/guyton92"
+DAEMON="${ROOT}/build/guyton92d"
+CLIENT="${ROOT}/build/guyton92c"
+
+if ! make -s -C "${ROOT}" build/guyton92 build/guyton92d build/guyton92c; then
+  echo "ERROR: unable to build the model and the daemon."
+  exit 2
+fi
+
+# The experiments and the daemon socket are kept in a private directory.
+WORK_DIR=`mktemp -d`
+export GUYTON92_SOCKET="${WORK_DIR}/daemon.sock"
+"${DAEMON}" -j 1 2>"${WORK_DIR}/daemon.log" &
+DAEMON_PID=$!
+trap 'kill ${DAEMON_PID} 2>/dev/null; rm -rf "${WORK_DIR}"' EXIT
+for i in `seq 50`; do
+  [ -S "${GUYTON92_SOCKET}" ] && break
+  sleep 0.1
+done
+
+# Each pair of experiments shares its initial state and first output time.
+cat > "${WORK_DIR}/vanilla_1.exp" <<EOF
+o= pa vud
+t= 2000
+t= 2100
+EOF
+cat > "${WORK_DIR}/ramp_2.exp" <<EOF
+o= pa vud
+ramp= nid 0 0.1 1500 0.5
+t= 2000
+t= 2100
+EOF
+cat > "${WORK_DIR}/vanilla_3.exp" <<EOF
+o= pa vud
+t= 40400
+t= 40500
+EOF
+cat > "${WORK_DIR}/variant_4.exp" <<EOF
+o= pa vud
+variant= uttamsingh2
+t= 40400
+t= 40500
+EOF
+
+FAILED=0
+cd "${WORK_DIR}"
+for EXP in vanilla_1 ramp_2 vanilla_3 variant_4; do
+  timeout "${TIMEOUT}" "${MODEL}" -N "${EXP}.exp" > "${EXP}.model" 2>&1
+  timeout "${TIMEOUT}" "${CLIENT}" -N "${EXP}.exp" > "${EXP}.daemon" 2>&1
+  if cmp -s "${EXP}.model" "${EXP}.daemon"; then
+    echo "${EXP}: OK"
+  else
+    echo "${EXP}: FAILED"
+    diff "${EXP}.model" "${EXP}.daemon"
+    FAILED=1
+  fi
+done
+
+exit ${FAILED}
@@ -0,0 +1,58 @@
+#!/bin/bash
+#
+# fastmath_report.sh
+#
+# Compares the outputs of each experiment when the model is built with and
+# without the fast approximations of the power and exponential functions
+# (see src/fastmath.h).
+#
+
+usage() {
+  cat <<EOF
+
+  USAGE       `basename $0` [-t seconds] [experiment ...]
+
+  Builds the model with and without FASTMATH=1, runs each experiment (by
+  default, every experiment in the exps directory) with both models, and
+  reports the largest difference in each experiment (see compare_models.sh).
+
+  OPTIONS
+    -t        The maximum run time of each simulation (default: 600 s).
+              Simulations that exceed this time are reported as such.
+EOF
+  exit 1
+}
+
+# The maximum run time of each simulation.
+TIMEOUT=600
+
+while getopts "t:" OPT; do
+  case ${OPT} in
+  t) TIMEOUT="${OPTARG}" ;;
+  ?) usage ;;
+  esac
+done
+shift $(( OPTIND - 1 ))
+
+# The root directory of the repository.
+ROOT=`dirname $0`/".."
+# The models built without and with the fast approximations.
+MODEL="${ROOT}/build/guyton92"
+FAST_DIR="${ROOT}/build/fastmath"
+FAST_MODEL="${FAST_DIR}/guyton92"
+
+# Build both models.
+mkdir -p "${FAST_DIR}"
+if ! make -s -C "${ROOT}" model; then
+  echo "ERROR: unable to build the model."
+  exit 2
+fi
+if ! make -s -C "${ROOT}" FASTMATH=1 BUILD_DIR=build/fastmath \
+    build/fastmath/guyton92; then
+  echo "ERROR: unable to build the model with FASTMATH=1."
+  exit 2
+fi
+
+# Compare the outputs of both models.
+exec "${ROOT}/utils/compare_models.sh" -t "${TIMEOUT}" "${MODEL}" \
+  "${FAST_MODEL}" "$@"
@@ -0,0 +1,136 @@
+#!/bin/bash
+#
+# mixed_report.sh
+#
+# Compares the outputs of each experiment when the model equations are
+# evaluated in double precision and in single precision (see src/scalar.h),
+# and reports the drift of each output variable.
+#
+
+usage() {
+  cat <<EOF
+
+  USAGE       `basename $0` [-t seconds] [-e tolerance] [-m model]
+                [experiment ...]
+
+  Runs each experiment (by default, every experiment in the exps directory)
+  in double precision and in single precision (the --float option of the
+  model), and reports the drift of each output variable: the largest
+  difference between the two simulations, relative to the range of the
+  output variable over time (as per compare_models.sh). The time-steps end
+  exactly at each output time, so that both simulations report the same
+  times.
+
+  Each output variable is reported as "safe" when its drift does not exceed
+  the tolerance in any experiment. The scheduled changes are applied in
+  double precision, but model variants and the experiments that intervene
+  in the model are not defined in single precision, and the experiments
+  that require them are reported as unsupported.
+
+  OPTIONS
+    -t        The maximum run time of each simulation (default: 600 s).
+              Simulations that exceed this time are reported as such.
+    -e        The largest relative drift of a safe output (default: 0.01).
+    -m        The model binary (default: build/guyton92).
+EOF
+  exit 1
+}
+
+# The maximum run time of each simulation.
+TIMEOUT=600
+# The largest relative drift of a safe output.
+TOLERANCE=0.01
+# The root directory of the repository.
+ROOT=`dirname $0`/".."
+# The model binary.
+MODEL="${ROOT}/build/guyton92"
+
+while getopts "t:e:m:" OPT; do
+  case ${OPT} in
+  t) TIMEOUT="${OPTARG}" ;;
+  e) TOLERANCE="${OPTARG}" ;;
+  m) MODEL="${OPTARG}" ;;
+  ?) usage ;;
+  esac
+done
+shift $(( OPTIND - 1 ))
+
+# Default to every experiment.
+if [ "$#" = "0" ]; then
+  set -- ${ROOT}/exps/*.exp
+fi
+
+if [ ! -x "${MODEL}" ]; then
+  echo "ERROR: unable to run ${MODEL}."
+  exit 2
+fi
+
+TMP_DIR=`mktemp -d`
+trap "rm -rf ${TMP_DIR}" EXIT
+
+# The drift of each output variable in each experiment.
+DRIFTS="${TMP_DIR}/drifts"
+touch "${DRIFTS}"
+
+for EXP in "$@"; do
+  NAME=`basename ${EXP} .exp`
+  timeout ${TIMEOUT} ${MODEL} -N -n -x ${EXP} > ${TMP_DIR}/1.out 2>/dev/null
+  STATUS1=$?
+  timeout ${TIMEOUT} ${MODEL} -N -n -x -F ${EXP} > ${TMP_DIR}/2.out \
+    2>${TMP_DIR}/2.err
+  STATUS2=$?
+  if [ "${STATUS1}" = "124" -o "${STATUS2}" = "124" ]; then
+    echo "${NAME}: (exceeded ${TIMEOUT} s)" >&2
+    continue
+  fi
+  if grep -q "only defined in double precision" ${TMP_DIR}/2.err; then
+    echo "${NAME}: (not supported in single precision)" >&2
+    continue
+  fi
+  if [ "${STATUS1}" != "${STATUS2}" ]; then
+    echo "${NAME}: (the exit status differs: ${STATUS1} and ${STATUS2})" >&2
+    echo "${NAME} * failed -" >> "${DRIFTS}"
+    continue
+  fi
+
+  # Compare the rows of the two outputs, which report the same times.
+  paste -d ' ' ${TMP_DIR}/1.out ${TMP_DIR}/2.out |
+    awk -v name="${NAME}" '
+      NR == 1 { n = NF / 2; for (i = 1; i <= n; i++) { var[i] = $i; } next; }
+      NF != 2 * n || $1 != $(n + 1) { mismatch = 1; next; }
+      { rows++;
+        for (i = 2; i <= n; i++) {
+          a = $i; b = $(n + i);
+          if (rows == 1 || a < lo[i]) { lo[i] = a; }
+          if (rows == 1 || a > hi[i]) { hi[i] = a; }
+          d = (a > b) ? a - b : b - a;
+          if (d > diff[i]) { diff[i] = d; when[i] = $1; }
+        } }
+      END {
+        if (mismatch) {
+          printf "%s * failed -\n", name;
+          exit;
+        }
+        for (i = 2; i <= n; i++) {
+          range = hi[i] - lo[i];
+          if (range <= 0) { range = (hi[i] > 0) ? hi[i] : -hi[i]; }
+          rel = (range > 0) ? diff[i] / range : diff[i];
+          printf "%s %s %g %s\n", name, var[i], rel,
+            (rel > 0) ? when[i] : "-";
+        } }' >> "${DRIFTS}"
+done
+
+# Report the largest drift of each output variable over every experiment,
+# and whether it is safe.
+printf "%-12s %12s %-20s %10s %s\n" "variable" "max drift" "experiment" \
+  "at time" "safe"
+awk -v tol="${TOLERANCE}" '
+  $2 == "*" { failed[$1] = 1; next; }
+  ! ($2 in worst) || $3 > worst[$2] {
+    worst[$2] = $3; where[$2] = $1; when[$2] = $4; }
+  END {
+    for (e in failed) { printf "%-12s %s\n", "*", "(" e " failed)"; }
+    for (v in worst) {
+      printf "%-12s %12.3g %-20s %10s %s\n", v, worst[v], where[v], when[v],
+        (worst[v] <= tol) ? "yes" : "no";
+    } }' "${DRIFTS}" | sort
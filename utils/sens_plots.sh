@@ -69,20 +69,17 @@ fi
 # Run the analyses and plot the results.
 #
 
-# Run a sensitivity analysis for each line of the input file.
+# Run every sensitivity analysis in a single (parallel) invocation.
+${ANALYSE} -f ${INFILE} ${MODULE} "$@" || exit 1
+
+# Run the generated gnuplot script for each analysis to plot the results.
 while read LINE; do
     if [ `echo ${LINE} | awk '{ print NF }'` = 4 ]; then
         VAR_NAME=`echo ${LINE} | awk '{ print $1; }'`
 
-        # Run the sensitivity analysis.
-        ${ANALYSE} ${MODULE} ${LINE} "$@"
-
-        # Run the generated gnuplot script to plot the results.
         echo -n "${MODULE}_${VAR_NAME}.eps ... "
         GNUPLOT_SCRIPT=./${MODULE}_${VAR_NAME}.gp
         gnuplot < ${GNUPLOT_SCRIPT}
         echo done
-    else
-        echo "ERROR: skipping invalid line'"${LINE}"'."
     fi
 done < ${INFILE}